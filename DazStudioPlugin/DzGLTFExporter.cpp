@@ -2,36 +2,41 @@
 // Self-contained GLB (binary glTF 2.0) exporter for DazToUnity.
 // No external glTF library required.
 //
-// GLB layout:
-//   [12-byte header][JSON chunk][BIN chunk]
-//
-// Each chunk:
-//   uint32 chunkLength | uint32 chunkType | byte[chunkLength] data
-//
-// JSON chunkType = 0x4E4F534A ('JSON')
-// BIN  chunkType = 0x004E4942 ('BIN\0')
+// The Daz Studio half: scene snapshots and the export pipeline.  Expansion
+// and LODs are in GltfSceneBuilder, serialisation in GltfGlbWriter; neither
+// touches the SDK.
 
 #include "DzGLTFExporter.h"
+#include "GltfAnimationStream.h"
+#include "GltfHash.h"
+#include "GltfMeshSource.h"
+#include "GltfSceneBuilder.h"
+#include "GltfOcclusionCuller.h"
+#include "GltfTrace.h"
+#include "GltfMemory.h"
 
 #include <dznode.h>
 #include <dzobject.h>
+#include <dzmodifier.h>
 #include <dzshape.h>
 #include <dzmaterial.h>
 #include <dzimageproperty.h>
 #include <dzcolorproperty.h>
 #include <dznumericproperty.h>
 #include <dztexture.h>
+#include <dzskeleton.h>
+#include <dzbone.h>
+#include <dzscene.h>
 
 #include "dzfacetshape.h"
 #include "dzfacetmesh.h"
 #include "dzfacegroup.h"
 #include "dzmap.h"
 
-#include <QtCore/qfile.h>
-#include <QtCore/qfileinfo.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qtconcurrentrun.h>
 #include <QtGui/qcolor.h>
 
-#include <cfloat>
 #include <cmath>
 #include <cstring>
 
@@ -39,6 +44,50 @@
 //   DzPnt3  = typedef float DzPnt3[3]   (x==[0], y==[1], z==[2])
 //   DzPnt2  = typedef float DzPnt2[2]   (u==[0], v==[1])
 //   DzFacet fields: m_vertIdx[4], m_uvwIdx[4], m_normIdx[4]
+//   DzTime  = qint64 ticks, 4800 per second
+
+static const double kDazTicksPerSecond = 4800.0;
+
+// Fewer leaf nodes than this sharing a mesh stay ordinary nodes.
+static const int kMinGpuInstances = 2;
+
+// Animation frames sampled, besides the bind and current pose, when testing
+// which body triangles clothing hides.
+static const int kOcclusionPoseSamples = 8;
+
+// getProgress() after each stage of an export; writing takes it to 100.
+static const int kSnapshotProgress = 10;
+static const int kAssembleProgress = 40;
+static const int kLodProgress      = 60;
+
+// Only fully opaque materials hide what is under them.
+static bool isOpaque(const GltfPrimData& prim)
+{
+    return prim.baseColor[3] >= 0.999f && prim.opacity >= 0.999f
+        && prim.opacityTexturePath.isEmpty();
+}
+
+// Add @p mat of @p node, and the images behind its maps, to @p stats.
+static void countMaterial(DzNode* node, DzMaterial* mat, GltfSourceStats& stats)
+{
+    stats.materials.insert(node->getName() + "/" + mat->getName());
+    for (int i = 0; i < mat->getNumProperties(); ++i)
+    {
+        DzProperty* prop = mat->getProperty(i);
+        DzTexture* tex = 0;
+        if (DzImageProperty* img = qobject_cast<DzImageProperty*>(prop))
+            tex = img->getValue();
+        else if (DzNumericProperty* num = qobject_cast<DzNumericProperty*>(prop))
+            tex = num->getMapValue();
+        if (!tex || stats.textures.contains(tex->getFilename()))
+            continue;
+        stats.textures.insert(tex->getFilename());
+        // known to Daz once loaded; no image file is opened
+        QSize size = tex->getOriginalImageSize();
+        if (size.isValid())
+            stats.texturePixels += (qint64)size.width() * size.height();
+    }
+}
 
 // ---------------------------------------------------------------------------
 // Construction
@@ -46,190 +95,535 @@
 
 DzGLTFExporter::DzGLTFExporter()
     : m_fScale(0.01f)   // Daz cm -> glTF m
+    , m_bExportAnimation(false)
+    , m_nAnimationWindowFrames(0)
+    , m_bExportHierarchy(false)
+    , m_bExportSkin(false)
+    , m_bIncludeFittedItems(false)
+    , m_nSubdivisionLevel(0)
+    , m_bRemoveHiddenSurfaces(false)
+    , m_bSeparateHiddenSurfaces(true)
+    , m_nLastHiddenTris(0)
+    , m_bGpuInstancing(true)
+    , m_nLastUniqueMeshes(0)
+    , m_nLastInstancedNodes(0)
+    , m_bGenerateLods(false)
+    , m_pPendingExport(0)
+    , m_bExportRunning(false)
+    , m_bExportResult(false)
+{
+    m_writer.setProgressCounter(&m_progress);
+    m_writer.setCancelFlag(&m_cancel);
+}
+
+DzGLTFExporter::~DzGLTFExporter()
 {
+    cancelExport();
+    waitForExport();
+}
+
+void DzGLTFExporter::setBufferPool(GltfBufferPool* pool)
+{
+    waitForExport();
+    m_writer.setBufferPool(pool);
 }
 
 // ---------------------------------------------------------------------------
 // Public API
 // ---------------------------------------------------------------------------
 
+/// Everything the background half of an export needs, copied out of the
+/// scene on the UI thread.  Holds no SDK pointers, so the user can go on
+/// editing the scene while it is encoded and written.
+struct DzGLTFExporter::PendingExport
+{
+    QString                    outputPath;
+    bool                       hierarchy;   // snapshotHierarchy(): node meshes index snaps
+    GltfSceneData              scene;       // nodes (bones, or the whole tree) so far
+    QVector<GltfMeshSnapshot>  snaps;       // figure first, then fitted items; or one per distinct mesh
+    QVector<quint64>           meshHashes;  // hierarchy: content hash of each snapshot
+    GltfSkinData               skin;        // used if any snapshot is skinned
+    bool                       cullHidden;
+    QVector< QVector<float> >  poses;       // skin poses for the occlusion test
+    bool                       reduceKeys;
+    QVector<GltfAnimChannel>   channels;    // sampled, not yet reduced
+    GltfAnimationStream*       stream;      // long takes: keys already fitted, on disk
+    GltfMemoryHold             primBytes;   // scene.prims, as last counted
+
+    PendingExport()
+        : hierarchy(false), cullHidden(false), reduceKeys(false), stream(0)
+        , primBytes(GltfMemoryPrimitives) {}
+    ~PendingExport() { delete stream; }
+};
+
+/// GltfMeshSource over DzNodes: facet geometry scaled to output units,
+/// relative to an optional pivot, with materials from each node's shape.
+struct DzGLTFExporter::NodeSource : public GltfMeshSource
+{
+    const DzGLTFExporter& exporter;
+    QVector<DzNode*>      nodes;
+    const float*          pivot;     // subtracted before scaling; null for none
+    GltfSourceStats*      stats;     // counted into while reading; null for none
+
+    explicit NodeSource(const DzGLTFExporter& e, const float* p = 0)
+        : exporter(e), pivot(p), stats(0) {}
+
+    int meshCount() const { return nodes.size(); }
+
+    bool readGeometry(int mesh, GltfMeshSnapshot& outSnap)
+    {
+        DzNode* node = nodes[mesh];
+        DzObject* obj = node->getObject();
+        if (!obj) {
+            m_sLastError = "readGeometry: node has no object";
+            return false;
+        }
+
+        DzShape* shape = obj->getCurrentShape();
+        DzFacetShape* facetShape = qobject_cast<DzFacetShape*>(shape);
+        if (!facetShape) {
+            m_sLastError = "readGeometry: shape is not a DzFacetShape";
+            return false;
+        }
+
+        DzFacetMesh* fm = facetShape->getFacetMesh();
+        if (!fm || fm->getNumVertices() == 0) {
+            m_sLastError = "readGeometry: no facet mesh / empty mesh";
+            return false;
+        }
+
+        outSnap.name = node->getLabel().isEmpty() ? node->getName() : node->getLabel();
+
+        // --- vertex positions ---
+        // DzPnt3 = typedef float DzPnt3[3]; access as srcPos[i][0..2]
+        // Hierarchy export writes geometry relative to the node's origin.
+        int numVerts = fm->getNumVertices();
+        const DzPnt3* srcPos = fm->getVerticesPtr();
+        const float scale = exporter.m_fScale;
+        const float px = pivot ? pivot[0] : 0.0f;
+        const float py = pivot ? pivot[1] : 0.0f;
+        const float pz = pivot ? pivot[2] : 0.0f;
+
+        outSnap.positions.resize(numVerts * 3);
+        float* pos = outSnap.positions.data();
+        for (int v = 0; v < numVerts; ++v) {
+            pos[v*3 + 0] = (srcPos[v][0] - px) * scale;
+            pos[v*3 + 1] = (srcPos[v][1] - py) * scale;
+            pos[v*3 + 2] = (srcPos[v][2] - pz) * scale;
+        }
+
+        // --- UV coordinates via DzMap (first UV set) ---
+        DzMap* uvMap = fm->getUVs();
+        if (uvMap && uvMap->getNumValues() > 0) {
+            int numUVs = uvMap->getNumValues();
+            outSnap.uvs.resize(numUVs * 2);
+            memcpy(outSnap.uvs.data(), uvMap->getPnt2ArrayPtr(), numUVs * sizeof(DzPnt2));
+        }
+
+        // --- facets ---
+        // DzFacet fields: m_vertIdx[4], m_uvwIdx[4]
+        int numFacets = fm->getNumFacets();
+        const DzFacet* facets = fm->getFacetsPtr();
+        outSnap.facetVerts.resize(numFacets * 4);
+        outSnap.facetUVs.resize(numFacets * 4);
+        qint64 numTris = 0;
+        for (int f = 0; f < numFacets; ++f) {
+            for (int k = 0; k < 4; ++k) {
+                outSnap.facetVerts[f*4 + k] = facets[f].m_vertIdx[k];
+                outSnap.facetUVs[f*4 + k]   = facets[f].m_uvwIdx[k];
+            }
+            numTris += (facets[f].m_vertIdx[3] < 0) ? 1 : 2;
+        }
+
+        // --- material groups; materials follow in readMaterial() ---
+        for (int g = 0; g < fm->getNumMaterialGroups(); ++g)
+        {
+            DzMaterialFaceGroup* group = fm->getMaterialGroup(g);
+            if (!group || group->count() == 0)
+                continue;
+
+            GltfMeshSnapshot::Group sg;
+            sg.material.materialName = group->getName();
+            sg.subdivLevel = qMax(0, exporter.m_groupSubdivLevels.value(sg.material.materialName,
+                                                                         exporter.m_nSubdivisionLevel));
+            sg.faces.resize(group->count());
+            memcpy(sg.faces.data(), group->getIndicesPtr(), group->count() * sizeof(int));
+            outSnap.groups.append(sg);
+        }
+
+        if (stats) {
+            stats->vertices   += numVerts;
+            stats->triangles  += numTris;
+            stats->primitives += outSnap.groups.size();
+        }
+        return true;
+    }
+
+    void readMaterial(int mesh, int group, GltfPrimData& prim)
+    {
+        Q_UNUSED(group);
+        // Find matching DzMaterial by name
+        DzShape* shape = 0;
+        if (!facetMeshOf(nodes[mesh], &shape))
+            return;
+        for (int mi = 0; mi < shape->getNumMaterials(); ++mi) {
+            DzMaterial* mat = shape->getMaterial(mi);
+            if (mat && mat->getName() == prim.materialName) {
+                extractMaterial(mat, prim);
+                if (stats)
+                    countMaterial(nodes[mesh], mat, *stats);
+                return;
+            }
+        }
+    }
+};
+
 bool DzGLTFExporter::exportGLB(DzNode* node, const QString& outputPath)
 {
+    return startExportGLB(node, outputPath) && waitForExport();
+}
+
+bool DzGLTFExporter::exportSceneGLB(const QString& outputPath)
+{
+    return startExportSceneGLB(outputPath) && waitForExport();
+}
+
+bool DzGLTFExporter::startExportGLB(DzNode* node, const QString& outputPath)
+{
+    if (!beginExport())
+        return false;
     if (!node) {
         m_sLastError = "exportGLB: null node";
         return false;
     }
 
-    QVector<GltfPrimData> prims;
-    if (!buildPrimitives(node, prims))
-        return false;
+    PendingExport* job = new PendingExport;
+    job->outputPath = outputPath;
 
-    if (prims.isEmpty()) {
-        m_sLastError = "exportGLB: no geometry found on node";
+    bool ok;
+    if (m_bExportHierarchy && !m_bExportAnimation) {
+        QVector<DzNode*> roots;
+        roots.append(node);
+        ok = snapshotHierarchy(roots, *job);
+    } else {
+        ok = snapshotNode(node, *job);
+    }
+    return launchExport(job, ok);
+}
+
+bool DzGLTFExporter::startExportSceneGLB(const QString& outputPath)
+{
+    if (!beginExport())
         return false;
+
+    QVector<DzNode*> roots;
+    for (int i = 0; i < dzScene->getNumNodes(); ++i) {
+        DzNode* node = dzScene->getNode(i);
+        if (node && !node->getNodeParent())
+            roots.append(node);
+    }
+
+    PendingExport* job = new PendingExport;
+    job->outputPath = outputPath;
+    return launchExport(job, snapshotHierarchy(roots, *job));
+}
+
+bool DzGLTFExporter::isExportFinished() const
+{
+    return !m_bExportRunning || m_exportFuture.isFinished();
+}
+
+void DzGLTFExporter::cancelExport()
+{
+    m_cancel = 1;
+}
+
+bool DzGLTFExporter::waitForExport()
+{
+    if (m_bExportRunning) {
+        m_exportFuture.waitForFinished();
+        m_bExportResult  = m_exportFuture.result();
+        m_bExportRunning = false;
+        delete m_pPendingExport;
+        m_pPendingExport = 0;
     }
+    return m_bExportResult;
+}
 
-    QByteArray glbData = buildGLB(prims, node->getLabel());
+/// Settle any previous export and reset the per-export state.
+bool DzGLTFExporter::beginExport()
+{
+    waitForExport();
+    m_sLastError          = QString();
+    m_bExportResult       = false;
+    m_cancel              = 0;
+    m_progress            = 0;
+    m_lastKeyStats        = GltfKeyReductionStats();
+    m_nLastHiddenTris     = 0;
+    m_nLastUniqueMeshes   = 0;
+    m_nLastInstancedNodes = 0;
+    m_sourceStats         = GltfSourceStats();
+    return true;
+}
 
-    QFile file(outputPath);
-    if (!file.open(QIODevice::WriteOnly)) {
-        m_sLastError = QString("exportGLB: cannot open '%1'").arg(outputPath);
+/// Hand a snapshot to the thread pool.  A failed snapshot finishes here.
+bool DzGLTFExporter::launchExport(PendingExport* job, bool snapshotOk)
+{
+    if (!snapshotOk) {
+        delete job;
+        m_bExportResult = false;
+        m_progress      = 100;
         return false;
     }
-    file.write(glbData);
-    file.close();
+    m_progress       = kSnapshotProgress;
+    m_pPendingExport = job;
+    m_bExportRunning = true;
+    m_exportFuture   = QtConcurrent::run(this, &DzGLTFExporter::finishExport);
     return true;
 }
 
-// ---------------------------------------------------------------------------
-// Mesh extraction
-// ---------------------------------------------------------------------------
+bool DzGLTFExporter::exportCancelled()
+{
+    if (!m_cancel)
+        return false;
+    m_sLastError = "exportGLB: cancelled";
+    return true;
+}
 
-bool DzGLTFExporter::buildPrimitives(DzNode* node,
-                                      QVector<GltfPrimData>& outPrims)
+/// UI-thread half of exportGLB(): skeleton, geometry, skin and animation
+/// samples.  Streamed animation is sampled and fitted here window by
+/// window; only its kept keys, in a scratch file, go to the background.
+bool DzGLTFExporter::snapshotNode(DzNode* node, PendingExport& job)
 {
-    DzObject* obj = node->getObject();
-    if (!obj) {
-        m_sLastError = "buildPrimitives: node has no object";
+    GltfTraceScope trace("snapshotNode", "export");
+    bool skinned = (m_bExportSkin || m_bIncludeFittedItems)
+                && qobject_cast<DzSkeleton*>(node) != 0;
+
+    GltfSceneData& scene = job.scene;
+    GltfNodeData root;
+    root.name = node->getLabel().isEmpty() ? QString("Root") : node->getLabel();
+    root.mesh = 0;
+    scene.nodes.append(root);
+
+    // Bones become nodes 1..N; sources[i] is the DzNode behind node i.
+    QVector<DzNode*> sources;
+    sources.append(node);
+    if (skinned || m_bExportAnimation)
+        extractSkeleton(node, scene.nodes, sources);
+
+    QVector<DzNode*> items;
+    items.append(node);
+    if (skinned && m_bIncludeFittedItems)
+        collectFittedItems(node, items);
+
+    NodeSource source(*this);
+    source.nodes = items;
+    source.stats = &m_sourceStats;
+    job.snaps.resize(items.size());
+    if (!source.snapshot(0, job.snaps[0])) {
+        m_sLastError = source.getLastError();
         return false;
     }
+    for (int i = 1; i < items.size(); ++i)
+        source.snapshot(i, job.snaps[i]);     // items without facet geometry are skipped
+    if (skinned) {
+        for (int i = 0; i < items.size(); ++i)
+            snapshotSkinWeights(items[i], sources, job.snaps[i]);
+        buildSkin(sources, job.skin);
+    }
 
-    DzShape* shape = obj->getCurrentShape();
-    DzFacetShape* facetShape = qobject_cast<DzFacetShape*>(shape);
-    if (!facetShape) {
-        m_sLastError = "buildPrimitives: shape is not a DzFacetShape";
-        return false;
+    job.cullHidden = m_bRemoveHiddenSurfaces && skinned && items.size() > 1;
+    if (job.cullHidden)
+        sampleSkinPoses(sources, job.poses);
+
+    if (m_bExportAnimation)
+    {
+        // Long takes: never hold more than one window of samples
+        if (m_nAnimationWindowFrames > 0)
+            return sampleAnimationStreamed(scene.nodes, sources, job);
+        extractAnimations(sources, scene.nodes, job.channels);
+        job.reduceKeys = true;
     }
+    return true;
+}
 
-    DzFacetMesh* mesh = facetShape->getFacetMesh();
-    if (!mesh || mesh->getNumVertices() == 0) {
-        m_sLastError = "buildPrimitives: no facet mesh / empty mesh";
+/// Background half of an export: expand, cull, LODs, key reduction, write.
+bool DzGLTFExporter::finishExport()
+{
+    GltfTraceScope trace("finishExport", "export");
+    PendingExport& job = *m_pPendingExport;
+
+    bool assembled = job.hierarchy ? assembleHierarchy(job) : assembleScene(job);
+    if (!assembled)
+        return false;
+    m_progress = kAssembleProgress;
+
+    if (exportCancelled())
         return false;
+    if (m_bGenerateLods) {
+        GltfSceneBuilder::appendLods(job.scene);
+        job.primBytes.set(GltfMemory::sizeOf(job.scene.prims));
     }
+    m_progress = kLodProgress;
 
-    // --- vertex positions ---
-    // DzPnt3 = typedef float DzPnt3[3]; access as srcPos[i][0..2]
-    int numVerts = mesh->getNumVertices();
-    const DzPnt3* srcPos = mesh->getVerticesPtr();
+    if (job.reduceKeys) {
+        GltfKeyframeReducer reducer(m_keyReduction);
+        m_lastKeyStats = reducer.reduce(job.channels);
+    }
 
-    // --- UV coordinates via DzMap (first UV set) ---
-    int numUVs = 0;
-    const DzPnt2* srcUVs = nullptr;
-    DzMap* uvMap = mesh->getUVs();
-    if (uvMap) {
-        numUVs = uvMap->getNumValues();
-        srcUVs = uvMap->getPnt2ArrayPtr();
+    if (exportCancelled())
+        return false;
+    bool written = job.stream ? m_writer.writeStreamed(job.scene, *job.stream, job.outputPath)
+                              : m_writer.write(job.scene, job.channels, job.outputPath);
+    if (!written) {
+        m_sLastError = m_writer.getLastError();
+        return false;
     }
+    return true;
+}
 
-    // --- facets ---
-    int numFacets = mesh->getNumFacets();
-    const DzFacet* facets = mesh->getFacetsPtr();
+/// Expand the snapshots to primitives, remove hidden body triangles and
+/// build meshes, fitted-item nodes and the shared skin.
+bool DzGLTFExporter::assembleScene(PendingExport& job)
+{
+    GltfTraceScope trace("assembleScene", "export");
+    GltfSceneData&                   scene = job.scene;
+    const QVector<GltfMeshSnapshot>& snaps = job.snaps;
 
-    // --- material groups ---
-    int numGroups    = mesh->getNumMaterialGroups();
-    int numShapeMats = shape->getNumMaterials();
+    // ---- expand to primitives on the thread pool -------------------------
+    QVector< QVector<GltfPrimData> > expanded;
+    GltfSceneBuilder::expandAll(snaps, expanded);
 
-    // Build one GltfPrimData per material group
-    for (int g = 0; g < numGroups; ++g)
+    if (expanded[0].isEmpty()) {
+        m_sLastError = "exportGLB: no geometry found on node";
+        return false;
+    }
+    if (exportCancelled())
+        return false;
+
+    // ---- hidden-surface removal: body triangles under opaque clothing ----
+    if (job.cullHidden)
     {
-        DzMaterialFaceGroup* group = mesh->getMaterialGroup(g);
-        if (!group || group->count() == 0)
-            continue;
+        GltfOcclusionCuller culler;
+        for (int i = 1; i < expanded.size(); ++i)
+            for (int p = 0; p < expanded[i].size(); ++p)
+                if (isOpaque(expanded[i][p]))
+                    culler.addOccluder(expanded[i][p]);
+        for (int k = 0; k < job.poses.size(); ++k)
+            culler.addPose(job.poses[k]);
+
+        QVector<bool> hidden = culler.findHidden(expanded[0]);
+        // a body with nothing left to draw would lose its node; keep it whole
+        if (m_bSeparateHiddenSurfaces || hidden.count(true) < hidden.size())
+            m_nLastHiddenTris = GltfOcclusionCuller::removeHidden(expanded[0], hidden,
+                                                                  m_bSeparateHiddenSurfaces);
+    }
 
-        GltfPrimData prim;
-        prim.materialName    = group->getName();
-        prim.baseColor[0]    = 1.0f;
-        prim.baseColor[1]    = 1.0f;
-        prim.baseColor[2]    = 1.0f;
-        prim.baseColor[3]    = 1.0f;
-        prim.metallicFactor  = 0.0f;
-        prim.roughnessFactor = 0.5f;
+    bool anySkinned = false;
+    for (int i = 0; i < expanded.size(); ++i)
+    {
+        if (expanded[i].isEmpty())
+            continue;
 
-        // Find matching DzMaterial by name
-        for (int mi = 0; mi < numShapeMats; ++mi) {
-            DzMaterial* mat = shape->getMaterial(mi);
-            if (mat && mat->getName() == prim.materialName) {
-                extractMaterial(mat, prim);
-                break;
-            }
+        GltfMeshData md;
+        md.name      = (i == 0) ? QString("Mesh") : snaps[i].name;
+        md.firstPrim = scene.prims.size();
+        md.primCount = expanded[i].size();
+        scene.prims += expanded[i];
+
+        int skin = snaps[i].joints.isEmpty() ? -1 : 0;
+        anySkinned = anySkinned || skin == 0;
+        if (i == 0) {
+            scene.nodes[0].skin = skin;
+        } else {
+            // fitted items share the figure's skin, so they need no bones of their own
+            GltfNodeData item;
+            item.name = snaps[i].name;
+            item.mesh = scene.meshes.size();
+            item.skin = skin;
+            scene.nodes.append(item);
         }
+        scene.meshes.append(md);
+    }
 
-        // Triangulate faces in this group
-        int numFaces    = group->count();
-        const int* faceIdx = group->getIndicesPtr();
+    if (anySkinned)
+        scene.skins.append(job.skin);
 
-        for (int f = 0; f < numFaces; ++f)
-        {
-            int fi = faceIdx[f];
-            if (fi < 0 || fi >= numFacets)
-                continue;
+    job.snaps.clear();
+    job.primBytes.set(GltfMemory::sizeOf(scene.prims));
+    return true;
+}
 
-            const DzFacet& face = facets[fi];
+/// Expand a hierarchy's distinct meshes on the thread pool and point each
+/// node, which snapshotHierarchy() left holding a snapshot index, at the
+/// mesh built from it.
+bool DzGLTFExporter::assembleHierarchy(PendingExport& job)
+{
+    GltfTraceScope trace("assembleHierarchy", "export");
+    GltfSceneData& scene = job.scene;
 
-            // DzFacet fields: m_vertIdx[4], m_uvwIdx[4]
-            // m_vertIdx[3] == -1 means triangle; >= 0 means quad
-            bool isQuad  = (face.m_vertIdx[3] >= 0);
-            int triCount = isQuad ? 2 : 1;
+    QVector< QVector<GltfPrimData> > expanded;
+    GltfSceneBuilder::expandAll(job.snaps, expanded);
+    if (exportCancelled())
+        return false;
 
-            // Two triangle fans from the quad: (0,1,2) and (0,2,3)
-            static const int triMap[2][3] = { {0,1,2}, {0,2,3} };
+    QVector<int> meshOfSnap(expanded.size(), -1);
+    for (int i = 0; i < expanded.size(); ++i)
+    {
+        if (expanded[i].isEmpty())
+            continue;
+        GltfMeshData md;
+        md.name        = job.snaps[i].name;
+        md.firstPrim   = scene.prims.size();
+        md.primCount   = expanded[i].size();
+        md.contentHash = job.meshHashes[i];
+        scene.prims += expanded[i];
+        meshOfSnap[i] = scene.meshes.size();
+        scene.meshes.append(md);
+    }
+    if (scene.meshes.isEmpty()) {
+        m_sLastError = "exportGLB: no geometry found in hierarchy";
+        return false;
+    }
+    m_nLastUniqueMeshes = scene.meshes.size();
 
-            for (int t = 0; t < triCount; ++t)
-            {
-                // Collect the 3 vertex positions (for flat normal computation)
-                float pa[3], pb[3], pc[3];
-                float* pts[3] = { pa, pb, pc };
-                for (int v = 0; v < 3; ++v) {
-                    int vi  = triMap[t][v];
-                    int idx = face.m_vertIdx[vi];
-                    if (idx < 0 || idx >= numVerts) idx = 0;
-                    pts[v][0] = srcPos[idx][0] * m_fScale;
-                    pts[v][1] = srcPos[idx][1] * m_fScale;
-                    pts[v][2] = srcPos[idx][2] * m_fScale;
-                }
-
-                float n[3];
-                computeFlatNormal(pa, pb, pc, n);
-
-                for (int v = 0; v < 3; ++v)
-                {
-                    int vi    = triMap[t][v];
-                    int vIdx  = face.m_vertIdx[vi];
-                    int uvIdx = (srcUVs && face.m_uvwIdx[vi] >= 0)
-                                    ? face.m_uvwIdx[vi] : -1;
-
-                    if (vIdx < 0 || vIdx >= numVerts) vIdx = 0;
-
-                    // Position (DzPnt3 == float[3])
-                    prim.positions.append(srcPos[vIdx][0] * m_fScale);
-                    prim.positions.append(srcPos[vIdx][1] * m_fScale);
-                    prim.positions.append(srcPos[vIdx][2] * m_fScale);
-
-                    // Flat normal
-                    prim.normals.append(n[0]);
-                    prim.normals.append(n[1]);
-                    prim.normals.append(n[2]);
-
-                    // UV: glTF origin is top-left, Daz is bottom-left -> flip V
-                    // DzPnt2 == float[2]
-                    if (uvIdx >= 0 && uvIdx < numUVs) {
-                        prim.texcoords.append(srcUVs[uvIdx][0]);
-                        prim.texcoords.append(1.0f - srcUVs[uvIdx][1]);
-                    } else {
-                        prim.texcoords.append(0.0f);
-                        prim.texcoords.append(0.0f);
-                    }
-                }
-            }
+    for (int n = 0; n < scene.nodes.size(); ++n)
+    {
+        GltfNodeData& nd = scene.nodes[n];
+        if (nd.mesh < 0)
+            continue;
+        nd.mesh = meshOfSnap[nd.mesh];
+        if (nd.mesh < 0) {
+            // every group empty: the node stays as a transform
+            nd.instanceTranslations.clear();
+            nd.instanceRotations.clear();
+            nd.instanceScales.clear();
         }
-
-        if (!prim.positions.isEmpty())
-            outPrims.append(prim);
     }
 
+    job.snaps.clear();
+    job.meshHashes.clear();
+    job.primBytes.set(GltfMemory::sizeOf(scene.prims));
     return true;
 }
 
+// ---------------------------------------------------------------------------
+// Mesh extraction
+// ---------------------------------------------------------------------------
+
+DzFacetMesh* DzGLTFExporter::facetMeshOf(DzNode* node, DzShape** outShape)
+{
+    DzObject* obj = node ? node->getObject() : 0;
+    DzShape* shape = obj ? obj->getCurrentShape() : 0;
+    DzFacetShape* facetShape = qobject_cast<DzFacetShape*>(shape);
+    DzFacetMesh* mesh = facetShape ? facetShape->getFacetMesh() : 0;
+    if (!mesh || mesh->getNumVertices() == 0)
+        return 0;
+    if (outShape)
+        *outShape = shape;
+    return mesh;
+}
+
 void DzGLTFExporter::extractMaterial(DzMaterial* mat, GltfPrimData& prim)
 {
     if (!mat) return;
@@ -266,6 +660,15 @@ void DzGLTFExporter::extractMaterial(DzMaterial* mat, GltfPrimData& prim)
         if (np) prim.roughnessFactor = (float)np->getDoubleValue();
     }
 
+    // Cutout opacity; a map means parts are see-through
+    DzNumericProperty* opacityProp =
+        qobject_cast<DzNumericProperty*>(mat->findProperty("Cutout Opacity", false));
+    if (opacityProp) {
+        prim.opacity = (float)opacityProp->getDoubleValue();
+        if (opacityProp->getMapValue())
+            prim.opacityTexturePath = opacityProp->getMapValue()->getFilename();
+    }
+
     // Normal map
     DzProperty* normProp = mat->findProperty("Normal Map", false);
     if (!normProp) normProp = mat->findProperty("normal map", false);
@@ -277,325 +680,853 @@ void DzGLTFExporter::extractMaterial(DzMaterial* mat, GltfPrimData& prim)
 }
 
 // ---------------------------------------------------------------------------
-// GLB serialisation
+// Hierarchy / instancing
 // ---------------------------------------------------------------------------
 
-QByteArray DzGLTFExporter::buildGLB(const QVector<GltfPrimData>& prims,
-                                     const QString& nodeName)
-{
-    // ---- 1. Build binary buffer ----------------------------------------
-    struct AccessorMeta {
-        quint32 byteOffset;
-        quint32 byteLength;
-        int     count;
-        float   minXYZ[3];
-        float   maxXYZ[3];
-        bool    hasMinMax;
-    };
-
-    QVector<AccessorMeta> posAcc, normAcc, uvAcc;
-    QByteArray binBuf;
-
-    for (int p = 0; p < prims.size(); ++p)
+bool DzGLTFExporter::snapshotHierarchy(const QVector<DzNode*>& roots,
+                                       PendingExport& job)
+{
+    GltfTraceScope trace("snapshotHierarchy", "export");
+    QVector<GltfNodeData>& nodes = job.scene.nodes;
+
+    QVector<DzNode*>      sources;
+    QVector<quint64>      hashes;
+    for (int i = 0; i < roots.size(); ++i)
+        collectHierarchy(roots[i], -1, nodes, sources, hashes);
+
+    // One snapshot per distinct content hash, taken from its first user.
+    // Until assembleHierarchy() expands them, node meshes index job.snaps;
+    // instancing only needs to know which nodes share one.
+    QHash<quint64, int>   snapByHash;
+    for (int n = 0; n < nodes.size(); ++n)
     {
-        const GltfPrimData& prim = prims[p];
-        int vertCount = prim.positions.size() / 3;
+        if (nodes[n].mesh < 0)
+            continue;
 
-        // POSITION
-        {
-            AccessorMeta am;
-            am.byteOffset = (quint32)binBuf.size();
-            am.count      = vertCount;
-            am.hasMinMax  = true;
-            am.minXYZ[0] = am.minXYZ[1] = am.minXYZ[2] =  FLT_MAX;
-            am.maxXYZ[0] = am.maxXYZ[1] = am.maxXYZ[2] = -FLT_MAX;
-            for (int i = 0; i < prim.positions.size(); i += 3) {
-                for (int j = 0; j < 3; ++j) {
-                    float v = prim.positions[i+j];
-                    if (v < am.minXYZ[j]) am.minXYZ[j] = v;
-                    if (v > am.maxXYZ[j]) am.maxXYZ[j] = v;
-                }
-            }
-            for (int i = 0; i < prim.positions.size(); ++i)
-                appendFloat32LE(binBuf, prim.positions[i]);
-            am.byteLength = (quint32)binBuf.size() - am.byteOffset;
-            posAcc.append(am);
+        QHash<quint64, int>::const_iterator it = snapByHash.constFind(hashes[n]);
+        if (it != snapByHash.constEnd()) {
+            nodes[n].mesh = it.value();
+            continue;
         }
 
-        // NORMAL
-        {
-            AccessorMeta am;
-            am.byteOffset = (quint32)binBuf.size();
-            am.count      = vertCount;
-            am.hasMinMax  = false;
-            for (int i = 0; i < prim.normals.size(); ++i)
-                appendFloat32LE(binBuf, prim.normals[i]);
-            am.byteLength = (quint32)binBuf.size() - am.byteOffset;
-            normAcc.append(am);
+        DzVec3 origin = sources[n]->getOrigin();
+        float pivot[3] = { origin.m_x, origin.m_y, origin.m_z };
+        NodeSource source(*this, pivot);
+        source.nodes.append(sources[n]);
+        GltfMeshSnapshot snap;
+        if (!source.snapshot(0, snap)) {
+            m_sLastError = source.getLastError();
+            return false;
         }
 
-        // TEXCOORD_0
-        {
-            AccessorMeta am;
-            am.byteOffset = (quint32)binBuf.size();
-            am.count      = prim.texcoords.size() / 2;
-            am.hasMinMax  = false;
-            for (int i = 0; i < prim.texcoords.size(); ++i)
-                appendFloat32LE(binBuf, prim.texcoords[i]);
-            am.byteLength = (quint32)binBuf.size() - am.byteOffset;
-            uvAcc.append(am);
-        }
+        nodes[n].mesh = job.snaps.size();
+        snapByHash.insert(hashes[n], nodes[n].mesh);
+        job.snaps.append(snap);
+        job.meshHashes.append(hashes[n]);
     }
 
-    // Pad BIN to 4-byte boundary
-    QByteArray binPadded = padTo4(binBuf, '\0');
+    if (job.snaps.isEmpty()) {
+        m_sLastError = "exportGLB: no geometry found in hierarchy";
+        return false;
+    }
 
-    // ---- 2. Collect unique image paths -----------------------------------
-    QVector<QString> imagePaths;
-    QVector<int>     baseColorTexIdx(prims.size(), -1);
-    QVector<int>     normalTexIdx(prims.size(), -1);
+    if (m_bGpuInstancing)
+        applyGpuInstancing(nodes, sources, job.snaps.size());
 
-    for (int p = 0; p < prims.size(); ++p) {
-        // base colour texture
-        if (!prims[p].baseColorTexturePath.isEmpty()) {
-            int found = -1;
-            for (int i = 0; i < imagePaths.size(); ++i)
-                if (imagePaths[i] == prims[p].baseColorTexturePath) { found = i; break; }
-            if (found < 0) { found = imagePaths.size(); imagePaths.append(prims[p].baseColorTexturePath); }
-            baseColorTexIdx[p] = found;
+    job.hierarchy = true;
+    return true;
+}
+
+// Affine 4x4 matrices below are column-major floats with a 0,0,0,1 last row.
+
+// Inverse of affine @p m; false if its linear part is singular (a parent
+// scaled to zero).
+static bool affineInverse(const float* m, float* out)
+{
+    const float a = m[0], b = m[4], c = m[8];
+    const float d = m[1], e = m[5], f = m[9];
+    const float g = m[2], h = m[6], k = m[10];
+    const float det = a*(e*k - f*h) - b*(d*k - f*g) + c*(d*h - e*g);
+    if (std::fabs(det) < 1e-12f)
+        return false;
+    const float s = 1.0f / det;
+    float inv[9] = {
+        (e*k - f*h)*s, (c*h - b*k)*s, (b*f - c*e)*s,    // row 0
+        (f*g - d*k)*s, (a*k - c*g)*s, (c*d - a*f)*s,    // row 1
+        (d*h - e*g)*s, (b*g - a*h)*s, (a*e - b*d)*s     // row 2
+    };
+    memset(out, 0, 16 * sizeof(float));
+    for (int r = 0; r < 3; ++r) {
+        for (int col = 0; col < 3; ++col)
+            out[col*4 + r] = inv[r*3 + col];
+        out[12 + r] = -(inv[r*3]*m[12] + inv[r*3 + 1]*m[13] + inv[r*3 + 2]*m[14]);
+    }
+    out[15] = 1.0f;
+    return true;
+}
+
+static void affineMul(const float* a, const float* b, float* out)
+{
+    float r[16];
+    for (int col = 0; col < 4; ++col)
+        for (int row = 0; row < 4; ++row)
+            r[col*4 + row] = a[row]*b[col*4] + a[4 + row]*b[col*4 + 1]
+                           + a[8 + row]*b[col*4 + 2] + a[12 + row]*b[col*4 + 3];
+    memcpy(out, r, sizeof(r));
+}
+
+// Translation, xyzw rotation and scale of affine @p m.  Shear is dropped,
+// as glTF nodes carry TRS only; a mirrored matrix gets a negative X scale.
+static void decomposeAffine(const float* m, float* outT, float* outR, float* outS)
+{
+    outT[0] = m[12]; outT[1] = m[13]; outT[2] = m[14];
+
+    float axis[3][3];
+    for (int col = 0; col < 3; ++col) {
+        const float* c = m + col*4;
+        outS[col] = std::sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
+        for (int row = 0; row < 3; ++row)
+            axis[col][row] = (outS[col] > 0.0f) ? c[row] / outS[col] : (row == col ? 1.0f : 0.0f);
+    }
+    const float det = axis[0][0]*(axis[1][1]*axis[2][2] - axis[2][1]*axis[1][2])
+                    - axis[1][0]*(axis[0][1]*axis[2][2] - axis[2][1]*axis[0][2])
+                    + axis[2][0]*(axis[0][1]*axis[1][2] - axis[1][1]*axis[0][2]);
+    if (det < 0.0f) {
+        outS[0] = -outS[0];
+        for (int row = 0; row < 3; ++row)
+            axis[0][row] = -axis[0][row];
+    }
+
+    // rotation matrix element (row, col) is axis[col][row]
+    const float m00 = axis[0][0], m11 = axis[1][1], m22 = axis[2][2];
+    const float trace = m00 + m11 + m22;
+    if (trace > 0.0f) {
+        float s = std::sqrt(trace + 1.0f) * 2.0f;
+        outR[3] = 0.25f * s;
+        outR[0] = (axis[1][2] - axis[2][1]) / s;
+        outR[1] = (axis[2][0] - axis[0][2]) / s;
+        outR[2] = (axis[0][1] - axis[1][0]) / s;
+    } else if (m00 > m11 && m00 > m22) {
+        float s = std::sqrt(1.0f + m00 - m11 - m22) * 2.0f;
+        outR[3] = (axis[1][2] - axis[2][1]) / s;
+        outR[0] = 0.25f * s;
+        outR[1] = (axis[1][0] + axis[0][1]) / s;
+        outR[2] = (axis[2][0] + axis[0][2]) / s;
+    } else if (m11 > m22) {
+        float s = std::sqrt(1.0f + m11 - m00 - m22) * 2.0f;
+        outR[3] = (axis[2][0] - axis[0][2]) / s;
+        outR[0] = (axis[1][0] + axis[0][1]) / s;
+        outR[1] = 0.25f * s;
+        outR[2] = (axis[2][1] + axis[1][2]) / s;
+    } else {
+        float s = std::sqrt(1.0f + m22 - m00 - m11) * 2.0f;
+        outR[3] = (axis[0][1] - axis[1][0]) / s;
+        outR[0] = (axis[2][0] + axis[0][2]) / s;
+        outR[1] = (axis[2][1] + axis[1][2]) / s;
+        outR[2] = 0.25f * s;
+    }
+    float len = std::sqrt(outR[0]*outR[0] + outR[1]*outR[1] + outR[2]*outR[2] + outR[3]*outR[3]);
+    for (int c = 0; c < 4; ++c)
+        outR[c] /= len;
+}
+
+bool DzGLTFExporter::collectHierarchy(DzNode* node, int parentIdx,
+                                      QVector<GltfNodeData>& outNodes,
+                                      QVector<DzNode*>& outSources,
+                                      QVector<quint64>& outHashes)
+{
+    if (!node || !node->isVisible())
+        return false;
+
+    DzTime now = dzScene->getTime();
+
+    GltfNodeData nd;
+    nd.name   = node->getLabel().isEmpty() ? node->getName() : node->getLabel();
+    nd.parent = parentIdx;
+    if (parentIdx < 0) {
+        sampleWorldTransform(node, now, nd.translation, nd.rotation, nd.scale);
+    } else {
+        // local = inverse(parent world) * world, so rotated and
+        // non-uniformly scaled parents come out right
+        float world[16], parentWorld[16], parentInv[16], local[16];
+        sampleWorldMatrix(node, now, world);
+        sampleWorldMatrix(outSources[parentIdx], now, parentWorld);
+        if (affineInverse(parentWorld, parentInv)) {
+            affineMul(parentInv, world, local);
+            decomposeAffine(local, nd.translation, nd.rotation, nd.scale);
+        } else {
+            // a parent scaled to nothing: keep the child's own scale
+            float unusedT[3], unusedR[4];
+            sampleLocalTransform(node, outSources[parentIdx], now, nd.translation, nd.rotation);
+            sampleWorldTransform(node, now, unusedT, unusedR, nd.scale);
         }
-        // normal texture
-        if (!prims[p].normalTexturePath.isEmpty()) {
-            int found = -1;
-            for (int i = 0; i < imagePaths.size(); ++i)
-                if (imagePaths[i] == prims[p].normalTexturePath) { found = i; break; }
-            if (found < 0) { found = imagePaths.size(); imagePaths.append(prims[p].normalTexturePath); }
-            normalTexIdx[p] = found;
+    }
+
+    quint64 hash = 0;
+    bool keep = hashNodeMesh(node, hash);
+    nd.mesh = keep ? 0 : -1;     // resolved to a mesh index by snapshotHierarchy()
+
+    int idx = outNodes.size();
+    outNodes.append(nd);
+    outSources.append(node);
+    outHashes.append(hash);
+
+    // Transform-only nodes (groups, bones) survive only if something below
+    // them carries geometry.
+    for (int i = 0; i < node->getNumNodeChildren(); ++i)
+        if (collectHierarchy(node->getNodeChild(i), idx, outNodes, outSources, outHashes))
+            keep = true;
+
+    if (!keep) {
+        outNodes.resize(idx);
+        outSources.resize(idx);
+        outHashes.resize(idx);
+    }
+    return keep;
+}
+
+// Also counts the mesh into m_sourceStats, from the same loops.
+bool DzGLTFExporter::hashNodeMesh(DzNode* node, quint64& outHash)
+{
+    DzShape* shape = 0;
+    DzFacetMesh* mesh = facetMeshOf(node, &shape);
+    if (!mesh)
+        return false;
+
+    GltfHasher h;
+
+    int numVerts = mesh->getNumVertices();
+    h.updateInt(numVerts);
+    h.update(mesh->getVerticesPtr(), (qint64)numVerts * sizeof(DzPnt3));
+
+    // Facet indices only; DzFacet carries other per-face state as well.
+    int numFacets = mesh->getNumFacets();
+    const DzFacet* facets = mesh->getFacetsPtr();
+    h.updateInt(numFacets);
+    qint64 numTris = 0;
+    for (int f = 0; f < numFacets; ++f) {
+        h.update(facets[f].m_vertIdx, sizeof(facets[f].m_vertIdx));
+        h.update(facets[f].m_uvwIdx,  sizeof(facets[f].m_uvwIdx));
+        numTris += (facets[f].m_vertIdx[3] < 0) ? 1 : 2;
+    }
+    m_sourceStats.vertices  += numVerts;
+    m_sourceStats.triangles += numTris;
+
+    DzMap* uvMap = mesh->getUVs();
+    if (uvMap) {
+        h.updateInt(uvMap->getNumValues());
+        h.update(uvMap->getPnt2ArrayPtr(), (qint64)uvMap->getNumValues() * sizeof(DzPnt2));
+    }
+
+    // Same geometry with different surfaces is a different mesh.
+    int numShapeMats = shape->getNumMaterials();
+    for (int g = 0; g < mesh->getNumMaterialGroups(); ++g)
+    {
+        DzMaterialFaceGroup* group = mesh->getMaterialGroup(g);
+        if (!group)
+            continue;
+        h.update(group->getName());
+        h.update(group->getIndicesPtr(), (qint64)group->count() * sizeof(int));
+        if (group->count() > 0)
+            ++m_sourceStats.primitives;
+
+        for (int mi = 0; mi < numShapeMats; ++mi) {
+            DzMaterial* mat = shape->getMaterial(mi);
+            if (!mat || mat->getName() != group->getName())
+                continue;
+            GltfPrimData sig;
+            extractMaterial(mat, sig);
+            countMaterial(node, mat, m_sourceStats);
+            h.update(sig.baseColor, sizeof(sig.baseColor));
+            h.updateFloat(sig.metallicFactor);
+            h.updateFloat(sig.roughnessFactor);
+            h.update(sig.baseColorTexturePath);
+            h.update(sig.normalTexturePath);
+            break;
         }
     }
 
-    // ---- 3. Build JSON ---------------------------------------------------
-    QString json;
-    json += "{\n";
-
-    // asset
-    json += "  \"asset\": { \"version\": \"2.0\", \"generator\": \"DazToUnity Bridge\" },\n";
-
-    // scene / scenes / nodes
-    json += "  \"scene\": 0,\n";
-    json += "  \"scenes\": [ { \"nodes\": [0] } ],\n";
-    json += QString("  \"nodes\": [ { \"name\": \"%1\", \"mesh\": 0 } ],\n")
-                .arg(nodeName.isEmpty() ? "Root" : nodeName);
-
-    // meshes
-    json += "  \"meshes\": [ { \"name\": \"Mesh\", \"primitives\": [\n";
-    for (int p = 0; p < prims.size(); ++p) {
-        int baseAcc = p * 3;
-        json += "    {\n";
-        json += QString("      \"attributes\": { \"POSITION\": %1, \"NORMAL\": %2, \"TEXCOORD_0\": %3 },\n")
-                    .arg(baseAcc).arg(baseAcc+1).arg(baseAcc+2);
-        json += QString("      \"material\": %1,\n").arg(p);
-        json += "      \"mode\": 4\n";       // TRIANGLES
-        json += (p < prims.size()-1) ? "    },\n" : "    }\n";
-    }
-    json += "  ] } ],\n";
-
-    // accessors + bufferViews (one bufferView per accessor)
-    json += "  \"accessors\": [\n";
-    for (int p = 0; p < prims.size(); ++p) {
-        // POSITION
-        const AccessorMeta& pa = posAcc[p];
-        json += "    {\n";
-        json += QString("      \"bufferView\": %1,\n").arg(p*3);
-        json += "      \"byteOffset\": 0,\n";
-        json += "      \"componentType\": 5126,\n";  // FLOAT
-        json += QString("      \"count\": %1,\n").arg(pa.count);
-        json += "      \"type\": \"VEC3\",\n";
-        json += QString("      \"min\": [%1, %2, %3],\n")
-                    .arg(jsonFloat(pa.minXYZ[0])).arg(jsonFloat(pa.minXYZ[1])).arg(jsonFloat(pa.minXYZ[2]));
-        json += QString("      \"max\": [%1, %2, %3]\n")
-                    .arg(jsonFloat(pa.maxXYZ[0])).arg(jsonFloat(pa.maxXYZ[1])).arg(jsonFloat(pa.maxXYZ[2]));
-        json += "    },\n";
-
-        // NORMAL
-        const AccessorMeta& na = normAcc[p];
-        json += "    {\n";
-        json += QString("      \"bufferView\": %1,\n").arg(p*3+1);
-        json += "      \"byteOffset\": 0,\n";
-        json += "      \"componentType\": 5126,\n";
-        json += QString("      \"count\": %1,\n").arg(na.count);
-        json += "      \"type\": \"VEC3\"\n";
-        json += "    },\n";
-
-        // TEXCOORD_0
-        const AccessorMeta& ua = uvAcc[p];
-        bool lastAccessor = (p == prims.size()-1);
-        json += "    {\n";
-        json += QString("      \"bufferView\": %1,\n").arg(p*3+2);
-        json += "      \"byteOffset\": 0,\n";
-        json += "      \"componentType\": 5126,\n";
-        json += QString("      \"count\": %1,\n").arg(ua.count);
-        json += "      \"type\": \"VEC2\"\n";
-        json += lastAccessor ? "    }\n" : "    },\n";
-    }
-    json += "  ],\n";
-
-    // bufferViews
-    json += "  \"bufferViews\": [\n";
-    for (int p = 0; p < prims.size(); ++p) {
-        bool lastPrim = (p == prims.size()-1);
-        // position BV
-        json += "    {\n";
-        json += "      \"buffer\": 0,\n";
-        json += QString("      \"byteOffset\": %1,\n").arg(posAcc[p].byteOffset);
-        json += QString("      \"byteLength\": %1,\n").arg(posAcc[p].byteLength);
-        json += "      \"target\": 34962\n";
-        json += "    },\n";
-        // normal BV
-        json += "    {\n";
-        json += "      \"buffer\": 0,\n";
-        json += QString("      \"byteOffset\": %1,\n").arg(normAcc[p].byteOffset);
-        json += QString("      \"byteLength\": %1,\n").arg(normAcc[p].byteLength);
-        json += "      \"target\": 34962\n";
-        json += "    },\n";
-        // uv BV
-        json += "    {\n";
-        json += "      \"buffer\": 0,\n";
-        json += QString("      \"byteOffset\": %1,\n").arg(uvAcc[p].byteOffset);
-        json += QString("      \"byteLength\": %1,\n").arg(uvAcc[p].byteLength);
-        json += "      \"target\": 34962\n";
-        json += lastPrim ? "    }\n" : "    },\n";
-    }
-    json += "  ],\n";
-
-    // images
-    if (!imagePaths.isEmpty()) {
-        json += "  \"images\": [\n";
-        for (int i = 0; i < imagePaths.size(); ++i) {
-            QString basename = QFileInfo(imagePaths[i]).fileName();
-            json += QString("    { \"uri\": \"%1\" }").arg(basename);
-            json += (i < imagePaths.size()-1) ? ",\n" : "\n";
+    DzVec3 origin = node->getOrigin();
+    float pivot[3] = { origin.m_x, origin.m_y, origin.m_z };
+    h.update(pivot, sizeof(pivot));
+
+    outHash = h.digest();
+    return true;
+}
+
+// Every property value of a material or node, so the content hash sees
+// edits that the glTF itself does not carry but the FBX and DTU do.
+static void hashProperties(const DzElement* element, GltfHasher& h)
+{
+    for (int i = 0; i < element->getNumProperties(); ++i)
+    {
+        DzProperty* prop = element->getProperty(i);
+        if (!prop)
+            continue;
+        h.update(prop->getName());
+        if (DzImageProperty* img = qobject_cast<DzImageProperty*>(prop)) {
+            DzTexture* tex = img->getValue();
+            h.update(tex ? tex->getFilename() : QString());
+        } else if (DzColorProperty* col = qobject_cast<DzColorProperty*>(prop)) {
+            h.updateInt(col->getColorValue().rgba());
+            DzTexture* tex = col->getMapValue();
+            h.update(tex ? tex->getFilename() : QString());
+        } else if (DzNumericProperty* num = qobject_cast<DzNumericProperty*>(prop)) {
+            double v = num->getDoubleValue();
+            h.update(&v, sizeof(v));
+            DzTexture* tex = num->getMapValue();
+            h.update(tex ? tex->getFilename() : QString());
         }
-        json += "  ],\n";
+    }
+}
+
+bool DzGLTFExporter::hashSceneContent(const QVector<DzNode*>& roots, quint64& outHash)
+{
+    GltfHasher h;
+    h.updateFloat(m_fScale);
+    m_sourceStats = GltfSourceStats();
+    for (int i = 0; i < roots.size(); ++i)
+        hashSubtree(roots[i], h);
+    outHash = h.digest();
+    return !roots.isEmpty();
+}
+
+void DzGLTFExporter::hashSubtree(DzNode* node, GltfHasher& h)
+{
+    if (!node)
+        return;
+
+    h.update(node->getName());
+    h.updateInt(node->isVisible() ? 1 : 0);
+
+    float t[3], r[4], sc[3];
+    sampleWorldTransform(node, dzScene->getTime(), t, r, sc);
+    h.update(t, sizeof(t));
+    h.update(r, sizeof(r));
+    h.update(sc, sizeof(sc));
+    hashProperties(node, h);
+
+    // Morph dials and other modifiers sit on the object and deform the
+    // base cage that hashNodeMesh() reads.
+    if (DzObject* object = node->getObject()) {
+        h.updateInt(object->getNumModifiers());
+        for (int m = 0; m < object->getNumModifiers(); ++m)
+            if (DzModifier* mod = object->getModifier(m)) {
+                h.update(mod->getName());
+                hashProperties(mod, h);
+            }
+    }
+
+    quint64 meshHash = 0;
+    if (hashNodeMesh(node, meshHash)) {
+        h.updateInt((qint64)meshHash);
+        DzShape* shape = 0;
+        facetMeshOf(node, &shape);
+        if (shape)
+            hashProperties(shape, h);      // subdivision level lives here
+        for (int m = 0; shape && m < shape->getNumMaterials(); ++m)
+            if (DzMaterial* mat = shape->getMaterial(m))
+                hashProperties(mat, h);
+    }
+
+    h.updateInt(node->getNumNodeChildren());
+    for (int i = 0; i < node->getNumNodeChildren(); ++i)
+        hashSubtree(node->getNodeChild(i), h);
+}
+
+void DzGLTFExporter::applyGpuInstancing(QVector<GltfNodeData>& nodes,
+                                        const QVector<DzNode*>& sources,
+                                        int meshCount)
+{
+    // Only leaf nodes are folded: a node with children has to stay in the
+    // tree to carry them.
+    QVector<bool> hasChildren(nodes.size(), false);
+    for (int n = 0; n < nodes.size(); ++n)
+        if (nodes[n].parent >= 0)
+            hasChildren[nodes[n].parent] = true;
+
+    QVector< QVector<int> > users(meshCount);
+    for (int n = 0; n < nodes.size(); ++n)
+        if (nodes[n].mesh >= 0 && !hasChildren[n])
+            users[nodes[n].mesh].append(n);
+
+    DzTime now = dzScene->getTime();
+    QVector<bool>         folded(nodes.size(), false);
+    QVector<GltfNodeData> instanceNodes;
+    for (int m = 0; m < meshCount; ++m)
+    {
+        if (users[m].size() < kMinGpuInstances)
+            continue;
 
-        // textures (one per image)
-        json += "  \"textures\": [\n";
-        for (int i = 0; i < imagePaths.size(); ++i) {
-            json += QString("    { \"source\": %1 }").arg(i);
-            json += (i < imagePaths.size()-1) ? ",\n" : "\n";
+        // The instancing node sits at the scene root, so instance
+        // transforms are world transforms.
+        GltfNodeData inst;
+        inst.name = nodes[users[m][0]].name + "_Instances";
+        inst.mesh = m;
+        for (int i = 0; i < users[m].size(); ++i) {
+            int n = users[m][i];
+            float t[3], r[4], sc[3];
+            sampleWorldTransform(sources[n], now, t, r, sc);
+            for (int c = 0; c < 3; ++c) inst.instanceTranslations.append(t[c]);
+            for (int c = 0; c < 4; ++c) inst.instanceRotations.append(r[c]);
+            for (int c = 0; c < 3; ++c) inst.instanceScales.append(sc[c]);
+            folded[n] = true;
         }
-        json += "  ],\n";
-    }
-
-    // materials
-    json += "  \"materials\": [\n";
-    for (int p = 0; p < prims.size(); ++p) {
-        const GltfPrimData& pr = prims[p];
-        json += "    {\n";
-        json += QString("      \"name\": \"%1\",\n").arg(pr.materialName);
-        json += "      \"pbrMetallicRoughness\": {\n";
-        json += QString("        \"baseColorFactor\": [%1, %2, %3, %4],\n")
-                    .arg(jsonFloat(pr.baseColor[0])).arg(jsonFloat(pr.baseColor[1]))
-                    .arg(jsonFloat(pr.baseColor[2])).arg(jsonFloat(pr.baseColor[3]));
-        if (baseColorTexIdx[p] >= 0)
-            json += QString("        \"baseColorTexture\": { \"index\": %1 },\n")
-                        .arg(baseColorTexIdx[p]);
-        json += QString("        \"metallicFactor\": %1,\n").arg(jsonFloat(pr.metallicFactor));
-        json += QString("        \"roughnessFactor\": %1\n").arg(jsonFloat(pr.roughnessFactor));
-        json += "      }";
-        if (normalTexIdx[p] >= 0)
-            json += QString(",\n      \"normalTexture\": { \"index\": %1 }").arg(normalTexIdx[p]);
-        json += "\n    }";
-        json += (p < prims.size()-1) ? ",\n" : "\n";
-    }
-    json += "  ],\n";
-
-    // buffer
-    json += QString("  \"buffers\": [ { \"byteLength\": %1 } ]\n").arg(binPadded.size());
-    json += "}\n";
-
-    // ---- 4. Assemble GLB -------------------------------------------------
-    QByteArray jsonBytes  = json.toUtf8();
-    QByteArray jsonPadded = padTo4(jsonBytes, ' ');
-
-    quint32 totalLen = 12
-                     + 8 + (quint32)jsonPadded.size()
-                     + (binPadded.isEmpty() ? 0 : 8 + (quint32)binPadded.size());
-
-    QByteArray glb;
-    appendUint32LE(glb, 0x46546C67u);     // magic 'glTF'
-    appendUint32LE(glb, 2u);              // version
-    appendUint32LE(glb, totalLen);        // total length
-
-    // JSON chunk
-    appendUint32LE(glb, (quint32)jsonPadded.size());
-    appendUint32LE(glb, 0x4E4F534Au);     // 'JSON'
-    glb.append(jsonPadded);
-
-    // BIN chunk
-    if (!binPadded.isEmpty()) {
-        appendUint32LE(glb, (quint32)binPadded.size());
-        appendUint32LE(glb, 0x004E4942u); // 'BIN\0'
-        glb.append(binPadded);
-    }
-
-    return glb;
+        m_nLastInstancedNodes += users[m].size();
+        instanceNodes.append(inst);
+    }
+    if (instanceNodes.isEmpty())
+        return;
+
+    // Folded nodes are leaves, so no surviving node has one as its parent.
+    QVector<int> remap(nodes.size(), -1);
+    QVector<GltfNodeData> kept;
+    kept.reserve(nodes.size() + instanceNodes.size());
+    for (int n = 0; n < nodes.size(); ++n) {
+        if (folded[n])
+            continue;
+        remap[n] = kept.size();
+        kept.append(nodes[n]);
+        if (kept.last().parent >= 0)
+            kept.last().parent = remap[kept.last().parent];
+    }
+    kept += instanceNodes;
+    nodes = kept;
+}
+
+void DzGLTFExporter::sampleWorldTransform(DzNode* node, qint64 time, float* outT,
+                                          float* outR, float* outS) const
+{
+    DzVec3    p = node->getWSPos(time);
+    DzQuat    r = node->getWSRot(time);
+    DzMatrix3 s = node->getWSScale(time);
+
+    outT[0] = p.m_x * m_fScale;
+    outT[1] = p.m_y * m_fScale;
+    outT[2] = p.m_z * m_fScale;
+    outR[0] = (float)r.m_x; outR[1] = (float)r.m_y;
+    outR[2] = (float)r.m_z; outR[3] = (float)r.m_w;
+    // shear is dropped; glTF nodes carry TRS only
+    outS[0] = s.row(0).m_x;
+    outS[1] = s.row(1).m_y;
+    outS[2] = s.row(2).m_z;
 }
 
 // ---------------------------------------------------------------------------
-// Geometry helpers
+// Level of detail
 // ---------------------------------------------------------------------------
 
-void DzGLTFExporter::computeFlatNormal(const float* a, const float* b,
-                                        const float* c, float* outN)
+int DzGLTFExporter::lodLevelCount()
 {
-    float u[3] = { b[0]-a[0], b[1]-a[1], b[2]-a[2] };
-    float v[3] = { c[0]-a[0], c[1]-a[1], c[2]-a[2] };
-    outN[0] = u[1]*v[2] - u[2]*v[1];
-    outN[1] = u[2]*v[0] - u[0]*v[2];
-    outN[2] = u[0]*v[1] - u[1]*v[0];
-    float len = std::sqrt(outN[0]*outN[0] + outN[1]*outN[1] + outN[2]*outN[2]);
-    if (len > 1e-8f) { outN[0]/=len; outN[1]/=len; outN[2]/=len; }
-    else              { outN[0]=0.0f; outN[1]=1.0f; outN[2]=0.0f; }
+    return GltfSceneBuilder::lodLevelCount();
 }
 
 // ---------------------------------------------------------------------------
-// Binary helpers
+// Skeleton / animation extraction
 // ---------------------------------------------------------------------------
 
-void DzGLTFExporter::appendFloat32LE(QByteArray& buf, float v)
+// Quaternions below are xyzw floats, matching the glTF layout.
+static void quatConjugate(const float* q, float* out)
+{
+    out[0] = -q[0]; out[1] = -q[1]; out[2] = -q[2]; out[3] = q[3];
+}
+
+static void quatMul(const float* a, const float* b, float* out)
+{
+    float r[4];
+    r[0] = a[3]*b[0] + a[0]*b[3] + a[1]*b[2] - a[2]*b[1];
+    r[1] = a[3]*b[1] - a[0]*b[2] + a[1]*b[3] + a[2]*b[0];
+    r[2] = a[3]*b[2] + a[0]*b[1] - a[1]*b[0] + a[2]*b[3];
+    r[3] = a[3]*b[3] - a[0]*b[0] - a[1]*b[1] - a[2]*b[2];
+    memcpy(out, r, sizeof(r));
+}
+
+static void quatRotate(const float* q, const float* v, float* out)
 {
-    quint32 bits;
-    memcpy(&bits, &v, sizeof(bits));
-    appendUint32LE(buf, bits);
+    // v' = v + 2w(q x v) + 2 q x (q x v)
+    float t[3] = { 2.0f*(q[1]*v[2] - q[2]*v[1]),
+                   2.0f*(q[2]*v[0] - q[0]*v[2]),
+                   2.0f*(q[0]*v[1] - q[1]*v[0]) };
+    out[0] = v[0] + q[3]*t[0] + (q[1]*t[2] - q[2]*t[1]);
+    out[1] = v[1] + q[3]*t[1] + (q[2]*t[0] - q[0]*t[2]);
+    out[2] = v[2] + q[3]*t[2] + (q[0]*t[1] - q[1]*t[0]);
 }
 
-void DzGLTFExporter::appendUint32LE(QByteArray& buf, quint32 v)
+// Column-major 4x4 of rotation @p q followed by translation @p t.
+static void rigidMatrix(const float* q, const float* t, float* out)
 {
-    buf.append((char)( v        & 0xFF));
-    buf.append((char)((v >>  8) & 0xFF));
-    buf.append((char)((v >> 16) & 0xFF));
-    buf.append((char)((v >> 24) & 0xFF));
+    const float x = q[0], y = q[1], z = q[2], w = q[3];
+    const float m[16] = {
+        1.0f - 2.0f*(y*y + z*z), 2.0f*(x*y + w*z),        2.0f*(x*z - w*y),        0.0f,
+        2.0f*(x*y - w*z),        1.0f - 2.0f*(x*x + z*z), 2.0f*(y*z + w*x),        0.0f,
+        2.0f*(x*z + w*y),        2.0f*(y*z - w*x),        1.0f - 2.0f*(x*x + y*y), 0.0f,
+        t[0],                    t[1],                    t[2],                    1.0f
+    };
+    memcpy(out, m, sizeof(m));
 }
 
-QByteArray DzGLTFExporter::padTo4(const QByteArray& data, char padByte)
+void DzGLTFExporter::extractSkeleton(DzNode* node, QVector<GltfNodeData>& outNodes,
+                                     QVector<DzNode*>& outSources)
 {
-    QByteArray result = data;
-    int rem = result.size() % 4;
-    if (rem != 0) result.append(QByteArray(4 - rem, padByte));
-    return result;
+    // Depth-first walk so every parent precedes its children.
+    int parentIdx = outSources.indexOf(node);
+    DzTime now = dzScene->getTime();
+
+    for (int i = 0; i < node->getNumNodeChildren(); ++i)
+    {
+        DzBone* bone = qobject_cast<DzBone*>(node->getNodeChild(i));
+        if (!bone)
+            continue;
+
+        GltfNodeData jn;
+        jn.name   = bone->getName();
+        jn.parent = parentIdx;
+        sampleLocalTransform(bone, node, now, jn.translation, jn.rotation);
+
+        outNodes.append(jn);
+        outSources.append(bone);
+        extractSkeleton(bone, outNodes, outSources);
+    }
+}
+
+void DzGLTFExporter::sampleLocalTransform(DzNode* node, DzNode* parent, qint64 time,
+                                          float* outT, float* outR) const
+{
+    DzVec3 p  = node->getWSPos(time);
+    DzQuat r  = node->getWSRot(time);
+    DzVec3 pp = parent->getWSPos(time);
+    DzQuat pr = parent->getWSRot(time);
+
+    float rot[4]  = { (float)r.m_x,  (float)r.m_y,  (float)r.m_z,  (float)r.m_w };
+    float prot[4] = { (float)pr.m_x, (float)pr.m_y, (float)pr.m_z, (float)pr.m_w };
+    float inv[4];
+    quatConjugate(prot, inv);
+
+    float d[3] = { (p.m_x - pp.m_x) * m_fScale,
+                   (p.m_y - pp.m_y) * m_fScale,
+                   (p.m_z - pp.m_z) * m_fScale };
+    quatRotate(inv, d, outT);
+    quatMul(inv, rot, outR);
+}
+
+void DzGLTFExporter::sampleWorldMatrix(DzNode* node, qint64 time, float* out) const
+{
+    DzVec3    p = node->getWSPos(time);
+    DzQuat    r = node->getWSRot(time);
+    DzMatrix3 s = node->getWSScale(time);
+
+    // scale, then rotation: column j of R*S is column j of S rotated
+    float q[4] = { (float)r.m_x, (float)r.m_y, (float)r.m_z, (float)r.m_w };
+    DzVec3 rows[3] = { s.row(0), s.row(1), s.row(2) };
+    float cols[3][3] = {
+        { rows[0].m_x, rows[1].m_x, rows[2].m_x },
+        { rows[0].m_y, rows[1].m_y, rows[2].m_y },
+        { rows[0].m_z, rows[1].m_z, rows[2].m_z }
+    };
+    for (int col = 0; col < 3; ++col) {
+        quatRotate(q, cols[col], out + col*4);
+        out[col*4 + 3] = 0.0f;
+    }
+    out[12] = p.m_x * m_fScale;
+    out[13] = p.m_y * m_fScale;
+    out[14] = p.m_z * m_fScale;
+    out[15] = 1.0f;
 }
 
 // ---------------------------------------------------------------------------
-// JSON helpers
+// Skinning
 // ---------------------------------------------------------------------------
 
-QString DzGLTFExporter::jsonFloat(float v)
+void DzGLTFExporter::collectFittedItems(DzNode* figure, QVector<DzNode*>& outItems)
+{
+    for (int i = 0; i < dzScene->getNumNodes(); ++i) {
+        DzSkeleton* item = qobject_cast<DzSkeleton*>(dzScene->getNode(i));
+        if (item && item != figure && item->isVisible() && item->getFollowTarget() == figure)
+            outItems.append(item);
+    }
+}
+
+bool DzGLTFExporter::snapshotSkinWeights(DzNode* node, const QVector<DzNode*>& sources,
+                                         GltfMeshSnapshot& snap)
+{
+    DzSkeleton* skel = qobject_cast<DzSkeleton*>(node);
+    DzSkinBinding* binding = skel ? skel->getSkinBinding() : 0;
+    if (!binding || snap.vertexCount() == 0)
+        return false;
+
+    // Joints are matched by name, so a conformer's own bones bind to the
+    // figure's joints of the same name.
+    QHash<QString, int> jointByName;
+    for (int j = 1; j < sources.size(); ++j)
+        jointByName.insert(sources[j]->getName(), j - 1);
+
+    const int numVerts = snap.vertexCount();
+    snap.joints.fill(0, numVerts * 4);
+    snap.weights.fill(0.0f, numVerts * 4);
+    quint16* vj = snap.joints.data();
+    float*   vw = snap.weights.data();
+
+    for (int b = 0; b < binding->getNumBoneBindings(); ++b)
+    {
+        DzBoneBinding* bb = binding->getBoneBinding(b);
+        DzWeightMap* map  = bb ? bb->getWeights() : 0;
+        if (!map)
+            continue;
+
+        // Bones the figure lacks (skirt, hair) fall back to their nearest
+        // ancestor that it has.
+        int joint = -1;
+        for (DzNode* n = bb->getBone(); n && joint < 0; n = n->getNodeParent())
+            joint = jointByName.value(n->getName(), -1);
+        if (joint < 0)
+            continue;
+
+        const unsigned short* w = map->getWeights();
+        int count = qMin(map->getNumWeights(), numVerts);
+        for (int v = 0; v < count; ++v)
+        {
+            if (w[v] == 0)
+                continue;
+            float wf = w[v] / 65535.0f;
+            quint16* j4 = vj + v * 4;
+            float*   w4 = vw + v * 4;
+
+            // several bones can fold onto one joint
+            int slot = -1;
+            for (int k = 0; k < 4 && slot < 0; ++k)
+                if (w4[k] > 0.0f && j4[k] == joint)
+                    slot = k;
+            if (slot >= 0) {
+                w4[slot] += wf;
+                continue;
+            }
+
+            // keep the four strongest influences
+            int smallest = 0;
+            for (int k = 1; k < 4; ++k)
+                if (w4[k] < w4[smallest])
+                    smallest = k;
+            if (wf > w4[smallest]) {
+                w4[smallest] = wf;
+                j4[smallest] = (quint16)joint;
+            }
+        }
+    }
+
+    // glTF wants weights summing to 1; unweighted vertices follow the root joint
+    for (int v = 0; v < numVerts; ++v) {
+        float* w4 = vw + v * 4;
+        float sum = w4[0] + w4[1] + w4[2] + w4[3];
+        if (sum <= 0.0f) {
+            vj[v*4] = 0;
+            w4[0]   = 1.0f;
+            continue;
+        }
+        for (int k = 0; k < 4; ++k)
+            w4[k] /= sum;
+    }
+    return true;
+}
+
+void DzGLTFExporter::buildSkin(const QVector<DzNode*>& sources, GltfSkinData& outSkin) const
+{
+    // The base mesh is in default (unposed) space, so each joint's bind
+    // matrix is its default world transform.
+    DzTime now = dzScene->getTime();
+    for (int j = 1; j < sources.size(); ++j)
+    {
+        DzVec3 p = sources[j]->getWSPos(now, true);
+        DzQuat r = sources[j]->getWSRot(now, true);
+
+        float q[4] = { (float)r.m_x, (float)r.m_y, (float)r.m_z, (float)r.m_w };
+        float inv[4];
+        quatConjugate(q, inv);
+
+        float negP[3] = { -p.m_x * m_fScale, -p.m_y * m_fScale, -p.m_z * m_fScale };
+        float t[3];
+        quatRotate(inv, negP, t);
+
+        float m[16];
+        rigidMatrix(inv, t, m);
+
+        outSkin.joints.append(j);
+        for (int k = 0; k < 16; ++k)
+            outSkin.inverseBindMatrices.append(m[k]);
+    }
+}
+
+void DzGLTFExporter::sampleSkinPoses(const QVector<DzNode*>& sources,
+                                     QVector< QVector<float> >& outPoses) const
+{
+    // Bind pose, the pose on screen, then frames spread over the take.
+    outPoses.append(QVector<float>());
+
+    DzTime now = dzScene->getTime();
+    QVector<DzTime> times;
+    times.append(now);
+    int frames = animationFrameCount();
+    if (frames > 1) {
+        DzTime start = dzScene->getAnimRange().getStart();
+        DzTime step  = dzScene->getTimeStep();
+        int samples  = qMin(frames, kOcclusionPoseSamples);
+        for (int k = 0; k < samples; ++k)
+            times.append(start + (DzTime)((frames - 1) * k / qMax(samples - 1, 1)) * step);
+    }
+
+    for (int i = 0; i < times.size(); ++i)
+    {
+        // joint matrix = posed world * inverse bind, as one rigid transform
+        QVector<float> pose((sources.size() - 1) * 16);
+        for (int j = 1; j < sources.size(); ++j)
+        {
+            DzVec3 bp = sources[j]->getWSPos(now, true);
+            DzQuat br = sources[j]->getWSRot(now, true);
+            DzVec3 p  = sources[j]->getWSPos(times[i]);
+            DzQuat r  = sources[j]->getWSRot(times[i]);
+
+            float bq[4] = { (float)br.m_x, (float)br.m_y, (float)br.m_z, (float)br.m_w };
+            float q[4]  = { (float)r.m_x,  (float)r.m_y,  (float)r.m_z,  (float)r.m_w };
+            float inv[4], rel[4];
+            quatConjugate(bq, inv);
+            quatMul(q, inv, rel);
+
+            float bind[3] = { bp.m_x * m_fScale, bp.m_y * m_fScale, bp.m_z * m_fScale };
+            float moved[3];
+            quatRotate(rel, bind, moved);
+            float t[3] = { p.m_x * m_fScale - moved[0],
+                           p.m_y * m_fScale - moved[1],
+                           p.m_z * m_fScale - moved[2] };
+            rigidMatrix(rel, t, pose.data() + (j - 1) * 16);
+        }
+        outPoses.append(pose);
+    }
+}
+
+void DzGLTFExporter::declareChannels(const QVector<GltfNodeData>& nodes, int numJoints,
+                                     QVector<GltfAnimChannel>& outChannels)
 {
-    return QString::number((double)v, 'f', 6);
+    // Node 0 is the mesh root and stays at identity; bones (nodes 1..numJoints)
+    // carry the motion.  Fitted items follow the bones and are not animated.
+    outChannels.resize(qMax(numJoints, 0) * 2);
+    for (int j = 0; j < numJoints; ++j)
+    {
+        const GltfNodeData& jn = nodes[j + 1];
+        GltfAnimChannel& tc = outChannels[j * 2];
+        GltfAnimChannel& rc = outChannels[j * 2 + 1];
+        tc.node = rc.node = j + 1;
+        tc.path = GltfAnimChannel::Translation;
+        rc.path = GltfAnimChannel::Rotation;
+        memcpy(tc.restValue, jn.translation, sizeof(jn.translation));
+        memcpy(rc.restValue, jn.rotation,    sizeof(jn.rotation));
+    }
+}
+
+int DzGLTFExporter::animationFrameCount() const
+{
+    DzTimeRange range = dzScene->getAnimRange();
+    DzTime step = dzScene->getTimeStep();
+    if (step <= 0)
+        return 0;
+    return (int)((range.getEnd() - range.getStart()) / step) + 1;
+}
+
+void DzGLTFExporter::extractAnimations(const QVector<DzNode*>& sources,
+                                       const QVector<GltfNodeData>& nodes,
+                                       QVector<GltfAnimChannel>& outChannels)
+{
+    DzTimeRange range = dzScene->getAnimRange();
+    DzTime step = dzScene->getTimeStep();
+    int numFrames = animationFrameCount();
+    if (numFrames < 2 || sources.size() < 2)
+        return;
+
+    int numJoints = sources.size() - 1;
+    declareChannels(nodes, numJoints, outChannels);
+    for (int c = 0; c < outChannels.size(); ++c) {
+        outChannels[c].times.reserve(numFrames);
+        outChannels[c].values.reserve(numFrames * outChannels[c].componentCount());
+    }
+
+    for (int f = 0; f < numFrames; ++f)
+    {
+        DzTime t = range.getStart() + (DzTime)f * step;
+        float seconds = (float)((double)(t - range.getStart()) / kDazTicksPerSecond);
+
+        for (int j = 0; j < numJoints; ++j)
+        {
+            DzNode* src    = sources[j + 1];
+            DzNode* parent = sources[nodes[j + 1].parent];
+            float tr[3], rot[4];
+            sampleLocalTransform(src, parent, t, tr, rot);
+
+            GltfAnimChannel& tc = outChannels[j * 2];
+            GltfAnimChannel& rc = outChannels[j * 2 + 1];
+            tc.times.append(seconds);
+            rc.times.append(seconds);
+            for (int c = 0; c < 3; ++c) tc.values.append(tr[c]);
+            for (int c = 0; c < 4; ++c) rc.values.append(rot[c]);
+        }
+    }
 }
 
-QString DzGLTFExporter::jsonVec3(float x, float y, float z)
+bool DzGLTFExporter::sampleAnimationStreamed(const QVector<GltfNodeData>& nodes,
+                                             const QVector<DzNode*>& sources,
+                                             PendingExport& job)
 {
-    return QString("[%1,%2,%3]").arg(jsonFloat(x)).arg(jsonFloat(y)).arg(jsonFloat(z));
+    GltfTraceScope trace("sampleAnimationStreamed", "export");
+    QVector<GltfAnimChannel> descs;
+    declareChannels(nodes, sources.size() - 1, descs);
+
+    job.stream = new GltfAnimationStream(m_keyReduction);
+    GltfAnimationStream& stream = *job.stream;
+    if (!stream.begin(descs, job.outputPath + ".anim.tmp")) {
+        m_sLastError = stream.getLastError();
+        return false;
+    }
+
+    // ---- sample and fit, one window at a time ----------------------------
+    DzTimeRange range = dzScene->getAnimRange();
+    DzTime step = dzScene->getTimeStep();
+    int numFrames = animationFrameCount();
+    int numJoints = sources.size() - 1;
+    int window    = qMax(m_nAnimationWindowFrames, 1);
+
+    QVector<float> times;
+    times.reserve(window);
+    QVector< QVector<float> > values(descs.size());
+    for (int c = 0; c < descs.size(); ++c)
+        values[c].reserve(window * descs[c].componentCount());
+
+    for (int w0 = 0; w0 < numFrames && numJoints > 0; w0 += window)
+    {
+        int w1 = qMin(w0 + window, numFrames);
+        times.resize(0);
+        for (int c = 0; c < values.size(); ++c)
+            values[c].resize(0);
+
+        for (int f = w0; f < w1; ++f)
+        {
+            DzTime t = range.getStart() + (DzTime)f * step;
+            times.append((float)((double)(t - range.getStart()) / kDazTicksPerSecond));
+
+            for (int j = 0; j < numJoints; ++j)
+            {
+                float tr[3], rot[4];
+                sampleLocalTransform(sources[j + 1], sources[nodes[j + 1].parent], t, tr, rot);
+                for (int c = 0; c < 3; ++c) values[j * 2].append(tr[c]);
+                for (int c = 0; c < 4; ++c) values[j * 2 + 1].append(rot[c]);
+            }
+        }
+
+        if (!stream.appendWindow(times, values)) {
+            m_sLastError = stream.getLastError();
+            return false;
+        }
+    }
+    if (!stream.finish()) {
+        m_sLastError = stream.getLastError();
+        return false;
+    }
+    m_lastKeyStats = stream.stats();
+    return true;
 }
@@ -2,46 +2,109 @@
 
 #include <QString>
 #include <QVector>
-#include <QByteArray>
+#include <QMap>
+#include <QSet>
+#include <QFuture>
+#include <QAtomicInt>
 
+#include "GltfTypes.h"
+#include "GltfKeyframeReducer.h"
+#include "GltfGlbWriter.h"
+
+class GltfHasher;
+class GltfBufferPool;
 class DzNode;
 class DzFacetMesh;
 class DzShape;
 class DzMaterial;
 
-/// Per-primitive (per-material-group) geometry and material data.
-struct GltfPrimData
+/// Counts of the Daz meshes an export snapshot or content hash read, taken
+/// in the loops that read them; what the FBX of the same nodes carries.
+struct GltfSourceStats
 {
-    // Geometry — expanded (no shared vertices), one entry per triangle corner.
-    // positions.size() == normals.size() == texcoords.size()/2 * 3
-    QVector<float> positions;   // xyz, flat
-    QVector<float> normals;     // xyz, flat (flat per-face normals)
-    QVector<float> texcoords;   // uv,  flat (V flipped for glTF convention)
-
-    // Material
-    QString materialName;
-    float   baseColor[4];              // RGBA, default 1,1,1,1
-    float   metallicFactor;            // default 0
-    float   roughnessFactor;           // default 0.5
-    QString baseColorTexturePath;      // absolute path, empty if none
-    QString normalTexturePath;         // absolute path, empty if none
+    qint64        vertices;
+    qint64        triangles;       // a quad counts as two
+    int           primitives;      // non-empty material groups
+    QSet<QString> materials;       // "<node>/<material>"
+    QSet<QString> textures;        // image paths of every map
+    qint64        texturePixels;   // over those images, at their original size
+
+    GltfSourceStats() : vertices(0), triangles(0), primitives(0), texturePixels(0) {}
 };
 
 /// Exports the selected DzNode as a GLB (binary glTF 2.0) file.
 /// No external libraries required — uses a hand-written GLB serialiser.
 ///
-/// Extensible stubs:
-///   - extractSkeleton()  for bone hierarchy export
-///   - extractMorphs()    for morph target (blend shape) export
-///   - extractAnimations() for keyframe animation export
+/// This class is the Daz Studio side only: it snapshots the scene, reading
+/// meshes and materials through a GltfMeshSource adapter, and drives the
+/// SDK-free core (GltfSceneBuilder to expand and build LODs, GltfGlbWriter
+/// to serialise), which builds and is tested without Daz Studio.
+///
+/// When animation export is enabled and the node is a figure, its bones are
+/// written as a node hierarchy and every frame of the scene's animation range
+/// is sampled, then thinned by GltfKeyframeReducer before serialisation.
+///
+/// Meshes can be Catmull-Clark subdivided through OpenSubdiv before they are
+/// expanded, globally or per material group (see GltfSubdivider).
+///
+/// With skin export enabled a figure's mesh is bound to its bones through
+/// JOINTS_0/WEIGHTS_0 and a glTF skin.  Fitted items (conformers following
+/// the figure) can be added as further meshes bound to that same skin; their
+/// geometry is snapshotted on the main thread and expanded in parallel.
+///
+/// Body triangles that opaque fitted clothing covers in every sampled pose
+/// can be dropped, or split into their own primitives (GltfOcclusionCuller).
+///
+/// In hierarchy mode the node's whole subtree (or, via exportSceneGLB(), every
+/// scene root) is written as a glTF node tree.  Meshes are content-hashed so
+/// identical geometry is stored once; leaf nodes sharing a mesh are folded
+/// into a single EXT_mesh_gpu_instancing node.
+///
+/// Split-buffer mode writes a .gltf plus categorised .bin files instead, for
+/// output past GLB's 4 GB limit.
+///
+/// Optionally each mesh also gets an LOD chain, simplified per primitive in
+/// parallel by GltfMeshSimplifier and written through MSFT_lod.
+///
+/// Only the snapshot touches the scene.  startExportGLB() returns once it is
+/// taken and leaves expansion, culling, LODs and writing to the thread pool,
+/// so the UI stays live and the export can be cancelled.
+///
+/// Re-exports can patch only the buffer ranges that changed
+/// (setIncrementalUpdate()), and hashSceneContent() lets the caller skip an
+/// export whose inputs have not changed at all.
+///
+/// Morph targets are not written; blend shapes reach Unity through the FBX.
 class DzGLTFExporter
 {
 public:
     DzGLTFExporter();
+    ~DzGLTFExporter();
 
     /// Export @p node to @p outputPath (.glb).  Returns true on success.
     bool exportGLB(DzNode* node, const QString& outputPath);
 
+    /// Export every top-level scene node, in hierarchy mode.
+    bool exportSceneGLB(const QString& outputPath);
+
+    /// Asynchronous exportGLB(): copy what the export needs out of the
+    /// scene on this (UI) thread, then expand, encode and write on the
+    /// thread pool.  Returns false if the snapshot fails.  Poll
+    /// isExportFinished() and getProgress(), then collect the result with
+    /// waitForExport().  Streamed animation is sampled and its keys
+    /// fitted before this returns; assembly, LODs and the write still
+    /// run in the background.
+    bool startExportGLB(DzNode* node, const QString& outputPath);
+    bool startExportSceneGLB(const QString& outputPath);
+
+    bool isExportFinished() const;
+    /// Rough completion of the running export, 0-100.
+    int  getProgress() const { return m_progress; }
+    /// Stop at the next stage or buffer write; partial files are removed.
+    void cancelExport();
+    /// Block until the export is done; true if it succeeded.
+    bool waitForExport();
+
     QString getLastError() const { return m_sLastError; }
 
     /// Scale factor applied to all positions. Daz Studio uses centimetres;
@@ -49,28 +112,205 @@ public:
     void setScaleFactor(float s) { m_fScale = s; }
     float getScaleFactor() const { return m_fScale; }
 
+    /// Sample the figure's bones over the scene animation range.
+    void setExportAnimation(bool b) { m_bExportAnimation = b; }
+    bool getExportAnimation() const { return m_bExportAnimation; }
+
+    /// Curve reduction applied to sampled channels before they are written.
+    void setKeyReductionOptions(const GltfKeyReductionOptions& o) { m_keyReduction = o; }
+    const GltfKeyReductionOptions& getKeyReductionOptions() const { return m_keyReduction; }
+
+    /// Sample the take in windows of @p frames and stream the kept keys to
+    /// disk window by window, so peak memory does not grow with take length.
+    /// 0 (default) samples the whole take in memory.
+    void setAnimationWindowFrames(int frames) { m_nAnimationWindowFrames = frames; }
+    int getAnimationWindowFrames() const { return m_nAnimationWindowFrames; }
+
+    /// Key counts before/after reduction for the last exportGLB() call.
+    const GltfKeyReductionStats& getLastKeyReductionStats() const { return m_lastKeyStats; }
+
+    /// Bind the figure mesh to its skeleton (JOINTS_0/WEIGHTS_0 + skin).
+    void setExportSkin(bool b) { m_bExportSkin = b; }
+    bool getExportSkin() const { return m_bExportSkin; }
+
+    /// Also export every item fitted to the figure, sharing its skin.
+    /// Implies skin export.
+    void setIncludeFittedItems(bool b) { m_bIncludeFittedItems = b; }
+    bool getIncludeFittedItems() const { return m_bIncludeFittedItems; }
+
+    /// Catmull-Clark subdivision applied to exported meshes (0 = base mesh).
+    void setSubdivisionLevel(int level) { m_nSubdivisionLevel = level; }
+    int getSubdivisionLevel() const { return m_nSubdivisionLevel; }
+
+    /// Per-material-group overrides of the subdivision level, keyed by
+    /// surface name, e.g. only "Face" and "Hands" at level 2.
+    void setGroupSubdivisionLevels(const QMap<QString, int>& levels) { m_groupSubdivLevels = levels; }
+    const QMap<QString, int>& getGroupSubdivisionLevels() const { return m_groupSubdivLevels; }
+
+    /// Remove body triangles hidden under opaque fitted items in the bind
+    /// pose, the current pose and a spread of animation frames.  Needs
+    /// fitted items.
+    void setRemoveHiddenSurfaces(bool b) { m_bRemoveHiddenSurfaces = b; }
+    bool getRemoveHiddenSurfaces() const { return m_bRemoveHiddenSurfaces; }
+
+    /// Keep hidden triangles as separate "<material>_Hidden" primitives
+    /// rather than dropping them, so they can be shown when clothes come off.
+    void setSeparateHiddenSurfaces(bool b) { m_bSeparateHiddenSurfaces = b; }
+    bool getSeparateHiddenSurfaces() const { return m_bSeparateHiddenSurfaces; }
+
+    /// Body triangles removed or separated by the last exportGLB() call.
+    int getLastHiddenTriangleCount() const { return m_nLastHiddenTris; }
+
+    /// Walk the node's children too, writing one glTF node per DzNode.
+    /// Ignored when animation export is enabled.
+    void setExportHierarchy(bool b) { m_bExportHierarchy = b; }
+    bool getExportHierarchy() const { return m_bExportHierarchy; }
+
+    /// Fold leaf nodes that share a mesh into EXT_mesh_gpu_instancing nodes.
+    void setGpuInstancing(bool b) { m_bGpuInstancing = b; }
+    bool getGpuInstancing() const { return m_bGpuInstancing; }
+
+    /// Distinct meshes written, and nodes folded into instance buffers,
+    /// by the last hierarchy export.
+    int getLastUniqueMeshCount() const { return m_nLastUniqueMeshes; }
+    int getLastInstancedNodeCount() const { return m_nLastInstancedNodes; }
+
+    /// Write a JSON .gltf (at the given output path) plus external .bin
+    /// buffers instead of one .glb.  Geometry, morphs and animation go to
+    /// separate files named "<name>_<category><n>.bin", each capped at
+    /// setMaxBufferBytes() and written concurrently.  Lifts GLB's 4 GB limit.
+    void setSplitBuffers(bool b) { m_writer.setSplitBuffers(b); }
+    bool getSplitBuffers() const { return m_writer.getSplitBuffers(); }
+
+    /// Largest .bin in split output; a single accessor larger than this
+    /// gets a file of its own.  0 = one file per category.
+    void setMaxBufferBytes(qint64 bytes) { m_writer.setMaxBufferBytes(bytes); }
+    qint64 getMaxBufferBytes() const { return m_writer.getMaxBufferBytes(); }
+
+    /// Keep a hidden sidecar index (".<file>.idx") of every buffer range and
+    /// its content hash.  A re-export with the same layout then rewrites
+    /// only the ranges whose content changed, plus the JSON; anything that
+    /// resizes a range falls back to a full write.  GLB JSON chunks get up
+    /// to 4 KB of space padding so small material edits still fit.
+    void setIncrementalUpdate(bool b) { m_writer.setIncrementalUpdate(b); }
+    bool getIncrementalUpdate() const { return m_writer.getIncrementalUpdate(); }
+
+    /// Whether the last write patched the existing files, and the bytes it
+    /// wrote (header, JSON and buffer data).
+    bool   getLastWriteIncremental() const { return m_writer.getLastWriteIncremental(); }
+    qint64 getLastBytesWritten() const { return m_writer.getLastBytesWritten(); }
+
+    /// .bin files the last split-buffer export wrote beside its .gltf.
+    QStringList getLastBufferFiles() const { return m_writer.getLastBufferFiles(); }
+
+    /// Counts and stage timings of the last write; valid once the export
+    /// has finished.
+    const GltfSceneStats&   getLastSceneStats() const { return m_writer.getLastStats(); }
+    const GltfWriteTimings& getLastWriteTimings() const { return m_writer.getLastTimings(); }
+
+    /// Scratch blocks for encoding buffer data come from this pool.  By
+    /// default each exporter has its own, kept between its exports; batch
+    /// callers can share one across exporters and trim() it when done.
+    /// Null restores the exporter's own pool.  Not owned.
+    void setBufferPool(GltfBufferPool* pool);
+    GltfBufferPool* getBufferPool() const { return m_writer.getBufferPool(); }
+
+    /// Build LOD1-3 for every mesh and attach them through MSFT_lod, with
+    /// MSFT_screencoverage hints matching DazLODGenerator's thresholds.
+    void setGenerateLods(bool b) { m_bGenerateLods = b; }
+    bool getGenerateLods() const { return m_bGenerateLods; }
+
+    /// Number of LOD levels written below LOD0 when generation is enabled.
+    static int lodLevelCount();
+
+    /// Content hash of @p roots' subtrees as they stand: geometry, UVs,
+    /// every node, modifier (morph) and material property value, and world
+    /// transforms in the current pose.  Equal hashes mean an export would read the same scene
+    /// data; used to skip regenerating unchanged outputs.
+    bool hashSceneContent(const QVector<DzNode*>& roots, quint64& outHash);
+
+    /// Meshes, materials and textures read by the last hashSceneContent()
+    /// or export snapshot, whichever came last.
+    const GltfSourceStats& getLastSourceStats() const { return m_sourceStats; }
+
 private:
     QString m_sLastError;
     float   m_fScale;
+    bool    m_bExportAnimation;
+    int     m_nAnimationWindowFrames;
+    bool    m_bExportHierarchy;
+    bool    m_bExportSkin;
+    bool    m_bIncludeFittedItems;
+    int     m_nSubdivisionLevel;
+    bool    m_bRemoveHiddenSurfaces;
+    bool    m_bSeparateHiddenSurfaces;
+    int     m_nLastHiddenTris;
+    QMap<QString, int> m_groupSubdivLevels;
+    bool    m_bGpuInstancing;
+    int     m_nLastUniqueMeshes;
+    int     m_nLastInstancedNodes;
+    bool    m_bGenerateLods;
+    GltfSourceStats m_sourceStats;
+    GltfGlbWriter m_writer;
 
-    // ---- mesh extraction ----
-    bool buildPrimitives(DzNode* node, QVector<GltfPrimData>& outPrims);
-    void extractMaterial(DzMaterial* mat, GltfPrimData& prim);
+    // ---- asynchronous export ----
+    struct PendingExport;
+    PendingExport* m_pPendingExport;
+    QFuture<bool>  m_exportFuture;
+    bool           m_bExportRunning;
+    bool           m_bExportResult;
+    QAtomicInt     m_cancel;
+    QAtomicInt     m_progress;
 
-    // ---- GLB serialisation ----
-    QByteArray buildGLB(const QVector<GltfPrimData>& prims,
-                        const QString& nodeName);
+    bool beginExport();
+    bool launchExport(PendingExport* job, bool snapshotOk);
+    bool exportCancelled();
+    bool snapshotNode(DzNode* node, PendingExport& job);
+    bool assembleScene(PendingExport& job);
+    bool assembleHierarchy(PendingExport& job);
+    bool finishExport();
+    GltfKeyReductionOptions m_keyReduction;
+    GltfKeyReductionStats   m_lastKeyStats;
+
+    // ---- mesh extraction ----
+    static DzFacetMesh* facetMeshOf(DzNode* node, DzShape** outShape);
+    struct NodeSource;
+    friend struct NodeSource;
+    static void extractMaterial(DzMaterial* mat, GltfPrimData& prim);
 
-    // ---- geometry helpers ----
-    static void computeFlatNormal(const float* a, const float* b,
-                                  const float* c, float* outN);
+    // ---- skinning ----
+    void collectFittedItems(DzNode* figure, QVector<DzNode*>& outItems);
+    bool snapshotSkinWeights(DzNode* node, const QVector<DzNode*>& sources,
+                             GltfMeshSnapshot& snap);
+    void buildSkin(const QVector<DzNode*>& sources, GltfSkinData& outSkin) const;
+    void sampleSkinPoses(const QVector<DzNode*>& sources,
+                         QVector< QVector<float> >& outPoses) const;
 
-    // ---- binary helpers ----
-    static void appendFloat32LE(QByteArray& buf, float v);
-    static void appendUint32LE (QByteArray& buf, quint32 v);
-    static QByteArray padTo4(const QByteArray& data, char padByte);
+    // ---- hierarchy / instancing ----
+    bool snapshotHierarchy(const QVector<DzNode*>& roots, PendingExport& job);
+    bool collectHierarchy(DzNode* node, int parentIdx, QVector<GltfNodeData>& outNodes,
+                          QVector<DzNode*>& outSources, QVector<quint64>& outHashes);
+    bool hashNodeMesh(DzNode* node, quint64& outHash);
+    void hashSubtree(DzNode* node, GltfHasher& h);
+    void applyGpuInstancing(QVector<GltfNodeData>& nodes,
+                            const QVector<DzNode*>& sources, int meshCount);
+    void sampleWorldTransform(DzNode* node, qint64 time, float* outT,
+                              float* outR, float* outS) const;
+    /// Column-major 4x4 of the world scale, rotation and translation.
+    void sampleWorldMatrix(DzNode* node, qint64 time, float* out) const;
 
-    // ---- JSON helpers ----
-    static QString jsonFloat(float v);
-    static QString jsonVec3(float x, float y, float z);
+    // ---- skeleton / animation extraction ----
+    void extractSkeleton(DzNode* node, QVector<GltfNodeData>& outNodes,
+                         QVector<DzNode*>& outSources);
+    void declareChannels(const QVector<GltfNodeData>& nodes, int numJoints,
+                         QVector<GltfAnimChannel>& outChannels);
+    int  animationFrameCount() const;
+    void extractAnimations(const QVector<DzNode*>& sources,
+                           const QVector<GltfNodeData>& nodes,
+                           QVector<GltfAnimChannel>& outChannels);
+    bool sampleAnimationStreamed(const QVector<GltfNodeData>& nodes,
+                                 const QVector<DzNode*>& sources,
+                                 PendingExport& job);
+    void sampleLocalTransform(DzNode* node, DzNode* parent, qint64 time,
+                              float* outT, float* outR) const;
 };
@@ -4,6 +4,11 @@
 #include <QtNetwork/qabstractsocket.h>
 #include <QCryptographicHash>
 #include <QtCore/qdir.h>
+#include <QtCore/qbuffer.h>
+#include <QtCore/qfileinfo.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qeventloop.h>
+#include <QtCore/qtimer.h>
 
 #include <dzapp.h>
 #include <dzscene.h>
@@ -29,6 +34,15 @@
 #include "DzUnityAction.h"
 #include "DzUnityDialog.h"
 #include "DzGLTFExporter.h"
+#include "DzUnityExportCache.h"
+#include "DzUnityBatchExporter.h"
+#include "DzUnityJobQueue.h"
+#include "DzUnityJobPanel.h"
+#include "GltfBufferPool.h"
+#include "GltfHash.h"
+#include "GltfTrace.h"
+#include "GltfMemory.h"
+#include "version.h"
 #include "DzBridgeMorphSelectionDialog.h"
 #include "DzBridgeSubdivisionDialog.h"
 
@@ -44,10 +58,27 @@ DzUnityAction::DzUnityAction() :
 	m_nNonInteractiveMode = 0;
 	m_sAssetType = QString("SkeletalMesh");
 	m_bExportGLTF = false;
+	m_pGltfExporter = nullptr;
+	m_bGltfStarted = false;
+	m_bGltfSucceeded = false;
+	m_bWaitingForGltf = false;
+	m_nGltfInFlight = 0;
+	m_bSourceStatsValid = false;
+	m_bBatchRunning = false;
+	m_bFbxWritten = false;
+	m_pGltfBufferPool = new GltfBufferPool();
+	m_bDeferGltfJoin = false;
+	m_pJobQueue = nullptr;
+	m_pJobPanel = nullptr;
 	m_bAutoGenerateLOD = false;
 	m_bAutoSetupRagdoll = false;
 	m_bAutoGenerateMorphClips = false;
 	m_bAutoEnableHairPhysics = false;
+	// scripts set EnableTrace; DAZTOUNITY_TRACE=1 turns it on for interactive sends
+	m_bEnableTrace = qgetenv("DAZTOUNITY_TRACE").toInt() != 0;
+	// likewise EnableMemoryLog and DAZTOUNITY_MEMORY_LOG=1; the log is a
+	// new asset to Unity, reimported on every send, so it is off by default
+	m_bEnableMemoryLog = qgetenv("DAZTOUNITY_MEMORY_LOG").toInt() != 0;
 	//Setup Icon
 	QString iconName = "icon";
 	QPixmap basePixmap = QPixmap::fromImage(getEmbeddedImage(iconName.toLatin1()));
@@ -124,6 +155,14 @@ void DzUnityAction::executeAction()
 		return;
 	}
 
+	// a send is waiting on its glTF with the event loop running; its
+	// exporter and members are still in use
+	if (m_bWaitingForGltf)
+	{
+		dzApp->log("DazToUnity: a send is still writing its glTF, ignoring the new send");
+		return;
+	}
+
 	// Create and show the dialog. If the user cancels, exit early,
 	// otherwise continue on and do the thing that required modal
 	// input from the user.
@@ -188,66 +227,44 @@ void DzUnityAction::executeAction()
 
 	}
 
+	// a queued job is exporting and waiting on the UI: the members it
+	// works from are in use
+	if (m_pJobQueue && m_pJobQueue->isSending())
+	{
+		if (m_nNonInteractiveMode == 0)
+		{
+			QMessageBox::information(0, "Daz To Unity Bridge",
+				tr("A queued send is being exported. Please try again when it has finished."), QMessageBox::Ok);
+		}
+		return;
+	}
+
 	// If the Accept button was pressed, start the export
 	int dlgResult = -1;
 	if (m_nNonInteractiveMode == 0)
 	{
+		// queued jobs wait until the dialog is closed
+		if (m_pJobQueue)
+			m_pJobQueue->setPaused(true);
 		dlgResult = m_bridgeDialog->exec();
+		if (m_pJobQueue)
+			m_pJobQueue->setPaused(false);
 	}
 	if (m_nNonInteractiveMode == 1 || dlgResult == QDialog::Accepted)
 	{
-		// DB 2021-10-11: Progress Bar
-		DzProgress* exportProgress = new DzProgress("Sending to Unity...", 10);
-
-		// Read Common GUI values
-		readGui(m_bridgeDialog);
-
-		// Read Custom GUI values
+		// send in the background: keep the selection and options for the
+		// job queue and hand Daz Studio back at once.  Sends made while
+		// jobs are pending join the queue too, so they run in order.
 		DzUnityDialog* unityDialog = qobject_cast<DzUnityDialog*>(m_bridgeDialog);
-		if (unityDialog)
-		{
-			m_bInstallUnityFiles = unityDialog->installUnityFilesCheckBox->isChecked();
-			m_bExportGLTF = unityDialog->exportGltfCheckBox->isChecked();
-			m_bAutoGenerateLOD = unityDialog->autoGenerateLODCheckBox->isChecked();
-			m_bAutoSetupRagdoll = unityDialog->autoSetupRagdollCheckBox->isChecked();
-			m_bAutoGenerateMorphClips = unityDialog->autoGenerateMorphClipsCheckBox->isChecked();
-			m_bAutoEnableHairPhysics = unityDialog->autoEnableHairPhysicsCheckBox->isChecked();
-		}
-		// custom animation filename correction for Unity
-		if (m_sAssetType == "Animation")
-		{
-			if (m_nNonInteractiveMode == 0)
-			{
-				// correct CharacterFolder
-				m_sExportSubfolder = m_sAssetName.left(m_sAssetName.indexOf("@"));
-				m_sDestinationPath = m_sRootFolder + "/" + m_sExportSubfolder + "/";
-				// correct animation filename
-				m_sDestinationFBX = m_sDestinationPath + m_sAssetName + ".fbx";
-			}
-		}
-
-		//Create Daz3D folder if it doesn't exist
-		QDir dir;
-		dir.mkpath(m_sRootFolder);
-		exportProgress->step();
-
-		exportHD(exportProgress);
-
-		// Fase 5: optional glTF (.glb) export
-		if (m_bExportGLTF && m_pSelectedNode)
+		bool bQueue = unityDialog && unityDialog->queueSendsCheckBox->isChecked();
+		if (m_nNonInteractiveMode == 0 && (bQueue || (m_pJobQueue && m_pJobQueue->isBusy())))
 		{
-			QString glbPath = m_sDestinationPath + m_sExportFilename + ".glb";
-			DzGLTFExporter gltfExporter;
-			if (!gltfExporter.exportGLB(m_pSelectedNode, glbPath))
-			{
-				if (m_nNonInteractiveMode == 0)
-					QMessageBox::warning(0, tr("Daz To Unity Bridge"),
-						tr("glTF export failed: ") + gltfExporter.getLastError());
-			}
+			readSendSettings();
+			enqueueSend();
+			return;
 		}
 
-		// DB 2021-10-11: Progress Bar
-		exportProgress->finish();
+		sendToUnity(true);
 
 		// DB 2021-09-02: messagebox "Export Complete"
 		if (m_nNonInteractiveMode == 0)
@@ -273,6 +290,561 @@ file located in the Assets\\Daz3D\\Support\\ folder of your Unity Project."), QM
 	}
 }
 
+// Reads the dialog into the members a send works from.
+void DzUnityAction::readSendSettings()
+{
+	// Read Common GUI values
+	{
+		GltfTraceScope trace("readGui", "action");
+		GltfMemoryPhaseScope memory("Read Settings");
+		readGui(m_bridgeDialog);
+	}
+
+	// Read Custom GUI values
+	DzUnityDialog* unityDialog = qobject_cast<DzUnityDialog*>(m_bridgeDialog);
+	if (unityDialog)
+	{
+		m_bInstallUnityFiles = unityDialog->installUnityFilesCheckBox->isChecked();
+		m_bExportGLTF = unityDialog->exportGltfCheckBox->isChecked();
+		m_bAutoGenerateLOD = unityDialog->autoGenerateLODCheckBox->isChecked();
+		m_bAutoSetupRagdoll = unityDialog->autoSetupRagdollCheckBox->isChecked();
+		m_bAutoGenerateMorphClips = unityDialog->autoGenerateMorphClipsCheckBox->isChecked();
+		m_bAutoEnableHairPhysics = unityDialog->autoEnableHairPhysicsCheckBox->isChecked();
+	}
+	// custom animation filename correction for Unity
+	if (m_sAssetType == "Animation")
+	{
+		if (m_nNonInteractiveMode == 0)
+		{
+			// correct CharacterFolder
+			m_sExportSubfolder = m_sAssetName.left(m_sAssetName.indexOf("@"));
+			m_sDestinationPath = m_sRootFolder + "/" + m_sExportSubfolder + "/";
+			// correct animation filename
+			m_sDestinationFBX = m_sDestinationPath + m_sAssetName + ".fbx";
+		}
+	}
+}
+
+// The export itself: FBX, DTU and glTF from the members readSendSettings()
+// filled in, now or (queued sends) when the job was accepted.
+void DzUnityAction::sendToUnity(bool bReadSettings)
+{
+	// the trace and memory recorders are process-wide.  While a queued or
+	// batch send before this one is still encoding its glTF on the pool,
+	// restarting them would drop its open events and charge its buffers to
+	// this send's phases, so this send goes unrecorded instead.
+	bool bRecord = (m_nGltfInFlight == 0);
+	if (!bRecord)
+		dzApp->log("DazToUnity: an earlier glTF is still encoding; no trace or memory log for this send");
+
+	// one trace per send, see EnableTrace
+	if (bRecord && m_bEnableTrace)
+		GltfTrace::start();
+	GltfTraceScope sendTrace("Send to Unity", "action");
+	// memory per phase is always recorded and summarised in the log: HD
+	// sends that swap are rare and rarely reproducible.  The full log file
+	// is written only with EnableMemoryLog.
+	if (bRecord)
+		GltfMemory::start();
+	m_aPhaseTimings.clear();
+	m_exportTimer.invalidate();
+	m_mLastExportStats.clear();
+	m_sourceStats = GltfSourceStats();
+	m_bSourceStatsValid = false;
+	m_bFbxWritten = false;
+	QElapsedTimer sendTimer;
+	sendTimer.start();
+
+	// DB 2021-10-11: Progress Bar
+	DzProgress* exportProgress = new DzProgress("Sending to Unity...", 10);
+
+	if (bReadSettings)
+		readSendSettings();
+
+	//Create Daz3D folder if it doesn't exist
+	QDir dir;
+	dir.mkpath(m_sRootFolder);
+	exportProgress->step();
+
+	// Outputs whose inputs hash the same as last time, and which are
+	// still on disk as they were left, are not regenerated: their
+	// timestamps stay put and Unity has nothing to reimport.
+	DzUnityExportCache exportCache(m_sDestinationPath);
+	quint64 nFbxKey = 0, nGltfKey = 0;
+	QElapsedTimer phaseTimer;
+	phaseTimer.start();
+	bool bCacheable = computeExportKeys(nFbxKey, nGltfKey);
+	recordPhaseTiming("Export Keys", phaseTimer);
+	QString sDtuPath = m_sDestinationPath + m_sExportFilename + ".dtu";
+	bool bFbxCurrent = bCacheable
+		&& exportCache.isUpToDate(m_sDestinationFBX, nFbxKey)
+		&& exportCache.isUpToDate(sDtuPath, nFbxKey);
+	bool bGltfCurrent = bCacheable && m_bExportGLTF
+		&& exportCache.isUpToDate(getGltfPath(), nGltfKey);
+
+	// Fase 5: optional glTF (.glb) export.  The scene is snapshotted
+	// before the FBX export touches it; the GLB is then encoded and
+	// written in the background while exportHD() runs, and joined once
+	// the FBX and DTU are written, so the wait reads no scene state.
+	if (!bGltfCurrent)
+	{
+		phaseTimer.restart();
+		startGltfExport();
+		recordPhaseTiming("glTF Snapshot", phaseTimer);
+	}
+
+	// an FBX left over from an earlier send does not count as written
+	m_bFbxWritten = bFbxCurrent;
+	if (!bFbxCurrent)
+	{
+		GltfTraceScope trace("exportHD", "action");
+		GltfMemoryPhaseScope memory("Export FBX");
+		QDateTime fbxBefore = QFileInfo(m_sDestinationFBX).lastModified();
+		m_exportTimer.start();
+		exportHD(exportProgress);
+		QFileInfo fbxInfo(m_sDestinationFBX);
+		m_bFbxWritten = fbxInfo.exists()
+			&& (!fbxBefore.isValid() || fbxInfo.lastModified() > fbxBefore);
+	}
+	else
+		dzApp->log("DazToUnity: scene and options unchanged, keeping the previous FBX and DTU");
+	if (bGltfCurrent)
+		dzApp->log("DazToUnity: scene and options unchanged, keeping the previous glTF");
+
+	// batch sends move on to the next asset while this one encodes,
+	// see takePendingGltf(); otherwise a no-op unless exportHD()
+	// stopped before writeConfiguration()
+	if (m_bDeferGltfJoin && m_pGltfExporter)
+	{
+		m_pendingGltf.pExporter = m_pGltfExporter;
+		m_pendingGltf.bStarted = m_bGltfStarted;
+		m_pendingGltf.sPath = getGltfPath();
+		m_pendingGltf.sCacheFolder = m_sDestinationPath;
+		m_pendingGltf.bCacheable = bCacheable;
+		m_pendingGltf.nKey = nGltfKey;
+		m_pGltfExporter = nullptr;
+		m_bGltfStarted = false;
+	}
+	finishGltfExport();
+
+	if (bCacheable)
+	{
+		if (!bFbxCurrent && m_bFbxWritten)
+		{
+			exportCache.record(m_sDestinationFBX, nFbxKey);
+			exportCache.record(sDtuPath, nFbxKey);
+		}
+		else if (!bFbxCurrent)
+		{
+			exportCache.forget(m_sDestinationFBX);
+			exportCache.forget(sDtuPath);
+		}
+		if (m_bExportGLTF && !bGltfCurrent && !m_pendingGltf.pExporter)
+		{
+			if (m_bGltfSucceeded)
+				exportCache.record(getGltfPath(), nGltfKey, m_aGltfBufferFiles);
+			else
+				exportCache.forget(getGltfPath());
+		}
+	}
+
+	// DB 2021-10-11: Progress Bar
+	exportProgress->finish();
+
+	// the trace covers the export itself, not the message boxes that
+	// follow an interactive send
+	sendTrace.end();
+	recordExportStats(sendTimer);
+	if (!bRecord)
+		return;
+	GltfMemory::stop();
+	if (m_bEnableMemoryLog)
+	{
+		QString sMemoryError;
+		QString sMemoryPath = m_sDestinationPath + m_sExportFilename + ".memory.log";
+		if (GltfMemory::writeLog(sMemoryPath, &sMemoryError))
+			dzApp->log("DazToUnity: memory log written to " + sMemoryPath);
+		else
+			dzApp->log("DazToUnity: " + sMemoryError);
+	}
+	QStringList aMemorySummary = GltfMemory::summary();
+	for (int i = 0; i < aMemorySummary.size(); i++)
+		dzApp->log("DazToUnity: memory: " + aMemorySummary[i]);
+	if (GltfTrace::isEnabled())
+	{
+		GltfTrace::stop();
+		QString sTraceError;
+		QString sTracePath = m_sDestinationPath + m_sExportFilename + ".trace.json";
+		if (GltfTrace::write(sTracePath, &sTraceError))
+			dzApp->log("DazToUnity: timing trace written to " + sTracePath);
+		else
+			dzApp->log("DazToUnity: " + sTraceError);
+	}
+}
+
+DzUnityAction::SendSettings DzUnityAction::captureSendSettings() const
+{
+	SendSettings settings;
+	settings.pNode = m_pSelectedNode;
+	settings.sAssetName = m_sAssetName;
+	settings.sAssetType = m_sAssetType;
+	settings.sRootFolder = m_sRootFolder;
+	settings.sExportSubfolder = m_sExportSubfolder;
+	settings.sDestinationPath = m_sDestinationPath;
+	settings.sDestinationFBX = m_sDestinationFBX;
+	settings.sExportFilename = m_sExportFilename;
+	settings.sProductName = m_sProductName;
+	settings.sProductComponentName = m_sProductComponentName;
+	settings.bEnableMorphs = m_bEnableMorphs;
+	settings.sMorphSelectionRule = m_sMorphSelectionRule;
+	settings.mMorphNameToLabel = m_mMorphNameToLabel;
+	settings.bEnableSubdivisions = m_EnableSubdivisions;
+	settings.bUndoNormalMaps = m_bUndoNormalMaps;
+	settings.bInstallUnityFiles = m_bInstallUnityFiles;
+	settings.bExportGLTF = m_bExportGLTF;
+	settings.bAutoGenerateLOD = m_bAutoGenerateLOD;
+	settings.bAutoSetupRagdoll = m_bAutoSetupRagdoll;
+	settings.bAutoGenerateMorphClips = m_bAutoGenerateMorphClips;
+	settings.bAutoEnableHairPhysics = m_bAutoEnableHairPhysics;
+	return settings;
+}
+
+void DzUnityAction::restoreSendSettings(const SendSettings& settings)
+{
+	m_pSelectedNode = settings.pNode;
+	m_sAssetName = settings.sAssetName;
+	m_sAssetType = settings.sAssetType;
+	m_sRootFolder = settings.sRootFolder;
+	m_sExportSubfolder = settings.sExportSubfolder;
+	m_sDestinationPath = settings.sDestinationPath;
+	m_sDestinationFBX = settings.sDestinationFBX;
+	m_sExportFilename = settings.sExportFilename;
+	m_sProductName = settings.sProductName;
+	m_sProductComponentName = settings.sProductComponentName;
+	m_bEnableMorphs = settings.bEnableMorphs;
+	m_sMorphSelectionRule = settings.sMorphSelectionRule;
+	m_mMorphNameToLabel = settings.mMorphNameToLabel;
+	m_EnableSubdivisions = settings.bEnableSubdivisions;
+	m_bUndoNormalMaps = settings.bUndoNormalMaps;
+	m_bInstallUnityFiles = settings.bInstallUnityFiles;
+	m_bExportGLTF = settings.bExportGLTF;
+	m_bAutoGenerateLOD = settings.bAutoGenerateLOD;
+	m_bAutoSetupRagdoll = settings.bAutoSetupRagdoll;
+	m_bAutoGenerateMorphClips = settings.bAutoGenerateMorphClips;
+	m_bAutoEnableHairPhysics = settings.bAutoEnableHairPhysics;
+}
+
+void DzUnityAction::enqueueSend()
+{
+	if (!m_pJobQueue)
+	{
+		m_pJobQueue = new DzUnityJobQueue(this);
+		m_pJobPanel = new DzUnityJobPanel(m_pJobQueue, dzApp->getInterface());
+	}
+	m_pJobQueue->enqueue(captureSendSettings());
+	m_pJobPanel->show();
+	m_pJobPanel->raise();
+}
+
+// One job of the queue: the send as it was accepted, without message boxes,
+// leaving the glTF encode for the queue to join.  False, with sError set, if
+// no FBX was written.
+bool DzUnityAction::runQueuedSend(const SendSettings& settings, PendingGltf& outGltf, QString& sError)
+{
+	int nInteractiveMode = m_nNonInteractiveMode;
+	m_nNonInteractiveMode = 1;
+	restoreSendSettings(settings);
+	m_bDeferGltfJoin = true;
+	sendToUnity(false);
+	m_bDeferGltfJoin = false;
+	m_nNonInteractiveMode = nInteractiveMode;
+	takePendingGltf(outGltf);
+
+	if (!m_bFbxWritten)
+	{
+		sError = tr("No FBX written to ") + m_sDestinationPath;
+		return false;
+	}
+	if (m_bInstallUnityFiles)
+		createUnityFiles(true);
+	return true;
+}
+
+QVariantList DzUnityAction::exportBatch(const QString& sManifestPath)
+{
+	if (m_bWaitingForGltf)
+	{
+		dzApp->log("DazToUnity: batch: a send is still writing its glTF");
+		return QVariantList();
+	}
+	// a batch and the queue would both drive the same action and glTF state
+	if (m_bBatchRunning || (m_pJobQueue && m_pJobQueue->isBusy()))
+	{
+		dzApp->log("DazToUnity: batch: another batch or queued sends are still running");
+		return QVariantList();
+	}
+
+	DzUnityBatchExporter batch(this);
+	if (!batch.loadManifest(sManifestPath))
+	{
+		dzApp->log("DazToUnity: batch: " + batch.getLastError());
+		return QVariantList();
+	}
+
+	int nInteractiveMode = m_nNonInteractiveMode;
+	m_bBatchRunning = true;
+	bool bCompleted = batch.run();
+	m_bBatchRunning = false;
+	m_nNonInteractiveMode = nInteractiveMode;
+
+	QString sReportPath = sManifestPath + ".report.json";
+	if (batch.writeReport(sReportPath))
+		dzApp->log("DazToUnity: batch report written to " + sReportPath);
+	else
+		dzApp->log("DazToUnity: batch: " + batch.getLastError());
+	if (!bCompleted)
+		dzApp->log("DazToUnity: batch cancelled");
+	return batch.getReport();
+}
+
+void DzUnityAction::startGltfExport()
+{
+	GltfTraceScope trace("startGltfExport", "action");
+	GltfMemoryPhaseScope memory("Snapshot glTF");
+	finishGltfExport();
+	m_bGltfSucceeded = false;
+	if (!m_bExportGLTF || !m_pSelectedNode)
+		return;
+
+	// HD figures can outgrow one GLB: write .gltf + capped .bin files instead
+	bool bSplitBuffers = m_EnableSubdivisions;
+	QString glbPath = getGltfPath();
+	m_pGltfExporter = new DzGLTFExporter();
+	DzGLTFExporter& gltfExporter = *m_pGltfExporter;
+	// scratch blocks survive between sends instead of being reallocated
+	gltfExporter.setBufferPool(m_pGltfBufferPool);
+	gltfExporter.setSplitBuffers(bSplitBuffers);
+	gltfExporter.setExportAnimation(m_sAssetType == "Animation");
+	// long takes are sampled and encoded a window at a time
+	gltfExporter.setAnimationWindowFrames(256);
+	// figures: one skin shared by the body and everything fitted to it
+	bool bFigure = (m_sAssetType == "SkeletalMesh" || m_sAssetType == "Animation");
+	gltfExporter.setExportSkin(bFigure);
+	gltfExporter.setIncludeFittedItems(bFigure);
+	// body hidden under opaque clothing goes to its own "_Hidden" primitives
+	gltfExporter.setRemoveHiddenSurfaces(bFigure);
+	// subdivision: the level the Subdivision dialog left on the figure's shape
+	if (m_EnableSubdivisions && m_pSelectedNode->getObject())
+	{
+		DzShape* shape = m_pSelectedNode->getObject()->getCurrentShape();
+		DzNumericProperty* levelProp = shape ?
+			qobject_cast<DzNumericProperty*>(shape->findProperty("SubDIALevel")) : 0;
+		if (levelProp)
+			gltfExporter.setSubdivisionLevel((int)levelProp->getDoubleValue());
+	}
+	// props and sets: whole hierarchy, repeated meshes instanced
+	gltfExporter.setExportHierarchy(m_sAssetType == "StaticMesh");
+	// LOD chain precomputed here instead of by DazLODGenerator in Unity
+	gltfExporter.setGenerateLods(m_bAutoGenerateLOD);
+	// re-sends patch only the buffer ranges that changed
+	gltfExporter.setIncrementalUpdate(true);
+	// snapshot now; encoding and writing run in the background
+	m_bGltfStarted = (m_sAssetType == "Environment")
+		? gltfExporter.startExportSceneGLB(glbPath)
+		: gltfExporter.startExportGLB(m_pSelectedNode, glbPath);
+	if (m_bGltfStarted)
+		m_nGltfInFlight++;
+	// no content hash for animations and poses; the snapshot counted instead
+	if (m_bGltfStarted && !m_bSourceStatsValid)
+	{
+		m_sourceStats = gltfExporter.getLastSourceStats();
+		m_bSourceStatsValid = true;
+	}
+}
+
+void DzUnityAction::finishGltfExport()
+{
+	if (!m_pGltfExporter)
+		return;
+	GltfTraceScope trace("finishGltfExport", "action");
+	GltfMemoryPhaseScope memory("Finish glTF");
+	QElapsedTimer waitTimer;
+	waitTimer.start();
+	// detached before the wait, so nothing reached from the event loop
+	// can join or delete it a second time
+	DzGLTFExporter* pExporter = m_pGltfExporter;
+	bool bStarted = m_bGltfStarted;
+	m_pGltfExporter = nullptr;
+	m_bGltfStarted = false;
+	m_bGltfSucceeded = joinGltfExport(pExporter, bStarted);
+	if (bStarted)
+		recordPhaseTiming("glTF Wait", waitTimer);
+}
+
+// Waits for pExporter, logs the outcome and deletes it.  True if it wrote
+// its file; m_gltfStats and m_gltfTimings then describe it.  Otherwise
+// pError, if given, gets the reason.
+bool DzUnityAction::joinGltfExport(DzGLTFExporter* pExporter, bool bStarted, QString* pError)
+{
+	DzGLTFExporter& gltfExporter = *pExporter;
+
+	// wait out the background export with the UI live, so the user can
+	// keep working or cancel; the action stays off meanwhile, see
+	// executeAction()
+	bool bGltfOk = bStarted;
+	bool bGltfCancelled = false;
+	if (bGltfOk)
+	{
+		bool bWasWaiting = m_bWaitingForGltf;
+		bool bWasEnabled = isEnabled();
+		m_bWaitingForGltf = true;
+		setEnabled(false);
+		DzProgress gltfProgress("Writing glTF...", 100, true);
+		while (!gltfExporter.isExportFinished())
+		{
+			if (gltfProgress.isCancelled())
+			{
+				gltfExporter.cancelExport();
+				bGltfCancelled = true;
+			}
+			gltfProgress.update(gltfExporter.getProgress());
+			QEventLoop wait;
+			QTimer::singleShot(50, &wait, SLOT(quit()));
+			wait.exec();
+		}
+		bGltfOk = gltfExporter.waitForExport();
+		m_nGltfInFlight--;
+		gltfProgress.finish();
+		setEnabled(bWasEnabled);
+		m_bWaitingForGltf = bWasWaiting;
+	}
+	if (bGltfOk)
+	{
+		m_gltfStats = gltfExporter.getLastSceneStats();
+		m_gltfTimings = gltfExporter.getLastWriteTimings();
+		m_aGltfBufferFiles = gltfExporter.getLastBufferFiles();
+	}
+	if (!bGltfOk && pError)
+		*pError = bGltfCancelled ? tr("cancelled") : gltfExporter.getLastError();
+	if (!bGltfOk && bGltfCancelled)
+	{
+		dzApp->log("DazToUnity: glTF export cancelled");
+	}
+	else if (!bGltfOk)
+	{
+		if (m_nNonInteractiveMode == 0)
+			QMessageBox::warning(0, tr("Daz To Unity Bridge"),
+				tr("glTF export failed: ") + gltfExporter.getLastError());
+	}
+	else if (gltfExporter.getExportAnimation())
+	{
+		const GltfKeyReductionStats& keyStats = gltfExporter.getLastKeyReductionStats();
+		dzApp->log(QString("DazToUnity: glTF animation keys %1 -> %2, channels %3 -> %4")
+			.arg(keyStats.keysIn).arg(keyStats.keysOut)
+			.arg(keyStats.channelsIn).arg(keyStats.channelsOut));
+	}
+	else if (gltfExporter.getLastUniqueMeshCount() > 0)
+	{
+		dzApp->log(QString("DazToUnity: glTF meshes %1, instanced nodes %2")
+			.arg(gltfExporter.getLastUniqueMeshCount())
+			.arg(gltfExporter.getLastInstancedNodeCount()));
+	}
+	if (bGltfOk && gltfExporter.getLastWriteIncremental())
+	{
+		dzApp->log(QString("DazToUnity: glTF patched in place, %1 bytes rewritten")
+			.arg(gltfExporter.getLastBytesWritten()));
+	}
+	if (bGltfOk && gltfExporter.getLastHiddenTriangleCount() > 0)
+	{
+		dzApp->log(QString("DazToUnity: glTF body triangles hidden under clothing: %1")
+			.arg(gltfExporter.getLastHiddenTriangleCount()));
+	}
+
+	delete pExporter;
+
+	// keep about one scratch block per worker thread for the next send
+	m_pGltfBufferPool->trim(32 * 1024 * 1024);
+	GltfBufferPoolStats poolStats = m_pGltfBufferPool->stats();
+	dzApp->log(QString("DazToUnity: glTF buffer pool %1 blocks handed out, %2 allocated (%3 MB total), %4 MB held")
+		.arg(poolStats.acquires).arg(poolStats.allocations)
+		.arg(poolStats.bytesAllocated / (1024 * 1024)).arg(poolStats.bytesHeld / (1024 * 1024)));
+	return bGltfOk;
+}
+
+bool DzUnityAction::takePendingGltf(PendingGltf& out)
+{
+	if (!m_pendingGltf.pExporter)
+		return false;
+	out = m_pendingGltf;
+	m_pendingGltf = PendingGltf();
+	return true;
+}
+
+QString DzUnityAction::getGltfPath() const
+{
+	// HD (subdivided) exports use split .gltf + .bin output, see startGltfExport()
+	return m_sDestinationPath + m_sExportFilename + (m_EnableSubdivisions ? ".gltf" : ".glb");
+}
+
+bool DzUnityAction::computeExportKeys(quint64& nFbxKey, quint64& nGltfKey)
+{
+	GltfTraceScope trace("computeExportKeys", "action");
+	GltfMemoryPhaseScope memory("Export Keys");
+	// an animation's content is every frame of the take, and a pose's the
+	// whole scene; hashing those costs as much as exporting them
+	if (m_sAssetType == "Animation" || m_sAssetType == "Pose")
+		return false;
+
+	QVector<DzNode*> roots;
+	if (m_sAssetType == "Environment")
+	{
+		for (int i = 0; i < dzScene->getNumNodes(); ++i)
+		{
+			DzNode* node = dzScene->getNode(i);
+			if (node && !node->getNodeParent())
+				roots.append(node);
+		}
+	}
+	else if (m_pSelectedNode)
+	{
+		roots.append(m_pSelectedNode);
+	}
+
+	quint64 nContent = 0;
+	DzGLTFExporter hasher;
+	if (!hasher.hashSceneContent(roots, nContent))
+		return false;
+	// counted while hashing, for writeExportStatistics()
+	m_sourceStats = hasher.getLastSourceStats();
+	m_bSourceStatsValid = true;
+
+	// options shared by every output
+	GltfHasher common(nContent);
+	common.updateInt(PLUGIN_VERSION);
+	common.update(m_sAssetType);
+	common.update(m_sAssetName);
+	common.update(m_sExportFilename);
+	common.updateInt(m_EnableSubdivisions);
+
+	GltfHasher fbx(common.digest());
+	fbx.updateInt(m_bEnableMorphs);
+	fbx.update(m_sMorphSelectionRule);
+	fbx.updateInt(m_bUndoNormalMaps);
+	fbx.update(m_sProductName);
+	fbx.update(m_sProductComponentName);
+	fbx.updateInt(m_bExportGLTF);
+	fbx.updateInt(m_bAutoGenerateLOD);
+	fbx.updateInt(m_bAutoSetupRagdoll);
+	fbx.updateInt(m_bAutoGenerateMorphClips);
+	fbx.updateInt(m_bAutoEnableHairPhysics);
+	nFbxKey = fbx.digest();
+
+	GltfHasher gltf(common.digest());
+	gltf.updateInt(m_bAutoGenerateLOD);
+	nGltfKey = gltf.digest();
+	return true;
+}
+
 QString DzUnityAction::createUnityFiles(bool replace)
 {
 	if (!m_bInstallUnityFiles)
@@ -306,15 +878,28 @@ QString DzUnityAction::createUnityFiles(bool replace)
 
 void DzUnityAction::writeConfiguration()
 {
+	GltfTraceScope trace("writeConfiguration", "action");
+	GltfMemoryPhaseScope memory("Write DTU");
+	// exportHD() writes the FBX first, then the DTU.  The background glTF
+	// export is joined after this, see sendToUnity(): the DTU describes the
+	// Daz meshes and is written while the scene is still as exported.
+	if (m_exportTimer.isValid())
+		recordPhaseTiming("FBX Export", m_exportTimer);
+
+	// built in memory and only written if it differs, so an unchanged DTU
+	// keeps its timestamp
 	QString DTUfilename = m_sDestinationPath + m_sExportFilename + ".dtu";
-	QFile DTUfile(DTUfilename);
-	DTUfile.open(QIODevice::WriteOnly);
-	DzJsonWriter writer(&DTUfile);
+	QBuffer DTUbuffer;
+	DTUbuffer.open(QIODevice::WriteOnly);
+	DzJsonWriter writer(&DTUbuffer);
 	writer.startObject(true);
 
 	writeDTUHeader(writer);
 
 	writer.addMember("Auto Generate LOD", m_bAutoGenerateLOD);
+	// LOD levels below LOD0 already present (MSFT_lod) in the .glb, 0 if none
+	writer.addMember("glTF LOD Levels",
+		(m_bExportGLTF && m_bAutoGenerateLOD) ? DzGLTFExporter::lodLevelCount() : 0);
 	writer.addMember("Auto Setup Ragdoll", m_bAutoSetupRagdoll);
 	writer.addMember("Auto Generate Morph Clips", m_bAutoGenerateMorphClips);
 	writer.addMember("Auto Enable Hair Physics", m_bAutoEnableHairPhysics);
@@ -348,8 +933,112 @@ void DzUnityAction::writeConfiguration()
 		writeEnvironment(writer);
 	}
 
+	writeExportStatistics(writer);
+
 	writer.finishObject();
-	DTUfile.close();
+	DTUbuffer.close();
+	GltfMemoryHold dtuBytes(GltfMemoryDtu, DTUbuffer.data().size());
+	DzUnityExportCache::writeIfChanged(DTUfilename, DTUbuffer.data());
+}
+
+void DzUnityAction::recordPhaseTiming(const QString& sPhase, const QElapsedTimer& timer)
+{
+	m_aPhaseTimings.append(qMakePair(sPhase, timer.nsecsElapsed() / 1.0e6));
+}
+
+// Per-asset budget figures for the Unity importer, counted from the Daz
+// meshes by the content hash or the glTF snapshot, both taken before
+// exportHD(): the DTU is written before the background glTF export is
+// joined.  recordExportStats() adds the glTF writer's own counts for QA.  Only
+// counts go in: an unchanged scene must give a byte-identical DTU, or
+// writeIfChanged() rewrites it and Unity reimports it.  Wall-clock phase
+// timings are in getLastExportStats() instead.
+void DzUnityAction::writeExportStatistics(DzJsonWriter& writer)
+{
+	// an animation or pose with the glTF off reads no mesh before the FBX
+	const GltfSourceStats& stats = m_sourceStats;
+	QString sGeometrySource = m_bSourceStatsValid ? "Daz Mesh" : "None";
+	double fTextureMegapixels = stats.texturePixels / 1.0e6;
+
+	int nMorphs = m_bEnableMorphs ? m_mMorphNameToLabel.size() : 0;
+	int nBones = m_pSelectedNode ? getAllBones(m_pSelectedNode).count() : 0;
+
+	writer.startMemberObject("Export Statistics", true);
+	writer.addMember("Geometry Source", sGeometrySource);
+	writer.addMember("Vertices", (int)stats.vertices);
+	writer.addMember("Triangles", (int)stats.triangles);
+	writer.addMember("Primitives", stats.primitives);
+	writer.addMember("Materials", stats.materials.size());
+	writer.addMember("Textures", stats.textures.size());
+	writer.addMember("Texture Megapixels", fTextureMegapixels);
+	writer.addMember("Morphs", nMorphs);
+	writer.addMember("Bones", nBones);
+
+	// the glTF is still being written; recordExportStats() has its size
+	writer.startMemberObject("File Sizes (KB)", true);
+	writer.addMember("FBX", (int)(QFileInfo(m_sDestinationFBX).size() / 1024));
+	writer.finishObject();
+
+	// the same counts for getLastExportStats()
+	m_mLastExportStats.insert("Geometry Source", sGeometrySource);
+	m_mLastExportStats.insert("Vertices", (double)stats.vertices);
+	m_mLastExportStats.insert("Triangles", (double)stats.triangles);
+	m_mLastExportStats.insert("Primitives", stats.primitives);
+	m_mLastExportStats.insert("Materials", stats.materials.size());
+	m_mLastExportStats.insert("Textures", stats.textures.size());
+	m_mLastExportStats.insert("Texture Megapixels", fTextureMegapixels);
+	m_mLastExportStats.insert("Morphs", nMorphs);
+	m_mLastExportStats.insert("Bones", nBones);
+
+	writer.finishObject();
+}
+
+// Sizes, times and memory of the send that just finished; the counts were
+// added by writeExportStatistics() if the DTU was written.
+void DzUnityAction::recordExportStats(const QElapsedTimer& sendTimer)
+{
+	const double fMegabyte = 1024.0 * 1024.0;
+	double fFbxMB = QFileInfo(m_sDestinationFBX).size() / fMegabyte;
+	double fDtuMB = QFileInfo(m_sDestinationPath + m_sExportFilename + ".dtu").size() / fMegabyte;
+	// a batch send's glTF may still be being written
+	double fGltfMB = (m_bExportGLTF && !m_pendingGltf.pExporter) ? getGltfBytes() / fMegabyte : 0.0;
+
+	m_mLastExportStats.insert("Export Seconds", sendTimer.nsecsElapsed() / 1.0e9);
+	m_mLastExportStats.insert("FBX MB", fFbxMB);
+	m_mLastExportStats.insert("DTU MB", fDtuMB);
+	m_mLastExportStats.insert("glTF MB", fGltfMB);
+	m_mLastExportStats.insert("Output MB", fFbxMB + fDtuMB + fGltfMB);
+	m_mLastExportStats.insert("Peak Resident MB", GltfMemory::peakResidentBytes() / fMegabyte);
+	if (m_bExportGLTF && m_bGltfSucceeded)
+	{
+		m_mLastExportStats.insert("glTF Vertices", (double)m_gltfStats.vertices);
+		m_mLastExportStats.insert("glTF Triangles", (double)m_gltfStats.triangles);
+		m_mLastExportStats.insert("glTF Primitives", m_gltfStats.primitives);
+		m_mLastExportStats.insert("glTF Materials", m_gltfStats.materials);
+	}
+
+	QVariantMap mTimings;
+	for (int i = 0; i < m_aPhaseTimings.size(); i++)
+		mTimings.insert(m_aPhaseTimings[i].first, m_aPhaseTimings[i].second);
+	if (m_bExportGLTF && m_bGltfSucceeded)
+	{
+		mTimings.insert("glTF Layout", m_gltfTimings.layoutMs);
+		mTimings.insert("glTF JSON", m_gltfTimings.jsonMs);
+		mTimings.insert("glTF Buffers", m_gltfTimings.buffersMs);
+	}
+	m_mLastExportStats.insert("Timings (ms)", mTimings);
+}
+
+qint64 DzUnityAction::getGltfBytes() const
+{
+	// split output: the .gltf plus its "<name>_<category><n>.bin" files
+	QFileInfo gltfInfo(getGltfPath());
+	qint64 nBytes = gltfInfo.size();
+	QFileInfoList aBins = gltfInfo.dir().entryInfoList(
+		QStringList(gltfInfo.completeBaseName() + "_*.bin"), QDir::Files);
+	for (int i = 0; i < aBins.size(); i++)
+		nBytes += aBins[i].size();
+	return nBytes;
 }
 
 // Setup custom FBX export options
@@ -4,10 +4,20 @@
 #include <dzjsonwriter.h>
 #include <QtCore/qfile.h>
 #include <QtCore/qtextstream.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qpair.h>
+#include <QtCore/qvariant.h>
+#include <QtCore/qpointer.h>
 #include <DzBridgeAction.h>
 #include "DzUnityDialog.h"
+#include "GltfGlbWriter.h"
+#include "DzGLTFExporter.h"
 
 class UnitTest_DzUnityAction;
+class DzUnityBatchExporter;
+class DzUnityJobQueue;
+class DzUnityJobPanel;
+class GltfBufferPool;
 
 #include "dzbridge.h"
 
@@ -19,6 +29,11 @@ class DzUnityAction : public DZ_BRIDGE_NAMESPACE::DzBridgeAction {
 	 Q_PROPERTY(bool AutoSetupRagdoll READ getAutoSetupRagdoll WRITE setAutoSetupRagdoll)
 	 Q_PROPERTY(bool AutoGenerateMorphClips READ getAutoGenerateMorphClips WRITE setAutoGenerateMorphClips)
 	 Q_PROPERTY(bool AutoEnableHairPhysics READ getAutoEnableHairPhysics WRITE setAutoEnableHairPhysics)
+	 Q_PROPERTY(bool EnableTrace READ getEnableTrace WRITE setEnableTrace)
+	 Q_PROPERTY(bool EnableMemoryLog READ getEnableMemoryLog WRITE setEnableMemoryLog)
+	 Q_PROPERTY(double LastExportSeconds READ getLastExportSeconds)
+	 Q_PROPERTY(double LastExportMegabytes READ getLastExportMegabytes)
+	 Q_PROPERTY(double LastPeakMemoryMegabytes READ getLastPeakMemoryMegabytes)
 public:
 	DzUnityAction();
 
@@ -40,6 +55,28 @@ public:
 	void setAutoEnableHairPhysics(bool arg) { m_bAutoEnableHairPhysics = arg; }
 	bool getAutoEnableHairPhysics() { return m_bAutoEnableHairPhysics; }
 
+	void setEnableTrace(bool arg) { m_bEnableTrace = arg; }
+	bool getEnableTrace() { return m_bEnableTrace; }
+
+	void setEnableMemoryLog(bool arg) { m_bEnableMemoryLog = arg; }
+	bool getEnableMemoryLog() { return m_bEnableMemoryLog; }
+
+	// Figures from the last executeAction(), for QA budget checks: wall time
+	// up to the completion message, size of everything written (FBX, DTU,
+	// glTF), and the process's peak working set.
+	double getLastExportSeconds() { return m_mLastExportStats.value("Export Seconds").toDouble(); }
+	double getLastExportMegabytes() { return m_mLastExportStats.value("Output MB").toDouble(); }
+	double getLastPeakMemoryMegabytes() { return m_mLastExportStats.value("Peak Resident MB").toDouble(); }
+
+	// All of the above plus the DTU's "Export Statistics" counts and the
+	// per-phase "Timings (ms)"; empty before the first export.
+	Q_INVOKABLE QVariantMap getLastExportStats() { return m_mLastExportStats; }
+
+	// Export every asset listed in the JSON manifest at sManifestPath (see
+	// DzUnityBatchExporter) and return one status map per asset.  The
+	// report is also written to "<manifest>.report.json".
+	Q_INVOKABLE QVariantList exportBatch(const QString& sManifestPath);
+
 protected:
 	 bool m_bInstallUnityFiles;
 	 bool m_bExportGLTF;
@@ -47,6 +84,71 @@ protected:
 	 bool m_bAutoSetupRagdoll;
 	 bool m_bAutoGenerateMorphClips;
 	 bool m_bAutoEnableHairPhysics;
+	 bool m_bEnableTrace;   // write <export>.trace.json (Chrome trace events) beside the DTU
+	 bool m_bEnableMemoryLog;   // write <export>.memory.log (per-phase memory) beside the DTU
+
+	 // glTF export running alongside the FBX export, see startGltfExport()
+	 DzGLTFExporter* m_pGltfExporter;
+	 bool m_bGltfStarted;
+	 bool m_bGltfSucceeded;
+	 bool m_bWaitingForGltf;              // joinGltfExport() is running the event loop
+	 int m_nGltfInFlight;                 // glTF exports started and not yet joined
+	 bool m_bBatchRunning;                // exportBatch() is running
+	 bool m_bFbxWritten;                  // the last send wrote its FBX, or kept an up-to-date one
+	 GltfBufferPool* m_pGltfBufferPool;   // shared by every send, kept for the plugin's lifetime
+	 GltfSceneStats m_gltfStats;          // of the last successful glTF export
+	 GltfWriteTimings m_gltfTimings;
+	 QStringList m_aGltfBufferFiles;      // .bin files beside it, for DzUnityExportCache
+	 GltfSourceStats m_sourceStats;       // Daz meshes of the current send, see writeExportStatistics()
+	 bool m_bSourceStatsValid;
+
+	 // wall-clock phases of the current send, for getLastExportStats()
+	 QList< QPair<QString, double> > m_aPhaseTimings;
+	 QElapsedTimer m_exportTimer;         // started with exportHD()
+	 QVariantMap m_mLastExportStats;      // see getLastExportStats()
+
+	 // A glTF export a batch send left running, for the batch to join
+	 struct PendingGltf
+	 {
+		 DzGLTFExporter* pExporter;
+		 bool bStarted;
+		 QString sPath;
+		 QString sCacheFolder;
+		 bool bCacheable;
+		 quint64 nKey;
+
+		 PendingGltf() : pExporter(nullptr), bStarted(false), bCacheable(false), nKey(0) {}
+	 };
+	 bool m_bDeferGltfJoin;               // set by DzUnityBatchExporter and queued sends
+	 PendingGltf m_pendingGltf;
+
+	 // What readSendSettings() read, kept by a queued send until it runs
+	 struct SendSettings
+	 {
+		 QPointer<DzNode> pNode;
+		 QString sAssetName;
+		 QString sAssetType;
+		 QString sRootFolder;
+		 QString sExportSubfolder;
+		 QString sDestinationPath;
+		 QString sDestinationFBX;
+		 QString sExportFilename;
+		 QString sProductName;
+		 QString sProductComponentName;
+		 bool bEnableMorphs;
+		 QString sMorphSelectionRule;
+		 QMap<QString, QString> mMorphNameToLabel;
+		 bool bEnableSubdivisions;
+		 bool bUndoNormalMaps;
+		 bool bInstallUnityFiles;
+		 bool bExportGLTF;
+		 bool bAutoGenerateLOD;
+		 bool bAutoSetupRagdoll;
+		 bool bAutoGenerateMorphClips;
+		 bool bAutoEnableHairPhysics;
+	 };
+	 DzUnityJobQueue* m_pJobQueue;        // created by the first queued send
+	 DzUnityJobPanel* m_pJobPanel;
 
 	 void executeAction();
 	 Q_INVOKABLE bool createUI();
@@ -54,7 +156,25 @@ protected:
 	 Q_INVOKABLE void setExportOptions(DzFileIOSettings& ExportOptions);
 	 Q_INVOKABLE QString createUnityFiles(bool replace = true);
 	 QString readGuiRootFolder();
+	 void readSendSettings();
+	 void sendToUnity(bool bReadSettings);
+	 SendSettings captureSendSettings() const;
+	 void restoreSendSettings(const SendSettings& settings);
+	 void enqueueSend();
+	 bool runQueuedSend(const SendSettings& settings, PendingGltf& outGltf, QString& sError);
+	 void startGltfExport();
+	 void finishGltfExport();
+	 bool joinGltfExport(DzGLTFExporter* pExporter, bool bStarted, QString* pError = nullptr);
+	 bool takePendingGltf(PendingGltf& out);
+	 QString getGltfPath() const;
+	 bool computeExportKeys(quint64& nFbxKey, quint64& nGltfKey);
+	 void recordPhaseTiming(const QString& sPhase, const QElapsedTimer& timer);
+	 void recordExportStats(const QElapsedTimer& sendTimer);
+	 qint64 getGltfBytes() const;
+	 void writeExportStatistics(DzJsonWriter& writer);
 
+	 friend class DzUnityBatchExporter;
+	 friend class DzUnityJobQueue;
 #ifdef UNITTEST_DZBRIDGE
 	friend class UnitTest_DzUnityAction;
 #endif
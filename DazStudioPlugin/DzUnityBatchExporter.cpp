@@ -0,0 +1,332 @@
+// DzUnityBatchExporter.cpp
+// Manifest-driven export of many assets, glTF encoding pipelined behind
+// the main-thread extraction of the next asset.
+
+#include "DzUnityBatchExporter.h"
+
+#include <QtCore/qfile.h>
+#include <QtCore/qfileinfo.h>
+#include <QtCore/qthread.h>
+
+#include <dzapp.h>
+#include <dzscene.h>
+#include <dzcontentmgr.h>
+#include <dznode.h>
+#include <dzjsonwriter.h>
+#include <dzprogress.h>
+
+#include "DzGLTFExporter.h"
+#include "DzUnityExportCache.h"
+#include "GltfJson.h"
+
+DzUnityBatchExporter::Entry::Entry()
+    : sAssetType("SkeletalMesh")
+    , bExportGLTF(false)
+    , bAutoGenerateLOD(false)
+    , bAutoSetupRagdoll(false)
+    , bAutoGenerateMorphClips(false)
+    , bAutoEnableHairPhysics(false)
+    , sStatus("Skipped")
+    , fExtractSeconds(0.0)
+    , fGltfSeconds(0.0)
+{
+}
+
+DzUnityBatchExporter::DzUnityBatchExporter(DzUnityAction* pAction)
+    : m_pAction(pAction)
+    , m_nWorkers(qMax(1, QThread::idealThreadCount() / 2))
+{
+}
+
+// ---------------------------------------------------------------------------
+// Manifest
+// ---------------------------------------------------------------------------
+
+DzUnityBatchExporter::Entry DzUnityBatchExporter::readEntry(const GltfJsonValue& value,
+                                                            const Entry& defaults)
+{
+    Entry entry = defaults;
+    if (value.contains("Scene"))
+        entry.sScene = value["Scene"].toString();
+    if (value.contains("Node"))
+        entry.sNode = value["Node"].toString();
+    if (value.contains("Asset Type"))
+        entry.sAssetType = value["Asset Type"].toString();
+    if (value.contains("Export Folder"))
+        entry.sExportFolder = value["Export Folder"].toString();
+    if (value.contains("Export Filename"))
+        entry.sExportFilename = value["Export Filename"].toString();
+    if (value.contains("Product Name"))
+        entry.sProductName = value["Product Name"].toString();
+    if (value.contains("Product Component Name"))
+        entry.sProductComponentName = value["Product Component Name"].toString();
+    if (value.contains("Morphs"))
+    {
+        const GltfJsonValue& morphs = value["Morphs"];
+        entry.aMorphs.clear();
+        for (int i = 0; i < morphs.size(); ++i)
+            entry.aMorphs.append(morphs.at(i).toString());
+    }
+    entry.bExportGLTF             = value["Export glTF"].toBool(entry.bExportGLTF);
+    entry.bAutoGenerateLOD        = value["Auto Generate LOD"].toBool(entry.bAutoGenerateLOD);
+    entry.bAutoSetupRagdoll       = value["Auto Setup Ragdoll"].toBool(entry.bAutoSetupRagdoll);
+    entry.bAutoGenerateMorphClips = value["Auto Generate Morph Clips"].toBool(entry.bAutoGenerateMorphClips);
+    entry.bAutoEnableHairPhysics  = value["Auto Enable Hair Physics"].toBool(entry.bAutoEnableHairPhysics);
+    return entry;
+}
+
+bool DzUnityBatchExporter::loadManifest(const QString& sManifestPath)
+{
+    m_aEntries.clear();
+    QFile file(sManifestPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_sLastError = "Cannot open " + sManifestPath + ": " + file.errorString();
+        return false;
+    }
+
+    GltfJsonValue manifest;
+    QString sParseError;
+    if (!GltfJsonValue::parse(file.readAll(), manifest, sParseError)) {
+        m_sLastError = sManifestPath + ": " + sParseError;
+        return false;
+    }
+
+    m_sRootFolder = manifest["Root Folder"].toString();
+    m_nWorkers = qMax(1, manifest["Workers"].toInt(m_nWorkers));
+
+    Entry defaults = readEntry(manifest["Defaults"], Entry());
+    const GltfJsonValue& assets = manifest["Assets"];
+    for (int i = 0; i < assets.size(); ++i)
+    {
+        Entry entry = readEntry(assets.at(i), defaults);
+        if (entry.sScene.isEmpty()) {
+            m_sLastError = QString("%1: asset %2 has no \"Scene\"").arg(sManifestPath).arg(i);
+            m_aEntries.clear();
+            return false;
+        }
+        m_aEntries.append(entry);
+    }
+    if (m_aEntries.isEmpty()) {
+        m_sLastError = sManifestPath + ": no \"Assets\" listed";
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Export
+// ---------------------------------------------------------------------------
+
+bool DzUnityBatchExporter::run()
+{
+    // a per-send trace would be restarted under the encodes still running
+    bool bTrace = m_pAction->m_bEnableTrace;
+    m_pAction->m_bEnableTrace = false;
+
+    bool bCancelled = false;
+    DzProgress progress("Batch export to Unity...", m_aEntries.size(), true);
+    for (int i = 0; i < m_aEntries.size(); ++i)
+    {
+        if (progress.isCancelled()) {
+            bCancelled = true;
+            break;
+        }
+        progress.setCurrentInfo(QString("%1 (%2 of %3)")
+            .arg(QFileInfo(m_aEntries[i].sScene).completeBaseName())
+            .arg(i + 1).arg(m_aEntries.size()));
+
+        // free what has finished, then make room for this asset's encode
+        joinFinished();
+        while (m_aInFlight.size() >= m_nWorkers)
+            joinOldest();
+
+        exportEntry(i);
+        progress.step();
+    }
+    while (!m_aInFlight.isEmpty())
+        joinOldest();
+    progress.finish();
+
+    m_pAction->m_bDeferGltfJoin = false;
+    m_pAction->m_bEnableTrace = bTrace;
+    return !bCancelled;
+}
+
+void DzUnityBatchExporter::exportEntry(int nEntry)
+{
+    Entry& entry = m_aEntries[nEntry];
+    QElapsedTimer timer;
+    timer.start();
+    dzApp->log(QString("DazToUnity: batch %1/%2: %3")
+        .arg(nEntry + 1).arg(m_aEntries.size()).arg(entry.sScene));
+
+    entry.sStatus = "Failed";
+    if (!loadScene(entry.sScene, entry.sError))
+        return;
+    if (!entry.sNode.isEmpty())
+    {
+        DzNode* pNode = findNode(entry.sNode);
+        if (!pNode) {
+            entry.sError = "No node \"" + entry.sNode + "\" in the scene";
+            return;
+        }
+        dzScene->setPrimarySelection(pNode);
+    }
+
+    DzUnityAction& action = *m_pAction;
+    action.resetToDefaults();
+    action.m_nNonInteractiveMode = 1;
+    if (!m_sRootFolder.isEmpty())
+        action.m_sRootFolder = m_sRootFolder;
+    action.m_sAssetType = entry.sAssetType;
+    action.m_sExportSubfolder = entry.sExportFolder;
+    action.m_sExportFilename = entry.sExportFilename;
+    action.m_sProductName = entry.sProductName;
+    action.m_sProductComponentName = entry.sProductComponentName;
+    action.m_aMorphListOverride = entry.aMorphs;
+    action.m_bExportGLTF = entry.bExportGLTF;
+    action.m_bAutoGenerateLOD = entry.bAutoGenerateLOD;
+    action.m_bAutoSetupRagdoll = entry.bAutoSetupRagdoll;
+    action.m_bAutoGenerateMorphClips = entry.bAutoGenerateMorphClips;
+    action.m_bAutoEnableHairPhysics = entry.bAutoEnableHairPhysics;
+    action.m_bDeferGltfJoin = true;
+    action.m_bFbxWritten = false;
+
+    action.executeAction();
+
+    entry.sDtuPath = action.m_sDestinationPath + action.m_sExportFilename + ".dtu";
+    entry.fExtractSeconds = timer.nsecsElapsed() / 1.0e9;
+    if (!action.m_bFbxWritten || !QFileInfo(entry.sDtuPath).exists())
+        entry.sError = "No FBX or DTU written to " + action.m_sDestinationPath;
+    else
+        entry.sStatus = "OK";
+
+    InFlight job;
+    if (action.takePendingGltf(job.gltf))
+    {
+        job.nEntry = nEntry;
+        job.timer.start();
+        m_aInFlight.append(job);
+    }
+    else if (entry.bExportGLTF)
+    {
+        // nothing started: either the cache kept the previous file or
+        // there was no node to export
+        entry.sGltfStatus = QFileInfo(action.getGltfPath()).exists() ? "Unchanged" : "Failed";
+    }
+}
+
+void DzUnityBatchExporter::joinOldest()
+{
+    InFlight job = m_aInFlight.takeFirst();
+    Entry& entry = m_aEntries[job.nEntry];
+
+    bool bOk = m_pAction->joinGltfExport(job.gltf.pExporter, job.gltf.bStarted);
+    entry.fGltfSeconds = job.timer.nsecsElapsed() / 1.0e9;
+    entry.sGltfStatus = bOk ? "OK" : "Failed";
+
+    if (job.gltf.bCacheable)
+    {
+        DzUnityExportCache exportCache(job.gltf.sCacheFolder);
+        if (bOk)
+            exportCache.record(job.gltf.sPath, job.gltf.nKey, m_pAction->m_aGltfBufferFiles);
+        else
+            exportCache.forget(job.gltf.sPath);
+    }
+}
+
+void DzUnityBatchExporter::joinFinished()
+{
+    // in order, so the report and the log read the same as the manifest
+    while (!m_aInFlight.isEmpty() && m_aInFlight.first().gltf.pExporter->isExportFinished())
+        joinOldest();
+}
+
+bool DzUnityBatchExporter::loadScene(const QString& sScene, QString& sError)
+{
+    // manifests may use content-library paths, as the QA scripts do
+    QString sPath = sScene;
+    if (!QFileInfo(sPath).exists())
+        sPath = dzApp->getContentMgr()->findFile(sScene);
+    if (sPath.isEmpty()) {
+        sError = "Scene not found: " + sScene;
+        return false;
+    }
+    DzError result = dzScene->loadScene(sPath, DzScene::OpenNew);
+    if (result != DZ_NO_ERROR) {
+        sError = "Could not load " + sPath;
+        return false;
+    }
+    return true;
+}
+
+DzNode* DzUnityBatchExporter::findNode(const QString& sNode) const
+{
+    DzNode* pNode = dzScene->findNodeByLabel(sNode);
+    return pNode ? pNode : dzScene->findNode(sNode);
+}
+
+// ---------------------------------------------------------------------------
+// Report
+// ---------------------------------------------------------------------------
+
+QVariantList DzUnityBatchExporter::getReport() const
+{
+    QVariantList aReport;
+    for (int i = 0; i < m_aEntries.size(); ++i)
+    {
+        const Entry& entry = m_aEntries[i];
+        QVariantMap mEntry;
+        mEntry.insert("Scene", entry.sScene);
+        mEntry.insert("Node", entry.sNode);
+        mEntry.insert("Status", entry.sStatus);
+        mEntry.insert("Error", entry.sError);
+        mEntry.insert("DTU", entry.sDtuPath);
+        mEntry.insert("glTF", entry.sGltfStatus);
+        mEntry.insert("Extract Seconds", entry.fExtractSeconds);
+        mEntry.insert("glTF Seconds", entry.fGltfSeconds);
+        aReport.append(mEntry);
+    }
+    return aReport;
+}
+
+bool DzUnityBatchExporter::writeReport(const QString& sReportPath)
+{
+    QFile file(sReportPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_sLastError = "Cannot open " + sReportPath + " for writing: " + file.errorString();
+        return false;
+    }
+
+    int nFailed = 0;
+    for (int i = 0; i < m_aEntries.size(); ++i)
+        if (m_aEntries[i].sStatus != "OK" || m_aEntries[i].sGltfStatus == "Failed")
+            ++nFailed;
+
+    DzJsonWriter writer(&file);
+    writer.startObject(true);
+    writer.addMember("Workers", m_nWorkers);
+    writer.addMember("Assets Exported", m_aEntries.size() - nFailed);
+    writer.addMember("Assets Failed", nFailed);
+    writer.startMemberArray("Assets", true);
+    for (int i = 0; i < m_aEntries.size(); ++i)
+    {
+        const Entry& entry = m_aEntries[i];
+        writer.startObject(true);
+        writer.addMember("Scene", entry.sScene);
+        writer.addMember("Node", entry.sNode);
+        writer.addMember("Status", entry.sStatus);
+        if (!entry.sError.isEmpty())
+            writer.addMember("Error", entry.sError);
+        writer.addMember("DTU", entry.sDtuPath);
+        if (!entry.sGltfStatus.isEmpty())
+            writer.addMember("glTF", entry.sGltfStatus);
+        writer.addMember("Extract Seconds", entry.fExtractSeconds);
+        writer.addMember("glTF Seconds", entry.fGltfSeconds);
+        writer.finishObject();
+    }
+    writer.finishArray();
+    writer.finishObject();
+    file.close();
+    return file.error() == QFile::NoError;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QVariant>
+#include <QElapsedTimer>
+
+#include "DzUnityAction.h"
+
+class GltfJsonValue;
+
+/// Headless export of a list of assets, for regenerating a whole library.
+///
+/// The manifest is JSON:
+///
+///     { "Root Folder": "C:/Users/me/Documents/DazToUnity",
+///       "Workers": 3,
+///       "Defaults": { "Asset Type": "SkeletalMesh", "Export glTF": true },
+///       "Assets": [
+///         { "Scene": "/People/Genesis 8 Female/Outfits/Outfit01.duf",
+///           "Node": "Genesis 8 Female",
+///           "Export Folder": "Outfit01", "Export Filename": "Outfit01",
+///           "Morphs": ["FBMVictoria8_1"] },
+///         ... ] }
+///
+/// Each asset takes any key it leaves out from "Defaults".  Recognised keys
+/// are "Scene", "Node" (label or name; default: the single root node),
+/// "Asset Type", "Export Folder", "Export Filename", "Product Name",
+/// "Product Component Name", "Morphs", "Export glTF", "Auto Generate LOD",
+/// "Auto Setup Ragdoll", "Auto Generate Morph Clips" and "Auto Enable Hair
+/// Physics".
+///
+/// Everything that reads the scene runs on the main thread, one asset at a
+/// time: load, glTF snapshot, FBX and DTU.  The glTF encoding and writing of
+/// an asset is left running on the thread pool while the next one loads;
+/// at most "Workers" of them are in flight (default: half the cores), the
+/// oldest being joined before another starts.  The DTU of a batch send
+/// therefore carries Daz mesh rather than glTF statistics.
+class DzUnityBatchExporter
+{
+public:
+    /// One asset of the manifest and, once run, how it went.
+    struct Entry
+    {
+        QString     sScene;
+        QString     sNode;
+        QString     sAssetType;
+        QString     sExportFolder;
+        QString     sExportFilename;
+        QString     sProductName;
+        QString     sProductComponentName;
+        QStringList aMorphs;
+        bool        bExportGLTF;
+        bool        bAutoGenerateLOD;
+        bool        bAutoSetupRagdoll;
+        bool        bAutoGenerateMorphClips;
+        bool        bAutoEnableHairPhysics;
+
+        QString     sStatus;        // "OK", "Failed" or "Skipped" (batch cancelled)
+        QString     sError;
+        QString     sDtuPath;
+        QString     sGltfStatus;    // "OK", "Failed", "Unchanged" or empty if not exported
+        double      fExtractSeconds;    // main thread: load, snapshot, FBX, DTU
+        double      fGltfSeconds;       // from extraction to the glTF being joined
+
+        Entry();
+    };
+
+    explicit DzUnityBatchExporter(DzUnityAction* pAction);
+
+    /// Read @p sManifestPath.  False, with getLastError() set, if it cannot
+    /// be read or lists no assets.
+    bool loadManifest(const QString& sManifestPath);
+
+    /// Export every asset.  False if the batch was cancelled; per-asset
+    /// failures only show in the report.
+    bool run();
+
+    /// Write the per-asset report as JSON.
+    bool writeReport(const QString& sReportPath);
+
+    /// The report as script values, one map per asset.
+    QVariantList getReport() const;
+
+    int getWorkerCount() const { return m_nWorkers; }
+    QString getLastError() const { return m_sLastError; }
+
+private:
+    struct InFlight
+    {
+        int                         nEntry;
+        DzUnityAction::PendingGltf  gltf;
+        QElapsedTimer               timer;
+    };
+
+    DzUnityAction*  m_pAction;
+    QString         m_sRootFolder;
+    int             m_nWorkers;
+    QList<Entry>    m_aEntries;
+    QList<InFlight> m_aInFlight;     // oldest first
+    QString         m_sLastError;
+
+    static Entry readEntry(const GltfJsonValue& value, const Entry& defaults);
+    bool loadScene(const QString& sScene, QString& sError);
+    DzNode* findNode(const QString& sNode) const;
+    void exportEntry(int nEntry);
+    void joinOldest();
+    void joinFinished();
+};
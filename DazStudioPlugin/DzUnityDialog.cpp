@@ -57,6 +57,7 @@ DzUnityDialog::DzUnityDialog(QWidget* parent) :
 	 autoSetupRagdollCheckBox = nullptr;
 	 autoGenerateMorphClipsCheckBox = nullptr;
 	 autoEnableHairPhysicsCheckBox = nullptr;
+	 queueSendsCheckBox = nullptr;
 
 	 settings = new QSettings("Daz 3D", "DazToUnity");
 
@@ -136,6 +137,11 @@ DzUnityDialog::DzUnityDialog(QWidget* parent) :
 	 autoEnableHairPhysicsCheckBox = new QCheckBox("", this);
 	 autoEnableHairPhysicsCheckBox->setToolTip(tr("Automatically enable dForce hair spring physics on hair meshes after import in Unity."));
 
+	 // Background sends
+	 queueSendsCheckBox = new QCheckBox("", this);
+	 queueSendsCheckBox->setToolTip(tr("Queue the send and return to Daz Studio at once. The Daz To Unity Jobs window shows queued, running and finished sends."));
+	 connect(queueSendsCheckBox, SIGNAL(stateChanged(int)), this, SLOT(HandleQueueSendsCheckBoxChange(int)));
+
 	// Disable Experimental Options Checkbox
 	m_enableExperimentalOptionsCheckBox->setEnabled(false);
 	m_enableExperimentalOptionsCheckBox->setToolTip(tr("No experimental options in this version."));
@@ -149,6 +155,7 @@ DzUnityDialog::DzUnityDialog(QWidget* parent) :
 	 mainLayout->insertRow(5, tr("Auto Setup Ragdoll"), autoSetupRagdollCheckBox);
 	 mainLayout->insertRow(6, tr("Auto Morph Clips"), autoGenerateMorphClipsCheckBox);
 	 mainLayout->insertRow(7, tr("Auto Hair Physics"), autoEnableHairPhysicsCheckBox);
+	 mainLayout->insertRow(8, tr("Send in Background"), queueSendsCheckBox);
 
 	 // Rename Open Intermediate Folder button
 	 m_OpenIntermediateFolderButton->setText(tr("Open Unity Project Folder"));
@@ -208,6 +215,8 @@ bool DzUnityDialog::loadSavedSettings()
 		assetsFolderEdit->setText(DefaultPath);
 	}
 
+	queueSendsCheckBox->setChecked(settings->value("QueueSends", false).toBool());
+
 	return true;
 }
 
@@ -264,6 +273,12 @@ void DzUnityDialog::HandleAssetFolderChanged(const QString& directoryName)
 
 }
 
+void DzUnityDialog::HandleQueueSendsCheckBoxChange(int state)
+{
+	if (settings == nullptr || m_bDontSaveSettings) return;
+	settings->setValue("QueueSends", state == Qt::Checked);
+}
+
 void DzUnityDialog::HandleSelectAssetsFolderButton()
 {
 	 // DB (2021-05-15): prepopulate with existing folder string
@@ -686,6 +701,7 @@ void DzUnityDialog::setDisabled(bool bDisabled)
 	autoSetupRagdollCheckBox->setDisabled(bDisabled);
 	autoGenerateMorphClipsCheckBox->setDisabled(bDisabled);
 	autoEnableHairPhysicsCheckBox->setDisabled(bDisabled);
+	queueSendsCheckBox->setDisabled(bDisabled);
 
 }
 
@@ -36,6 +36,7 @@ public:
 protected slots:
 	void HandleSelectAssetsFolderButton();
 	void HandleInstallUnityFilesCheckBoxChange(int state);
+	void HandleQueueSendsCheckBoxChange(int state);
 	void HandleAssetFolderChanged(const QString& directoryName);
 	void HandleAssetTypeComboChange(int state) override;
 	void HandleTargetPluginInstallerButton() override;
@@ -58,6 +59,8 @@ protected:
 	QCheckBox* autoGenerateMorphClipsCheckBox;
 	QCheckBox* autoEnableHairPhysicsCheckBox;
 
+	QCheckBox* queueSendsCheckBox;
+
 	bool IsValidProjectFolder(QString sProjectFolderPath);
 	bool installUpmPackage(const QString& sProjectFolder);
 	virtual void setDisabled(bool) override;
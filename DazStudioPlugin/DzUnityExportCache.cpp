@@ -0,0 +1,113 @@
+// DzUnityExportCache.cpp
+// Per-folder record of which inputs produced which exported file.
+
+#include "DzUnityExportCache.h"
+
+#include <QtCore/qfile.h>
+#include <QtCore/qfileinfo.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qsettings.h>
+
+// Kept next to the exports; Unity ignores dot files under Assets.
+static const char* kCacheFileName = ".DazToUnityCache.ini";
+
+DzUnityExportCache::DzUnityExportCache(const QString& folder)
+    : m_sFolder(folder)
+    , m_pSettings(new QSettings(folder + "/" + kCacheFileName, QSettings::IniFormat))
+{
+    m_pSettings->beginGroup("Artifacts");
+}
+
+DzUnityExportCache::~DzUnityExportCache()
+{
+    m_pSettings->endGroup();
+    delete m_pSettings;
+}
+
+QString DzUnityExportCache::keyFor(const QString& path) const
+{
+    // QSettings treats '/' and '\' as group separators
+    return QFileInfo(path).fileName();
+}
+
+// An entry is the inputs key, size and modification time, then the file
+// names of any companions, each with an entry of its own.
+bool DzUnityExportCache::fileIsUpToDate(const QString& path, quint64 inputsKey) const
+{
+    QStringList entry = m_pSettings->value(keyFor(path)).toStringList();
+    if (entry.size() < 3)
+        return false;
+
+    QFileInfo info(path);
+    return info.exists()
+        && entry[0] == QString::number(inputsKey, 16)
+        && entry[1] == QString::number(info.size())
+        && entry[2] == QString::number(info.lastModified().toTime_t());
+}
+
+bool DzUnityExportCache::isUpToDate(const QString& path, quint64 inputsKey) const
+{
+    if (!fileIsUpToDate(path, inputsKey))
+        return false;
+    QStringList entry = m_pSettings->value(keyFor(path)).toStringList();
+    QString sFolder = QFileInfo(path).absolutePath() + "/";
+    for (int i = 3; i < entry.size(); ++i)
+        if (!fileIsUpToDate(sFolder + entry[i], inputsKey))
+            return false;
+    return true;
+}
+
+void DzUnityExportCache::recordFile(const QString& path, quint64 inputsKey,
+                                    const QStringList& companions)
+{
+    QFileInfo info(path);
+    QStringList entry;
+    entry << QString::number(inputsKey, 16)
+          << QString::number(info.size())
+          << QString::number(info.lastModified().toTime_t());
+    entry += companions;
+    m_pSettings->setValue(keyFor(path), entry);
+}
+
+void DzUnityExportCache::record(const QString& path, quint64 inputsKey,
+                                const QStringList& companions)
+{
+    // a missing piece leaves nothing worth keeping
+    QStringList aNames;
+    bool bComplete = QFileInfo(path).exists();
+    for (int i = 0; i < companions.size() && bComplete; ++i) {
+        bComplete = QFileInfo(companions[i]).exists();
+        aNames << keyFor(companions[i]);
+    }
+    forget(path);
+    if (!bComplete)
+        return;
+
+    for (int i = 0; i < companions.size(); ++i)
+        recordFile(companions[i], inputsKey, QStringList());
+    recordFile(path, inputsKey, aNames);
+}
+
+void DzUnityExportCache::forget(const QString& path)
+{
+    QStringList entry = m_pSettings->value(keyFor(path)).toStringList();
+    for (int i = 3; i < entry.size(); ++i)
+        m_pSettings->remove(entry[i]);
+    m_pSettings->remove(keyFor(path));
+}
+
+bool DzUnityExportCache::writeIfChanged(const QString& path, const QByteArray& data)
+{
+    QFile file(path);
+    if (file.size() == data.size() && file.open(QIODevice::ReadOnly)) {
+        bool same = (file.readAll() == data);
+        file.close();
+        if (same)
+            return true;
+    }
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    bool ok = file.write(data) == data.size();
+    file.close();
+    return ok;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QStringList>
+
+class QSettings;
+
+/// Remembers which inputs each exported file was generated from.
+///
+/// One INI file per destination folder maps each artifact's file name to a
+/// 64-bit hash of its inputs plus the size and modification time it had
+/// when written.  If the inputs hash the same and the file is still as it
+/// was left, the export can skip regenerating it: the file and its
+/// timestamp stay untouched, so Unity sees nothing to reimport.
+///
+/// An artifact made of several files (a .gltf and its .bin buffers) lists
+/// the others in its entry; it is up to date only if they all are.
+class DzUnityExportCache
+{
+public:
+    explicit DzUnityExportCache(const QString& folder);
+    ~DzUnityExportCache();
+
+    /// True if @p path, and every companion recorded with it, was recorded
+    /// with @p inputsKey and is unchanged on disk since.
+    bool isUpToDate(const QString& path, quint64 inputsKey) const;
+
+    /// Note that @p path, and the @p companions written with it in the
+    /// same folder, have just been written from @p inputsKey.
+    void record(const QString& path, quint64 inputsKey,
+                const QStringList& companions = QStringList());
+
+    /// Drop the entry for @p path and its companions, e.g. after a failed
+    /// export.
+    void forget(const QString& path);
+
+    /// Write @p data to @p path unless the file already holds exactly that.
+    /// Returns false only on a write error.
+    static bool writeIfChanged(const QString& path, const QByteArray& data);
+
+private:
+    QString    m_sFolder;
+    QSettings* m_pSettings;
+
+    QString keyFor(const QString& path) const;
+    bool fileIsUpToDate(const QString& path, quint64 inputsKey) const;
+    void recordFile(const QString& path, quint64 inputsKey, const QStringList& companions);
+};
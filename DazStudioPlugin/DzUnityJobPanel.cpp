@@ -0,0 +1,103 @@
+// DzUnityJobPanel.cpp
+// Status window for background sends.
+
+#include "DzUnityJobPanel.h"
+
+#include <QtGui/qboxlayout.h>
+#include <QtGui/qheaderview.h>
+#include <QtGui/qpushbutton.h>
+#include <QtGui/qtreewidget.h>
+#include <QtCore/qtimer.h>
+
+#include "DzUnityJobQueue.h"
+
+namespace
+{
+    enum Column { ColumnAsset, ColumnType, ColumnState, ColumnWait, ColumnExport, ColumnGltf, ColumnCount };
+
+    QString seconds(double fSeconds)
+    {
+        return QString::number(fSeconds, 'f', 1) + " s";
+    }
+}
+
+DzUnityJobPanel::DzUnityJobPanel(DzUnityJobQueue* pQueue, QWidget* parent)
+    : QWidget(parent, Qt::Tool)
+    , m_pQueue(pQueue)
+{
+    setWindowTitle(tr("Daz To Unity Jobs"));
+
+    m_pJobList = new QTreeWidget(this);
+    m_pJobList->setColumnCount(ColumnCount);
+    m_pJobList->setRootIsDecorated(false);
+    m_pJobList->setHeaderLabels(QStringList() << tr("Asset") << tr("Type") << tr("State")
+        << tr("Waited") << tr("Export") << tr("glTF"));
+    m_pJobList->header()->setStretchLastSection(false);
+    m_pJobList->header()->setResizeMode(ColumnAsset, QHeaderView::Stretch);
+
+    m_pCancelButton = new QPushButton(tr("Cancel Queued"), this);
+    m_pClearButton = new QPushButton(tr("Clear Finished"), this);
+    connect(m_pCancelButton, SIGNAL(released()), m_pQueue, SLOT(cancelQueued()));
+    connect(m_pClearButton, SIGNAL(released()), m_pQueue, SLOT(clearFinished()));
+
+    QHBoxLayout* buttonLayout = new QHBoxLayout();
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(m_pCancelButton);
+    buttonLayout->addWidget(m_pClearButton);
+
+    QVBoxLayout* mainLayout = new QVBoxLayout();
+    mainLayout->addWidget(m_pJobList);
+    mainLayout->addLayout(buttonLayout);
+    setLayout(mainLayout);
+    resize(560, 240);
+
+    m_pRefreshTimer = new QTimer(this);
+    m_pRefreshTimer->setInterval(500);
+    connect(m_pRefreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+    connect(m_pQueue, SIGNAL(jobsChanged()), this, SLOT(refresh()));
+    refresh();
+}
+
+void DzUnityJobPanel::refresh()
+{
+    const QList<DzUnityJobQueue::Job>& aJobs = m_pQueue->getJobs();
+
+    // one row per job, in queue order; rows are reused to keep the
+    // selection and scroll position
+    while (m_pJobList->topLevelItemCount() > aJobs.size())
+        delete m_pJobList->takeTopLevelItem(m_pJobList->topLevelItemCount() - 1);
+    while (m_pJobList->topLevelItemCount() < aJobs.size())
+        m_pJobList->addTopLevelItem(new QTreeWidgetItem());
+
+    for (int i = 0; i < aJobs.size(); ++i)
+    {
+        const DzUnityJobQueue::Job& job = aJobs[i];
+        double fElapsed = job.timer.nsecsElapsed() / 1.0e9;
+        QString sWait = job.eState == DzUnityJobQueue::Queued ? seconds(fElapsed) : seconds(job.fWaitSeconds);
+        QString sExport, sGltf;
+        if (job.eState == DzUnityJobQueue::Exporting)
+            sExport = seconds(fElapsed);
+        else if (job.fExportSeconds > 0.0)
+            sExport = seconds(job.fExportSeconds);
+        if (job.eState == DzUnityJobQueue::Encoding)
+            sGltf = seconds(fElapsed);
+        else if (job.fGltfSeconds > 0.0)
+            sGltf = seconds(job.fGltfSeconds);
+
+        QTreeWidgetItem* item = m_pJobList->topLevelItem(i);
+        item->setText(ColumnAsset, job.sLabel);
+        item->setText(ColumnType, job.sAssetType);
+        item->setText(ColumnState, DzUnityJobQueue::stateName(job.eState));
+        item->setText(ColumnWait, sWait);
+        item->setText(ColumnExport, sExport);
+        item->setText(ColumnGltf, sGltf);
+        item->setToolTip(ColumnState, job.sError);
+    }
+
+    if (m_pQueue->isBusy())
+        m_pRefreshTimer->start();
+    else
+        m_pRefreshTimer->stop();
+}
+
+#include "moc_DzUnityJobPanel.cpp"
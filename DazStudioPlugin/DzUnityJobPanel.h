@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QtGui/qwidget.h>
+
+class QTreeWidget;
+class QPushButton;
+class QTimer;
+class DzUnityJobQueue;
+
+/// Small tool window listing the background sends of a DzUnityJobQueue:
+/// state, how long each waited, its FBX/DTU export and its glTF encode.
+class DzUnityJobPanel : public QWidget
+{
+    Q_OBJECT
+public:
+    DzUnityJobPanel(DzUnityJobQueue* pQueue, QWidget* parent = nullptr);
+
+protected slots:
+    void refresh();
+
+private:
+    DzUnityJobQueue* m_pQueue;
+    QTreeWidget*     m_pJobList;
+    QPushButton*     m_pCancelButton;
+    QPushButton*     m_pClearButton;
+    QTimer*          m_pRefreshTimer;   // running jobs' times tick while the queue is busy
+};
@@ -0,0 +1,213 @@
+// DzUnityJobQueue.cpp
+// Background sends: accepted jobs exported one at a time from the event
+// loop, their glTF encodes overlapping the next job.
+
+#include "DzUnityJobQueue.h"
+
+#include <QtCore/qthread.h>
+#include <QtCore/qtimer.h>
+
+#include <dzapp.h>
+#include <dzscene.h>
+#include <dznode.h>
+
+#include "DzGLTFExporter.h"
+#include "DzUnityExportCache.h"
+
+// how often the queue looks for finished encodes and the next job
+static const int kPollIntervalMs = 100;
+
+DzUnityJobQueue::DzUnityJobQueue(DzUnityAction* pAction)
+    : QObject(pAction)
+    , m_pAction(pAction)
+    , m_pTimer(new QTimer(this))
+    , m_nNextId(1)
+    , m_nMaxEncoding(qMax(1, QThread::idealThreadCount() / 2))
+    , m_bSending(false)
+    , m_bPaused(false)
+{
+    m_pTimer->setInterval(kPollIntervalMs);
+    connect(m_pTimer, SIGNAL(timeout()), this, SLOT(process()));
+}
+
+void DzUnityJobQueue::enqueue(const DzUnityAction::SendSettings& settings)
+{
+    Job job;
+    job.nId = m_nNextId++;
+    job.sLabel = settings.sExportFilename.isEmpty() ? settings.sAssetName : settings.sExportFilename;
+    job.sAssetType = settings.sAssetType;
+    job.settings = settings;
+    job.eState = Queued;
+    job.fWaitSeconds = 0.0;
+    job.fExportSeconds = 0.0;
+    job.fGltfSeconds = 0.0;
+    job.timer.start();
+    m_aJobs.append(job);
+
+    dzApp->log(QString("DazToUnity: queued send %1 (%2)").arg(job.nId).arg(job.sLabel));
+    emit jobsChanged();
+    if (!m_pTimer->isActive())
+        m_pTimer->start();
+}
+
+bool DzUnityJobQueue::isBusy() const
+{
+    return countState(Queued) + countState(Exporting) + countState(Encoding) > 0;
+}
+
+int DzUnityJobQueue::countState(State eState) const
+{
+    int n = 0;
+    for (int i = 0; i < m_aJobs.size(); ++i)
+        if (m_aJobs[i].eState == eState)
+            ++n;
+    return n;
+}
+
+QString DzUnityJobQueue::stateName(State eState)
+{
+    switch (eState)
+    {
+    case Queued:    return tr("Queued");
+    case Exporting: return tr("Exporting");
+    case Encoding:  return tr("Writing glTF");
+    case Done:      return tr("Done");
+    case Failed:    return tr("Failed");
+    case Cancelled: return tr("Cancelled");
+    }
+    return QString();
+}
+
+void DzUnityJobQueue::cancelQueued()
+{
+    for (int i = 0; i < m_aJobs.size(); ++i)
+        if (m_aJobs[i].eState == Queued)
+            m_aJobs[i].eState = Cancelled;
+    emit jobsChanged();
+}
+
+void DzUnityJobQueue::clearFinished()
+{
+    for (int i = m_aJobs.size() - 1; i >= 0; --i)
+    {
+        State eState = m_aJobs[i].eState;
+        if (eState == Done || eState == Failed || eState == Cancelled)
+            m_aJobs.removeAt(i);
+    }
+    emit jobsChanged();
+}
+
+// ---------------------------------------------------------------------------
+// Running jobs
+// ---------------------------------------------------------------------------
+
+void DzUnityJobQueue::process()
+{
+    // a job's export waits on the UI, which lands back here; so does a
+    // send waiting for its glTF, and a batch, which drive the same action
+    if (m_bSending || m_pAction->m_bWaitingForGltf || m_pAction->m_bBatchRunning)
+        return;
+
+    for (int i = 0; i < m_aJobs.size(); ++i)
+        if (m_aJobs[i].eState == Encoding && m_aJobs[i].gltf.pExporter->isExportFinished())
+            joinJob(i);
+
+    if (!m_bPaused && countState(Encoding) < m_nMaxEncoding)
+    {
+        for (int i = 0; i < m_aJobs.size(); ++i)
+        {
+            if (m_aJobs[i].eState == Queued)
+            {
+                runJob(i);
+                break;
+            }
+        }
+    }
+
+    if (!isBusy())
+        m_pTimer->stop();
+}
+
+void DzUnityJobQueue::runJob(int nJob)
+{
+    Job& job = m_aJobs[nJob];
+    job.fWaitSeconds = job.timer.nsecsElapsed() / 1.0e9;
+    if (!job.settings.pNode)
+    {
+        job.eState = Failed;
+        job.sError = tr("The node was deleted before the send started");
+        emit jobsChanged();
+        return;
+    }
+
+    job.eState = Exporting;
+    emit jobsChanged();
+
+    // the export reads the node as the selection, as an interactive send
+    // does; the user's selection, even an empty one, is put back afterwards
+    DzNode* pPreviousSelection = dzScene->getPrimarySelection();
+    dzScene->setPrimarySelection(job.settings.pNode);
+
+    m_bSending = true;
+    int nId = job.nId;
+    job.timer.restart();
+    DzUnityAction::PendingGltf gltf;
+    QString sError;
+    bool bOk = m_pAction->runQueuedSend(job.settings, gltf, sError);
+    m_bSending = false;
+
+    if (pPreviousSelection)
+        dzScene->setPrimarySelection(pPreviousSelection);
+    else
+        dzScene->selectAllNodes(false);
+
+    // the panel may have cleared other jobs meanwhile, shifting this one
+    int nIndex = 0;
+    while (m_aJobs[nIndex].nId != nId)
+        ++nIndex;
+    Job& ran = m_aJobs[nIndex];
+
+    ran.fExportSeconds = ran.timer.nsecsElapsed() / 1.0e9;
+    ran.sError = sError;
+    ran.gltf = gltf;
+    ran.timer.restart();
+    if (gltf.pExporter)
+        ran.eState = Encoding;
+    else
+        ran.eState = bOk ? Done : Failed;
+    dzApp->log(QString("DazToUnity: send %1 (%2) exported in %3 s")
+        .arg(ran.nId).arg(ran.sLabel).arg(ran.fExportSeconds, 0, 'f', 1));
+    emit jobsChanged();
+}
+
+void DzUnityJobQueue::joinJob(int nJob)
+{
+    Job& job = m_aJobs[nJob];
+
+    // joined from the timer, long after runQueuedSend() put the action back
+    // in interactive mode: a failure goes to the panel, not a message box
+    int nInteractiveMode = m_pAction->m_nNonInteractiveMode;
+    m_pAction->m_nNonInteractiveMode = 1;
+    QString sGltfError;
+    bool bOk = m_pAction->joinGltfExport(job.gltf.pExporter, job.gltf.bStarted, &sGltfError);
+    m_pAction->m_nNonInteractiveMode = nInteractiveMode;
+    job.fGltfSeconds = job.timer.nsecsElapsed() / 1.0e9;
+
+    if (job.gltf.bCacheable)
+    {
+        DzUnityExportCache exportCache(job.gltf.sCacheFolder);
+        if (bOk)
+            exportCache.record(job.gltf.sPath, job.gltf.nKey, m_pAction->m_aGltfBufferFiles);
+        else
+            exportCache.forget(job.gltf.sPath);
+    }
+
+    // a failed FBX stays failed; a failed glTF fails the job
+    if (job.sError.isEmpty() && !bOk)
+        job.sError = tr("glTF export failed: ") + sGltfError;
+    job.eState = job.sError.isEmpty() ? Done : Failed;
+    job.gltf = DzUnityAction::PendingGltf();
+    emit jobsChanged();
+}
+
+#include "moc_DzUnityJobQueue.cpp"
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QElapsedTimer>
+
+#include "DzUnityAction.h"
+
+class QTimer;
+
+/// Sends accepted while "Send in Background" is on, run one after another
+/// without holding up Daz Studio.
+///
+/// Accepting the dialog only records the selection and options (a job).
+/// Jobs start from the event loop, oldest first, once the dialog is closed.
+/// The FBX and DTU of a job are written on the main thread, as any send's;
+/// its glTF is then encoded and written on the thread pool while the next
+/// job starts.  At most getMaxEncoding() glTF encodes run at once.
+///
+/// A job exports the scene as it is when the job starts, not as it was when
+/// accepted: FBX export reads the live scene.  A job whose node has been
+/// deleted by then fails.
+class DzUnityJobQueue : public QObject
+{
+    Q_OBJECT
+public:
+    enum State { Queued, Exporting, Encoding, Done, Failed, Cancelled };
+
+    struct Job
+    {
+        int                         nId;
+        QString                     sLabel;
+        QString                     sAssetType;
+        DzUnityAction::SendSettings settings;
+        State                       eState;
+        QString                     sError;
+        QElapsedTimer               timer;              // since accepted, then since the glTF was left encoding
+        double                      fWaitSeconds;       // accepted -> started
+        double                      fExportSeconds;     // main thread: FBX, DTU, glTF snapshot
+        double                      fGltfSeconds;       // glTF still encoding after that
+        DzUnityAction::PendingGltf  gltf;
+    };
+
+    explicit DzUnityJobQueue(DzUnityAction* pAction);
+
+    void enqueue(const DzUnityAction::SendSettings& settings);
+
+    const QList<Job>& getJobs() const { return m_aJobs; }
+
+    /// Jobs queued, exporting or encoding.
+    bool isBusy() const;
+    /// A job's main-thread export is on the stack.
+    bool isSending() const { return m_bSending; }
+
+    /// Hold queued jobs, e.g. while the bridge dialog is open.
+    void setPaused(bool b) { m_bPaused = b; }
+
+    void setMaxEncoding(int n) { m_nMaxEncoding = qMax(1, n); }
+    int getMaxEncoding() const { return m_nMaxEncoding; }
+
+    static QString stateName(State eState);
+
+public slots:
+    /// Mark every job that has not started as cancelled.
+    void cancelQueued();
+    /// Forget finished, failed and cancelled jobs.
+    void clearFinished();
+
+signals:
+    void jobsChanged();
+
+private slots:
+    void process();
+
+private:
+    DzUnityAction* m_pAction;
+    QTimer*        m_pTimer;
+    QList<Job>     m_aJobs;
+    int            m_nNextId;
+    int            m_nMaxEncoding;
+    bool           m_bSending;
+    bool           m_bPaused;
+
+    int  countState(State eState) const;
+    void runJob(int nJob);
+    void joinJob(int nJob);
+};
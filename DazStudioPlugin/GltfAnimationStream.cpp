@@ -0,0 +1,341 @@
+// GltfAnimationStream.cpp
+// Windowed, bounded-memory keyframe encoding for long animation takes.
+//
+// The per-channel fit is the same greedy algorithm as
+// GltfKeyframeReducer::reduceChannel(), restated so it can consume keys one
+// at a time: the state is the anchor key plus the keys sampled since it.
+
+#include "GltfAnimationStream.h"
+
+#include <QtCore/qtconcurrentmap.h>
+
+#include <cmath>
+#include <cstring>
+
+// ---------------------------------------------------------------------------
+// Construction
+// ---------------------------------------------------------------------------
+
+GltfAnimationStream::GltfAnimationStream(const GltfKeyReductionOptions& options)
+    : m_reducer(options)
+    , m_bFinished(false)
+{
+}
+
+GltfAnimationStream::~GltfAnimationStream()
+{
+    if (m_scratch.isOpen())
+        m_scratch.close();
+    if (!m_scratch.fileName().isEmpty())
+        m_scratch.remove();
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+bool GltfAnimationStream::begin(const QVector<GltfAnimChannel>& channels,
+                                const QString& scratchPath)
+{
+    m_channels.clear();
+    m_channels.resize(channels.size());
+    for (int c = 0; c < channels.size(); ++c) {
+        ChannelState& st = m_channels[c];
+        st.desc = channels[c];
+        st.desc.times.clear();
+        st.desc.values.clear();
+        st.desc.quantized = st.desc.path == GltfAnimChannel::Rotation
+                         && m_reducer.options().quantizeRotations;
+    }
+
+    m_bFinished = false;
+    m_scratch.setFileName(scratchPath);
+    if (!m_scratch.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        m_sLastError = QString("GltfAnimationStream: cannot open scratch file '%1'").arg(scratchPath);
+        return false;
+    }
+    return true;
+}
+
+struct GltfAnimationStream::FitTask
+{
+    typedef void result_type;
+
+    const GltfAnimationStream* stream;
+    ChannelState*              channels;
+    const QVector<float>*      times;
+    const QVector< QVector<float> >* values;
+
+    void operator()(int& c) const
+    {
+        ChannelState& st = channels[c];
+        const int comps  = st.desc.componentCount();
+        const float* src = (*values)[c].constData();
+        for (int f = 0; f < times->size(); ++f)
+            stream->feedKey(st, (*times)[f], src + f * comps);
+    }
+};
+
+bool GltfAnimationStream::appendWindow(const QVector<float>& times,
+                                       const QVector< QVector<float> >& values)
+{
+    if (m_bFinished || values.size() != m_channels.size()) {
+        m_sLastError = "GltfAnimationStream: window does not match declared channels";
+        return false;
+    }
+    for (int c = 0; c < values.size(); ++c) {
+        if (values[c].size() != times.size() * m_channels[c].desc.componentCount()) {
+            m_sLastError = "GltfAnimationStream: window value count mismatch";
+            return false;
+        }
+    }
+
+    QVector<int> indices(m_channels.size());
+    for (int c = 0; c < indices.size(); ++c)
+        indices[c] = c;
+
+    FitTask task;
+    task.stream   = this;
+    task.channels = m_channels.data();   // detach once, before the workers start
+    task.times    = &times;
+    task.values   = &values;
+    QtConcurrent::blockingMap(indices, task);
+
+    return flushWindow();
+}
+
+bool GltfAnimationStream::finish()
+{
+    if (m_bFinished)
+        return true;
+
+    for (int c = 0; c < m_channels.size(); ++c) {
+        ChannelState& st = m_channels[c];
+        const int comps = st.desc.componentCount();
+        if (st.desc.times.size() > 1)
+            emitKey(st, st.desc.times.last(), st.desc.values.constData() + st.desc.values.size() - comps);
+        st.desc.times.clear();
+        st.desc.values.clear();
+    }
+    m_bFinished = true;
+    return flushWindow();
+}
+
+bool GltfAnimationStream::isDropped(int c) const
+{
+    const ChannelState& st = m_channels[c];
+    if (st.keysIn == 0)
+        return true;
+    if (!st.constant || !m_reducer.options().enabled)
+        return false;
+    return GltfKeyframeReducer::keyError(st.desc, st.firstKey, st.desc.restValue)
+           <= m_reducer.toleranceFor(st.desc);
+}
+
+int GltfAnimationStream::keyCount(int c) const
+{
+    if (isDropped(c))
+        return 0;
+    const ChannelState& st = m_channels[c];
+    return (st.constant && m_reducer.options().enabled) ? 1 : st.keysOut;
+}
+
+bool GltfAnimationStream::copyTimes(int c, QIODevice& out)
+{
+    int remaining = keyCount(c);
+    const QVector<Segment>& segs = m_channels[c].segments;
+    for (int s = 0; s < segs.size() && remaining > 0; ++s) {
+        int n = qMin(segs[s].keys, remaining);
+        if (!copyRange(segs[s].offset, (qint64)n * 4, out))
+            return false;
+        remaining -= n;
+    }
+    return true;
+}
+
+bool GltfAnimationStream::copyValues(int c, QIODevice& out, bool asInt16)
+{
+    const ChannelState& st = m_channels[c];
+    const int comps = st.desc.componentCount();
+    int remaining = keyCount(c);
+
+    for (int s = 0; s < st.segments.size() && remaining > 0; ++s)
+    {
+        const Segment& seg = st.segments[s];
+        int n = qMin(seg.keys, remaining);
+        qint64 valueOffset = seg.offset + (qint64)seg.keys * 4;
+        remaining -= n;
+
+        if (!asInt16) {
+            if (!copyRange(valueOffset, (qint64)n * comps * 4, out))
+                return false;
+            continue;
+        }
+
+        QVector<float> buf(n * comps);
+        if (!m_scratch.seek(valueOffset)
+            || m_scratch.read((char*)buf.data(), (qint64)buf.size() * 4) != (qint64)buf.size() * 4) {
+            m_sLastError = "GltfAnimationStream: scratch read failed";
+            return false;
+        }
+        QByteArray packed;
+        packed.reserve(buf.size() * 2);
+        for (int i = 0; i < buf.size(); ++i) {
+            float v = qBound(-1.0f, buf[i], 1.0f);
+            quint16 bits = (quint16)(qint16)qRound(v * 32767.0f);
+            packed.append((char)(bits & 0xFF));
+            packed.append((char)(bits >> 8));
+        }
+        if (out.write(packed) != packed.size()) {
+            m_sLastError = "GltfAnimationStream: output write failed";
+            return false;
+        }
+    }
+    return true;
+}
+
+GltfKeyReductionStats GltfAnimationStream::stats() const
+{
+    GltfKeyReductionStats s;
+    s.channelsIn = m_channels.size();
+    for (int c = 0; c < m_channels.size(); ++c) {
+        s.keysIn += m_channels[c].keysIn;
+        int k = keyCount(c);
+        s.keysOut += k;
+        if (k > 0) ++s.channelsOut;
+    }
+    return s;
+}
+
+// ---------------------------------------------------------------------------
+// Streaming fit
+// ---------------------------------------------------------------------------
+
+void GltfAnimationStream::feedKey(ChannelState& st, float time, const float* src) const
+{
+    const int comps = st.desc.componentCount();
+    float key[4];
+    memcpy(key, src, comps * sizeof(float));
+
+    if (st.desc.path == GltfAnimChannel::Rotation) {
+        if (st.desc.quantized)
+            GltfKeyframeReducer::unpackSmallestThree(GltfKeyframeReducer::packSmallestThree(key), key);
+        if (st.keysIn > 0) {
+            const float* p = st.prevKey;
+            if (p[0]*key[0] + p[1]*key[1] + p[2]*key[2] + p[3]*key[3] < 0.0f) {
+                key[0] = -key[0]; key[1] = -key[1]; key[2] = -key[2]; key[3] = -key[3];
+            }
+        }
+        memcpy(st.prevKey, key, sizeof(key));
+    }
+
+    const float tol = m_reducer.toleranceFor(st.desc);
+    if (st.keysIn == 0) {
+        memcpy(st.firstKey, key, comps * sizeof(float));
+        st.tMin = time;
+    } else if (st.constant) {
+        st.constant = GltfKeyframeReducer::keyError(st.desc, st.firstKey, key) <= tol;
+    }
+    st.tMax = time;
+    ++st.keysIn;
+
+    QVector<float>& pt = st.desc.times;    // pending span: anchor + keys since
+    QVector<float>& pv = st.desc.values;
+
+    if (pt.isEmpty()) {
+        emitKey(st, time, key);
+        pt.append(time);
+        for (int c = 0; c < comps; ++c) pv.append(key[c]);
+        return;
+    }
+
+    if (pt.size() == 1) {
+        pt.append(time);
+        for (int c = 0; c < comps; ++c) pv.append(key[c]);
+        return;
+    }
+
+    bool fits = m_reducer.options().enabled
+             && pt.size() <= GltfKeyframeReducer::kMaxSpanKeys;
+    if (fits) {
+        const float* a  = pv.constData();
+        const float  t0 = pt[0];
+        const float  dt = time - t0;
+        float interp[4];
+        for (int k = 1; k < pt.size() && fits; ++k) {
+            float t = dt > 0.0f ? (pt[k] - t0) / dt : 0.0f;
+            GltfKeyframeReducer::interpolate(st.desc, a, key, t, interp);
+            fits = GltfKeyframeReducer::keyError(st.desc, interp, a + k * comps) <= tol;
+        }
+    }
+
+    if (!fits) {
+        // the previous key becomes the new anchor
+        float lastT = pt.last();
+        float last[4];
+        memcpy(last, pv.constData() + pv.size() - comps, comps * sizeof(float));
+        emitKey(st, lastT, last);
+        pt.resize(0);
+        pv.resize(0);
+        pt.append(lastT);
+        for (int c = 0; c < comps; ++c) pv.append(last[c]);
+    }
+
+    pt.append(time);
+    for (int c = 0; c < comps; ++c) pv.append(key[c]);
+}
+
+void GltfAnimationStream::emitKey(ChannelState& st, float time, const float* key)
+{
+    st.outTimes.append(time);
+    for (int c = 0; c < st.desc.componentCount(); ++c)
+        st.outValues.append(key[c]);
+}
+
+bool GltfAnimationStream::flushWindow()
+{
+    for (int c = 0; c < m_channels.size(); ++c)
+    {
+        ChannelState& st = m_channels[c];
+        if (st.outTimes.isEmpty())
+            continue;
+
+        Segment seg;
+        seg.offset = m_scratch.size();
+        seg.keys   = st.outTimes.size();
+
+        qint64 tBytes = (qint64)st.outTimes.size() * 4;
+        qint64 vBytes = (qint64)st.outValues.size() * 4;
+        if (!m_scratch.seek(seg.offset)
+            || m_scratch.write((const char*)st.outTimes.constData(), tBytes) != tBytes
+            || m_scratch.write((const char*)st.outValues.constData(), vBytes) != vBytes) {
+            m_sLastError = "GltfAnimationStream: scratch write failed";
+            return false;
+        }
+
+        st.segments.append(seg);
+        st.keysOut += seg.keys;
+        st.outTimes.resize(0);
+        st.outValues.resize(0);
+    }
+    return true;
+}
+
+bool GltfAnimationStream::copyRange(qint64 offset, qint64 bytes, QIODevice& out)
+{
+    static const qint64 kChunk = 1 << 20;
+    QByteArray buf;
+    if (!m_scratch.seek(offset)) {
+        m_sLastError = "GltfAnimationStream: scratch seek failed";
+        return false;
+    }
+    while (bytes > 0) {
+        buf = m_scratch.read(qMin(bytes, kChunk));
+        if (buf.isEmpty() || out.write(buf) != buf.size()) {
+            m_sLastError = "GltfAnimationStream: copy to output failed";
+            return false;
+        }
+        bytes -= buf.size();
+    }
+    return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QtCore/qfile.h>
+
+#include "GltfKeyframeReducer.h"
+
+class QIODevice;
+
+/// Bounded-memory animation encoder for long takes.
+///
+/// Frames arrive one window at a time.  Each channel runs a streaming version
+/// of GltfKeyframeReducer's greedy fit; the keys it settles on are appended to
+/// a scratch file before the next window is sampled.  Peak memory is one
+/// window of samples plus at most kMaxSpanKeys pending keys per channel,
+/// independent of take length.  Once all windows are in, the kept keys are
+/// copied from the scratch file straight into the GLB's BIN chunk.
+class GltfAnimationStream
+{
+public:
+    explicit GltfAnimationStream(const GltfKeyReductionOptions& options = GltfKeyReductionOptions());
+    ~GltfAnimationStream();
+
+    /// Declare the channels (node, path, restValue; keys are ignored) and
+    /// open @p scratchPath.  Returns false if the scratch file cannot be opened.
+    bool begin(const QVector<GltfAnimChannel>& channels, const QString& scratchPath);
+
+    /// Feed one window.  @p times holds one entry per frame; @p values holds,
+    /// per channel, times.size() * componentCount() floats.
+    bool appendWindow(const QVector<float>& times,
+                      const QVector< QVector<float> >& values);
+
+    /// Flush pending keys.  Final key counts are valid afterwards.
+    bool finish();
+
+    int  channelCount() const { return m_channels.size(); }
+    const GltfAnimChannel& channelDesc(int c) const { return m_channels[c].desc; }
+    bool isDropped(int c) const;
+    int  keyCount(int c) const;
+    float timeMin(int c) const { return m_channels[c].tMin; }
+    float timeMax(int c) const { return m_channels[c].tMax; }
+
+    /// Stream channel @p c's kept key times (float) into @p out.
+    bool copyTimes(int c, QIODevice& out);
+    /// Stream channel @p c's kept values into @p out; rotations become
+    /// normalised int16 when @p asInt16.
+    bool copyValues(int c, QIODevice& out, bool asInt16);
+
+    GltfKeyReductionStats stats() const;
+    QString getLastError() const { return m_sLastError; }
+
+private:
+    struct Segment
+    {
+        qint64 offset;   // times, then values, in the scratch file
+        int    keys;
+    };
+
+    struct ChannelState
+    {
+        GltfAnimChannel desc;          // times/values hold the pending span
+        QVector<float>  outTimes;      // keys settled during this window
+        QVector<float>  outValues;
+        QVector<Segment> segments;
+        float firstKey[4];
+        float prevKey[4];
+        bool  constant;
+        int   keysIn;
+        int   keysOut;
+        float tMin;
+        float tMax;
+
+        ChannelState() : constant(true), keysIn(0), keysOut(0), tMin(0.0f), tMax(0.0f) {}
+    };
+
+    struct FitTask;
+    friend struct FitTask;
+
+    GltfKeyframeReducer   m_reducer;
+    QVector<ChannelState> m_channels;
+    QFile   m_scratch;
+    bool    m_bFinished;
+    QString m_sLastError;
+
+    void feedKey(ChannelState& st, float time, const float* key) const;
+    static void emitKey(ChannelState& st, float time, const float* key);
+    bool flushWindow();
+    bool copyRange(qint64 offset, qint64 bytes, QIODevice& out);
+};
@@ -0,0 +1,85 @@
+// GltfBufferPool.cpp
+// Size-classed free lists of QByteArray blocks, shared between threads.
+
+#include "GltfBufferPool.h"
+#include "GltfMemory.h"
+
+#include <QtCore/qmutex.h>
+
+static int blockSizeFor(int minBytes)
+{
+    int size = GltfBufferPool::kMinBlockBytes;
+    while (size < minBytes && size < (1 << 30))
+        size <<= 1;
+    return qMax(size, minBytes);
+}
+
+GltfBufferPool::GltfBufferPool()
+{
+}
+
+GltfBufferPool::~GltfBufferPool()
+{
+    trim(0);
+}
+
+QByteArray GltfBufferPool::acquire(int minBytes)
+{
+    int size = blockSizeFor(minBytes);
+
+    QMutexLocker lock(&m_mutex);
+    ++m_stats.acquires;
+    m_stats.bytesInUse += size;
+
+    QMap<int, QList<QByteArray> >::iterator it = m_free.find(size);
+    if (it != m_free.end() && !it.value().isEmpty()) {
+        m_stats.bytesHeld -= size;
+        return it.value().takeLast();
+    }
+
+    ++m_stats.allocations;
+    m_stats.bytesAllocated += size;
+    m_stats.peakBytes = qMax(m_stats.peakBytes, m_stats.bytesInUse + m_stats.bytesHeld);
+    lock.unlock();
+
+    GltfMemory::allocated(GltfMemoryBuffers, size);
+
+    // allocate outside the lock; other threads keep drawing from the lists
+    return QByteArray(size, Qt::Uninitialized);
+}
+
+void GltfBufferPool::release(QByteArray& block)
+{
+    int size = block.size();
+    if (size == 0)
+        return;
+
+    QMutexLocker lock(&m_mutex);
+    m_stats.bytesInUse -= size;
+    m_stats.bytesHeld  += size;
+    m_free[size].append(block);
+    block = QByteArray();
+}
+
+void GltfBufferPool::trim(qint64 keepBytes)
+{
+    QMutexLocker lock(&m_mutex);
+    while (m_stats.bytesHeld > keepBytes && !m_free.isEmpty())
+    {
+        QMap<int, QList<QByteArray> >::iterator it = m_free.end();
+        --it;
+        if (it.value().isEmpty()) {
+            m_free.erase(it);
+            continue;
+        }
+        it.value().removeLast();
+        m_stats.bytesHeld -= it.key();
+        GltfMemory::released(GltfMemoryBuffers, it.key());
+    }
+}
+
+GltfBufferPoolStats GltfBufferPool::stats() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_stats;
+}
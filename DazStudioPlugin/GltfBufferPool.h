@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+
+/// Allocation counters for GltfBufferPool.
+struct GltfBufferPoolStats
+{
+    qint64 acquires;        // blocks handed out
+    qint64 allocations;     // of those, freshly allocated rather than reused
+    qint64 bytesAllocated;  // total size of fresh allocations
+    qint64 bytesInUse;      // handed out and not yet released
+    qint64 bytesHeld;       // released and kept for reuse
+    qint64 peakBytes;       // high-water mark of in use + held
+
+    GltfBufferPoolStats()
+        : acquires(0), allocations(0), bytesAllocated(0)
+        , bytesInUse(0), bytesHeld(0), peakBytes(0) {}
+};
+
+/// Thread-safe pool of scratch byte blocks for the glTF writer.
+///
+/// Blocks are rounded up to a power of two (64 KB at least) and, once
+/// released, kept on a free list for the next request of that size class.
+/// A pool that outlives many exports settles into reusing the same few
+/// blocks: allocations stops growing once the largest export has run.
+/// trim() hands memory back to the heap when a batch is done.
+class GltfBufferPool
+{
+public:
+    GltfBufferPool();
+    ~GltfBufferPool();
+
+    /// A block of at least @p minBytes.  Its contents are undefined; the
+    /// QByteArray's size is the block's full capacity.
+    QByteArray acquire(int minBytes);
+
+    /// Return a block from acquire().  @p block is left empty.
+    void release(QByteArray& block);
+
+    /// Free held blocks, largest first, until at most @p keepBytes remain.
+    void trim(qint64 keepBytes = 0);
+
+    GltfBufferPoolStats stats() const;
+
+    /// Smallest block handed out.
+    static const int kMinBlockBytes = 64 * 1024;
+
+private:
+    Q_DISABLE_COPY(GltfBufferPool)
+
+    mutable QMutex                  m_mutex;
+    QMap<int, QList<QByteArray> >   m_free;     // by block size
+    GltfBufferPoolStats             m_stats;
+};
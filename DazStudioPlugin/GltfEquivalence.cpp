@@ -0,0 +1,592 @@
+// GltfEquivalence.cpp
+// Semantic comparison of two glTF exports; see GltfEquivalence.h for what
+// counts as "the same".
+
+#include "GltfEquivalence.h"
+#include "GltfGlbReader.h"
+#include "GltfHash.h"
+
+#include <QtCore/qfileinfo.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qpair.h>
+#include <QtCore/qvector.h>
+
+#include <cmath>
+
+// ---------------------------------------------------------------------------
+// Difference list
+// ---------------------------------------------------------------------------
+
+namespace
+{
+    struct DiffList
+    {
+        QStringList* out;
+        int          max;
+        int          total;
+
+        void add(const QString& s)
+        {
+            if (total++ < max)
+                out->append(s);
+        }
+    };
+
+    /// What one side of the comparison knows about its document.
+    struct Side
+    {
+        const GltfDocument*          doc;
+        QVector<GltfReadPrimitive>   prims;
+        QVector<QVector<int> >       skinJointIds;  // per skin: joint name id per joint
+    };
+
+    typedef QHash<QString, int> NameIds;
+
+}
+
+static bool near(float a, float b, float tol)
+{
+    return std::fabs(a - b) <= tol;
+}
+
+static QString vecString(const float* v, int n)
+{
+    QStringList parts;
+    for (int i = 0; i < n; ++i)
+        parts.append(QString::number(v[i], 'g', 6));
+    return "(" + parts.join(", ") + ")";
+}
+
+/// A node's name, or "#<index>" when it has none.
+static QString nodeName(const GltfDocument& doc, int node)
+{
+    if (node < 0)
+        return QString();
+    QString name = doc.json["nodes"].at(node)["name"].toString();
+    return name.isEmpty() ? QString("#%1").arg(node) : name;
+}
+
+static QString meshName(const GltfDocument& doc, int mesh)
+{
+    if (mesh < 0)
+        return QString();
+    QString name = doc.json["meshes"].at(mesh)["name"].toString();
+    return name.isEmpty() ? QString("#%1").arg(mesh) : name;
+}
+
+static QString materialName(const GltfDocument& doc, int material)
+{
+    if (material < 0)
+        return "<default>";
+    QString name = doc.json["materials"].at(material)["name"].toString();
+    return name.isEmpty() ? QString("#%1").arg(material) : name;
+}
+
+/// Indices of @p array's elements grouped by @p nameOf, in document order.
+static QMap<QString, QList<int> > indicesByName(const GltfDocument& doc, int count,
+                                                QString (*nameOf)(const GltfDocument&, int))
+{
+    QMap<QString, QList<int> > map;
+    for (int i = 0; i < count; ++i)
+        map[nameOf(doc, i)].append(i);
+    return map;
+}
+
+static bool prepareSide(const GltfDocument& doc, Side& side, NameIds& nameIds, DiffList& diffs,
+                        const char* label)
+{
+    side.doc = &doc;
+    GltfGlbReader reader;
+    if (!reader.readPrimitives(doc, side.prims)) {
+        diffs.add(QString("%1: %2").arg(label).arg(reader.getLastError()));
+        return false;
+    }
+
+    const GltfJsonValue& skins = doc.json["skins"];
+    side.skinJointIds.resize(skins.size());
+    for (int s = 0; s < skins.size(); ++s) {
+        const GltfJsonValue& joints = skins.at(s)["joints"];
+        for (int j = 0; j < joints.size(); ++j) {
+            QString name = nodeName(doc, joints.at(j).toInt(-1));
+            NameIds::iterator it = nameIds.find(name);
+            if (it == nameIds.end())
+                it = nameIds.insert(name, nameIds.size());
+            side.skinJointIds[s].append(it.value());
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Materials
+// ---------------------------------------------------------------------------
+
+/// What a textureInfo refers to: the image's file name, its name, or a hash
+/// of its bytes when embedded; plus the UV set if not the first.
+static QString imageKey(const GltfDocument& doc, const GltfJsonValue& textureInfo)
+{
+    if (textureInfo.isNull())
+        return QString();
+
+    const GltfJsonValue& texture = doc.json["textures"].at(textureInfo["index"].toInt(-1));
+    const GltfJsonValue& image   = doc.json["images"].at(texture["source"].toInt(-1));
+    QString key;
+    if (!image["uri"].toString().isEmpty() && !image["uri"].toString().startsWith("data:")) {
+        key = QFileInfo(image["uri"].toString()).fileName();
+    } else if (image.contains("bufferView") || image["uri"].toString().startsWith("data:")) {
+        QByteArray bytes;
+        if (image.contains("bufferView")) {
+            const GltfJsonValue& view = doc.json["bufferViews"].at(image["bufferView"].toInt(-1));
+            int buffer = view["buffer"].toInt(-1);
+            if (buffer >= 0 && buffer < doc.buffers.size())
+                bytes = doc.buffers[buffer].mid(view["byteOffset"].toInt(), view["byteLength"].toInt());
+        } else {
+            bytes = image["uri"].toString().toLatin1();
+        }
+        key = QString("embedded:%1").arg(GltfHasher::hash(bytes.constData(), bytes.size()), 16, 16, QChar('0'));
+    } else {
+        key = "name:" + image["name"].toString();
+    }
+    if (textureInfo["texCoord"].toInt(0) != 0)
+        key += QString(" (TEXCOORD_%1)").arg(textureInfo["texCoord"].toInt());
+    return key;
+}
+
+static void compareNumber(const QString& where, const char* field, double expected, double actual,
+                          float tol, DiffList& diffs)
+{
+    if (!near((float)expected, (float)actual, tol))
+        diffs.add(QString("%1: %2 is %3, expected %4").arg(where).arg(field)
+                      .arg(actual, 0, 'g', 6).arg(expected, 0, 'g', 6));
+}
+
+static void compareText(const QString& where, const char* field, const QString& expected,
+                        const QString& actual, DiffList& diffs)
+{
+    if (expected != actual)
+        diffs.add(QString("%1: %2 is '%3', expected '%4'").arg(where).arg(field).arg(actual).arg(expected));
+}
+
+static void compareMaterials(const GltfDocument& e, int em, const GltfDocument& a, int am,
+                             const QString& where, const GltfEquivalenceOptions& opt, DiffList& diffs)
+{
+    const GltfJsonValue& me = e.json["materials"].at(em);
+    const GltfJsonValue& ma = a.json["materials"].at(am);
+    const GltfJsonValue& pe = me["pbrMetallicRoughness"];
+    const GltfJsonValue& pa = ma["pbrMetallicRoughness"];
+    const float tol = opt.factorTolerance;
+
+    for (int i = 0; i < 4; ++i)
+        compareNumber(where, "baseColorFactor", pe["baseColorFactor"].at(i).toDouble(1.0),
+                      pa["baseColorFactor"].at(i).toDouble(1.0), tol, diffs);
+    compareNumber(where, "metallicFactor",  pe["metallicFactor"].toDouble(1.0),
+                  pa["metallicFactor"].toDouble(1.0), tol, diffs);
+    compareNumber(where, "roughnessFactor", pe["roughnessFactor"].toDouble(1.0),
+                  pa["roughnessFactor"].toDouble(1.0), tol, diffs);
+    for (int i = 0; i < 3; ++i)
+        compareNumber(where, "emissiveFactor", me["emissiveFactor"].at(i).toDouble(0.0),
+                      ma["emissiveFactor"].at(i).toDouble(0.0), tol, diffs);
+    compareNumber(where, "normalTexture scale", me["normalTexture"]["scale"].toDouble(1.0),
+                  ma["normalTexture"]["scale"].toDouble(1.0), tol, diffs);
+    compareNumber(where, "alphaCutoff", me["alphaCutoff"].toDouble(0.5),
+                  ma["alphaCutoff"].toDouble(0.5), tol, diffs);
+
+    QString modeE = me["alphaMode"].toString(), modeA = ma["alphaMode"].toString();
+    compareText(where, "alphaMode", modeE.isEmpty() ? "OPAQUE" : modeE,
+                modeA.isEmpty() ? "OPAQUE" : modeA, diffs);
+    if (me["doubleSided"].toBool() != ma["doubleSided"].toBool())
+        diffs.add(QString("%1: doubleSided differs").arg(where));
+
+    compareText(where, "baseColorTexture", imageKey(e, pe["baseColorTexture"]),
+                imageKey(a, pa["baseColorTexture"]), diffs);
+    compareText(where, "metallicRoughnessTexture", imageKey(e, pe["metallicRoughnessTexture"]),
+                imageKey(a, pa["metallicRoughnessTexture"]), diffs);
+    compareText(where, "normalTexture", imageKey(e, me["normalTexture"]),
+                imageKey(a, ma["normalTexture"]), diffs);
+    compareText(where, "occlusionTexture", imageKey(e, me["occlusionTexture"]),
+                imageKey(a, ma["occlusionTexture"]), diffs);
+    compareText(where, "emissiveTexture", imageKey(e, me["emissiveTexture"]),
+                imageKey(a, ma["emissiveTexture"]), diffs);
+}
+
+// ---------------------------------------------------------------------------
+// Triangles
+// ---------------------------------------------------------------------------
+
+namespace
+{
+    /// Triangle @p tri of primitive @p prim of one side.
+    struct TriRef
+    {
+        int prim;
+        int tri;
+    };
+
+    /// One triangle group (one mesh, one material) of both sides, plus the
+    /// attributes both sides carry.
+    struct TriangleGroup
+    {
+        const Side*     e;
+        const Side*     a;
+        QVector<TriRef> eTris;
+        QVector<TriRef> aTris;
+        bool            normals;
+        bool            texcoords;
+        bool            skin;
+        const GltfEquivalenceOptions* opt;
+
+        const float* position(const Side& s, const TriRef& t, int corner) const
+        {
+            return s.prims[t.prim].positions.constData() + (t.tri * 3 + corner) * 3;
+        }
+
+        /// Influences of a corner as (joint name id, weight), merged by id.
+        int influences(const Side& s, const TriRef& t, int corner, int* ids, float* weights) const
+        {
+            const GltfReadPrimitive& p = s.prims[t.prim];
+            const QVector<int>* jointIds = (p.skin >= 0 && p.skin < s.skinJointIds.size())
+                                         ? &s.skinJointIds[p.skin] : 0;
+            int n = 0;
+            for (int k = 0; k < 4; ++k) {
+                int   c = (t.tri * 3 + corner) * 4 + k;
+                float w = p.weights[c];
+                int   j = p.joints[c];
+                if (w == 0.0f)
+                    continue;
+                int id = (jointIds && j >= 0 && j < jointIds->size()) ? jointIds->at(j) : -1 - j;
+                int i = 0;
+                while (i < n && ids[i] != id)
+                    ++i;
+                if (i == n) { ids[n] = id; weights[n] = 0.0f; ++n; }
+                weights[i] += w;
+            }
+            return n;
+        }
+
+        bool skinsMatch(const TriRef& et, int ec, const TriRef& at, int ac) const
+        {
+            int   eIds[4], aIds[4];
+            float eW[4],   aW[4];
+            int   en = influences(*e, et, ec, eIds, eW);
+            int   an = influences(*a, at, ac, aIds, aW);
+            bool  aMatched[4] = { false, false, false, false };
+            for (int i = 0; i < en; ++i) {
+                float other = 0.0f;
+                for (int j = 0; j < an; ++j)
+                    if (aIds[j] == eIds[i]) { other = aW[j]; aMatched[j] = true; }
+                if (!near(eW[i], other, opt->weightTolerance))
+                    return false;
+            }
+            for (int j = 0; j < an; ++j)
+                if (!aMatched[j] && aW[j] > opt->weightTolerance)
+                    return false;
+            return true;
+        }
+
+        bool cornersMatch(const TriRef& et, int ec, const TriRef& at, int ac) const
+        {
+            const GltfReadPrimitive& ep = e->prims[et.prim];
+            const GltfReadPrimitive& ap = a->prims[at.prim];
+            int ei = et.tri * 3 + ec, ai = at.tri * 3 + ac;
+            for (int k = 0; k < 3; ++k)
+                if (!near(ep.positions[ei * 3 + k], ap.positions[ai * 3 + k], opt->positionTolerance))
+                    return false;
+            for (int k = 0; normals && k < 3; ++k)
+                if (!near(ep.normals[ei * 3 + k], ap.normals[ai * 3 + k], opt->normalTolerance))
+                    return false;
+            for (int k = 0; texcoords && k < 2; ++k)
+                if (!near(ep.texcoords[ei * 2 + k], ap.texcoords[ai * 2 + k], opt->texcoordTolerance))
+                    return false;
+            return !skin || skinsMatch(et, ec, at, ac);
+        }
+
+        /// Same corners in the same cyclic order, from any starting corner.
+        bool trianglesMatch(const TriRef& et, const TriRef& at) const
+        {
+            for (int r = 0; r < 3; ++r)
+                if (cornersMatch(et, 0, at, r) && cornersMatch(et, 1, at, (r + 1) % 3)
+                    && cornersMatch(et, 2, at, (r + 2) % 3))
+                    return true;
+            return false;
+        }
+    };
+
+}
+
+static void centroidCell(const float* p0, const float* p1, const float* p2, float cell, qint64* out)
+{
+    for (int k = 0; k < 3; ++k)
+        out[k] = (qint64)std::floor((p0[k] + p1[k] + p2[k]) / 3.0f / cell);
+}
+
+static quint64 cellKey(qint64 x, qint64 y, qint64 z)
+{
+    return (quint64)x * 73856093ULL ^ (quint64)y * 19349663ULL ^ (quint64)z * 83492791ULL;
+}
+
+/// Pair every expected triangle with an unused actual one, looked up by
+/// centroid in a grid whose cells are wider than the position tolerance,
+/// so a match is always in the same or a neighbouring cell.
+static void matchTriangles(const TriangleGroup& g, const QString& where, DiffList& diffs)
+{
+    const float cell = qMax(g.opt->positionTolerance * 4.0f, 1e-5f);
+
+    QHash<quint64, int> head;
+    QVector<int> next(g.aTris.size(), -1);
+    for (int i = 0; i < g.aTris.size(); ++i) {
+        qint64 c[3];
+        const TriRef& t = g.aTris[i];
+        centroidCell(g.position(*g.a, t, 0), g.position(*g.a, t, 1), g.position(*g.a, t, 2), cell, c);
+        quint64 key = cellKey(c[0], c[1], c[2]);
+        next[i] = head.value(key, -1);
+        head[key] = i;
+    }
+
+    QVector<bool> used(g.aTris.size(), false);
+    int missing = 0;
+    for (int i = 0; i < g.eTris.size(); ++i)
+    {
+        const TriRef& t = g.eTris[i];
+        const float* p0 = g.position(*g.e, t, 0);
+        const float* p1 = g.position(*g.e, t, 1);
+        const float* p2 = g.position(*g.e, t, 2);
+        qint64 c[3];
+        centroidCell(p0, p1, p2, cell, c);
+
+        bool found = false;
+        for (int n = 0; n < 27 && !found; ++n) {
+            int cand = head.value(cellKey(c[0] + n % 3 - 1, c[1] + n / 3 % 3 - 1, c[2] + n / 9 - 1), -1);
+            for (; cand >= 0 && !found; cand = next[cand])
+                if (!used[cand] && g.trianglesMatch(t, g.aTris[cand]))
+                    used[cand] = found = true;
+        }
+        if (!found && missing++ < 3) {
+            diffs.add(QString("%1: no match for triangle %2 %3 %4").arg(where)
+                          .arg(vecString(p0, 3)).arg(vecString(p1, 3)).arg(vecString(p2, 3)));
+        }
+    }
+    if (missing > 3)
+        diffs.add(QString("%1: %2 triangles without a match in all").arg(where).arg(missing));
+}
+
+static void compareMesh(const Side& e, int em, const Side& a, int am, const QString& where,
+                        const GltfEquivalenceOptions& opt, DiffList& diffs)
+{
+    // Group triangles by material name, whichever primitives they sit in.
+    QMap<QString, QPair<QVector<TriRef>, QVector<TriRef> > > groups;
+    QMap<QString, QPair<int, int> > materials;
+    for (int pass = 0; pass < 2; ++pass) {
+        const Side& s  = pass ? a : e;
+        const int mesh = pass ? am : em;
+        for (int p = 0; p < s.prims.size(); ++p) {
+            if (s.prims[p].mesh != mesh)
+                continue;
+            QString name = materialName(*s.doc, s.prims[p].material);
+            QVector<TriRef>& tris = pass ? groups[name].second : groups[name].first;
+            if (!materials.contains(name))
+                materials[name] = qMakePair(-1, -1);
+            (pass ? materials[name].second : materials[name].first) = s.prims[p].material;
+            for (int t = 0; t < s.prims[p].triangleCount(); ++t) {
+                TriRef ref = { p, t };
+                tris.append(ref);
+            }
+        }
+    }
+
+    for (QMap<QString, QPair<QVector<TriRef>, QVector<TriRef> > >::const_iterator it = groups.constBegin();
+         it != groups.constEnd(); ++it)
+    {
+        QString at = QString("%1, material '%2'").arg(where).arg(it.key());
+        TriangleGroup g;
+        g.e = &e; g.a = &a;
+        g.eTris = it.value().first;
+        g.aTris = it.value().second;
+        g.opt   = &opt;
+        if (g.eTris.isEmpty() || g.aTris.isEmpty()) {
+            diffs.add(QString("%1: %2 triangles, expected %3").arg(at).arg(g.aTris.size()).arg(g.eTris.size()));
+            continue;
+        }
+        compareMaterials(*e.doc, materials[it.key()].first, *a.doc, materials[it.key()].second, at, opt, diffs);
+        if (g.eTris.size() != g.aTris.size())
+            diffs.add(QString("%1: %2 triangles, expected %3").arg(at).arg(g.aTris.size()).arg(g.eTris.size()));
+
+        // An attribute counts only if every primitive of the group has it.
+        bool has[2][3] = { { true, true, true }, { true, true, true } };
+        for (int pass = 0; pass < 2; ++pass) {
+            const Side& s = pass ? a : e;
+            const QVector<TriRef>& tris = pass ? g.aTris : g.eTris;
+            for (int i = 0; i < tris.size(); ++i) {
+                const GltfReadPrimitive& p = s.prims[tris[i].prim];
+                has[pass][0] = has[pass][0] && !p.normals.isEmpty();
+                has[pass][1] = has[pass][1] && !p.texcoords.isEmpty();
+                has[pass][2] = has[pass][2] && !p.joints.isEmpty() && !p.weights.isEmpty();
+            }
+        }
+        static const char* const attrNames[3] = { "NORMAL", "TEXCOORD_0", "JOINTS_0/WEIGHTS_0" };
+        for (int k = 0; k < 3; ++k)
+            if (has[0][k] != has[1][k])
+                diffs.add(QString("%1: %2 %3").arg(at).arg(attrNames[k])
+                              .arg(has[0][k] ? "missing" : "not expected"));
+        g.normals   = has[0][0] && has[1][0];
+        g.texcoords = has[0][1] && has[1][1];
+        g.skin      = has[0][2] && has[1][2];
+
+        matchTriangles(g, at, diffs);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Nodes
+// ---------------------------------------------------------------------------
+
+static QVector<int> parentsOf(const GltfDocument& doc)
+{
+    const GltfJsonValue& nodes = doc.json["nodes"];
+    QVector<int> parents(nodes.size(), -1);
+    for (int n = 0; n < nodes.size(); ++n) {
+        const GltfJsonValue& children = nodes.at(n)["children"];
+        for (int c = 0; c < children.size(); ++c) {
+            int child = children.at(c).toInt(-1);
+            if (child >= 0 && child < parents.size())
+                parents[child] = n;
+        }
+    }
+    return parents;
+}
+
+static void compareNodes(const GltfDocument& e, const GltfDocument& a,
+                         const GltfEquivalenceOptions& opt, DiffList& diffs)
+{
+    QMap<QString, QList<int> > eNodes = indicesByName(e, e.json["nodes"].size(), nodeName);
+    QMap<QString, QList<int> > aNodes = indicesByName(a, a.json["nodes"].size(), nodeName);
+    QVector<int> eParents = parentsOf(e), aParents = parentsOf(a);
+
+    for (QMap<QString, QList<int> >::const_iterator it = eNodes.constBegin(); it != eNodes.constEnd(); ++it)
+    {
+        const QList<int>& aList = aNodes.value(it.key());
+        if (aList.size() != it.value().size()) {
+            diffs.add(QString("node '%1': %2 in output, expected %3").arg(it.key())
+                          .arg(aList.size()).arg(it.value().size()));
+            continue;
+        }
+        for (int i = 0; i < aList.size(); ++i)
+        {
+            const int en = it.value()[i], an = aList[i];
+            const GltfJsonValue& ne = e.json["nodes"].at(en);
+            const GltfJsonValue& na = a.json["nodes"].at(an);
+            QString where = QString("node '%1'").arg(it.key());
+
+            compareText(where, "parent", nodeName(e, eParents[en]), nodeName(a, aParents[an]), diffs);
+            compareText(where, "mesh", meshName(e, ne["mesh"].toInt(-1)), meshName(a, na["mesh"].toInt(-1)), diffs);
+            for (int k = 0; k < 3; ++k) {
+                compareNumber(where, "translation", ne["translation"].at(k).toDouble(0.0),
+                              na["translation"].at(k).toDouble(0.0), opt.factorTolerance, diffs);
+                compareNumber(where, "scale", ne["scale"].at(k).toDouble(1.0),
+                              na["scale"].at(k).toDouble(1.0), opt.factorTolerance, diffs);
+            }
+            // q and -q are the same rotation.
+            double dot = 0.0;
+            for (int k = 0; k < 4; ++k)
+                dot += ne["rotation"].at(k).toDouble(k == 3 ? 1.0 : 0.0) * na["rotation"].at(k).toDouble(k == 3 ? 1.0 : 0.0);
+            if (std::fabs(std::fabs(dot) - 1.0) > opt.factorTolerance)
+                diffs.add(QString("%1: rotation differs").arg(where));
+
+            // Skins: the same joints by name, each with the same inverse bind matrix.
+            const int es = ne["skin"].toInt(-1), as = na["skin"].toInt(-1);
+            if ((es < 0) != (as < 0)) {
+                diffs.add(QString("%1: %2").arg(where).arg(es < 0 ? "skinned, expected unskinned" : "not skinned"));
+                continue;
+            }
+            if (es < 0)
+                continue;
+
+            GltfGlbReader reader;
+            QVector<float> eIbm, aIbm;
+            int comps = 0;
+            const GltfJsonValue& se = e.json["skins"].at(es);
+            const GltfJsonValue& sa = a.json["skins"].at(as);
+            if (se.contains("inverseBindMatrices"))
+                reader.readAccessor(e, se["inverseBindMatrices"].toInt(-1), eIbm, comps);
+            if (sa.contains("inverseBindMatrices"))
+                reader.readAccessor(a, sa["inverseBindMatrices"].toInt(-1), aIbm, comps);
+
+            QHash<QString, int> aJoint;
+            for (int j = 0; j < sa["joints"].size(); ++j)
+                aJoint.insert(nodeName(a, sa["joints"].at(j).toInt(-1)), j);
+            if (sa["joints"].size() != se["joints"].size())
+                diffs.add(QString("%1: skin has %2 joints, expected %3").arg(where)
+                              .arg(sa["joints"].size()).arg(se["joints"].size()));
+            for (int j = 0; j < se["joints"].size(); ++j) {
+                QString joint = nodeName(e, se["joints"].at(j).toInt(-1));
+                int k = aJoint.value(joint, -1);
+                if (k < 0) {
+                    diffs.add(QString("%1: skin joint '%2' missing").arg(where).arg(joint));
+                    continue;
+                }
+                for (int m = 0; m < 16; ++m) {
+                    float ev = (j * 16 + m < eIbm.size()) ? eIbm[j * 16 + m] : (m % 5 == 0 ? 1.0f : 0.0f);
+                    float av = (k * 16 + m < aIbm.size()) ? aIbm[k * 16 + m] : (m % 5 == 0 ? 1.0f : 0.0f);
+                    if (!near(ev, av, opt.factorTolerance)) {
+                        diffs.add(QString("%1: inverse bind matrix of joint '%2' differs").arg(where).arg(joint));
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    for (QMap<QString, QList<int> >::const_iterator it = aNodes.constBegin(); it != aNodes.constEnd(); ++it)
+        if (!eNodes.contains(it.key()))
+            diffs.add(QString("node '%1': not expected").arg(it.key()));
+}
+
+// ---------------------------------------------------------------------------
+// Entry points
+// ---------------------------------------------------------------------------
+
+bool GltfEquivalence::compare(const GltfDocument& expected, const GltfDocument& actual,
+                              const GltfEquivalenceOptions& options, QStringList& outDifferences)
+{
+    outDifferences.clear();
+    DiffList diffs = { &outDifferences, qMax(1, options.maxDifferences), 0 };
+
+    Side e, a;
+    NameIds nameIds;
+    bool readable = prepareSide(expected, e, nameIds, diffs, "expected");
+    readable = prepareSide(actual, a, nameIds, diffs, "actual") && readable;
+    if (!readable)
+        return false;
+
+    QMap<QString, QList<int> > eMeshes = indicesByName(expected, expected.json["meshes"].size(), meshName);
+    QMap<QString, QList<int> > aMeshes = indicesByName(actual, actual.json["meshes"].size(), meshName);
+    for (QMap<QString, QList<int> >::const_iterator it = eMeshes.constBegin(); it != eMeshes.constEnd(); ++it)
+    {
+        const QList<int>& aList = aMeshes.value(it.key());
+        if (aList.size() != it.value().size())
+            diffs.add(QString("mesh '%1': %2 in output, expected %3").arg(it.key())
+                          .arg(aList.size()).arg(it.value().size()));
+        for (int i = 0; i < qMin(aList.size(), it.value().size()); ++i)
+            compareMesh(e, it.value()[i], a, aList[i], QString("mesh '%1'").arg(it.key()), options, diffs);
+    }
+    for (QMap<QString, QList<int> >::const_iterator it = aMeshes.constBegin(); it != aMeshes.constEnd(); ++it)
+        if (!eMeshes.contains(it.key()))
+            diffs.add(QString("mesh '%1': not expected").arg(it.key()));
+
+    compareNodes(expected, actual, options, diffs);
+
+    if (diffs.total > diffs.max)
+        outDifferences.append(QString("... %1 more differences").arg(diffs.total - diffs.max));
+    return diffs.total == 0;
+}
+
+bool GltfEquivalence::compareFiles(const QString& expectedPath, const QString& actualPath,
+                                   const GltfEquivalenceOptions& options, QStringList& outDifferences)
+{
+    GltfGlbReader reader;
+    GltfDocument  expected, actual;
+    if (!reader.read(expectedPath, expected) || !reader.read(actualPath, actual)) {
+        outDifferences = QStringList(reader.getLastError());
+        return false;
+    }
+    return compare(expected, actual, options, outDifferences);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+struct GltfDocument;
+
+/// How far two exports may drift apart and still count as the same.
+struct GltfEquivalenceOptions
+{
+    float positionTolerance;    // per component, output units
+    float normalTolerance;      // per component of the unit normal
+    float texcoordTolerance;    // per UV component
+    float weightTolerance;      // per skin weight; lighter influences may come or go
+    float factorTolerance;      // material factors, node transforms, bind matrices
+    int   maxDifferences;       // differences listed before the rest are only counted
+
+    GltfEquivalenceOptions()
+        : positionTolerance(1e-4f), normalTolerance(5e-3f), texcoordTolerance(1e-4f)
+        , weightTolerance(5e-3f), factorTolerance(1e-4f), maxDifferences(20) {}
+};
+
+/// Decides whether two glTF exports mean the same thing, whatever their
+/// bytes: the guard for export fast paths (vertex sharing, reordering,
+/// quantisation, parallel writes) against the reference writer.
+///
+/// Compared, matched by name rather than by index:
+///   - meshes: the set of triangles drawn with each material, every
+///     corner's position, normal, UV and skin influences (by joint name)
+///     within tolerance, regardless of primitive split, vertex order,
+///     indexing, component types or which corner a triangle starts at;
+///     winding must agree;
+///   - materials: factors, alpha settings and texture images (by file
+///     name, or content for embedded images);
+///   - nodes: parent, mesh, transform, and skin joints with their inverse
+///     bind matrices.
+/// Not compared: animation, instancing and LOD extensions, extras.
+class GltfEquivalence
+{
+public:
+    /// True if @p actual matches @p expected; otherwise @p outDifferences
+    /// says where, most useful first.
+    static bool compare(const GltfDocument& expected, const GltfDocument& actual,
+                        const GltfEquivalenceOptions& options, QStringList& outDifferences);
+
+    /// compare() on two files (.glb or .gltf).  A file that cannot be read
+    /// is reported as a difference.
+    static bool compareFiles(const QString& expectedPath, const QString& actualPath,
+                             const GltfEquivalenceOptions& options, QStringList& outDifferences);
+};
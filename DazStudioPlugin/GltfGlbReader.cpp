@@ -0,0 +1,391 @@
+// GltfGlbReader.cpp
+// Reads GLB / .gltf files back into plain arrays.  Everything is bounds
+// checked: the input may come from an older writer, a fast path under test
+// or another tool altogether.
+
+#include "GltfGlbReader.h"
+
+#include <QtCore/qfile.h>
+#include <QtCore/qfileinfo.h>
+#include <QtCore/qdir.h>
+
+#include <climits>
+#include <cstring>
+
+// Values an accessor without a bufferView may ask for: it has no data to
+// bound its count, and a corrupt count must not become an allocation.
+static const qint64 kMaxUnbackedValues = 64 * 1024 * 1024;
+
+static quint32 readUint32LE(const char* p)
+{
+    const uchar* u = (const uchar*)p;
+    return (quint32)u[0] | ((quint32)u[1] << 8) | ((quint32)u[2] << 16) | ((quint32)u[3] << 24);
+}
+
+static int componentCount(const QString& type)
+{
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2")   return 2;
+    if (type == "VEC3")   return 3;
+    if (type == "VEC4")   return 4;
+    if (type == "MAT2")   return 4;
+    if (type == "MAT3")   return 9;
+    if (type == "MAT4")   return 16;
+    return 0;
+}
+
+static int componentBytes(int componentType)
+{
+    switch (componentType) {
+        case 5120: case 5121: return 1;     // BYTE, UNSIGNED_BYTE
+        case 5122: case 5123: return 2;     // SHORT, UNSIGNED_SHORT
+        case 5125: case 5126: return 4;     // UNSIGNED_INT, FLOAT
+        default:              return 0;
+    }
+}
+
+/// One component at @p p, mapped to float.
+static float decodeComponent(const char* p, int componentType, bool normalized)
+{
+    switch (componentType) {
+        case 5120: { qint8 v = (qint8)*p;
+                     return normalized ? qMax(v / 127.0f, -1.0f) : (float)v; }
+        case 5121: { quint8 v = (quint8)*p;
+                     return normalized ? v / 255.0f : (float)v; }
+        case 5122: { qint16 v = (qint16)((uchar)p[0] | ((uchar)p[1] << 8));
+                     return normalized ? qMax(v / 32767.0f, -1.0f) : (float)v; }
+        case 5123: { quint16 v = (quint16)((uchar)p[0] | ((uchar)p[1] << 8));
+                     return normalized ? v / 65535.0f : (float)v; }
+        case 5125: return (float)readUint32LE(p);
+        case 5126: { quint32 bits = readUint32LE(p); float f;
+                     memcpy(&f, &bits, sizeof(f)); return f; }
+        default:   return 0.0f;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Files
+// ---------------------------------------------------------------------------
+
+bool GltfGlbReader::read(const QString& path, GltfDocument& outDoc)
+{
+    m_sLastError = QString();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_sLastError = QString("readGLB: cannot open '%1'").arg(path);
+        return false;
+    }
+    QByteArray data = file.readAll();
+    file.close();
+
+    QString baseDir = QFileInfo(path).absolutePath();
+    if (data.size() >= 4 && readUint32LE(data.constData()) == 0x46546C67u)
+        return parseGlb(data, baseDir, outDoc);
+
+    return parseJson(data, outDoc) && loadBuffers(outDoc, QByteArray(), baseDir);
+}
+
+bool GltfGlbReader::parse(const QByteArray& glb, GltfDocument& outDoc)
+{
+    m_sLastError = QString();
+    return parseGlb(glb, QString(), outDoc);
+}
+
+bool GltfGlbReader::parseGlb(const QByteArray& glb, const QString& baseDir, GltfDocument& outDoc)
+{
+    const char* d = glb.constData();
+    if (glb.size() < 20 || readUint32LE(d) != 0x46546C67u) {
+        m_sLastError = "readGLB: not a GLB file";
+        return false;
+    }
+    if (readUint32LE(d + 4) != 2u) {
+        m_sLastError = QString("readGLB: unsupported GLB version %1").arg(readUint32LE(d + 4));
+        return false;
+    }
+    quint32 total = readUint32LE(d + 8);
+    if (total > (quint32)glb.size()) {
+        m_sLastError = "readGLB: file is shorter than its header says";
+        return false;
+    }
+
+    QByteArray json, bin;
+    bool haveJson = false;
+    quint32 pos = 12;
+    while (pos + 8 <= total)
+    {
+        quint32 length = readUint32LE(d + pos);
+        quint32 type   = readUint32LE(d + pos + 4);
+        pos += 8;
+        if (length > total - pos) {
+            m_sLastError = "readGLB: chunk runs past the end of the file";
+            return false;
+        }
+        if (type == 0x4E4F534Au && !haveJson) {
+            json = QByteArray(d + pos, (int)length);
+            haveJson = true;
+        } else if (type == 0x004E4942u && bin.isNull()) {
+            bin = QByteArray(d + pos, (int)length);
+        }
+        pos += length;                          // unknown chunks are skipped
+    }
+    if (!haveJson) {
+        m_sLastError = "readGLB: no JSON chunk";
+        return false;
+    }
+    return parseJson(json, outDoc) && loadBuffers(outDoc, bin, baseDir);
+}
+
+bool GltfGlbReader::parseJson(const QByteArray& text, GltfDocument& outDoc)
+{
+    QString error;
+    if (!GltfJsonValue::parse(text, outDoc.json, error)) {
+        m_sLastError = "readGLB: " + error;
+        return false;
+    }
+    if (!outDoc.json.isObject()) {
+        m_sLastError = "readGLB: JSON root is not an object";
+        return false;
+    }
+    return true;
+}
+
+bool GltfGlbReader::loadBuffers(GltfDocument& doc, const QByteArray& bin, const QString& baseDir)
+{
+    const GltfJsonValue& buffers = doc.json["buffers"];
+    doc.buffers.resize(buffers.size());
+    for (int b = 0; b < buffers.size(); ++b)
+    {
+        const GltfJsonValue& buf = buffers.at(b);
+        QString uri = buf["uri"].toString();
+        if (uri.isEmpty()) {
+            if (b != 0 || bin.isNull()) {
+                m_sLastError = QString("readGLB: buffer %1 has no data").arg(b);
+                return false;
+            }
+            doc.buffers[b] = bin;
+        } else if (uri.startsWith("data:")) {
+            int comma = uri.indexOf(',');
+            doc.buffers[b] = QByteArray::fromBase64(uri.mid(comma + 1).toLatin1());
+        } else {
+            if (baseDir.isEmpty()) {
+                m_sLastError = QString("readGLB: external buffer '%1' needs a file path").arg(uri);
+                return false;
+            }
+            QFile file(QDir(baseDir).filePath(uri));
+            if (!file.open(QIODevice::ReadOnly)) {
+                m_sLastError = QString("readGLB: cannot open buffer '%1'").arg(uri);
+                return false;
+            }
+            doc.buffers[b] = file.readAll();
+        }
+
+        if (doc.buffers[b].size() < buf["byteLength"].toInt64()) {
+            m_sLastError = QString("readGLB: buffer %1 is shorter than its byteLength").arg(b);
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Accessors
+// ---------------------------------------------------------------------------
+
+bool GltfGlbReader::readAccessor(const GltfDocument& doc, int index,
+                                 QVector<float>& outValues, int& outComps)
+{
+    const GltfJsonValue& acc = doc.json["accessors"].at(index);
+    if (!acc.isObject()) {
+        m_sLastError = QString("readGLB: no accessor %1").arg(index);
+        return false;
+    }
+    if (acc.contains("sparse")) {
+        m_sLastError = QString("readGLB: accessor %1 is sparse, which is not supported").arg(index);
+        return false;
+    }
+
+    const int    componentType = acc["componentType"].toInt();
+    const bool   normalized    = acc["normalized"].toBool();
+    const int    comps         = componentCount(acc["type"].toString());
+    const int    compBytes     = componentBytes(componentType);
+    const qint64 count         = acc["count"].toInt64();
+    if (comps == 0 || compBytes == 0 || count < 0) {
+        m_sLastError = QString("readGLB: accessor %1 has a bad type").arg(index);
+        return false;
+    }
+
+    outComps = comps;
+    if (!acc.contains("bufferView")) {
+        // all zeros, per the specification; nothing else bounds count
+        if (count > kMaxUnbackedValues / comps) {
+            m_sLastError = QString("readGLB: accessor %1 has no bufferView and a count of %2")
+                .arg(index).arg(count);
+            return false;
+        }
+        outValues.fill(0.0f, int(count * comps));
+        return true;
+    }
+
+    const GltfJsonValue& view = doc.json["bufferViews"].at(acc["bufferView"].toInt(-1));
+    const int buffer = view["buffer"].toInt(-1);
+    if (!view.isObject() || buffer < 0 || buffer >= doc.buffers.size()) {
+        m_sLastError = QString("readGLB: accessor %1 has a bad bufferView").arg(index);
+        return false;
+    }
+
+    const qint64 elemBytes  = (qint64)comps * compBytes;
+    const qint64 stride     = view["byteStride"].toInt64(0) ? view["byteStride"].toInt64() : elemBytes;
+    const qint64 viewStart  = view["byteOffset"].toInt64();
+    const qint64 viewLength = view["byteLength"].toInt64();
+    const qint64 accOffset  = acc["byteOffset"].toInt64();
+    const qint64 bufferSize = doc.buffers[buffer].size();
+    // each offset on its own first, so no sum below can overflow
+    if (stride < elemBytes || viewStart < 0 || viewStart > bufferSize ||
+        viewLength < 0 || viewLength > bufferSize - viewStart ||
+        accOffset < 0 || accOffset > viewLength) {
+        m_sLastError = QString("readGLB: accessor %1 has a bad bufferView").arg(index);
+        return false;
+    }
+    const qint64 viewEnd = viewStart + viewLength;
+    const qint64 start   = viewStart + accOffset;
+    // count checked against the view before anything is allocated, in a
+    // form that cannot overflow
+    if (count > 0 && (start + elemBytes > viewEnd || count - 1 > (viewEnd - start - elemBytes) / stride ||
+                      count > INT_MAX / comps)) {
+        m_sLastError = QString("readGLB: accessor %1 runs past its bufferView").arg(index);
+        return false;
+    }
+    outValues.fill(0.0f, int(count * comps));
+
+    const char* src = doc.buffers[buffer].constData() + start;
+    float*      dst = outValues.data();
+    for (qint64 i = 0; i < count; ++i, src += stride)
+        for (int c = 0; c < comps; ++c)
+            *dst++ = decodeComponent(src + c * compBytes, componentType, normalized);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Primitives
+// ---------------------------------------------------------------------------
+
+bool GltfGlbReader::readIndices(const GltfDocument& doc, const GltfJsonValue& prim,
+                                int vertexCount, QVector<int>& outCorners)
+{
+    QVector<int> seq;
+    if (prim.contains("indices")) {
+        QVector<float> values;
+        int comps = 0;
+        if (!readAccessor(doc, prim["indices"].toInt(-1), values, comps))
+            return false;
+        seq.resize(values.size());
+        for (int i = 0; i < values.size(); ++i) {
+            seq[i] = (int)values[i];
+            if (seq[i] < 0 || seq[i] >= vertexCount) {
+                m_sLastError = "readGLB: index out of range";
+                return false;
+            }
+        }
+    } else {
+        seq.resize(vertexCount);
+        for (int i = 0; i < vertexCount; ++i)
+            seq[i] = i;
+    }
+
+    outCorners.clear();
+    const int mode = prim["mode"].toInt(4);
+    if (mode == 4) {                            // TRIANGLES
+        outCorners = seq;
+        outCorners.resize(seq.size() / 3 * 3);
+    } else if (mode == 5) {                     // TRIANGLE_STRIP
+        for (int i = 0; i + 2 < seq.size(); ++i) {
+            bool odd = (i & 1) != 0;
+            outCorners << seq[i] << seq[odd ? i + 2 : i + 1] << seq[odd ? i + 1 : i + 2];
+        }
+    } else if (mode == 6) {                     // TRIANGLE_FAN
+        for (int i = 1; i + 1 < seq.size(); ++i)
+            outCorners << seq[0] << seq[i] << seq[i + 1];
+    }
+    // points and lines carry no triangles
+    return true;
+}
+
+bool GltfGlbReader::readPrimitives(const GltfDocument& doc, QVector<GltfReadPrimitive>& outPrims)
+{
+    outPrims.clear();
+
+    // The skin a mesh is drawn with comes from the node that carries it.
+    const GltfJsonValue& nodes  = doc.json["nodes"];
+    const GltfJsonValue& meshes = doc.json["meshes"];
+    QVector<int> meshSkin(meshes.size(), -1);
+    QVector<bool> meshSeen(meshes.size(), false);
+    for (int n = 0; n < nodes.size(); ++n) {
+        int m = nodes.at(n)["mesh"].toInt(-1);
+        if (m >= 0 && m < meshes.size() && !meshSeen[m]) {
+            meshSeen[m] = true;
+            meshSkin[m] = nodes.at(n)["skin"].toInt(-1);
+        }
+    }
+
+    for (int m = 0; m < meshes.size(); ++m)
+    {
+        const GltfJsonValue& prims = meshes.at(m)["primitives"];
+        for (int p = 0; p < prims.size(); ++p)
+        {
+            const GltfJsonValue& prim  = prims.at(p);
+            const GltfJsonValue& attrs = prim["attributes"];
+            if (!attrs.contains("POSITION"))
+                continue;
+
+            static const char* const names[] = { "POSITION", "NORMAL", "TEXCOORD_0", "JOINTS_0", "WEIGHTS_0" };
+            static const int         wanted[] = { 3, 3, 2, 4, 4 };
+            QVector<float> values[5];
+            int vertexCount = -1;
+            for (int a = 0; a < 5; ++a) {
+                if (!attrs.contains(names[a]))
+                    continue;
+                int comps = 0;
+                if (!readAccessor(doc, attrs[names[a]].toInt(-1), values[a], comps))
+                    return false;
+                int count = comps ? values[a].size() / comps : 0;
+                if (comps != wanted[a] || (vertexCount >= 0 && count != vertexCount)) {
+                    m_sLastError = QString("readGLB: mesh %1 primitive %2 has a bad %3 accessor")
+                                       .arg(m).arg(p).arg(names[a]);
+                    return false;
+                }
+                vertexCount = count;
+            }
+
+            QVector<int> corners;
+            if (!readIndices(doc, prim, vertexCount, corners))
+                return false;
+
+            GltfReadPrimitive out;
+            out.mesh     = m;
+            out.material = prim["material"].toInt(-1);
+            out.skin     = meshSkin[m];
+            const int nc = corners.size();
+            out.positions.resize(nc * 3);
+            if (!values[1].isEmpty()) out.normals.resize(nc * 3);
+            if (!values[2].isEmpty()) out.texcoords.resize(nc * 2);
+            if (!values[3].isEmpty()) out.joints.resize(nc * 4);
+            if (!values[4].isEmpty()) out.weights.resize(nc * 4);
+            for (int c = 0; c < nc; ++c)
+            {
+                const int v = corners[c];
+                for (int k = 0; k < 3; ++k)
+                    out.positions[c * 3 + k] = values[0][v * 3 + k];
+                for (int k = 0; k < 3 && !out.normals.isEmpty(); ++k)
+                    out.normals[c * 3 + k] = values[1][v * 3 + k];
+                for (int k = 0; k < 2 && !out.texcoords.isEmpty(); ++k)
+                    out.texcoords[c * 2 + k] = values[2][v * 2 + k];
+                for (int k = 0; k < 4 && !out.joints.isEmpty(); ++k)
+                    out.joints[c * 4 + k] = (int)values[3][v * 4 + k];
+                for (int k = 0; k < 4 && !out.weights.isEmpty(); ++k)
+                    out.weights[c * 4 + k] = values[4][v * 4 + k];
+            }
+            outPrims.append(out);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+
+#include "GltfJson.h"
+
+/// A glTF asset read back into memory: its JSON and every buffer it uses.
+struct GltfDocument
+{
+    GltfJsonValue        json;
+    QVector<QByteArray>  buffers;
+};
+
+/// One primitive with its indices resolved: every attribute is given per
+/// triangle corner, as floats, whatever its stored component type.
+struct GltfReadPrimitive
+{
+    int            mesh;
+    int            material;    // -1 if none
+    int            skin;        // skin of the first node drawing the mesh, -1 if none
+    QVector<float> positions;   // xyz
+    QVector<float> normals;     // xyz, empty if absent
+    QVector<float> texcoords;   // uv, empty if absent
+    QVector<int>   joints;      // 4 per corner, indices into the skin's joints
+    QVector<float> weights;     // 4 per corner
+
+    GltfReadPrimitive() : mesh(-1), material(-1), skin(-1) {}
+
+    int triangleCount() const { return positions.size() / 9; }
+};
+
+/// Reads GLB and .gltf files back, for tests and tools that check what the
+/// writer produced.  Not used by the export itself.
+///
+/// Understands every accessor layout glTF 2.0 allows apart from sparse
+/// storage: interleaved or tightly packed, float or normalised and plain
+/// integer components, indexed or not, and triangle lists, strips and fans.
+class GltfGlbReader
+{
+public:
+    /// Read a .glb, or a .gltf with its .bin files beside it.
+    bool read(const QString& path, GltfDocument& outDoc);
+
+    /// Read GLB bytes held in memory.  External buffers are not resolved.
+    bool parse(const QByteArray& glb, GltfDocument& outDoc);
+
+    /// Accessor @p index as floats, @p outComps per element.  Normalised
+    /// integers are mapped to [0,1] or [-1,1] as the specification says.
+    bool readAccessor(const GltfDocument& doc, int index,
+                      QVector<float>& outValues, int& outComps);
+
+    /// Every triangle primitive of every mesh, in mesh order.
+    bool readPrimitives(const GltfDocument& doc, QVector<GltfReadPrimitive>& outPrims);
+
+    QString getLastError() const { return m_sLastError; }
+
+private:
+    QString m_sLastError;
+
+    bool parseGlb(const QByteArray& glb, const QString& baseDir, GltfDocument& outDoc);
+    bool parseJson(const QByteArray& text, GltfDocument& outDoc);
+    bool loadBuffers(GltfDocument& doc, const QByteArray& bin, const QString& baseDir);
+    bool readIndices(const GltfDocument& doc, const GltfJsonValue& prim,
+                     int vertexCount, QVector<int>& outCorners);
+};
@@ -0,0 +1,1532 @@
+// GltfGlbWriter.cpp
+// GLB (binary glTF 2.0) and split .gltf/.bin serialisation for DazToUnity.
+// No external glTF library required, and no Daz Studio SDK.
+//
+// GLB layout:
+//   [12-byte header][JSON chunk][BIN chunk]
+//
+// Each chunk:
+//   uint32 chunkLength | uint32 chunkType | byte[chunkLength] data
+//
+// JSON chunkType = 0x4E4F534A ('JSON')
+// BIN  chunkType = 0x004E4942 ('BIN\0')
+
+#include "GltfGlbWriter.h"
+#include "GltfAnimationStream.h"
+#include "GltfHash.h"
+#include "GltfBufferPool.h"
+#include "GltfTrace.h"
+#include "GltfMemory.h"
+
+#include <QtCore/qfile.h>
+#include <QtCore/qfileinfo.h>
+#include <QtCore/qdatastream.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qstringlist.h>
+#include <QtCore/qtconcurrentmap.h>
+#include <QtCore/qendian.h>
+
+#include <cfloat>
+#include <cstring>
+
+// Split output: cap per .bin file.  Keeps each buffer well inside what a
+// QByteArray (and most loaders) can hold.
+static const qint64 kDefaultMaxBufferBytes = 512LL * 1024 * 1024;
+
+static double elapsedMs(const QElapsedTimer& timer)
+{
+    return timer.nsecsElapsed() / 1.0e6;
+}
+
+// ---------------------------------------------------------------------------
+// Construction
+// ---------------------------------------------------------------------------
+
+GltfGlbWriter::GltfGlbWriter()
+    : m_bSplitBuffers(false)
+    , m_nMaxBufferBytes(kDefaultMaxBufferBytes)
+    , m_bIncrementalUpdate(false)
+    , m_bLastWriteIncremental(false)
+    , m_nLastBytesWritten(0)
+    , m_pOwnBufferPool(new GltfBufferPool)
+    , m_pBufferPool(m_pOwnBufferPool)
+    , m_pProgress(&m_ownProgress)
+    , m_pCancel(&m_ownCancel)
+{
+}
+
+GltfGlbWriter::~GltfGlbWriter()
+{
+    delete m_pOwnBufferPool;
+}
+
+void GltfGlbWriter::setBufferPool(GltfBufferPool* pool)
+{
+    m_pBufferPool = pool ? pool : m_pOwnBufferPool;
+}
+
+void GltfGlbWriter::setProgressCounter(QAtomicInt* progress)
+{
+    m_pProgress = progress ? progress : &m_ownProgress;
+}
+
+void GltfGlbWriter::setCancelFlag(const QAtomicInt* cancel)
+{
+    m_pCancel = cancel ? cancel : &m_ownCancel;
+}
+
+void GltfGlbWriter::beginWrite()
+{
+    m_sLastError            = QString();
+    m_bLastWriteIncremental = false;
+    m_nLastBytesWritten     = 0;
+    m_lastBufferFiles.clear();
+    m_lastTimings           = GltfWriteTimings();
+    m_lastStats             = GltfSceneStats();
+}
+
+bool GltfGlbWriter::writeCancelled()
+{
+    if (!*m_pCancel)
+        return false;
+    m_sLastError = "exportGLB: cancelled";
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Layout
+// ---------------------------------------------------------------------------
+
+namespace
+{
+    struct BufferViewMeta
+    {
+        int     buffer;
+        quint64 byteOffset;      // 64-bit: split buffers are not bound by GLB's 4 GB
+        quint64 byteLength;
+        int     target;          // 34962 ARRAY_BUFFER, 0 = none
+    };
+
+    struct AccessorMeta
+    {
+        int     bufferView;
+        int     componentType;   // 5126 FLOAT, 5122 SHORT, 5123 UNSIGNED_SHORT
+        bool    normalized;
+        int     count;
+        QString type;            // "SCALAR", "VEC2", "VEC3", "VEC4"
+        bool    hasMinMax;
+        int     numComps;
+        float   minV[4];
+        float   maxV[4];
+    };
+
+    const char* bufferCategoryName(int category)
+    {
+        switch (category) {
+        case GltfGlbWriter::MorphBuffer:     return "morphs";
+        case GltfGlbWriter::AnimationBuffer: return "animation";
+        default:                              return "geometry";
+        }
+    }
+
+    const char* accessorTypeName(int numComps)
+    {
+        switch (numComps) {
+        case 1:  return "SCALAR";
+        case 2:  return "VEC2";
+        case 3:  return "VEC3";
+        case 16: return "MAT4";
+        default: return "VEC4";
+        }
+    }
+}
+
+/// Binary buffers plus the bufferViews / accessors describing them.
+/// A GLB has one buffer (its BIN chunk); split output has several .bin
+/// files, one run per category, each capped at maxBufferBytes.
+struct GltfGlbWriter::GlbLayout
+{
+    struct Buffer
+    {
+        quint64    dataBytes;       // filled by encode jobs, 4-byte aligned
+        quint64    reservedBytes;   // streamed after data, see reserveAccessor()
+        int        category;
+        QString    uri;             // split output only
+
+        Buffer() : dataBytes(0), reservedBytes(0), category(GeometryBuffer) {}
+        quint64 byteLength() const { return dataBytes + reservedBytes; }
+    };
+
+    /// One in-memory view, encoded and written at its final offset once
+    /// the whole layout is known.  Points into the scene being written.
+    struct EncodeJob
+    {
+        enum Kind { Float32, QuatInt16, Uint16 };
+
+        const void* src;
+        int         values;
+        int         kind;
+        int         buffer;
+        quint64     offset;
+        int         block;          // jobs of one block are encoded together
+
+        /// Bytes filled, padding included.
+        quint64 byteLength() const
+        {
+            return ((quint64)values * (kind == Float32 ? 4 : 2) + 3) & ~(quint64)3;
+        }
+    };
+
+    QVector<Buffer>         buffers;
+    bool                    split;
+    quint64                 maxBufferBytes;  // split only; 0 = no cap
+    int                     category;        // category of accessors being appended
+    int                     block;           // block of accessors being appended
+    QVector<BufferViewMeta> views;
+    QVector<AccessorMeta>   accessors;
+    QVector<EncodeJob>      jobs;
+    QVector<quint64>        hashes;          // per job, incremental writes only
+
+    QVector<int> posAcc, normAcc, uvAcc;         // per primitive
+    QVector<int> jointsAcc, weightsAcc;          // per primitive, -1 if unskinned
+    QVector<int> skinIbmAcc;                     // per skin
+    QVector<int> animInputAcc, animOutputAcc;    // per channel
+    QVector<int> instTAcc, instRAcc, instSAcc;   // per node, -1 if not instanced
+
+    GlbLayout() : split(false), maxBufferBytes(0), category(GeometryBuffer), block(0) {}
+
+    /// Next accessors form a new block: one primitive, skin, instanced
+    /// node or animation channel.
+    void beginBlock() { ++block; }
+};
+
+/// Buffer to take a view of @p bytes in the current category.  A view
+/// never straddles buffers; one larger than the cap gets a buffer of its
+/// own.  In-memory views never follow reserved ranges, which are written
+/// after the data.
+int GltfGlbWriter::bufferFor(GlbLayout& layout, quint64 bytes, bool reserved)
+{
+    if (!layout.split) {
+        if (layout.buffers.isEmpty())
+            layout.buffers.append(GlbLayout::Buffer());
+        return 0;
+    }
+
+    for (int b = layout.buffers.size() - 1; b >= 0; --b)
+    {
+        const GlbLayout::Buffer& buf = layout.buffers[b];
+        if (buf.category != layout.category)
+            continue;
+        bool fits = layout.maxBufferBytes == 0 || buf.byteLength() == 0
+                 || buf.byteLength() + bytes <= layout.maxBufferBytes;
+        if (fits && (reserved || buf.reservedBytes == 0))
+            return b;
+        break;
+    }
+
+    GlbLayout::Buffer buf;
+    buf.category = layout.category;
+    layout.buffers.append(buf);
+    return layout.buffers.size() - 1;
+}
+
+/// Place an in-memory view of @p bytes and queue the job that fills it.
+/// Returns the view index.
+int GltfGlbWriter::placeView(GlbLayout& layout, quint64 bytes,
+                             const void* src, int values, int kind, int target)
+{
+    BufferViewMeta bv;
+    bv.buffer     = bufferFor(layout, (bytes + 3) & ~(quint64)3, false);
+    GlbLayout::Buffer& buf = layout.buffers[bv.buffer];
+    bv.byteOffset = buf.dataBytes;
+    bv.byteLength = bytes;
+    bv.target     = target;
+
+    GlbLayout::EncodeJob job;
+    job.src    = src;
+    job.values = values;
+    job.kind   = kind;
+    job.buffer = bv.buffer;
+    job.offset = bv.byteOffset;
+    job.block  = layout.block;
+    layout.jobs.append(job);
+
+    // keep the next view 4-byte aligned
+    buf.dataBytes += (bytes + 3) & ~(quint64)3;
+    layout.views.append(bv);
+    return layout.views.size() - 1;
+}
+
+int GltfGlbWriter::appendFloatAccessor(GlbLayout& layout, const float* data,
+                                       int count, int numComps, int target,
+                                       bool withMinMax)
+{
+    int total = count * numComps;
+    int view = placeView(layout, (quint64)total * 4, data, total,
+                         GlbLayout::EncodeJob::Float32, target);
+
+    AccessorMeta am;
+    am.bufferView    = view;
+    am.componentType = 5126;   // FLOAT
+    am.normalized    = false;
+    am.count         = count;
+    am.type          = accessorTypeName(numComps);
+    am.numComps      = numComps;
+    am.hasMinMax     = withMinMax;
+    for (int j = 0; j < 4; ++j) { am.minV[j] = FLT_MAX; am.maxV[j] = -FLT_MAX; }
+
+    // bounds go into the JSON, which precedes the BIN chunk, so they are
+    // taken here rather than by the encoders
+    if (withMinMax) {
+        for (int i = 0; i < total; i += numComps) {
+            for (int j = 0; j < numComps; ++j) {
+                float v = data[i+j];
+                if (v < am.minV[j]) am.minV[j] = v;
+                if (v > am.maxV[j]) am.maxV[j] = v;
+            }
+        }
+    }
+
+    layout.accessors.append(am);
+    return layout.accessors.size() - 1;
+}
+
+int GltfGlbWriter::appendQuatInt16Accessor(GlbLayout& layout, const float* data,
+                                           int count)
+{
+    int view = placeView(layout, (quint64)count * 8, data, count * 4,
+                         GlbLayout::EncodeJob::QuatInt16, 0);
+
+    AccessorMeta am;
+    am.bufferView    = view;
+    am.componentType = 5122;   // SHORT, normalised (allowed for rotation outputs)
+    am.normalized    = true;
+    am.count         = count;
+    am.type          = "VEC4";
+    am.numComps      = 4;
+    am.hasMinMax     = false;
+
+    layout.accessors.append(am);
+    return layout.accessors.size() - 1;
+}
+
+int GltfGlbWriter::appendUint16Accessor(GlbLayout& layout, const quint16* data,
+                                        int count, int numComps, int target)
+{
+    int view = placeView(layout, (quint64)count * numComps * 2, data, count * numComps,
+                         GlbLayout::EncodeJob::Uint16, target);
+
+    AccessorMeta am;
+    am.bufferView    = view;
+    am.componentType = 5123;   // UNSIGNED_SHORT
+    am.normalized    = false;
+    am.count         = count;
+    am.type          = accessorTypeName(numComps);
+    am.numComps      = numComps;
+    am.hasMinMax     = false;
+
+    layout.accessors.append(am);
+    return layout.accessors.size() - 1;
+}
+
+int GltfGlbWriter::reserveAccessor(GlbLayout& layout, int count, int numComps,
+                                   int componentType, bool normalized,
+                                   const float* minV, const float* maxV)
+{
+    int compBytes = (componentType == 5126) ? 4 : 2;
+
+    BufferViewMeta bv;
+    bv.byteLength = (quint64)count * numComps * compBytes;
+    bv.buffer     = bufferFor(layout, (bv.byteLength + 3) & ~(quint64)3, true);
+    GlbLayout::Buffer& buf = layout.buffers[bv.buffer];
+    bv.byteOffset = buf.dataBytes + buf.reservedBytes;
+    bv.target     = 0;
+
+    AccessorMeta am;
+    am.bufferView    = layout.views.size();
+    am.componentType = componentType;
+    am.normalized    = normalized;
+    am.count         = count;
+    am.type          = accessorTypeName(numComps);
+    am.numComps      = numComps;
+    am.hasMinMax     = (minV && maxV);
+    for (int j = 0; j < numComps && am.hasMinMax; ++j) {
+        am.minV[j] = minV[j];
+        am.maxV[j] = maxV[j];
+    }
+
+    // keep every reserved view 4-byte aligned
+    buf.reservedBytes += (bv.byteLength + 3) & ~(quint64)3;
+    layout.views.append(bv);
+    layout.accessors.append(am);
+    return layout.accessors.size() - 1;
+}
+
+void GltfGlbWriter::appendMeshAccessors(GlbLayout& layout,
+                                        const QVector<GltfPrimData>& prims)
+{
+    layout.category = GeometryBuffer;
+    for (int p = 0; p < prims.size(); ++p)
+    {
+        const GltfPrimData& prim = prims[p];
+        int vertCount = prim.positions.size() / 3;
+        layout.beginBlock();
+
+        layout.posAcc.append(appendFloatAccessor(layout, prim.positions.constData(),
+                                                 vertCount, 3, 34962, true));
+        layout.normAcc.append(appendFloatAccessor(layout, prim.normals.constData(),
+                                                  vertCount, 3, 34962, false));
+        layout.uvAcc.append(appendFloatAccessor(layout, prim.texcoords.constData(),
+                                                prim.texcoords.size() / 2, 2, 34962, false));
+
+        bool skinned = !prim.joints.isEmpty();
+        layout.jointsAcc.append(skinned ? appendUint16Accessor(layout, prim.joints.constData(),
+                                                               vertCount, 4, 34962) : -1);
+        layout.weightsAcc.append(skinned ? appendFloatAccessor(layout, prim.weights.constData(),
+                                                               vertCount, 4, 34962, false) : -1);
+    }
+}
+
+void GltfGlbWriter::appendSkinAccessors(GlbLayout& layout,
+                                        const QVector<GltfSkinData>& skins)
+{
+    layout.category = GeometryBuffer;
+    for (int k = 0; k < skins.size(); ++k) {
+        layout.beginBlock();
+        layout.skinIbmAcc.append(appendFloatAccessor(layout, skins[k].inverseBindMatrices.constData(),
+                                                     skins[k].joints.size(), 16, 0, false));
+    }
+}
+
+void GltfGlbWriter::appendInstanceAccessors(GlbLayout& layout,
+                                            const QVector<GltfNodeData>& nodes)
+{
+    layout.category = GeometryBuffer;
+    layout.instTAcc.fill(-1, nodes.size());
+    layout.instRAcc.fill(-1, nodes.size());
+    layout.instSAcc.fill(-1, nodes.size());
+    for (int n = 0; n < nodes.size(); ++n)
+    {
+        const GltfNodeData& nd = nodes[n];
+        int count = nd.instanceTranslations.size() / 3;
+        if (count == 0)
+            continue;
+        layout.beginBlock();
+        layout.instTAcc[n] = appendFloatAccessor(layout, nd.instanceTranslations.constData(),
+                                                 count, 3, 0, false);
+        layout.instRAcc[n] = appendFloatAccessor(layout, nd.instanceRotations.constData(),
+                                                 count, 4, 0, false);
+        layout.instSAcc[n] = appendFloatAccessor(layout, nd.instanceScales.constData(),
+                                                 count, 3, 0, false);
+    }
+}
+
+void GltfGlbWriter::appendAnimationAccessors(GlbLayout& layout,
+                                             const QVector<GltfAnimChannel>& channels)
+{
+    layout.category = AnimationBuffer;
+    for (int c = 0; c < channels.size(); ++c)
+    {
+        const GltfAnimChannel& ch = channels[c];
+        layout.beginBlock();
+        layout.animInputAcc.append(appendFloatAccessor(layout, ch.times.constData(),
+                                                       ch.keyCount(), 1, 0, true));
+        if (ch.path == GltfAnimChannel::Rotation && ch.quantized)
+            layout.animOutputAcc.append(appendQuatInt16Accessor(layout, ch.values.constData(),
+                                                                ch.keyCount()));
+        else
+            layout.animOutputAcc.append(appendFloatAccessor(layout, ch.values.constData(),
+                                                            ch.keyCount(), ch.componentCount(),
+                                                            0, false));
+    }
+}
+
+void GltfGlbWriter::beginLayout(GlbLayout& layout) const
+{
+    layout.split          = m_bSplitBuffers;
+    layout.maxBufferBytes = m_bSplitBuffers ? (quint64)qMax<qint64>(m_nMaxBufferBytes, 0) : 0;
+}
+
+bool GltfGlbWriter::write(const GltfSceneData& scene,
+                          const QVector<GltfAnimChannel>& channels,
+                          const QString& outputPath)
+{
+    GltfTraceScope trace("writeGltf", "writer");
+    beginWrite();
+    QElapsedTimer timer;
+    timer.start();
+    GltfTraceScope layoutTrace("layout", "writer");
+    GlbLayout layout;
+    beginLayout(layout);
+    appendMeshAccessors(layout, scene.prims);
+    appendInstanceAccessors(layout, scene.nodes);
+    appendSkinAccessors(layout, scene.skins);
+    appendAnimationAccessors(layout, channels);
+    layoutTrace.end();
+    m_lastTimings.layoutMs = elapsedMs(timer);
+
+    return writeLayout(layout, scene, channels, outputPath, 0);
+}
+
+/// Zero bytes taking @p file from @p before to the next 4-byte boundary;
+/// false if they cannot all be written.
+static bool alignStream(QFile& file, qint64 before)
+{
+    static const char zeros[4] = { 0, 0, 0, 0 };
+    qint64 pad = (4 - (file.pos() - before) % 4) % 4;
+    return file.write(zeros, pad) == pad;
+}
+
+bool GltfGlbWriter::writeStreamed(const GltfSceneData& scene, GltfAnimationStream& stream,
+                                  const QString& outputPath)
+{
+    GltfTraceScope trace("writeGltfStreamed", "writer");
+    beginWrite();
+    QElapsedTimer timer;
+    timer.start();
+
+    // ---- lay out mesh data in memory, animation as reserved ranges --------
+    GlbLayout layout;
+    beginLayout(layout);
+    appendMeshAccessors(layout, scene.prims);
+    appendInstanceAccessors(layout, scene.nodes);
+    appendSkinAccessors(layout, scene.skins);
+
+    layout.category = AnimationBuffer;
+
+    QVector<GltfAnimChannel> kept;     // node/path only, for the JSON
+    QVector<int>             keptSrc;
+    QVector<bool>            keptInt16;
+    for (int c = 0; c < stream.channelCount(); ++c)
+    {
+        int n = stream.keyCount(c);
+        if (n == 0)
+            continue;
+        const GltfAnimChannel& desc = stream.channelDesc(c);
+        bool asInt16 = desc.path == GltfAnimChannel::Rotation && desc.quantized;
+        float tMin = stream.timeMin(c);
+        float tMax = (n == 1) ? tMin : stream.timeMax(c);
+
+        layout.animInputAcc.append(reserveAccessor(layout, n, 1, 5126, false, &tMin, &tMax));
+        layout.animOutputAcc.append(reserveAccessor(layout, n, desc.componentCount(),
+                                                    asInt16 ? 5122 : 5126, asInt16, 0, 0));
+        kept.append(desc);
+        keptSrc.append(c);
+        keptInt16.append(asInt16);
+    }
+    m_lastTimings.layoutMs = elapsedMs(timer);
+
+    // ---- write the in-memory part, then stream the keys after it --------
+    QVector<QFile*> files;
+    if (!writeLayout(layout, scene, kept, outputPath, &files))
+        return false;
+
+    QString sError;
+    for (int k = 0; k < kept.size() && sError.isEmpty(); ++k)
+    {
+        // input and output can land in different buffers when one fills up
+        QFile* tFile = files[layout.views[layout.accessors[layout.animInputAcc[k]].bufferView].buffer];
+        QFile* vFile = files[layout.views[layout.accessors[layout.animOutputAcc[k]].bufferView].buffer];
+
+        qint64 before = tFile->pos();
+        if (!stream.copyTimes(keptSrc[k], *tFile))
+            sError = stream.getLastError();
+        else if (!alignStream(*tFile, before))
+            sError = QString("exportGLB: cannot write '%1'").arg(tFile->fileName());
+        if (!sError.isEmpty())
+            break;
+
+        before = vFile->pos();
+        if (!stream.copyValues(keptSrc[k], *vFile, keptInt16[k]))
+            sError = stream.getLastError();
+        else if (!alignStream(*vFile, before))
+            sError = QString("exportGLB: cannot write '%1'").arg(vFile->fileName());
+    }
+    // buffered tails that do not reach the disk fail the export too
+    for (int f = 0; f < files.size() && sError.isEmpty(); ++f)
+        if (files[f] && !files[f]->flush())
+            sError = QString("exportGLB: cannot write '%1'").arg(files[f]->fileName());
+    closeStreamFiles(files);
+
+    if (!sError.isEmpty()) {
+        m_sLastError = sError;
+        return false;
+    }
+    return true;
+}
+
+QByteArray GltfGlbWriter::buildJSON(const GlbLayout& layout,
+                                    const GltfSceneData& scene,
+                                    const QVector<GltfAnimChannel>& channels)
+{
+    GltfTraceScope trace("buildJSON", "writer");
+    const QVector<GltfPrimData>& prims  = scene.prims;
+    const QVector<GltfMeshData>& meshes = scene.meshes;
+    const QVector<GltfNodeData>& nodes  = scene.nodes;
+
+    // ---- 1. Collect unique image paths -----------------------------------
+    QVector<QString> imagePaths;
+    QVector<int>     baseColorTexIdx(prims.size(), -1);
+    QVector<int>     normalTexIdx(prims.size(), -1);
+
+    GltfSceneStats& stats = m_lastStats;
+    for (int p = 0; p < prims.size(); ++p) {
+        stats.vertices  += prims[p].positions.size() / 3;
+        stats.triangles += prims[p].positions.size() / 9;
+        // base colour texture
+        if (!prims[p].baseColorTexturePath.isEmpty()) {
+            int found = -1;
+            for (int i = 0; i < imagePaths.size(); ++i)
+                if (imagePaths[i] == prims[p].baseColorTexturePath) { found = i; break; }
+            if (found < 0) { found = imagePaths.size(); imagePaths.append(prims[p].baseColorTexturePath); }
+            baseColorTexIdx[p] = found;
+        }
+        // normal texture
+        if (!prims[p].normalTexturePath.isEmpty()) {
+            int found = -1;
+            for (int i = 0; i < imagePaths.size(); ++i)
+                if (imagePaths[i] == prims[p].normalTexturePath) { found = i; break; }
+            if (found < 0) { found = imagePaths.size(); imagePaths.append(prims[p].normalTexturePath); }
+            normalTexIdx[p] = found;
+        }
+    }
+
+    // LOD meshes reuse their LOD0 primitives' materials; every other
+    // primitive gets its own.
+    QVector<int> reuses(prims.size(), -1);
+    for (int m = 0; m < meshes.size(); ++m)
+        if (meshes[m].materialBase >= 0)
+            for (int i = 0; i < meshes[m].primCount; ++i)
+                reuses[meshes[m].firstPrim + i] = meshes[m].materialBase + i;
+
+    QVector<int> materialOf(prims.size(), -1);
+    QVector<int> ownMaterials;
+    for (int p = 0; p < prims.size(); ++p) {
+        if (reuses[p] >= 0) {
+            materialOf[p] = materialOf[reuses[p]];
+        } else {
+            materialOf[p] = ownMaterials.size();
+            ownMaterials.append(p);
+        }
+    }
+
+    stats.primitives = prims.size();
+    stats.meshes     = meshes.size();
+    stats.nodes      = nodes.size();
+    stats.materials  = ownMaterials.size();
+    stats.textures   = imagePaths.toList();
+    for (int k = 0; k < scene.skins.size(); ++k)
+        stats.joints += scene.skins[k].joints.size();
+
+    // ---- 2. Build JSON ---------------------------------------------------
+    QString json;
+    json += "{\n";
+
+    // asset
+    json += "  \"asset\": { \"version\": \"2.0\", \"generator\": \"DazToUnity Bridge\" },\n";
+
+    // Instancing degrades gracefully (one copy at the node), and so does
+    // MSFT_lod (LOD0 only), so both are used but not required.
+    bool anyInstanced = false, anyLods = false;
+    QVector<bool> isLod(nodes.size(), false);
+    for (int n = 0; n < nodes.size(); ++n) {
+        anyInstanced = anyInstanced || !nodes[n].instanceTranslations.isEmpty();
+        anyLods      = anyLods      || !nodes[n].lods.isEmpty();
+        for (int l = 0; l < nodes[n].lods.size(); ++l)
+            isLod[nodes[n].lods[l]] = true;
+    }
+    QStringList extensionsUsed;
+    if (anyInstanced) extensionsUsed.append("\"EXT_mesh_gpu_instancing\"");
+    if (anyLods)      extensionsUsed.append("\"MSFT_lod\"");
+    if (!extensionsUsed.isEmpty())
+        json += QString("  \"extensionsUsed\": [ %1 ],\n").arg(extensionsUsed.join(", "));
+
+    // scene / scenes / nodes
+    QStringList rootList;
+    QVector<QStringList> childLists(nodes.size());
+    for (int n = 0; n < nodes.size(); ++n) {
+        if (isLod[n])
+            continue;
+        if (nodes[n].parent < 0) rootList.append(QString::number(n));
+        else                     childLists[nodes[n].parent].append(QString::number(n));
+    }
+
+    json += "  \"scene\": 0,\n";
+    json += QString("  \"scenes\": [ { \"nodes\": [%1] } ],\n").arg(rootList.join(", "));
+    json += "  \"nodes\": [";
+    for (int n = 0; n < nodes.size(); ++n) {
+        const GltfNodeData& nd = nodes[n];
+        json += (n == 0) ? " " : ",\n    ";
+        json += QString("{ \"name\": \"%1\"").arg(nd.name);
+        if (nd.mesh >= 0)
+            json += QString(", \"mesh\": %1").arg(nd.mesh);
+        if (nd.skin >= 0)
+            json += QString(", \"skin\": %1").arg(nd.skin);
+        if (!childLists[n].isEmpty())
+            json += QString(", \"children\": [%1]").arg(childLists[n].join(", "));
+        if (nd.translation[0] != 0.0f || nd.translation[1] != 0.0f || nd.translation[2] != 0.0f)
+            json += QString(", \"translation\": %1")
+                        .arg(jsonVec3(nd.translation[0], nd.translation[1], nd.translation[2]));
+        if (nd.rotation[0] != 0.0f || nd.rotation[1] != 0.0f || nd.rotation[2] != 0.0f || nd.rotation[3] != 1.0f)
+            json += QString(", \"rotation\": [%1,%2,%3,%4]")
+                        .arg(jsonFloat(nd.rotation[0])).arg(jsonFloat(nd.rotation[1]))
+                        .arg(jsonFloat(nd.rotation[2])).arg(jsonFloat(nd.rotation[3]));
+        if (nd.scale[0] != 1.0f || nd.scale[1] != 1.0f || nd.scale[2] != 1.0f)
+            json += QString(", \"scale\": %1")
+                        .arg(jsonVec3(nd.scale[0], nd.scale[1], nd.scale[2]));
+        QStringList ext;
+        if (layout.instTAcc.value(n, -1) >= 0)
+            ext.append(QString("\"EXT_mesh_gpu_instancing\": { \"attributes\": "
+                               "{ \"TRANSLATION\": %1, \"ROTATION\": %2, \"SCALE\": %3 } }")
+                           .arg(layout.instTAcc[n]).arg(layout.instRAcc[n]).arg(layout.instSAcc[n]));
+        if (!nd.lods.isEmpty()) {
+            QStringList ids;
+            for (int l = 0; l < nd.lods.size(); ++l)
+                ids.append(QString::number(nd.lods[l]));
+            ext.append(QString("\"MSFT_lod\": { \"ids\": [%1] }").arg(ids.join(", ")));
+        }
+        if (!ext.isEmpty())
+            json += QString(", \"extensions\": { %1 }").arg(ext.join(", "));
+        if (!nd.lodCoverage.isEmpty()) {
+            QStringList coverage;
+            for (int l = 0; l < nd.lodCoverage.size(); ++l)
+                coverage.append(jsonFloat(nd.lodCoverage[l]));
+            json += QString(", \"extras\": { \"MSFT_screencoverage\": [%1] }").arg(coverage.join(", "));
+        }
+        json += " }";
+    }
+    json += " ],\n";
+
+    // skins
+    if (!scene.skins.isEmpty()) {
+        json += "  \"skins\": [\n";
+        for (int k = 0; k < scene.skins.size(); ++k) {
+            QStringList joints;
+            for (int j = 0; j < scene.skins[k].joints.size(); ++j)
+                joints.append(QString::number(scene.skins[k].joints[j]));
+            json += QString("    { \"inverseBindMatrices\": %1, \"joints\": [%2] }")
+                        .arg(layout.skinIbmAcc[k]).arg(joints.join(", "));
+            json += (k < scene.skins.size()-1) ? ",\n" : "\n";
+        }
+        json += "  ],\n";
+    }
+
+    // meshes
+    json += "  \"meshes\": [\n";
+    for (int m = 0; m < meshes.size(); ++m) {
+        const GltfMeshData& md = meshes[m];
+        json += QString("    { \"name\": \"%1\", \"primitives\": [\n").arg(md.name);
+        for (int p = md.firstPrim; p < md.firstPrim + md.primCount; ++p) {
+            json += "    {\n";
+            json += QString("      \"attributes\": { \"POSITION\": %1, \"NORMAL\": %2, \"TEXCOORD_0\": %3")
+                        .arg(layout.posAcc[p]).arg(layout.normAcc[p]).arg(layout.uvAcc[p]);
+            if (layout.jointsAcc[p] >= 0)
+                json += QString(", \"JOINTS_0\": %1, \"WEIGHTS_0\": %2")
+                            .arg(layout.jointsAcc[p]).arg(layout.weightsAcc[p]);
+            json += " },\n";
+            json += QString("      \"material\": %1,\n").arg(materialOf[p]);
+            json += "      \"mode\": 4\n";       // TRIANGLES
+            json += (p < md.firstPrim + md.primCount - 1) ? "    },\n" : "    }\n";
+        }
+        json += (m < meshes.size()-1) ? "    ] },\n" : "    ] }\n";
+    }
+    json += "  ],\n";
+
+    // animations
+    if (!channels.isEmpty()) {
+        static const char* pathNames[] = { "translation", "rotation", "scale" };
+        json += "  \"animations\": [ { \"name\": \"Animation\",\n";
+        json += "    \"samplers\": [\n";
+        for (int c = 0; c < channels.size(); ++c) {
+            json += QString("      { \"input\": %1, \"output\": %2, \"interpolation\": \"LINEAR\" }")
+                        .arg(layout.animInputAcc[c]).arg(layout.animOutputAcc[c]);
+            json += (c < channels.size()-1) ? ",\n" : "\n";
+        }
+        json += "    ],\n";
+        json += "    \"channels\": [\n";
+        for (int c = 0; c < channels.size(); ++c) {
+            json += QString("      { \"sampler\": %1, \"target\": { \"node\": %2, \"path\": \"%3\" } }")
+                        .arg(c).arg(channels[c].node).arg(pathNames[channels[c].path]);
+            json += (c < channels.size()-1) ? ",\n" : "\n";
+        }
+        json += "    ]\n";
+        json += "  } ],\n";
+    }
+
+    // accessors (one bufferView per accessor)
+    json += "  \"accessors\": [\n";
+    for (int a = 0; a < layout.accessors.size(); ++a) {
+        const AccessorMeta& am = layout.accessors[a];
+        json += "    {\n";
+        json += QString("      \"bufferView\": %1,\n").arg(am.bufferView);
+        json += "      \"byteOffset\": 0,\n";
+        json += QString("      \"componentType\": %1,\n").arg(am.componentType);
+        if (am.normalized)
+            json += "      \"normalized\": true,\n";
+        json += QString("      \"count\": %1,\n").arg(am.count);
+        json += QString("      \"type\": \"%1\"").arg(am.type);
+        if (am.hasMinMax) {
+            QStringList mins, maxs;
+            for (int j = 0; j < am.numComps; ++j) {
+                mins.append(jsonFloat(am.minV[j]));
+                maxs.append(jsonFloat(am.maxV[j]));
+            }
+            json += QString(",\n      \"min\": [%1],\n").arg(mins.join(", "));
+            json += QString("      \"max\": [%1]").arg(maxs.join(", "));
+        }
+        json += "\n";
+        json += (a < layout.accessors.size()-1) ? "    },\n" : "    }\n";
+    }
+    json += "  ],\n";
+
+    // bufferViews
+    json += "  \"bufferViews\": [\n";
+    for (int v = 0; v < layout.views.size(); ++v) {
+        const BufferViewMeta& bv = layout.views[v];
+        json += "    {\n";
+        json += QString("      \"buffer\": %1,\n").arg(bv.buffer);
+        json += QString("      \"byteOffset\": %1,\n").arg(bv.byteOffset);
+        json += QString("      \"byteLength\": %1").arg(bv.byteLength);
+        if (bv.target != 0)
+            json += QString(",\n      \"target\": %1").arg(bv.target);
+        json += "\n";
+        json += (v < layout.views.size()-1) ? "    },\n" : "    }\n";
+    }
+    json += "  ],\n";
+
+    // images
+    if (!imagePaths.isEmpty()) {
+        json += "  \"images\": [\n";
+        for (int i = 0; i < imagePaths.size(); ++i) {
+            QString basename = QFileInfo(imagePaths[i]).fileName();
+            json += QString("    { \"uri\": \"%1\" }").arg(basename);
+            json += (i < imagePaths.size()-1) ? ",\n" : "\n";
+        }
+        json += "  ],\n";
+
+        // textures (one per image)
+        json += "  \"textures\": [\n";
+        for (int i = 0; i < imagePaths.size(); ++i) {
+            json += QString("    { \"source\": %1 }").arg(i);
+            json += (i < imagePaths.size()-1) ? ",\n" : "\n";
+        }
+        json += "  ],\n";
+    }
+
+    // materials
+    json += "  \"materials\": [\n";
+    for (int i = 0; i < ownMaterials.size(); ++i) {
+        const int p = ownMaterials[i];
+        const GltfPrimData& pr = prims[p];
+        json += "    {\n";
+        json += QString("      \"name\": \"%1\",\n").arg(pr.materialName);
+        json += "      \"pbrMetallicRoughness\": {\n";
+        json += QString("        \"baseColorFactor\": [%1, %2, %3, %4],\n")
+                    .arg(jsonFloat(pr.baseColor[0])).arg(jsonFloat(pr.baseColor[1]))
+                    .arg(jsonFloat(pr.baseColor[2])).arg(jsonFloat(pr.baseColor[3]));
+        if (baseColorTexIdx[p] >= 0)
+            json += QString("        \"baseColorTexture\": { \"index\": %1 },\n")
+                        .arg(baseColorTexIdx[p]);
+        json += QString("        \"metallicFactor\": %1,\n").arg(jsonFloat(pr.metallicFactor));
+        json += QString("        \"roughnessFactor\": %1\n").arg(jsonFloat(pr.roughnessFactor));
+        json += "      }";
+        if (normalTexIdx[p] >= 0)
+            json += QString(",\n      \"normalTexture\": { \"index\": %1 }").arg(normalTexIdx[p]);
+        json += "\n    }";
+        json += (i < ownMaterials.size()-1) ? ",\n" : "\n";
+    }
+    json += "  ],\n";
+
+    // buffers: the GLB BIN chunk, or the external .bin files
+    json += "  \"buffers\": [";
+    for (int b = 0; b < layout.buffers.size(); ++b) {
+        const GlbLayout::Buffer& buf = layout.buffers[b];
+        json += (b == 0) ? " " : ",\n    ";
+        if (!buf.uri.isEmpty())
+            json += QString("{ \"uri\": \"%1\", \"byteLength\": %2 }").arg(buf.uri).arg(buf.byteLength());
+        else
+            json += QString("{ \"byteLength\": %1 }").arg(buf.byteLength());
+    }
+    json += " ]\n";
+    json += "}\n";
+
+    return padTo4(json.toUtf8(), ' ');
+}
+
+QByteArray GltfGlbWriter::glbPrefix(const QByteArray& jsonPadded, quint32 binPaddedSize)
+{
+    quint32 totalLen = 12
+                     + 8 + (quint32)jsonPadded.size()
+                     + (binPaddedSize == 0 ? 0 : 8 + binPaddedSize);
+
+    QByteArray glb;
+    appendUint32LE(glb, 0x46546C67u);     // magic 'glTF'
+    appendUint32LE(glb, 2u);              // version
+    appendUint32LE(glb, totalLen);        // total length
+
+    // JSON chunk
+    appendUint32LE(glb, (quint32)jsonPadded.size());
+    appendUint32LE(glb, 0x4E4F534Au);     // 'JSON'
+    glb.append(jsonPadded);
+
+    // BIN chunk header; the caller appends the data
+    if (binPaddedSize != 0) {
+        appendUint32LE(glb, binPaddedSize);
+        appendUint32LE(glb, 0x004E4942u); // 'BIN\0'
+    }
+
+    return glb;
+}
+
+bool GltfGlbWriter::writeFile(const QString& outputPath, const QByteArray& data)
+{
+    QFile file(outputPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        m_sLastError = QString("exportGLB: cannot open '%1'").arg(outputPath);
+        return false;
+    }
+    file.write(data);
+    file.close();
+    return true;
+}
+
+/// Write tasks take whole blocks, at least this many bytes each, so small
+/// primitives don't cost a task apiece.  Also each task's scratch size.
+static const quint64 kWriteTaskBytes = 4 * 1024 * 1024;
+
+/// Encode a run of blocks and write each view at its final offset.  The
+/// file already has its full size, the runs are disjoint, and every task
+/// has its own handles, so tasks never wait on each other.  Views are
+/// encoded into one pooled scratch block, sliced where a view outgrows it,
+/// and adjacent views of one buffer go out in a single write.
+struct GltfGlbWriter::WriteTask
+{
+    typedef void result_type;
+
+    struct Item
+    {
+        int  firstJob;
+        int  endJob;
+        int  progressShare;     // added to getProgress() when done
+        bool ok;
+    };
+
+    const GlbLayout*  layout;
+    QStringList       paths;    // per buffer
+    QVector<quint64>  bases;    // per buffer: file offset of byte 0
+    QAtomicInt*       progress;
+    const QAtomicInt* cancel;
+    const bool*       dirty;    // per job; null writes every job
+    GltfBufferPool*   pool;
+
+    /// Pending bytes: @p used of @p block, destined for @p offset in @p buffer.
+    struct Chunk
+    {
+        QByteArray block;
+        int        used;
+        int        buffer;
+        quint64    offset;
+    };
+
+    void operator()(Item& item) const
+    {
+        GltfTraceScope trace("writeRange", "writer");
+        if (*cancel) {
+            item.ok = false;
+            return;
+        }
+
+        QVector<QFile*> files(layout->buffers.size(), 0);
+        Chunk chunk;
+        chunk.block  = pool->acquire((int)kWriteTaskBytes);
+        chunk.used   = 0;
+        chunk.buffer = -1;
+        chunk.offset = 0;
+
+        item.ok = true;
+        for (int j = item.firstJob; j < item.endJob && item.ok; ++j)
+        {
+            if (dirty && !dirty[j])
+                continue;       // unchanged; the gap it leaves ends the run
+            const GlbLayout::EncodeJob& job = layout->jobs[j];
+            if (job.buffer != chunk.buffer || job.offset != chunk.offset + (quint64)chunk.used) {
+                item.ok = flush(files, chunk);
+                chunk.buffer = job.buffer;
+                chunk.offset = job.offset;
+            }
+
+            int valueBytes = (job.kind == GlbLayout::EncodeJob::Float32) ? 4 : 2;
+            int blockBytes = chunk.block.size();
+            for (int v = 0; v < job.values && item.ok; )
+            {
+                int fit = (blockBytes - chunk.used) / valueBytes;
+                if (fit == 0) {
+                    item.ok = flush(files, chunk);
+                    continue;
+                }
+                int n = qMin(fit, job.values - v);
+                encode(job, v, n, (uchar*)chunk.block.data() + chunk.used);
+                chunk.used += n * valueBytes;
+                v += n;
+            }
+
+            // views start 4-byte aligned, see placeView()
+            int pad = (int)(job.byteLength() - (quint64)job.values * valueBytes);
+            if (pad > 0 && item.ok) {
+                if (chunk.used + pad > blockBytes)
+                    item.ok = flush(files, chunk);
+                memset(chunk.block.data() + chunk.used, 0, pad);
+                chunk.used += pad;
+            }
+        }
+        if (item.ok)
+            item.ok = flush(files, chunk);
+
+        pool->release(chunk.block);
+        for (int b = 0; b < files.size(); ++b)
+            delete files[b];
+        progress->fetchAndAddRelaxed(item.progressShare);
+    }
+
+    /// Encode values [first, first + count) of @p job, little-endian, to @p out.
+    static void encode(const GlbLayout::EncodeJob& job, int first, int count, uchar* out)
+    {
+        switch (job.kind)
+        {
+        case GlbLayout::EncodeJob::Float32: {
+            const float* v = (const float*)job.src + first;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+            memcpy(out, v, count * 4);
+#else
+            for (int i = 0; i < count; ++i) {
+                quint32 bits;
+                memcpy(&bits, v + i, 4);
+                qToLittleEndian<quint32>(bits, out + i * 4);
+            }
+#endif
+            break;
+        }
+        case GlbLayout::EncodeJob::QuatInt16: {
+            const float* v = (const float*)job.src + first;
+            for (int i = 0; i < count; ++i) {
+                float q = v[i];
+                if (q >  1.0f) q =  1.0f;
+                if (q < -1.0f) q = -1.0f;
+                qToLittleEndian<qint16>((qint16)qRound(q * 32767.0f), out + i * 2);
+            }
+            break;
+        }
+        case GlbLayout::EncodeJob::Uint16: {
+            const quint16* v = (const quint16*)job.src + first;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+            memcpy(out, v, count * 2);
+#else
+            for (int i = 0; i < count; ++i)
+                qToLittleEndian<quint16>(v[i], out + i * 2);
+#endif
+            break;
+        }
+        }
+    }
+
+    /// Write out the chunk's pending bytes; the chunk then continues
+    /// right after them.
+    bool flush(QVector<QFile*>& files, Chunk& chunk) const
+    {
+        if (chunk.used == 0)
+            return true;
+        QFile*& file = files[chunk.buffer];
+        if (!file) {
+            file = new QFile(paths[chunk.buffer]);
+            if (!file->open(QIODevice::ReadWrite))
+                return false;
+        }
+        bool ok = file->seek((qint64)(bases[chunk.buffer] + chunk.offset))
+               && file->write(chunk.block.constData(), chunk.used) == chunk.used;
+        chunk.offset += chunk.used;
+        chunk.used    = 0;
+        return ok;
+    }
+};
+
+bool GltfGlbWriter::writeBuffers(const GlbLayout& layout, const QStringList& paths,
+                                 const QVector<quint64>& bases, const QVector<bool>* dirty)
+{
+    GltfTraceScope trace("writeBuffers", "writer");
+    QVector<WriteTask::Item> items;
+    quint64 runBytes = 0;
+    for (int j = 0; j < layout.jobs.size(); ++j)
+    {
+        const GlbLayout::EncodeJob& job = layout.jobs[j];
+        bool newBlock = (j == 0) || job.block != layout.jobs[j - 1].block;
+        if (items.isEmpty() || (newBlock && runBytes >= kWriteTaskBytes)) {
+            WriteTask::Item item;
+            item.firstJob      = j;
+            item.progressShare = 0;
+            item.ok            = false;
+            items.append(item);
+            runBytes = 0;
+        }
+        items.last().endJob = j + 1;
+        if (!dirty || (*dirty)[j]) {
+            runBytes += job.byteLength();
+            m_nLastBytesWritten += (qint64)job.byteLength();
+        }
+    }
+
+    // the rest of getProgress() is shared out over the tasks
+    int from = qMin<int>(*m_pProgress, 100);
+    for (int i = 0; i < items.size(); ++i)
+        items[i].progressShare = (100 - from) * (i + 1) / items.size()
+                               - (100 - from) * i / items.size();
+
+    WriteTask task;
+    task.layout   = &layout;
+    task.paths    = paths;
+    task.bases    = bases;
+    task.progress = m_pProgress;
+    task.cancel   = m_pCancel;
+    task.dirty    = dirty ? dirty->constData() : 0;
+    task.pool     = m_pBufferPool;
+    QtConcurrent::blockingMap(items, task);
+
+    if (writeCancelled())
+        return false;
+    for (int i = 0; i < items.size(); ++i)
+        if (!items[i].ok) {
+            m_sLastError = QString("exportGLB: cannot write '%1'")
+                               .arg(paths[layout.jobs[items[i].firstJob].buffer]);
+            return false;
+        }
+    return true;
+}
+
+/// In-memory counterpart of WriteTask: one job, encoded straight into the
+/// GLB's BIN chunk.  The chunk starts zeroed, so padding needs no writes.
+struct GltfGlbWriter::PackTask
+{
+    typedef void result_type;
+
+    const GlbLayout* layout;
+    uchar*           bin;
+
+    void operator()(int& j) const
+    {
+        const GlbLayout::EncodeJob& job = layout->jobs[j];
+        WriteTask::encode(job, 0, job.values, bin + job.offset);
+    }
+};
+
+bool GltfGlbWriter::writeToBuffer(const GltfSceneData& scene,
+                                  const QVector<GltfAnimChannel>& channels,
+                                  QByteArray& outGlb)
+{
+    beginWrite();
+    QElapsedTimer timer;
+    timer.start();
+    GlbLayout layout;       // one buffer, whatever setSplitBuffers() says
+    appendMeshAccessors(layout, scene.prims);
+    appendInstanceAccessors(layout, scene.nodes);
+    appendSkinAccessors(layout, scene.skins);
+    appendAnimationAccessors(layout, channels);
+    m_lastTimings.layoutMs = elapsedMs(timer);
+
+    timer.restart();
+    QByteArray jsonPadded = buildJSON(layout, scene, channels);
+    GltfMemoryHold jsonHold(GltfMemoryJson, jsonPadded.size());
+    m_lastTimings.jsonMs = elapsedMs(timer);
+
+    quint64 binLength = layout.buffers.isEmpty() ? 0 : layout.buffers[0].byteLength();
+    quint64 totalLen  = 12 + 8 + (quint64)jsonPadded.size() + (binLength ? 8 + binLength : 0);
+    if (totalLen > 0x7FFFFFFFull) {
+        m_sLastError = "exportGLB: output too large to build in memory";
+        return false;
+    }
+
+    timer.restart();
+    outGlb = glbPrefix(jsonPadded, (quint32)binLength);
+    int binStart = outGlb.size();
+    outGlb.resize(binStart + (int)binLength);
+    memset(outGlb.data() + binStart, 0, (size_t)binLength);
+
+    QVector<int> indices(layout.jobs.size());
+    for (int j = 0; j < indices.size(); ++j)
+        indices[j] = j;
+    PackTask task;
+    task.layout = &layout;
+    task.bin    = (uchar*)outGlb.data() + binStart;
+    QtConcurrent::blockingMap(indices, task);
+    m_lastTimings.buffersMs = elapsedMs(timer);
+
+    m_nLastBytesWritten = outGlb.size();
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Incremental writes
+// ---------------------------------------------------------------------------
+
+/// Sidecar record of the last write: every file's size and time, and each
+/// encode job's byte range and content hash.  A re-export whose ranges all
+/// match rewrites only the jobs whose hash changed, plus the JSON.
+struct GltfGlbWriter::PatchIndex
+{
+    struct File
+    {
+        QString name;
+        quint64 dataBytes;
+        qint64  size;
+        uint    modified;
+    };
+
+    quint64          jsonChunkBytes;   // GLB JSON chunk, slack included
+    QVector<File>    files;            // per buffer
+    QVector<int>     buffers;          // per job
+    QVector<quint64> offsets, lengths, hashes;
+
+    PatchIndex() : jsonChunkBytes(0) {}
+};
+
+// "GIDX", bumped with the format
+static const quint32 kPatchIndexMagic   = 0x58444947u;
+static const quint32 kPatchIndexVersion = 1;
+
+// GLB JSON chunks are padded to a multiple of this with spaces, so a small
+// material edit still fits the chunk and the BIN data need not move.
+static const int kJsonSlackBytes = 4096;
+
+QString GltfGlbWriter::patchIndexPath(const QString& outputPath)
+{
+    // dot file: Unity skips it rather than importing it as an asset
+    QFileInfo info(outputPath);
+    return info.absolutePath() + "/." + info.fileName() + ".idx";
+}
+
+struct GltfGlbWriter::HashTask
+{
+    typedef void result_type;
+
+    GlbLayout* layout;
+
+    void operator()(int& j) const
+    {
+        const GlbLayout::EncodeJob& job = layout->jobs[j];
+        int srcBytes = (job.kind == GlbLayout::EncodeJob::Uint16) ? 2 : 4;
+        layout->hashes[j] = GltfHasher::hash(job.src, (qint64)job.values * srcBytes,
+                                             (quint64)job.kind);
+    }
+};
+
+void GltfGlbWriter::hashJobs(GlbLayout& layout)
+{
+    GltfTraceScope trace("hashJobs", "writer");
+    layout.hashes.resize(layout.jobs.size());
+    QVector<int> indices(layout.jobs.size());
+    for (int j = 0; j < indices.size(); ++j)
+        indices[j] = j;
+
+    HashTask task;
+    task.layout = &layout;
+    QtConcurrent::blockingMap(indices, task);
+}
+
+bool GltfGlbWriter::loadPatchIndex(const QString& outputPath, PatchIndex& index)
+{
+    QFile file(patchIndexPath(outputPath));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_4_8);
+
+    quint32 magic = 0, version = 0, fileCount = 0, jobCount = 0;
+    in >> magic >> version;
+    if (magic != kPatchIndexMagic || version != kPatchIndexVersion)
+        return false;
+
+    in >> index.jsonChunkBytes >> fileCount;
+    index.files.resize(fileCount);
+    for (quint32 f = 0; f < fileCount; ++f) {
+        PatchIndex::File& pf = index.files[f];
+        in >> pf.name >> pf.dataBytes >> pf.size >> pf.modified;
+    }
+
+    in >> jobCount;
+    index.buffers.resize(jobCount);
+    index.offsets.resize(jobCount);
+    index.lengths.resize(jobCount);
+    index.hashes.resize(jobCount);
+    for (quint32 j = 0; j < jobCount; ++j) {
+        qint32 buffer = 0;
+        in >> buffer >> index.offsets[j] >> index.lengths[j] >> index.hashes[j];
+        index.buffers[j] = buffer;
+    }
+    return in.status() == QDataStream::Ok;
+}
+
+void GltfGlbWriter::savePatchIndex(const QString& outputPath, const GlbLayout& layout,
+                                   const QStringList& paths, quint64 jsonChunkBytes)
+{
+    QFile file(patchIndexPath(outputPath));
+    if (!file.open(QIODevice::WriteOnly))
+        return;     // only costs the next export a full write
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_4_8);
+
+    out << kPatchIndexMagic << kPatchIndexVersion;
+    out << jsonChunkBytes << (quint32)paths.size();
+    for (int b = 0; b < paths.size(); ++b) {
+        QFileInfo info(paths[b]);
+        out << info.fileName() << layout.buffers[b].dataBytes
+            << info.size() << (uint)info.lastModified().toTime_t();
+    }
+
+    out << (quint32)layout.jobs.size();
+    for (int j = 0; j < layout.jobs.size(); ++j) {
+        const GlbLayout::EncodeJob& job = layout.jobs[j];
+        out << (qint32)job.buffer << job.offset << job.byteLength() << layout.hashes[j];
+    }
+}
+
+/// Jobs to rewrite if @p layout can be patched into the files @p index
+/// describes; false if anything moved and the files must be rewritten.
+bool GltfGlbWriter::diffPatchIndex(const PatchIndex& index, const GlbLayout& layout,
+                                   const QStringList& paths, QVector<bool>& dirty)
+{
+    if (index.files.size() != layout.buffers.size()
+        || index.buffers.size() != layout.jobs.size())
+        return false;
+
+    for (int b = 0; b < paths.size(); ++b) {
+        const PatchIndex::File& pf = index.files[b];
+        QFileInfo info(paths[b]);
+        if (pf.name != info.fileName() || pf.dataBytes != layout.buffers[b].dataBytes
+            || layout.buffers[b].reservedBytes != 0
+            || !info.exists() || pf.size != info.size()
+            || pf.modified != (uint)info.lastModified().toTime_t())
+            return false;   // resized, or touched by something else since
+    }
+
+    dirty.fill(false, layout.jobs.size());
+    for (int j = 0; j < layout.jobs.size(); ++j) {
+        const GlbLayout::EncodeJob& job = layout.jobs[j];
+        if (index.buffers[j] != job.buffer || index.offsets[j] != job.offset
+            || index.lengths[j] != job.byteLength())
+            return false;
+        dirty[j] = index.hashes[j] != layout.hashes[j];
+    }
+    return true;
+}
+
+bool GltfGlbWriter::writeLayout(GlbLayout& layout, const GltfSceneData& scene,
+                                const QVector<GltfAnimChannel>& channels,
+                                const QString& outputPath, QVector<QFile*>* streamFiles)
+{
+    // streamed ranges are not hashed; those writes are always whole
+    bool incremental = m_bIncrementalUpdate && !streamFiles;
+    PatchIndex index;
+    if (incremental) {
+        hashJobs(layout);
+        incremental = loadPatchIndex(outputPath, index);
+    } else {
+        QFile::remove(patchIndexPath(outputPath));
+    }
+
+    if (layout.split)
+    {
+        // ---- .gltf plus one .bin per buffer, each sized up front ----------
+        QFileInfo info(outputPath);
+        QVector<int> perCategory(BufferCategoryCount, 0);
+        QStringList      paths;
+        QVector<quint64> bases(layout.buffers.size(), 0);
+        for (int b = 0; b < layout.buffers.size(); ++b) {
+            GlbLayout::Buffer& buf = layout.buffers[b];
+            buf.uri = QString("%1_%2%3.bin").arg(info.completeBaseName())
+                          .arg(bufferCategoryName(buf.category)).arg(perCategory[buf.category]++);
+            paths.append(info.absolutePath() + "/" + buf.uri);
+        }
+
+        QVector<bool> dirty;
+        m_bLastWriteIncremental = incremental && diffPatchIndex(index, layout, paths, dirty);
+
+        QElapsedTimer timer;
+        timer.start();
+        QByteArray json = buildJSON(layout, scene, channels);
+        GltfMemoryHold jsonHold(GltfMemoryJson, json.size());
+        m_lastTimings.jsonMs = elapsedMs(timer);
+        if (!writeFile(outputPath, json))
+            return false;
+        m_nLastBytesWritten += json.size();
+
+        if (!m_bLastWriteIncremental) {
+            for (int b = 0; b < layout.buffers.size(); ++b) {
+                QFile file(paths[b]);
+                if (!file.open(QIODevice::WriteOnly) || !file.resize((qint64)layout.buffers[b].dataBytes)) {
+                    m_sLastError = QString("exportGLB: cannot open '%1'").arg(paths[b]);
+                    return false;
+                }
+            }
+        }
+        timer.restart();
+        bool written = writeBuffers(layout, paths, bases, m_bLastWriteIncremental ? &dirty : 0);
+        m_lastTimings.buffersMs = elapsedMs(timer);
+        if (!written) {
+            QFile::remove(patchIndexPath(outputPath));
+            if (*m_pCancel)
+                removeFiles(paths << outputPath);
+            return false;
+        }
+        m_lastBufferFiles = paths;
+        if (m_bIncrementalUpdate && !streamFiles)
+            savePatchIndex(outputPath, layout, paths, 0);
+
+        // reserved ranges are appended by the caller, buffer by buffer
+        if (streamFiles) {
+            streamFiles->fill(0, layout.buffers.size());
+            for (int b = 0; b < layout.buffers.size(); ++b) {
+                if (layout.buffers[b].reservedBytes == 0)
+                    continue;
+                QFile* file = new QFile(paths[b]);
+                (*streamFiles)[b] = file;
+                if (!file->open(QIODevice::WriteOnly | QIODevice::Append)) {
+                    m_sLastError = QString("exportGLB: cannot open '%1'").arg(file->fileName());
+                    closeStreamFiles(*streamFiles);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // ---- one GLB: header, JSON chunk, BIN chunk --------------------------
+    QStringList paths;
+    paths << outputPath;
+    QVector<bool> dirty;
+    QElapsedTimer timer;
+    timer.start();
+    QByteArray jsonPadded = buildJSON(layout, scene, channels);
+    GltfMemoryHold jsonHold(GltfMemoryJson, jsonPadded.size());
+    m_lastTimings.jsonMs = elapsedMs(timer);
+    m_bLastWriteIncremental = incremental && diffPatchIndex(index, layout, paths, dirty)
+                           && (quint64)jsonPadded.size() <= index.jsonChunkBytes;
+    if (m_bLastWriteIncremental)
+        jsonPadded.append(QByteArray((int)index.jsonChunkBytes - jsonPadded.size(), ' '));
+    else if (m_bIncrementalUpdate && !streamFiles)
+        jsonPadded.append(QByteArray((kJsonSlackBytes - jsonPadded.size() % kJsonSlackBytes)
+                                     % kJsonSlackBytes, ' '));
+
+    quint64    binLength  = layout.buffers.isEmpty() ? 0 : layout.buffers[0].byteLength();
+    quint64    totalLen   = 12 + 8 + (quint64)jsonPadded.size() + (binLength ? 8 + binLength : 0);
+    if (totalLen > 0xFFFFFFFFull) {
+        m_sLastError = "exportGLB: output exceeds the 4 GB GLB limit; use split buffers (.gltf + .bin)";
+        return false;
+    }
+
+    QByteArray prefix   = glbPrefix(jsonPadded, (quint32)binLength);
+    quint64    binStart = (quint64)prefix.size();
+    quint64    dataEnd  = binStart + (layout.buffers.isEmpty() ? 0 : layout.buffers[0].dataBytes);
+    {
+        // a patch keeps the file and overwrites the header and JSON in place
+        QFile file(outputPath);
+        bool opened = m_bLastWriteIncremental ? file.open(QIODevice::ReadWrite)
+                                              : file.open(QIODevice::WriteOnly);
+        if (!opened
+            || file.write(prefix) != prefix.size()
+            || (!m_bLastWriteIncremental && !file.resize((qint64)dataEnd))) {
+            m_sLastError = QString("exportGLB: cannot open '%1'").arg(outputPath);
+            return false;
+        }
+        m_nLastBytesWritten += prefix.size();
+    }
+    timer.restart();
+    bool written = layout.buffers.isEmpty()
+                || writeBuffers(layout, paths, QVector<quint64>(1, binStart),
+                                m_bLastWriteIncremental ? &dirty : 0);
+    m_lastTimings.buffersMs = elapsedMs(timer);
+    if (!written) {
+        QFile::remove(patchIndexPath(outputPath));
+        if (*m_pCancel)
+            removeFiles(paths);
+        return false;
+    }
+    if (m_bIncrementalUpdate && !streamFiles)
+        savePatchIndex(outputPath, layout, paths, (quint64)jsonPadded.size());
+
+    if (streamFiles) {
+        QFile* file = new QFile(outputPath);
+        streamFiles->fill(0, 1);
+        (*streamFiles)[0] = file;
+        if (!file->open(QIODevice::ReadWrite) || !file->seek((qint64)dataEnd)) {
+            m_sLastError = QString("exportGLB: cannot open '%1'").arg(outputPath);
+            closeStreamFiles(*streamFiles);
+            return false;
+        }
+    }
+    return true;
+}
+
+/// A cancelled export leaves no partial files behind.
+void GltfGlbWriter::removeFiles(const QStringList& paths)
+{
+    for (int i = 0; i < paths.size(); ++i)
+        QFile::remove(paths[i]);
+}
+
+void GltfGlbWriter::closeStreamFiles(QVector<QFile*>& files)
+{
+    for (int f = 0; f < files.size(); ++f) {
+        if (!files[f])
+            continue;
+        files[f]->close();
+        delete files[f];
+    }
+    files.clear();
+}
+
+// ---------------------------------------------------------------------------
+// Binary helpers
+// ---------------------------------------------------------------------------
+
+void GltfGlbWriter::appendFloat32LE(QByteArray& buf, float v)
+{
+    quint32 bits;
+    memcpy(&bits, &v, sizeof(bits));
+    appendUint32LE(buf, bits);
+}
+
+void GltfGlbWriter::appendUint32LE(QByteArray& buf, quint32 v)
+{
+    buf.append((char)( v        & 0xFF));
+    buf.append((char)((v >>  8) & 0xFF));
+    buf.append((char)((v >> 16) & 0xFF));
+    buf.append((char)((v >> 24) & 0xFF));
+}
+
+void GltfGlbWriter::appendInt16LE(QByteArray& buf, qint16 v)
+{
+    quint16 bits = (quint16)v;
+    buf.append((char)( bits       & 0xFF));
+    buf.append((char)((bits >> 8) & 0xFF));
+}
+
+QByteArray GltfGlbWriter::padTo4(const QByteArray& data, char padByte)
+{
+    QByteArray result = data;
+    int rem = result.size() % 4;
+    if (rem != 0) result.append(QByteArray(4 - rem, padByte));
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// JSON helpers
+// ---------------------------------------------------------------------------
+
+QString GltfGlbWriter::jsonFloat(float v)
+{
+    return QString::number((double)v, 'f', 6);
+}
+
+QString GltfGlbWriter::jsonVec3(float x, float y, float z)
+{
+    return QString("[%1,%2,%3]").arg(jsonFloat(x)).arg(jsonFloat(y)).arg(jsonFloat(z));
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+#include <QAtomicInt>
+
+#include "GltfTypes.h"
+#include "GltfKeyframeReducer.h"
+
+class QFile;
+class GltfAnimationStream;
+class GltfBufferPool;
+
+/// Wall-clock split of one write, in milliseconds.
+struct GltfWriteTimings
+{
+    double layoutMs;    // accessors, views and buffer placement
+    double jsonMs;      // the JSON document
+    double buffersMs;   // encoding buffer data, and writing it to disk if it goes there
+
+    GltfWriteTimings() : layoutMs(0.0), jsonMs(0.0), buffersMs(0.0) {}
+};
+
+/// What the last write put in the file, counted while building its JSON.
+struct GltfSceneStats
+{
+    int         primitives;
+    int         meshes;         // LOD meshes included
+    int         nodes;
+    int         joints;         // over all skins
+    qint64      vertices;       // glTF vertices: one per triangle corner
+    qint64      triangles;
+    int         materials;
+    QStringList textures;       // image paths, each once
+
+    GltfSceneStats()
+        : primitives(0), meshes(0), nodes(0), joints(0)
+        , vertices(0), triangles(0), materials(0) {}
+};
+
+/// Serialises a GltfSceneData as GLB (binary glTF 2.0), or as .gltf plus
+/// categorised .bin files.  No external libraries required.
+///
+/// The whole layout is decided first; buffer data is then encoded and
+/// written at its final offsets by parallel tasks, straight from the scene,
+/// through pooled scratch blocks.  Optionally a sidecar index lets a
+/// re-export patch only the ranges that changed.
+///
+/// SDK-free: the Daz Studio exporter drives it, and so do the tests.
+class GltfGlbWriter
+{
+public:
+    /// Split output writes each category to its own run of .bin files.
+    enum BufferCategory { GeometryBuffer, MorphBuffer, AnimationBuffer, BufferCategoryCount };
+
+    GltfGlbWriter();
+    ~GltfGlbWriter();
+
+    /// Write @p scene and @p channels (already reduced) to @p outputPath.
+    bool write(const GltfSceneData& scene, const QVector<GltfAnimChannel>& channels,
+               const QString& outputPath);
+
+    /// As write(), with the animation keys copied from a finished
+    /// @p stream after the rest of the data rather than held in memory.
+    bool writeStreamed(const GltfSceneData& scene, GltfAnimationStream& stream,
+                       const QString& outputPath);
+
+    /// The GLB that write() would produce, built in memory; split and
+    /// incremental settings are ignored.  Fails past 2 GB.
+    bool writeToBuffer(const GltfSceneData& scene, const QVector<GltfAnimChannel>& channels,
+                       QByteArray& outGlb);
+
+    QString getLastError() const { return m_sLastError; }
+
+    /// Where the time of the last write went.
+    const GltfWriteTimings& getLastTimings() const { return m_lastTimings; }
+
+    /// Counts of what the last write contained.
+    const GltfSceneStats& getLastStats() const { return m_lastStats; }
+
+    /// Write a JSON .gltf (at the given output path) plus external .bin
+    /// buffers instead of one .glb.  Geometry, morphs and animation go to
+    /// separate files named "<name>_<category><n>.bin", each capped at
+    /// setMaxBufferBytes() and written concurrently.  Lifts GLB's 4 GB limit.
+    void setSplitBuffers(bool b) { m_bSplitBuffers = b; }
+    bool getSplitBuffers() const { return m_bSplitBuffers; }
+
+    /// Largest .bin in split output; a single accessor larger than this
+    /// gets a file of its own.  0 = one file per category.
+    void setMaxBufferBytes(qint64 bytes) { m_nMaxBufferBytes = bytes; }
+    qint64 getMaxBufferBytes() const { return m_nMaxBufferBytes; }
+
+    /// Keep a hidden sidecar index (".<file>.idx") of every buffer range and
+    /// its content hash, and patch unchanged layouts in place.
+    void setIncrementalUpdate(bool b) { m_bIncrementalUpdate = b; }
+    bool getIncrementalUpdate() const { return m_bIncrementalUpdate; }
+
+    /// Whether the last write patched the existing files, and the bytes it
+    /// wrote (header, JSON and buffer data).
+    bool   getLastWriteIncremental() const { return m_bLastWriteIncremental; }
+    qint64 getLastBytesWritten() const { return m_nLastBytesWritten; }
+
+    /// The .bin files the last split write produced beside its .gltf;
+    /// empty for GLB output.
+    const QStringList& getLastBufferFiles() const { return m_lastBufferFiles; }
+
+    /// Scratch blocks come from this pool; null restores the writer's own.
+    /// Not owned.
+    void setBufferPool(GltfBufferPool* pool);
+    GltfBufferPool* getBufferPool() const { return m_pBufferPool; }
+
+    /// Counters shared with the caller: buffer writes share out what is
+    /// left of @p progress up to 100, and stop once @p cancel is set.
+    /// Null restores the writer's own.  Not owned.
+    void setProgressCounter(QAtomicInt* progress);
+    void setCancelFlag(const QAtomicInt* cancel);
+
+private:
+    QString m_sLastError;
+    bool    m_bSplitBuffers;
+    qint64  m_nMaxBufferBytes;
+    bool    m_bIncrementalUpdate;
+    bool    m_bLastWriteIncremental;
+    qint64  m_nLastBytesWritten;
+    QStringList       m_lastBufferFiles;
+    GltfWriteTimings  m_lastTimings;
+    GltfSceneStats    m_lastStats;
+    GltfBufferPool*   m_pOwnBufferPool;
+    GltfBufferPool*   m_pBufferPool;
+    QAtomicInt        m_ownProgress;
+    QAtomicInt        m_ownCancel;
+    QAtomicInt*       m_pProgress;
+    const QAtomicInt* m_pCancel;
+
+    void beginWrite();
+    bool writeCancelled();
+
+    // ---- layout ----
+    struct GlbLayout;
+    static int bufferFor(GlbLayout& layout, quint64 bytes, bool reserved);
+    static int placeView(GlbLayout& layout, quint64 bytes, const void* src,
+                         int values, int kind, int target);
+    static int appendFloatAccessor(GlbLayout& layout, const float* data,
+                                   int count, int numComps, int target,
+                                   bool withMinMax);
+    static int appendQuatInt16Accessor(GlbLayout& layout, const float* data,
+                                       int count);
+    static int appendUint16Accessor(GlbLayout& layout, const quint16* data,
+                                    int count, int numComps, int target);
+    static int reserveAccessor(GlbLayout& layout, int count, int numComps,
+                               int componentType, bool normalized,
+                               const float* minV, const float* maxV);
+    static void appendMeshAccessors(GlbLayout& layout,
+                                    const QVector<GltfPrimData>& prims);
+    static void appendInstanceAccessors(GlbLayout& layout,
+                                        const QVector<GltfNodeData>& nodes);
+    static void appendSkinAccessors(GlbLayout& layout,
+                                    const QVector<GltfSkinData>& skins);
+    static void appendAnimationAccessors(GlbLayout& layout,
+                                         const QVector<GltfAnimChannel>& channels);
+    void beginLayout(GlbLayout& layout) const;
+
+    // ---- output ----
+    bool writeLayout(GlbLayout& layout, const GltfSceneData& scene,
+                     const QVector<GltfAnimChannel>& channels,
+                     const QString& outputPath, QVector<QFile*>* streamFiles);
+    bool writeBuffers(const GlbLayout& layout, const QStringList& paths,
+                      const QVector<quint64>& bases, const QVector<bool>* dirty);
+    static void removeFiles(const QStringList& paths);
+    static void closeStreamFiles(QVector<QFile*>& files);
+    struct WriteTask;
+    friend struct WriteTask;
+    struct PackTask;
+    friend struct PackTask;
+
+    // ---- incremental writes ----
+    struct PatchIndex;
+    struct HashTask;
+    friend struct HashTask;
+    static QString patchIndexPath(const QString& outputPath);
+    static void hashJobs(GlbLayout& layout);
+    static bool loadPatchIndex(const QString& outputPath, PatchIndex& index);
+    static void savePatchIndex(const QString& outputPath, const GlbLayout& layout,
+                               const QStringList& paths, quint64 jsonChunkBytes);
+    static bool diffPatchIndex(const PatchIndex& index, const GlbLayout& layout,
+                               const QStringList& paths, QVector<bool>& dirty);
+    QByteArray buildJSON(const GlbLayout& layout, const GltfSceneData& scene,
+                         const QVector<GltfAnimChannel>& channels);
+    static QByteArray glbPrefix(const QByteArray& jsonPadded, quint32 binPaddedSize);
+    bool writeFile(const QString& outputPath, const QByteArray& data);
+
+    // ---- binary helpers ----
+    static void appendFloat32LE(QByteArray& buf, float v);
+    static void appendUint32LE (QByteArray& buf, quint32 v);
+    static void appendInt16LE  (QByteArray& buf, qint16 v);
+    static QByteArray padTo4(const QByteArray& data, char padByte);
+
+    // ---- JSON helpers ----
+    static QString jsonFloat(float v);
+    static QString jsonVec3(float x, float y, float z);
+};
@@ -0,0 +1,144 @@
+// GltfHash.cpp
+// XXH64, written out from the reference description.  Byte order is taken
+// as little-endian, which holds on every platform Daz Studio ships for.
+
+#include "GltfHash.h"
+
+#include <cstring>
+
+static const quint64 kPrime1 = 11400714785074694791ULL;
+static const quint64 kPrime2 = 14029467366897019727ULL;
+static const quint64 kPrime3 =  1609587929392839161ULL;
+static const quint64 kPrime4 =  9650029242287828579ULL;
+static const quint64 kPrime5 =  2870177450012600261ULL;
+
+static inline quint64 rotl64(quint64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline quint64 read64(const uchar* p)
+{
+    quint64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline quint32 read32(const uchar* p)
+{
+    quint32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline quint64 round64(quint64 acc, quint64 input)
+{
+    acc += input * kPrime2;
+    acc  = rotl64(acc, 31);
+    return acc * kPrime1;
+}
+
+static inline quint64 mergeRound(quint64 acc, quint64 val)
+{
+    acc ^= round64(0, val);
+    return acc * kPrime1 + kPrime4;
+}
+
+// ---------------------------------------------------------------------------
+// Construction
+// ---------------------------------------------------------------------------
+
+GltfHasher::GltfHasher(quint64 seed)
+    : m_seed(seed)
+    , m_totalLength(0)
+    , m_bufferLength(0)
+{
+    m_acc[0] = seed + kPrime1 + kPrime2;
+    m_acc[1] = seed + kPrime2;
+    m_acc[2] = seed;
+    m_acc[3] = seed - kPrime1;
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+void GltfHasher::update(const void* data, qint64 length)
+{
+    if (!data || length <= 0)
+        return;
+
+    const uchar* p   = (const uchar*)data;
+    const uchar* end = p + length;
+    m_totalLength += (quint64)length;
+
+    // top up a partial stripe first
+    if (m_bufferLength > 0) {
+        int take = (int)qMin<qint64>(32 - m_bufferLength, end - p);
+        memcpy(m_buffer + m_bufferLength, p, take);
+        m_bufferLength += take;
+        p += take;
+        if (m_bufferLength < 32)
+            return;
+        for (int i = 0; i < 4; ++i)
+            m_acc[i] = round64(m_acc[i], read64(m_buffer + i * 8));
+        m_bufferLength = 0;
+    }
+
+    while (end - p >= 32) {
+        for (int i = 0; i < 4; ++i)
+            m_acc[i] = round64(m_acc[i], read64(p + i * 8));
+        p += 32;
+    }
+
+    if (p < end) {
+        m_bufferLength = (int)(end - p);
+        memcpy(m_buffer, p, m_bufferLength);
+    }
+}
+
+quint64 GltfHasher::digest() const
+{
+    quint64 h;
+    if (m_totalLength >= 32) {
+        h = rotl64(m_acc[0], 1) + rotl64(m_acc[1], 7)
+          + rotl64(m_acc[2], 12) + rotl64(m_acc[3], 18);
+        for (int i = 0; i < 4; ++i)
+            h = mergeRound(h, m_acc[i]);
+    } else {
+        h = m_seed + kPrime5;
+    }
+    h += m_totalLength;
+
+    const uchar* p   = m_buffer;
+    const uchar* end = m_buffer + m_bufferLength;
+    while (end - p >= 8) {
+        h ^= round64(0, read64(p));
+        h  = rotl64(h, 27) * kPrime1 + kPrime4;
+        p += 8;
+    }
+    if (end - p >= 4) {
+        h ^= (quint64)read32(p) * kPrime1;
+        h  = rotl64(h, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (quint64)(*p) * kPrime5;
+        h  = rotl64(h, 11) * kPrime1;
+        ++p;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+quint64 GltfHasher::hash(const void* data, qint64 length, quint64 seed)
+{
+    GltfHasher h(seed);
+    h.update(data, length);
+    return h.digest();
+}
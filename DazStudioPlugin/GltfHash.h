@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QString>
+#include <QByteArray>
+
+/// Streaming 64-bit content hash (the XXH64 algorithm).
+///
+/// Used to recognise identical geometry across scene nodes.  Not a
+/// cryptographic hash; equal digests are treated as equal content.
+class GltfHasher
+{
+public:
+    explicit GltfHasher(quint64 seed = 0);
+
+    void update(const void* data, qint64 length);
+    void update(const QByteArray& data) { update(data.constData(), data.size()); }
+    void update(const QString& s)        { update(s.constData(), (qint64)s.size() * sizeof(QChar)); }
+    void updateInt(qint64 v)             { update(&v, sizeof(v)); }
+    void updateFloat(float v)            { update(&v, sizeof(v)); }
+
+    /// Digest of everything fed so far.  Does not reset the hasher.
+    quint64 digest() const;
+
+    /// One-shot convenience.
+    static quint64 hash(const void* data, qint64 length, quint64 seed = 0);
+
+private:
+    quint64 m_seed;
+    quint64 m_acc[4];
+    quint64 m_totalLength;
+    uchar   m_buffer[32];
+    int     m_bufferLength;
+};
@@ -0,0 +1,241 @@
+// GltfJson.cpp
+// Recursive-descent JSON parser (RFC 8259) for reading back glTF.
+
+#include "GltfJson.h"
+
+// Deeper nesting than any glTF needs; guards the recursion against hostile
+// input.
+static const int kMaxDepth = 256;
+
+static const GltfJsonValue& nullJsonValue()
+{
+    static const GltfJsonValue value;
+    return value;
+}
+
+int GltfJsonValue::size() const
+{
+    if (m_type == Array)  return m_array.size();
+    if (m_type == Object) return m_object.size();
+    return 0;
+}
+
+const GltfJsonValue& GltfJsonValue::at(int i) const
+{
+    if (m_type != Array || i < 0 || i >= m_array.size())
+        return nullJsonValue();
+    return m_array[i];
+}
+
+const GltfJsonValue& GltfJsonValue::operator[](const QString& key) const
+{
+    QMap<QString, GltfJsonValue>::const_iterator it = m_object.constFind(key);
+    return it == m_object.constEnd() ? nullJsonValue() : it.value();
+}
+
+// ---------------------------------------------------------------------------
+// Parser
+// ---------------------------------------------------------------------------
+
+struct GltfJsonValue::Parser
+{
+    const char* begin;
+    const char* p;
+    const char* end;
+    QString     error;
+
+    bool fail(const char* what)
+    {
+        if (error.isEmpty())
+            error = QString("JSON: %1 at offset %2").arg(what).arg(p - begin);
+        return false;
+    }
+
+    void skipSpace()
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            ++p;
+    }
+
+    bool literal(const char* word)
+    {
+        const char* q = p;
+        for (; *word; ++word, ++q)
+            if (q >= end || *q != *word)
+                return fail("bad literal");
+        p = q;
+        return true;
+    }
+
+    bool hex4(uint& out)
+    {
+        if (end - p < 4)
+            return fail("truncated \\u escape");
+        out = 0;
+        for (int i = 0; i < 4; ++i, ++p) {
+            char c = *p;
+            out <<= 4;
+            if      (c >= '0' && c <= '9') out |= c - '0';
+            else if (c >= 'a' && c <= 'f') out |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') out |= c - 'A' + 10;
+            else return fail("bad \\u escape");
+        }
+        return true;
+    }
+
+    bool string(QString& out)
+    {
+        ++p;                                    // opening quote
+        QByteArray utf8;
+        while (true)
+        {
+            const char* run = p;
+            while (p < end && *p != '"' && *p != '\\' && (uchar)*p >= 0x20)
+                ++p;
+            utf8.append(run, int(p - run));
+            if (p >= end)
+                return fail("unterminated string");
+            if (*p == '"')
+                break;
+            if (*p != '\\')
+                return fail("control character in string");
+
+            if (++p >= end)
+                return fail("unterminated string");
+            char c = *p++;
+            switch (c) {
+                case '"':  utf8.append('"');  break;
+                case '\\': utf8.append('\\'); break;
+                case '/':  utf8.append('/');  break;
+                case 'b':  utf8.append('\b'); break;
+                case 'f':  utf8.append('\f'); break;
+                case 'n':  utf8.append('\n'); break;
+                case 'r':  utf8.append('\r'); break;
+                case 't':  utf8.append('\t'); break;
+                case 'u': {
+                    uint code;
+                    if (!hex4(code))
+                        return false;
+                    QString s;
+                    if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                        p += 2;
+                        uint low;
+                        if (!hex4(low))
+                            return false;
+                        s.append(QChar((ushort)code));
+                        s.append(QChar((ushort)low));
+                    } else {
+                        s.append(QChar((ushort)code));
+                    }
+                    utf8.append(s.toUtf8());
+                    break;
+                }
+                default:
+                    return fail("bad escape");
+            }
+        }
+        ++p;                                    // closing quote
+        out = QString::fromUtf8(utf8.constData(), utf8.size());
+        return true;
+    }
+
+    bool number(GltfJsonValue& out)
+    {
+        const char* start = p;
+        if (p < end && *p == '-') ++p;
+        while (p < end && ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e'
+                           || *p == 'E' || *p == '+' || *p == '-'))
+            ++p;
+        bool ok = false;
+        // QByteArray::toDouble() ignores the C locale, unlike strtod().
+        out.m_number = QByteArray(start, int(p - start)).toDouble(&ok);
+        if (!ok)
+            return fail("bad number");
+        out.m_type = Number;
+        return true;
+    }
+
+    bool value(GltfJsonValue& out, int depth)
+    {
+        if (depth > kMaxDepth)
+            return fail("nesting too deep");
+        skipSpace();
+        if (p >= end)
+            return fail("unexpected end");
+
+        switch (*p) {
+            case 'n': return literal("null");
+            case 't': out.m_type = Bool; out.m_bool = true;  return literal("true");
+            case 'f': out.m_type = Bool; out.m_bool = false; return literal("false");
+            case '"': out.m_type = String; return string(out.m_string);
+            case '[': return array(out, depth);
+            case '{': return object(out, depth);
+            default:  return number(out);
+        }
+    }
+
+    bool array(GltfJsonValue& out, int depth)
+    {
+        out.m_type = Array;
+        ++p;
+        skipSpace();
+        if (p < end && *p == ']') { ++p; return true; }
+        while (true)
+        {
+            out.m_array.append(GltfJsonValue());
+            if (!value(out.m_array.last(), depth + 1))
+                return false;
+            skipSpace();
+            if (p < end && *p == ',') { ++p; continue; }
+            if (p < end && *p == ']') { ++p; return true; }
+            return fail("expected ',' or ']'");
+        }
+    }
+
+    bool object(GltfJsonValue& out, int depth)
+    {
+        out.m_type = Object;
+        ++p;
+        skipSpace();
+        if (p < end && *p == '}') { ++p; return true; }
+        while (true)
+        {
+            skipSpace();
+            if (p >= end || *p != '"')
+                return fail("expected member name");
+            QString key;
+            if (!string(key))
+                return false;
+            skipSpace();
+            if (p >= end || *p != ':')
+                return fail("expected ':'");
+            ++p;
+            if (!value(out.m_object[key], depth + 1))
+                return false;
+            skipSpace();
+            if (p < end && *p == ',') { ++p; continue; }
+            if (p < end && *p == '}') { ++p; return true; }
+            return fail("expected ',' or '}'");
+        }
+    }
+};
+
+bool GltfJsonValue::parse(const QByteArray& text, GltfJsonValue& out, QString& error)
+{
+    Parser parser;
+    parser.begin = parser.p = text.constData();
+    parser.end   = parser.begin + text.size();
+
+    out = GltfJsonValue();
+    bool ok = parser.value(out, 0);
+    if (ok) {
+        // GLB pads the JSON chunk with spaces; anything else is an error.
+        parser.skipSpace();
+        while (parser.p < parser.end && *parser.p == '\0')
+            ++parser.p;
+        if (parser.p != parser.end)
+            ok = parser.fail("trailing characters");
+    }
+    error = parser.error;
+    return ok;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+
+/// Read-only JSON document tree, just enough to read back glTF.
+///
+/// Qt 4 has no JSON classes and the core may not pull in a library for
+/// it.  Numbers are doubles; a missing key or index yields a Null value,
+/// so lookups chain without checks: doc["meshes"].at(0)["name"].toString().
+class GltfJsonValue
+{
+public:
+    enum Type { Null, Bool, Number, String, Array, Object };
+
+    GltfJsonValue() : m_type(Null), m_bool(false), m_number(0.0) {}
+
+    /// Parse UTF-8 @p text.  False, with @p error set, on malformed input.
+    static bool parse(const QByteArray& text, GltfJsonValue& out, QString& error);
+
+    Type type() const     { return m_type; }
+    bool isNull() const   { return m_type == Null; }
+    bool isArray() const  { return m_type == Array; }
+    bool isObject() const { return m_type == Object; }
+
+    bool    toBool(bool def = false) const      { return m_type == Bool ? m_bool : def; }
+    double  toDouble(double def = 0.0) const    { return m_type == Number ? m_number : def; }
+    int     toInt(int def = 0) const            { return m_type == Number ? (int)m_number : def; }
+    qint64  toInt64(qint64 def = 0) const       { return m_type == Number ? (qint64)m_number : def; }
+    QString toString() const                    { return m_string; }
+
+    /// Elements of an array, members of an object; 0 otherwise.
+    int size() const;
+
+    const GltfJsonValue& at(int i) const;
+    const GltfJsonValue& operator[](const QString& key) const;
+    bool contains(const QString& key) const { return m_object.contains(key); }
+    QStringList keys() const { return m_object.keys(); }
+
+private:
+    Type                          m_type;
+    bool                          m_bool;
+    double                        m_number;
+    QString                       m_string;
+    QList<GltfJsonValue>          m_array;
+    QMap<QString, GltfJsonValue>  m_object;
+
+    struct Parser;
+    friend struct Parser;
+};
@@ -0,0 +1,273 @@
+// GltfKeyframeReducer.cpp
+// Error-bounded keyframe reduction for the glTF animation path.
+//
+// Daz bakes one key per frame for every bone property, most of which are
+// either constant or lie on a straight line (slerp arc for rotations).
+// The reducer keeps only the keys needed to stay within tolerance.
+
+#include "GltfKeyframeReducer.h"
+#include "GltfTrace.h"
+
+#include <QtCore/qtconcurrentmap.h>
+
+#include <cmath>
+
+static const float kSqrt2    = 1.41421356f;
+static const float kInvSqrt2 = 0.70710678f;
+
+// ---------------------------------------------------------------------------
+// Construction
+// ---------------------------------------------------------------------------
+
+GltfKeyframeReducer::GltfKeyframeReducer(const GltfKeyReductionOptions& options)
+    : m_options(options)
+{
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+namespace
+{
+    struct ReduceTask
+    {
+        typedef void result_type;
+
+        const GltfKeyframeReducer* reducer;
+        GltfAnimChannel*           channels;
+        char*                      keep;
+
+        void operator()(int& i) const
+        {
+            keep[i] = reducer->reduceChannel(channels[i]) ? 1 : 0;
+        }
+    };
+}
+
+GltfKeyReductionStats GltfKeyframeReducer::reduce(QVector<GltfAnimChannel>& channels) const
+{
+    GltfTraceScope trace("reduceKeyframes", "animation");
+    GltfKeyReductionStats stats;
+    stats.channelsIn = channels.size();
+    for (int i = 0; i < channels.size(); ++i)
+        stats.keysIn += channels[i].keyCount();
+
+    if (!m_options.enabled) {
+        stats.channelsOut = stats.channelsIn;
+        stats.keysOut     = stats.keysIn;
+        return stats;
+    }
+
+    QVector<int>  indices(channels.size());
+    QByteArray    keep(channels.size(), 1);
+    for (int i = 0; i < indices.size(); ++i)
+        indices[i] = i;
+
+    ReduceTask task;
+    task.reducer  = this;
+    task.channels = channels.data();   // detach once, before the workers start
+    task.keep     = keep.data();
+    QtConcurrent::blockingMap(indices, task);
+
+    QVector<GltfAnimChannel> kept;
+    kept.reserve(channels.size());
+    for (int i = 0; i < channels.size(); ++i) {
+        if (!keep[i])
+            continue;
+        stats.keysOut += channels[i].keyCount();
+        kept.append(channels[i]);
+    }
+    stats.channelsOut = kept.size();
+    channels = kept;
+    return stats;
+}
+
+bool GltfKeyframeReducer::reduceChannel(GltfAnimChannel& ch) const
+{
+    const int n     = ch.keyCount();
+    const int comps = ch.componentCount();
+    if (n == 0 || ch.values.size() != n * comps)
+        return false;
+
+    float* vals = ch.values.data();
+
+    if (ch.path == GltfAnimChannel::Rotation) {
+        for (int k = 0; k < n; ++k) {
+            float* q = vals + k * 4;
+            if (m_options.quantizeRotations)
+                unpackSmallestThree(packSmallestThree(q), q);
+            // Keep consecutive keys on the same hemisphere so slerp
+            // between them takes the short arc.
+            if (k > 0) {
+                const float* p = q - 4;
+                if (p[0]*q[0] + p[1]*q[1] + p[2]*q[2] + p[3]*q[3] < 0.0f) {
+                    q[0] = -q[0]; q[1] = -q[1]; q[2] = -q[2]; q[3] = -q[3];
+                }
+            }
+        }
+        ch.quantized = m_options.quantizeRotations;
+    }
+
+    const float tol = toleranceFor(ch);
+
+    // ---- constant channel ------------------------------------------------
+    bool constant = true;
+    for (int k = 1; k < n && constant; ++k)
+        constant = keyError(ch, vals, vals + k * comps) <= tol;
+
+    if (constant) {
+        if (keyError(ch, vals, ch.restValue) <= tol)
+            return false;
+        ch.times.resize(1);
+        ch.values.resize(comps);
+        return true;
+    }
+
+    // ---- greedy linear fit ----------------------------------------------
+    QVector<int> keptIdx;
+    keptIdx.append(0);
+
+    int anchor = 0;
+    float interp[4];
+    for (int end = 2; end < n; ++end)
+    {
+        bool fits = (end - anchor) <= kMaxSpanKeys;
+        const float* a  = vals + anchor * comps;
+        const float* b  = vals + end * comps;
+        const float  t0 = ch.times[anchor];
+        const float  dt = ch.times[end] - t0;
+
+        for (int k = anchor + 1; k < end && fits; ++k) {
+            float t = dt > 0.0f ? (ch.times[k] - t0) / dt : 0.0f;
+            interpolate(ch, a, b, t, interp);
+            fits = keyError(ch, interp, vals + k * comps) <= tol;
+        }
+
+        if (!fits) {
+            anchor = end - 1;
+            keptIdx.append(anchor);
+        }
+    }
+    if (n > 1)
+        keptIdx.append(n - 1);
+
+    if (keptIdx.size() == n)
+        return true;
+
+    QVector<float> newTimes(keptIdx.size());
+    QVector<float> newValues(keptIdx.size() * comps);
+    for (int i = 0; i < keptIdx.size(); ++i) {
+        newTimes[i] = ch.times[keptIdx[i]];
+        for (int c = 0; c < comps; ++c)
+            newValues[i * comps + c] = vals[keptIdx[i] * comps + c];
+    }
+    ch.times  = newTimes;
+    ch.values = newValues;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Smallest-three quaternion encoding
+// ---------------------------------------------------------------------------
+
+GltfKeyframeReducer::PackedQuat GltfKeyframeReducer::packSmallestThree(const float* q)
+{
+    int largest = 0;
+    for (int i = 1; i < 4; ++i)
+        if (std::fabs(q[i]) > std::fabs(q[largest]))
+            largest = i;
+
+    // q and -q are the same rotation; make the dropped component positive
+    const float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+
+    PackedQuat p;
+    p.largest = (quint8)largest;
+    int j = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (i == largest)
+            continue;
+        float v = q[i] * sign * kSqrt2 * 0.5f + 0.5f;   // [-1/sqrt2, 1/sqrt2] -> [0, 1]
+        if (v < 0.0f) v = 0.0f;
+        if (v > 1.0f) v = 1.0f;
+        p.c[j++] = (quint16)std::floor(v * 65535.0f + 0.5f);
+    }
+    return p;
+}
+
+void GltfKeyframeReducer::unpackSmallestThree(const PackedQuat& p, float* outQ)
+{
+    float sumSq = 0.0f;
+    int j = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (i == p.largest)
+            continue;
+        float v = ((float)p.c[j++] / 65535.0f - 0.5f) * 2.0f * kInvSqrt2;
+        outQ[i] = v;
+        sumSq  += v * v;
+    }
+    outQ[p.largest] = std::sqrt(sumSq < 1.0f ? 1.0f - sumSq : 0.0f);
+}
+
+// ---------------------------------------------------------------------------
+// Helpers
+// ---------------------------------------------------------------------------
+
+float GltfKeyframeReducer::toleranceFor(const GltfAnimChannel& channel) const
+{
+    switch (channel.path) {
+    case GltfAnimChannel::Rotation: return m_options.rotationTolerance;
+    case GltfAnimChannel::Scale:    return m_options.scaleTolerance;
+    default:                        return m_options.positionTolerance;
+    }
+}
+
+float GltfKeyframeReducer::keyError(const GltfAnimChannel& channel,
+                                    const float* a, const float* b)
+{
+    if (channel.path == GltfAnimChannel::Rotation) {
+        // angle between the two orientations, in radians
+        float d = std::fabs(a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3]);
+        if (d > 1.0f) d = 1.0f;
+        return 2.0f * std::acos(d);
+    }
+    float dx = a[0]-b[0], dy = a[1]-b[1], dz = a[2]-b[2];
+    return std::sqrt(dx*dx + dy*dy + dz*dz);
+}
+
+void GltfKeyframeReducer::interpolate(const GltfAnimChannel& channel,
+                                      const float* a, const float* b,
+                                      float t, float* out)
+{
+    if (channel.path != GltfAnimChannel::Rotation) {
+        for (int c = 0; c < 3; ++c)
+            out[c] = a[c] + (b[c] - a[c]) * t;
+        return;
+    }
+
+    // slerp, matching the glTF LINEAR interpolation for rotations
+    float d = a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3];
+    float sb = 1.0f;
+    if (d < 0.0f) { d = -d; sb = -1.0f; }
+
+    float wa, wb;
+    if (d > 0.9995f) {
+        wa = 1.0f - t;
+        wb = t;
+    } else {
+        float theta = std::acos(d);
+        float s     = std::sin(theta);
+        wa = std::sin((1.0f - t) * theta) / s;
+        wb = std::sin(t * theta) / s;
+    }
+    wb *= sb;
+
+    float len = 0.0f;
+    for (int c = 0; c < 4; ++c) {
+        out[c] = a[c] * wa + b[c] * wb;
+        len   += out[c] * out[c];
+    }
+    len = std::sqrt(len);
+    if (len > 1e-8f)
+        for (int c = 0; c < 4; ++c) out[c] /= len;
+}
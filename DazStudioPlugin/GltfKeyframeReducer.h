@@ -0,0 +1,99 @@
+#pragma once
+
+#include <QVector>
+
+/// One sampled animation channel (one node property over time).
+struct GltfAnimChannel
+{
+    enum Path { Translation = 0, Rotation = 1, Scale = 2 };
+
+    int   node;                  // index into the exporter's node list
+    Path  path;
+    QVector<float> times;        // seconds, strictly increasing
+    QVector<float> values;       // componentCount() floats per key
+    float restValue[4];          // node's static value for this path
+    bool  quantized;             // rotations snapped to smallest-three 16-bit
+
+    GltfAnimChannel() : node(-1), path(Translation), quantized(false)
+    {
+        restValue[0] = restValue[1] = restValue[2] = 0.0f;
+        restValue[3] = 1.0f;
+    }
+
+    int componentCount() const { return path == Rotation ? 4 : 3; }
+    int keyCount() const { return times.size(); }
+};
+
+/// Tolerances and switches for GltfKeyframeReducer.
+struct GltfKeyReductionOptions
+{
+    bool  enabled;
+    float positionTolerance;     // metres (after exporter scale)
+    float rotationTolerance;     // radians
+    float scaleTolerance;        // unitless
+    bool  quantizeRotations;     // smallest-three 16-bit
+
+    GltfKeyReductionOptions()
+        : enabled(true)
+        , positionTolerance(0.0001f)   // 0.1 mm
+        , rotationTolerance(0.0005f)   // ~0.03 degrees
+        , scaleTolerance(0.0001f)
+        , quantizeRotations(false)
+    {}
+};
+
+/// Before/after key counts reported by GltfKeyframeReducer::reduce().
+struct GltfKeyReductionStats
+{
+    int channelsIn;
+    int channelsOut;
+    int keysIn;
+    int keysOut;
+
+    GltfKeyReductionStats() : channelsIn(0), channelsOut(0), keysIn(0), keysOut(0) {}
+};
+
+/// Error-bounded curve reduction for densely baked animation.
+///
+/// Per channel, in this order:
+///   1. optional smallest-three quantisation of rotation keys
+///   2. constant channels collapse to one key, and are dropped entirely
+///      when that key matches the node's rest value
+///   3. keys that linear interpolation (slerp for rotations) reproduces
+///      within tolerance are removed
+///
+/// Channels are independent, so they are processed on the global thread pool.
+class GltfKeyframeReducer
+{
+public:
+    explicit GltfKeyframeReducer(const GltfKeyReductionOptions& options = GltfKeyReductionOptions());
+
+    /// Reduce @p channels in place.  Dropped channels are removed from the vector.
+    GltfKeyReductionStats reduce(QVector<GltfAnimChannel>& channels) const;
+
+    /// Reduce a single channel.  Returns false if the whole channel can be dropped.
+    bool reduceChannel(GltfAnimChannel& channel) const;
+
+    // ---- smallest-three quaternion encoding ----
+    struct PackedQuat { quint16 c[3]; quint8 largest; };
+    static PackedQuat packSmallestThree(const float* q);
+    static void unpackSmallestThree(const PackedQuat& p, float* outQ);
+
+    // ---- building blocks, shared with GltfAnimationStream ----
+    const GltfKeyReductionOptions& options() const { return m_options; }
+    float toleranceFor(const GltfAnimChannel& channel) const;
+
+    /// Distance between two keys: metres/units, or radians for rotations.
+    static float keyError(const GltfAnimChannel& channel, const float* a,
+                          const float* b);
+    /// Linear interpolation, slerp for rotations.
+    static void interpolate(const GltfAnimChannel& channel, const float* a,
+                            const float* b, float t, float* out);
+
+    /// Upper bound on the number of keys one interpolated span may cover.
+    /// Keeps the greedy fit O(keys * span) on long, perfectly linear takes.
+    static const int kMaxSpanKeys = 512;
+
+private:
+    GltfKeyReductionOptions m_options;
+};
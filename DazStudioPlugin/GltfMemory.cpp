@@ -0,0 +1,303 @@
+// GltfMemory.cpp
+// Resident-memory sampling and tracked-buffer accounting per export phase.
+
+#include "GltfMemory.h"
+
+#include <QtCore/qatomic.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qtextstream.h>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_MAC)
+#include <mach/mach.h>
+#include <sys/resource.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#include <cstdio>
+#endif
+
+namespace
+{
+    QAtomicInt s_enabled;
+
+    QMutex                   s_mutex;
+    qint64                   s_live[GltfMemoryCategoryCount];  // zero-initialised (static storage)
+    QVector<GltfMemoryPhase> s_phases;
+    QVector<int>             s_open;    // indices into s_phases, innermost last
+
+    qint64 liveTotal()
+    {
+        qint64 total = 0;
+        for (int c = 0; c < GltfMemoryCategoryCount; ++c)
+            total += s_live[c];
+        return total;
+    }
+
+    QString mb(qint64 bytes)
+    {
+        return QString::number(bytes / (1024.0 * 1024.0), 'f', 1);
+    }
+
+    QString megabytes(qint64 bytes)
+    {
+        return mb(bytes) + " MB";
+    }
+
+    QString column(const QString& text)
+    {
+        return text.rightJustified(12);
+    }
+}
+
+qint64 GltfMemoryPhase::totalAllocatedBytes() const
+{
+    qint64 total = 0;
+    for (int c = 0; c < GltfMemoryCategoryCount; ++c)
+        total += allocatedBytes[c];
+    return total;
+}
+
+void GltfMemory::start()
+{
+    QMutexLocker lock(&s_mutex);
+    s_phases.clear();
+    s_open.clear();
+    s_enabled.fetchAndStoreOrdered(1);
+}
+
+void GltfMemory::stop()
+{
+    s_enabled.fetchAndStoreOrdered(0);
+}
+
+bool GltfMemory::isEnabled()
+{
+    return s_enabled != 0;
+}
+
+void GltfMemory::allocated(GltfMemoryCategory category, qint64 bytes)
+{
+    QMutexLocker lock(&s_mutex);
+    s_live[category] += bytes;
+    qint64 total = liveTotal();
+    for (int i = 0; i < s_open.size(); ++i)
+    {
+        GltfMemoryPhase& phase = s_phases[s_open[i]];
+        phase.allocatedBytes[category] += bytes;
+        phase.peakTrackedBytes = qMax(phase.peakTrackedBytes, total);
+    }
+}
+
+void GltfMemory::released(GltfMemoryCategory category, qint64 bytes)
+{
+    QMutexLocker lock(&s_mutex);
+    s_live[category] -= bytes;
+}
+
+qint64 GltfMemory::trackedBytes(int category)
+{
+    QMutexLocker lock(&s_mutex);
+    return category < 0 ? liveTotal() : s_live[category];
+}
+
+void GltfMemory::beginPhase(const char* name)
+{
+    // sample outside the lock; on Windows this is a system call
+    qint64 resident = residentBytes();
+    qint64 peak     = peakResidentBytes();
+
+    QMutexLocker lock(&s_mutex);
+    GltfMemoryPhase phase;
+    phase.name               = name;
+    phase.depth              = s_open.size();
+    phase.residentBeginBytes = resident;
+    phase.peakResidentBytes  = peak;        // replaced by the growth in endPhase()
+    phase.peakTrackedBytes   = liveTotal();
+    s_open.append(s_phases.size());
+    s_phases.append(phase);
+}
+
+void GltfMemory::endPhase()
+{
+    qint64 resident = residentBytes();
+    qint64 peak     = peakResidentBytes();
+
+    QMutexLocker lock(&s_mutex);
+    if (s_open.isEmpty())
+        return;
+    GltfMemoryPhase& phase = s_phases[s_open.last()];
+    s_open.removeLast();
+    phase.residentEndBytes   = resident;
+    phase.peakResidentGrowth = qMax<qint64>(0, peak - phase.peakResidentBytes);
+    phase.peakResidentBytes  = peak;
+}
+
+QVector<GltfMemoryPhase> GltfMemory::phases()
+{
+    QMutexLocker lock(&s_mutex);
+    return s_phases;
+}
+
+QStringList GltfMemory::summary()
+{
+    QVector<GltfMemoryPhase> recorded = phases();
+    QStringList lines;
+
+    int worst = -1;
+    for (int i = 0; i < recorded.size(); ++i)
+        if (recorded[i].peakResidentGrowth > 0
+            && (worst < 0 || recorded[i].peakResidentGrowth > recorded[worst].peakResidentGrowth))
+            worst = i;
+
+    lines << QString("peak resident %1, now %2")
+             .arg(megabytes(peakResidentBytes())).arg(megabytes(residentBytes()));
+    if (worst >= 0)
+        lines << QString("largest rise in peak: %1 (+%2)")
+                 .arg(recorded[worst].name).arg(megabytes(recorded[worst].peakResidentGrowth));
+
+    // top-level phases cover everything the nested ones do
+    qint64 allocated[GltfMemoryCategoryCount] = {};
+    qint64 peakTracked = 0;
+    for (int i = 0; i < recorded.size(); ++i)
+    {
+        if (recorded[i].depth != 0)
+            continue;
+        for (int c = 0; c < GltfMemoryCategoryCount; ++c)
+            allocated[c] += recorded[i].allocatedBytes[c];
+        peakTracked = qMax(peakTracked, recorded[i].peakTrackedBytes);
+    }
+    QStringList parts;
+    for (int c = 0; c < GltfMemoryCategoryCount; ++c)
+        parts << QString("%1 %2").arg(categoryName((GltfMemoryCategory)c)).arg(megabytes(allocated[c]));
+    lines << QString("allocated: %1; peak tracked %2").arg(parts.join(", ")).arg(megabytes(peakTracked));
+    return lines;
+}
+
+bool GltfMemory::writeLog(const QString& path, QString* outError)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        if (outError)
+            *outError = "Cannot open " + path + " for writing: " + file.errorString();
+        return false;
+    }
+
+    QVector<GltfMemoryPhase> recorded = phases();
+    QTextStream out(&file);
+    out << "# Memory per export phase, in MB.  Resident figures are the whole process;\n";
+    out << "# allocated and tracked figures are the exporter's own large buffers.\n";
+    out << QString("Phase").leftJustified(28) << column("Res. Begin") << column("Res. End")
+        << column("Peak") << column("Peak Rise");
+    for (int c = 0; c < GltfMemoryCategoryCount; ++c)
+        out << column(categoryName((GltfMemoryCategory)c));
+    out << column("Tracked Pk") << "\n";
+
+    for (int i = 0; i < recorded.size(); ++i)
+    {
+        const GltfMemoryPhase& p = recorded[i];
+        QString name = QString(p.depth * 2, ' ') + p.name;
+        out << name.leftJustified(28) << column(mb(p.residentBeginBytes))
+            << column(mb(p.residentEndBytes)) << column(mb(p.peakResidentBytes))
+            << column(mb(p.peakResidentGrowth));
+        for (int c = 0; c < GltfMemoryCategoryCount; ++c)
+            out << column(mb(p.allocatedBytes[c]));
+        out << column(mb(p.peakTrackedBytes)) << "\n";
+    }
+
+    out << "\n";
+    QStringList lines = summary();
+    for (int i = 0; i < lines.size(); ++i)
+        out << "# " << lines[i] << "\n";
+    out.flush();
+
+    if (file.error() != QFile::NoError) {
+        if (outError)
+            *outError = "Failed writing " + path + ": " + file.errorString();
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Platform queries
+// ---------------------------------------------------------------------------
+
+qint64 GltfMemory::residentBytes()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return (qint64)counters.WorkingSetSize;
+    return 0;
+#elif defined(Q_OS_MAC)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS)
+        return (qint64)info.resident_size;
+    return 0;
+#else
+    // /proc/self/statm: size resident shared ... in pages
+    long pages = 0;
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (!statm)
+        return 0;
+    if (std::fscanf(statm, "%*s %ld", &pages) != 1)
+        pages = 0;
+    std::fclose(statm);
+    return (qint64)pages * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+qint64 GltfMemory::peakResidentBytes()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return (qint64)counters.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#if defined(Q_OS_MAC)
+    return (qint64)usage.ru_maxrss;             // bytes
+#else
+    return (qint64)usage.ru_maxrss * 1024;      // kilobytes
+#endif
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Helpers
+// ---------------------------------------------------------------------------
+
+qint64 GltfMemory::sizeOf(const QVector<GltfPrimData>& prims)
+{
+    qint64 bytes = 0;
+    for (int p = 0; p < prims.size(); ++p)
+    {
+        const GltfPrimData& prim = prims[p];
+        bytes += (qint64)prim.positions.capacity() * sizeof(float)
+               + (qint64)prim.normals.capacity()   * sizeof(float)
+               + (qint64)prim.texcoords.capacity() * sizeof(float)
+               + (qint64)prim.joints.capacity()    * sizeof(quint16)
+               + (qint64)prim.weights.capacity()   * sizeof(float);
+    }
+    return bytes;
+}
+
+const char* GltfMemory::categoryName(GltfMemoryCategory category)
+{
+    switch (category)
+    {
+    case GltfMemoryPrimitives: return "Primitives";
+    case GltfMemoryBuffers:    return "Buffers";
+    case GltfMemoryJson:       return "JSON";
+    case GltfMemoryDtu:        return "DTU";
+    default:                   return "Other";
+    }
+}
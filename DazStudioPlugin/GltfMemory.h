@@ -0,0 +1,151 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "GltfTypes.h"
+
+/// What a tracked allocation holds.
+enum GltfMemoryCategory
+{
+    GltfMemoryPrimitives,   // expanded GltfPrimData vertex arrays
+    GltfMemoryBuffers,      // encoding scratch blocks (GltfBufferPool)
+    GltfMemoryJson,         // glTF JSON chunk
+    GltfMemoryDtu,          // DTU text built in memory
+    GltfMemoryCategoryCount
+};
+
+/// Memory figures for one phase of an export.
+struct GltfMemoryPhase
+{
+    QString name;
+    int     depth;                  // 0 for top-level phases, +1 per enclosing phase
+    qint64  residentBeginBytes;     // process working set when the phase began
+    qint64  residentEndBytes;       // ... and when it ended
+    qint64  peakResidentBytes;      // process high-water mark when it ended
+    qint64  peakResidentGrowth;     // how far the phase raised that mark
+    qint64  allocatedBytes[GltfMemoryCategoryCount];   // tracked bytes allocated during the phase
+    qint64  peakTrackedBytes;       // most tracked bytes live at once during the phase
+
+    GltfMemoryPhase()
+        : depth(0), residentBeginBytes(0), residentEndBytes(0)
+        , peakResidentBytes(0), peakResidentGrowth(0), peakTrackedBytes(0)
+    {
+        for (int c = 0; c < GltfMemoryCategoryCount; ++c)
+            allocatedBytes[c] = 0;
+    }
+
+    qint64 totalAllocatedBytes() const;
+};
+
+/// Process-wide memory accounting for the export pipeline.
+///
+/// Two sources: the process's resident set as the OS reports it, sampled at
+/// phase boundaries, and the bytes our own large buffers hold, reported by
+/// the code that allocates them.  The second is always counted (a mutex per
+/// buffer, not per element); phases are only recorded between start() and
+/// stop().
+///
+/// Phases are wall-clock windows opened on the main thread.  Work running
+/// in the background at the time (the glTF export during exportHD()) is
+/// charged to whichever phases are open, nested ones included.
+class GltfMemory
+{
+public:
+    /// Drop recorded phases and start recording new ones.
+    static void start();
+    static void stop();
+    static bool isEnabled();
+
+    static void allocated(GltfMemoryCategory category, qint64 bytes);
+    static void released(GltfMemoryCategory category, qint64 bytes);
+
+    /// Tracked bytes live now, in one category or (-1) all of them.
+    static qint64 trackedBytes(int category = -1);
+
+    /// Open / close a phase.  Phases nest; endPhase() closes the innermost.
+    static void beginPhase(const char* name);
+    static void endPhase();
+
+    /// Phases recorded since start(), in the order they began.
+    static QVector<GltfMemoryPhase> phases();
+
+    /// A few lines for the application log: peak resident memory, the phase
+    /// that raised it most, and the tracked totals.
+    static QStringList summary();
+
+    /// Every phase as a table.  False, with @p outError set if given, if
+    /// the file cannot be written.
+    static bool writeLog(const QString& path, QString* outError = 0);
+
+    /// Process working set / its high-water mark, in bytes; 0 if the
+    /// platform will not say.
+    static qint64 residentBytes();
+    static qint64 peakResidentBytes();
+
+    /// Heap bytes held by the vertex arrays of @p prims.
+    static qint64 sizeOf(const QVector<GltfPrimData>& prims);
+
+    static const char* categoryName(GltfMemoryCategory category);
+};
+
+/// Holds @p bytes of tracked memory for its lifetime; set() follows a
+/// buffer that grows or shrinks.
+class GltfMemoryHold
+{
+public:
+    explicit GltfMemoryHold(GltfMemoryCategory category, qint64 bytes = 0)
+        : m_category(category), m_bytes(0)
+    {
+        set(bytes);
+    }
+
+    ~GltfMemoryHold()
+    {
+        set(0);
+    }
+
+    void set(qint64 bytes)
+    {
+        if (bytes > m_bytes)
+            GltfMemory::allocated(m_category, bytes - m_bytes);
+        else if (bytes < m_bytes)
+            GltfMemory::released(m_category, m_bytes - bytes);
+        m_bytes = bytes;
+    }
+
+    qint64 bytes() const { return m_bytes; }
+
+private:
+    Q_DISABLE_COPY(GltfMemoryHold)
+
+    GltfMemoryCategory m_category;
+    qint64             m_bytes;
+};
+
+/// Records its lifetime as one phase.
+///
+///     GltfMemoryPhaseScope memory("Export FBX");
+class GltfMemoryPhaseScope
+{
+public:
+    explicit GltfMemoryPhaseScope(const char* name)
+        : m_open(GltfMemory::isEnabled())
+    {
+        if (m_open)
+            GltfMemory::beginPhase(name);
+    }
+
+    ~GltfMemoryPhaseScope()
+    {
+        if (m_open)
+            GltfMemory::endPhase();
+    }
+
+private:
+    Q_DISABLE_COPY(GltfMemoryPhaseScope)
+
+    bool m_open;
+};
@@ -0,0 +1,402 @@
+// GltfMeshSimplifier.cpp
+// Progressive half-edge collapse driven by vertex quadrics.  Replaces the
+// UnityMeshSimplifier pass DazLODGenerator.cs runs after import.
+
+#include "GltfMeshSimplifier.h"
+#include "GltfHash.h"
+#include "GltfTopology.h"
+
+#include <QHash>
+
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <vector>
+#include <functional>
+
+namespace
+{
+    /// Symmetric 4x4 quadric, upper triangle.
+    struct Quadric
+    {
+        double a[10];
+
+        Quadric() { memset(a, 0, sizeof(a)); }
+
+        void addPlane(double nx, double ny, double nz, double d, double w)
+        {
+            a[0] += w*nx*nx; a[1] += w*nx*ny; a[2] += w*nx*nz; a[3] += w*nx*d;
+                             a[4] += w*ny*ny; a[5] += w*ny*nz; a[6] += w*ny*d;
+                                              a[7] += w*nz*nz; a[8] += w*nz*d;
+                                                               a[9] += w*d*d;
+        }
+        void add(const Quadric& q)
+        {
+            for (int i = 0; i < 10; ++i)
+                a[i] += q.a[i];
+        }
+        double eval(const float* p) const
+        {
+            double x = p[0], y = p[1], z = p[2];
+            return a[0]*x*x + 2*a[1]*x*y + 2*a[2]*x*z + 2*a[3]*x
+                 + a[4]*y*y + 2*a[5]*y*z + 2*a[6]*y
+                 + a[7]*z*z + 2*a[8]*z
+                 + a[9];
+        }
+    };
+
+    struct Collapse
+    {
+        double cost;
+        int    from;
+        int    to;
+        int    stampFrom;
+        int    stampTo;
+
+        bool operator>(const Collapse& o) const { return cost > o.cost; }
+    };
+
+    typedef std::priority_queue<Collapse, std::vector<Collapse>,
+                                std::greater<Collapse> > CollapseQueue;
+
+    void cross(const float* a, const float* b, const float* c, double* n)
+    {
+        double e1[3] = { b[0]-a[0], b[1]-a[1], b[2]-a[2] };
+        double e2[3] = { c[0]-a[0], c[1]-a[1], c[2]-a[2] };
+        n[0] = e1[1]*e2[2] - e1[2]*e2[1];
+        n[1] = e1[2]*e2[0] - e1[0]*e2[2];
+        n[2] = e1[0]*e2[1] - e1[1]*e2[0];
+    }
+
+    /// Welded, indexed working copy of one primitive.
+    class Simplifier
+    {
+    public:
+        explicit Simplifier(const GltfPrimData& prim);
+
+        int  liveTriangles() const { return m_liveTris; }
+        /// Collapse edges until at most @p target triangles remain.
+        /// Returns false when no legal collapse is left.
+        bool reduceTo(int target);
+        void writeLevel(const GltfPrimData& material, GltfPrimData& out) const;
+
+    private:
+        bool  m_skinned;
+        int   m_liveTris;
+
+        // per welded vertex
+        QVector<int>     m_corner;      // one source corner carrying the attributes
+        QVector<bool>    m_locked;
+        QVector<bool>    m_removed;
+        QVector<int>     m_stamp;
+        QVector<Quadric> m_quadric;
+        QVector<QVector<int> > m_vertTris;
+
+        // per triangle
+        QVector<int>  m_tris;           // 3 welded indices each
+        QVector<bool> m_triDead;
+
+        const GltfPrimData& m_src;
+        CollapseQueue       m_queue;
+
+        const float* pos(int v) const { return m_src.positions.constData() + m_corner[v] * 3; }
+        void pushEdges(int v);
+        bool collapse(int from, int to);
+    };
+
+    Simplifier::Simplifier(const GltfPrimData& prim)
+        : m_skinned(!prim.joints.isEmpty())
+        , m_liveTris(0)
+        , m_src(prim)
+    {
+        const int numCorners = prim.positions.size() / 3;
+        const bool hasUVs    = prim.texcoords.size() == numCorners * 2;
+
+        // ---- weld corners into vertices --------------------------------
+        // Two hashes: the full attribute set gives the welded vertex, the
+        // position alone finds UV/skin seams (one position, several vertices).
+        QMultiHash<quint64, int> byAttrs;
+        QHash<quint64, int>      posUses;
+        QVector<int> cornerVert(numCorners);
+
+        for (int c = 0; c < numCorners; ++c)
+        {
+            GltfHasher h;
+            h.update(prim.positions.constData() + c*3, 3 * sizeof(float));
+            quint64 posKey = h.digest();
+            if (hasUVs)
+                h.update(prim.texcoords.constData() + c*2, 2 * sizeof(float));
+            if (m_skinned) {
+                h.update(prim.joints.constData()  + c*4, 4 * sizeof(quint16));
+                h.update(prim.weights.constData() + c*4, 4 * sizeof(float));
+            }
+            quint64 key = h.digest();
+
+            int found = -1;
+            for (QMultiHash<quint64, int>::const_iterator it = byAttrs.constFind(key);
+                 it != byAttrs.constEnd() && it.key() == key && found < 0; ++it)
+            {
+                int o = m_corner[it.value()];
+                bool same = memcmp(prim.positions.constData() + o*3,
+                                   prim.positions.constData() + c*3, 3 * sizeof(float)) == 0;
+                if (same && hasUVs)
+                    same = memcmp(prim.texcoords.constData() + o*2,
+                                  prim.texcoords.constData() + c*2, 2 * sizeof(float)) == 0;
+                if (same && m_skinned)
+                    same = memcmp(prim.joints.constData() + o*4,
+                                  prim.joints.constData() + c*4, 4 * sizeof(quint16)) == 0
+                        && memcmp(prim.weights.constData() + o*4,
+                                  prim.weights.constData() + c*4, 4 * sizeof(float)) == 0;
+                if (same)
+                    found = it.value();
+            }
+            if (found < 0) {
+                found = m_corner.size();
+                m_corner.append(c);
+                byAttrs.insert(key, found);
+                posUses[posKey] += 1;
+            }
+            cornerVert[c] = found;
+        }
+
+        const int numVerts = m_corner.size();
+        m_locked.fill(false, numVerts);
+        m_removed.fill(false, numVerts);
+        m_stamp.fill(0, numVerts);
+        m_quadric.resize(numVerts);
+        m_vertTris.resize(numVerts);
+
+        // seam vertices: the same position welded into more than one vertex
+        for (int v = 0; v < numVerts; ++v) {
+            quint64 posKey = GltfHasher::hash(pos(v), 3 * sizeof(float));
+            if (posUses.value(posKey) > 1)
+                m_locked[v] = true;
+        }
+
+        // ---- triangles, quadrics ---------------------------------------
+        const int numTris = numCorners / 3;
+        m_tris.reserve(numTris * 3);
+
+        for (int t = 0; t < numTris; ++t)
+        {
+            int v[3] = { cornerVert[t*3], cornerVert[t*3+1], cornerVert[t*3+2] };
+            if (v[0] == v[1] || v[1] == v[2] || v[0] == v[2])
+                continue;
+
+            for (int k = 0; k < 3; ++k)
+                m_tris.append(v[k]);
+
+            double n[3];
+            cross(pos(v[0]), pos(v[1]), pos(v[2]), n);
+            double len = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+            if (len <= 0.0)
+                continue;
+            const float* p = pos(v[0]);
+            double nx = n[0]/len, ny = n[1]/len, nz = n[2]/len;
+            double d  = -(nx*p[0] + ny*p[1] + nz*p[2]);
+            for (int k = 0; k < 3; ++k)
+                m_quadric[v[k]].addPlane(nx, ny, nz, d, len * 0.5);
+        }
+        m_triDead.fill(false, m_tris.size() / 3);
+        m_liveTris = m_tris.size() / 3;
+
+        // ---- adjacency, borders ----------------------------------------
+        // The welded triangles' topology gives each vertex its triangles
+        // (corner h is in triangle h / 3) and the half-edges without a twin.
+        GltfMeshTopology topology;
+        GltfTopology::buildTriangles(m_tris.constData(), m_liveTris, numVerts, topology);
+        for (int v = 0; v < numVerts; ++v)
+        {
+            int begin = topology.vertexOffsets[v];
+            int end   = topology.vertexOffsets[v + 1];
+            m_vertTris[v].reserve(end - begin);
+            for (int k = begin; k < end; ++k)
+                m_vertTris[v].append(topology.cornerFaces[topology.vertexCorners[k]]);
+        }
+
+        // Open edges are the primitive's border — where the next material
+        // starts — or a hole; edges of more than two triangles, or of two
+        // that disagree on winding, have no twin either.  Their vertices
+        // stay put.
+        for (int h = 0; h < topology.cornerCount(); ++h)
+        {
+            if (topology.twin[h] >= 0)
+                continue;
+            m_locked[topology.from(h)] = true;
+            m_locked[topology.to(h)]   = true;
+        }
+
+        for (int v = 0; v < numVerts; ++v)
+            pushEdges(v);
+    }
+
+    /// Queue every collapse out of and into @p v at the current quadrics.
+    void Simplifier::pushEdges(int v)
+    {
+        const QVector<int>& tris = m_vertTris[v];
+        for (int i = 0; i < tris.size(); ++i)
+        {
+            int t = tris[i];
+            if (m_triDead[t])
+                continue;
+            for (int k = 0; k < 3; ++k)
+            {
+                int n = m_tris[t*3 + k];
+                if (n == v)
+                    continue;
+                Quadric q = m_quadric[v];
+                q.add(m_quadric[n]);
+                if (!m_locked[v]) {
+                    Collapse c = { q.eval(pos(n)), v, n, m_stamp[v], m_stamp[n] };
+                    m_queue.push(c);
+                }
+                if (!m_locked[n]) {
+                    Collapse c = { q.eval(pos(v)), n, v, m_stamp[n], m_stamp[v] };
+                    m_queue.push(c);
+                }
+            }
+        }
+    }
+
+    /// Move @p from onto @p to.  Rejected if any surviving triangle would
+    /// flip or degenerate.
+    bool Simplifier::collapse(int from, int to)
+    {
+        QVector<int>& fromTris = m_vertTris[from];
+        for (int i = 0; i < fromTris.size(); ++i)
+        {
+            int t = fromTris[i];
+            if (m_triDead[t])
+                continue;
+            const int* tv = m_tris.constData() + t*3;
+            if (tv[0] == to || tv[1] == to || tv[2] == to)
+                continue;
+
+            const float* p[3];
+            const float* q[3];
+            for (int k = 0; k < 3; ++k) {
+                p[k] = pos(tv[k]);
+                q[k] = tv[k] == from ? pos(to) : p[k];
+            }
+            double before[3], after[3];
+            cross(p[0], p[1], p[2], before);
+            cross(q[0], q[1], q[2], after);
+            double dot = before[0]*after[0] + before[1]*after[1] + before[2]*after[2];
+            double la  = after[0]*after[0] + after[1]*after[1] + after[2]*after[2];
+            double lb  = before[0]*before[0] + before[1]*before[1] + before[2]*before[2];
+            if (la <= 0.0 || dot <= 0.2 * std::sqrt(la * lb))
+                return false;
+        }
+
+        QVector<int>& toTris = m_vertTris[to];
+        for (int i = 0; i < fromTris.size(); ++i)
+        {
+            int t = fromTris[i];
+            if (m_triDead[t])
+                continue;
+            int* tv = m_tris.data() + t*3;
+            if (tv[0] == to || tv[1] == to || tv[2] == to) {
+                m_triDead[t] = true;
+                --m_liveTris;
+                continue;
+            }
+            for (int k = 0; k < 3; ++k)
+                if (tv[k] == from) tv[k] = to;
+            toTris.append(t);
+        }
+        fromTris.clear();
+
+        m_quadric[to].add(m_quadric[from]);
+        m_removed[from] = true;
+        ++m_stamp[from];
+        ++m_stamp[to];
+        pushEdges(to);
+        return true;
+    }
+
+    bool Simplifier::reduceTo(int target)
+    {
+        while (m_liveTris > target)
+        {
+            if (m_queue.empty())
+                return false;
+            Collapse c = m_queue.top();
+            m_queue.pop();
+
+            if (m_removed[c.from] || m_removed[c.to]
+                || m_stamp[c.from] != c.stampFrom || m_stamp[c.to] != c.stampTo)
+                continue;
+            collapse(c.from, c.to);
+        }
+        return true;
+    }
+
+    void Simplifier::writeLevel(const GltfPrimData& material, GltfPrimData& out) const
+    {
+        out = material;
+        out.positions.clear();
+        out.normals.clear();
+        out.texcoords.clear();
+        out.joints.clear();
+        out.weights.clear();
+
+        const bool hasUVs = !m_src.texcoords.isEmpty();
+        out.positions.reserve(m_liveTris * 9);
+        out.normals.reserve(m_liveTris * 9);
+        if (hasUVs)    out.texcoords.reserve(m_liveTris * 6);
+        if (m_skinned) { out.joints.reserve(m_liveTris * 12); out.weights.reserve(m_liveTris * 12); }
+
+        for (int t = 0; t < m_triDead.size(); ++t)
+        {
+            if (m_triDead[t])
+                continue;
+            const int* tv = m_tris.constData() + t*3;
+
+            double n[3];
+            cross(pos(tv[0]), pos(tv[1]), pos(tv[2]), n);
+            double len = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+            if (len > 0.0) { n[0] /= len; n[1] /= len; n[2] /= len; }
+            else           { n[0] = 0.0; n[1] = 1.0; n[2] = 0.0; }
+
+            for (int k = 0; k < 3; ++k)
+            {
+                int c = m_corner[tv[k]];
+                out.positions << m_src.positions[c*3] << m_src.positions[c*3+1] << m_src.positions[c*3+2];
+                out.normals   << (float)n[0] << (float)n[1] << (float)n[2];
+                if (hasUVs)
+                    out.texcoords << m_src.texcoords[c*2] << m_src.texcoords[c*2+1];
+                if (m_skinned)
+                    for (int j = 0; j < 4; ++j) {
+                        out.joints  << m_src.joints[c*4 + j];
+                        out.weights << m_src.weights[c*4 + j];
+                    }
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+QVector<GltfPrimData> GltfMeshSimplifier::simplifyChain(const GltfPrimData& prim,
+                                                        const QVector<float>& ratios)
+{
+    QVector<GltfPrimData> levels(ratios.size());
+    const int srcTris = prim.positions.size() / 9;
+
+    if (srcTris < kMinTriangles) {
+        for (int l = 0; l < levels.size(); ++l)
+            levels[l] = prim;
+        return levels;
+    }
+
+    Simplifier s(prim);
+    for (int l = 0; l < ratios.size(); ++l)
+    {
+        int target = qMax(1, (int)(srcTris * ratios[l]));
+        s.reduceTo(target);
+        s.writeLevel(prim, levels[l]);
+    }
+    return levels;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QVector>
+
+#include "GltfTypes.h"
+
+/// Quadric-error mesh simplification for LOD generation.
+///
+/// Works on one primitive at a time.  Corners are welded back into shared
+/// vertices (position + UV + skin), then edges are collapsed cheapest-first
+/// by Garland-Heckbert quadric error.  Collapses are half-edge: a vertex
+/// merges into an existing neighbour, so surviving vertices keep their
+/// exact UVs and skin weights.  Vertices on a UV seam or on the primitive's
+/// border (which is where one material meets the next) never move, so
+/// seams and material boundaries stay closed at every level.
+///
+/// All levels come out of a single progressive pass; a primitive is
+/// independent of every other, so callers run them in parallel.
+class GltfMeshSimplifier
+{
+public:
+    /// Simplify @p prim to each fraction in @p ratios (descending, relative
+    /// to the source triangle count).  Returns one primitive per ratio;
+    /// material fields are copied from @p prim.  Levels the mesh cannot
+    /// reach stop at the coarsest result found.
+    static QVector<GltfPrimData> simplifyChain(const GltfPrimData& prim,
+                                               const QVector<float>& ratios);
+
+    /// Primitives with fewer triangles than this are copied, not simplified.
+    static const int kMinTriangles = 64;
+};
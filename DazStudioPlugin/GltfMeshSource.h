@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QString>
+
+#include "GltfTypes.h"
+
+/// Where the glTF core reads meshes and materials from.
+///
+/// The Daz Studio exporter implements this over DzNode / DzFacetMesh /
+/// DzMaterial; tests and benchmarks supply synthetic meshes.  Everything
+/// downstream of a snapshot (expansion, LODs, culling, serialisation) only
+/// sees GltfTypes.h.  Called from one thread at a time.
+class GltfMeshSource
+{
+public:
+    virtual ~GltfMeshSource() {}
+
+    virtual int meshCount() const = 0;
+
+    /// Geometry of mesh @p mesh: name, positions in output units, UVs,
+    /// facets, and one group per material with its faces, materialName and
+    /// subdivision level.  False, with getLastError() set, if it has none.
+    virtual bool readGeometry(int mesh, GltfMeshSnapshot& outSnap) = 0;
+
+    /// Material of group @p group of mesh @p mesh.  @p prim arrives with
+    /// glTF defaults and materialName set; fill whatever the source knows.
+    virtual void readMaterial(int mesh, int group, GltfPrimData& prim) = 0;
+
+    /// readGeometry() plus readMaterial() for every group.
+    bool snapshot(int mesh, GltfMeshSnapshot& outSnap)
+    {
+        if (!readGeometry(mesh, outSnap))
+            return false;
+        for (int g = 0; g < outSnap.groups.size(); ++g)
+            readMaterial(mesh, g, outSnap.groups[g].material);
+        return true;
+    }
+
+    QString getLastError() const { return m_sLastError; }
+
+protected:
+    QString m_sLastError;
+};
@@ -0,0 +1,400 @@
+// GltfOcclusionCuller.cpp
+// Ray-cast visibility of body triangles against skinned clothing.
+
+#include "GltfOcclusionCuller.h"
+#include "GltfTrace.h"
+
+#include <QtCore/qtconcurrentmap.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    const double kPi = 3.14159265358979323846;
+
+    /// Linear blend skinning of expanded corners.  No matrices = bind pose.
+    QVector<float> skinPositions(const GltfPrimData& prim, const QVector<float>& matrices)
+    {
+        if (matrices.isEmpty() || prim.joints.isEmpty())
+            return prim.positions;
+
+        const int numJoints = matrices.size() / 16;
+        const int numCorners = prim.positions.size() / 3;
+        QVector<float> out(numCorners * 3);
+        for (int c = 0; c < numCorners; ++c)
+        {
+            const float* p = prim.positions.constData() + c*3;
+            float acc[3] = { 0.0f, 0.0f, 0.0f };
+            float wsum = 0.0f;
+            for (int k = 0; k < 4; ++k)
+            {
+                float w = prim.weights[c*4 + k];
+                int   j = prim.joints[c*4 + k];
+                if (w <= 0.0f || j >= numJoints)
+                    continue;
+                const float* m = matrices.constData() + j*16;
+                acc[0] += w * (m[0]*p[0] + m[4]*p[1] + m[8]*p[2]  + m[12]);
+                acc[1] += w * (m[1]*p[0] + m[5]*p[1] + m[9]*p[2]  + m[13]);
+                acc[2] += w * (m[2]*p[0] + m[6]*p[1] + m[10]*p[2] + m[14]);
+                wsum += w;
+            }
+            float* o = out.data() + c*3;
+            if (wsum > 0.0f) { o[0] = acc[0] / wsum; o[1] = acc[1] / wsum; o[2] = acc[2] / wsum; }
+            else             { o[0] = p[0]; o[1] = p[1]; o[2] = p[2]; }
+        }
+        return out;
+    }
+
+    /// Bounding volume hierarchy over triangles, for any-hit ray queries.
+    class Bvh
+    {
+    public:
+        explicit Bvh(const QVector<float>& tris);
+        bool occluded(const float* origin, const float* dir) const;
+
+    private:
+        struct Node
+        {
+            float lo[3], hi[3];
+            int   first;        // leaf: first entry in m_order; inner: right child
+            int   count;        // leaf triangle count, 0 for inner nodes
+        };
+        static const int kLeafSize = 4;
+
+        const QVector<float>& m_tris;       // 9 floats per triangle
+        QVector<int>          m_order;
+        QVector<Node>         m_nodes;
+        QVector<float>        m_centroids;
+
+        struct AxisLess
+        {
+            const float* centroids;
+            int          axis;
+            bool operator()(int x, int y) const { return centroids[x*3 + axis] < centroids[y*3 + axis]; }
+        };
+
+        int  build(int begin, int end);
+        bool hitTriangle(int t, const float* o, const float* d) const;
+    };
+
+    Bvh::Bvh(const QVector<float>& tris)
+        : m_tris(tris)
+    {
+        const int numTris = tris.size() / 9;
+        m_order.resize(numTris);
+        m_centroids.resize(numTris * 3);
+        for (int t = 0; t < numTris; ++t) {
+            m_order[t] = t;
+            for (int a = 0; a < 3; ++a)
+                m_centroids[t*3 + a] = (tris[t*9 + a] + tris[t*9 + 3 + a] + tris[t*9 + 6 + a]) / 3.0f;
+        }
+        m_nodes.reserve(numTris / kLeafSize * 2 + 1);
+        if (numTris > 0)
+            build(0, numTris);
+    }
+
+    /// Median split on the longest centroid axis.
+    int Bvh::build(int begin, int end)
+    {
+        int index = m_nodes.size();
+        m_nodes.append(Node());
+
+        Node n;
+        float clo[3] = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
+        float chi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (int a = 0; a < 3; ++a) { n.lo[a] = FLT_MAX; n.hi[a] = -FLT_MAX; }
+        for (int i = begin; i < end; ++i)
+        {
+            int t = m_order[i];
+            for (int a = 0; a < 3; ++a) {
+                for (int v = 0; v < 3; ++v) {
+                    n.lo[a] = qMin(n.lo[a], m_tris[t*9 + v*3 + a]);
+                    n.hi[a] = qMax(n.hi[a], m_tris[t*9 + v*3 + a]);
+                }
+                clo[a] = qMin(clo[a], m_centroids[t*3 + a]);
+                chi[a] = qMax(chi[a], m_centroids[t*3 + a]);
+            }
+        }
+
+        if (end - begin <= kLeafSize) {
+            n.first = begin;
+            n.count = end - begin;
+            m_nodes[index] = n;
+            return index;
+        }
+
+        int axis = 0;
+        for (int a = 1; a < 3; ++a)
+            if (chi[a] - clo[a] > chi[axis] - clo[axis])
+                axis = a;
+
+        int mid = (begin + end) / 2;
+        AxisLess less = { m_centroids.constData(), axis };
+        std::nth_element(m_order.begin() + begin, m_order.begin() + mid, m_order.begin() + end, less);
+
+        build(begin, mid);          // left child is always index + 1
+        n.first = build(mid, end);
+        n.count = 0;
+        m_nodes[index] = n;
+        return index;
+    }
+
+    /// Moller-Trumbore, any hit in front of the origin.
+    bool Bvh::hitTriangle(int t, const float* o, const float* d) const
+    {
+        const float* v0 = m_tris.constData() + t*9;
+        const float* v1 = v0 + 3;
+        const float* v2 = v0 + 6;
+        float e1[3] = { v1[0]-v0[0], v1[1]-v0[1], v1[2]-v0[2] };
+        float e2[3] = { v2[0]-v0[0], v2[1]-v0[1], v2[2]-v0[2] };
+        float p[3]  = { d[1]*e2[2] - d[2]*e2[1], d[2]*e2[0] - d[0]*e2[2], d[0]*e2[1] - d[1]*e2[0] };
+        float det   = e1[0]*p[0] + e1[1]*p[1] + e1[2]*p[2];
+        if (std::fabs(det) < 1e-12f)
+            return false;
+        float inv   = 1.0f / det;
+        float s[3]  = { o[0]-v0[0], o[1]-v0[1], o[2]-v0[2] };
+        float u     = (s[0]*p[0] + s[1]*p[1] + s[2]*p[2]) * inv;
+        if (u < 0.0f || u > 1.0f)
+            return false;
+        float q[3]  = { s[1]*e1[2] - s[2]*e1[1], s[2]*e1[0] - s[0]*e1[2], s[0]*e1[1] - s[1]*e1[0] };
+        float v     = (d[0]*q[0] + d[1]*q[1] + d[2]*q[2]) * inv;
+        if (v < 0.0f || u + v > 1.0f)
+            return false;
+        return (e2[0]*q[0] + e2[1]*q[1] + e2[2]*q[2]) * inv > 0.0f;
+    }
+
+    bool Bvh::occluded(const float* o, const float* d) const
+    {
+        if (m_nodes.isEmpty())
+            return false;
+
+        float invD[3];
+        for (int a = 0; a < 3; ++a)
+            invD[a] = d[a] != 0.0f ? 1.0f / d[a] : FLT_MAX;
+
+        int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const int   index = stack[--top];
+            const Node& n     = m_nodes[index];
+
+            // slab test
+            float tmin = 0.0f, tmax = FLT_MAX;
+            for (int a = 0; a < 3 && tmin <= tmax; ++a) {
+                float t0 = (n.lo[a] - o[a]) * invD[a];
+                float t1 = (n.hi[a] - o[a]) * invD[a];
+                if (t0 > t1) qSwap(t0, t1);
+                tmin = qMax(tmin, t0);
+                tmax = qMin(tmax, t1);
+            }
+            if (tmin > tmax)
+                continue;
+
+            if (n.count > 0) {
+                for (int i = n.first; i < n.first + n.count; ++i)
+                    if (hitTriangle(m_order[i], o, d))
+                        return true;
+            } else if (top < 62) {
+                stack[top++] = n.first;
+                stack[top++] = index + 1;
+            }
+        }
+        return false;
+    }
+
+    /// Tests one chunk of body triangles against the pose's BVH.
+    struct RayTask
+    {
+        typedef void result_type;
+        static const int kChunk = 256;
+
+        const Bvh*     bvh;
+        const float*   tris;            // 9 floats per body triangle, posed
+        const float*   dirs;            // 3 per direction
+        int            numDirs;
+        int            numTris;
+        float          offset;
+        bool*          hidden;          // cleared when a ray escapes
+
+        void operator()(int& chunk) const
+        {
+            int begin = chunk * kChunk;
+            int end   = qMin(begin + kChunk, numTris);
+            for (int t = begin; t < end; ++t)
+            {
+                if (!hidden[t])
+                    continue;
+                const float* v = tris + t*9;
+                float e1[3] = { v[3]-v[0], v[4]-v[1], v[5]-v[2] };
+                float e2[3] = { v[6]-v[0], v[7]-v[1], v[8]-v[2] };
+                float n[3]  = { e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2],
+                                e1[0]*e2[1] - e1[1]*e2[0] };
+                float len = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+                if (len <= 0.0f) {
+                    hidden[t] = false;      // degenerate: leave it alone
+                    continue;
+                }
+                n[0] /= len; n[1] /= len; n[2] /= len;
+
+                // centroid plus a point leaning towards each corner
+                static const float kBary[4][3] = {
+                    { 1.0f/3, 1.0f/3, 1.0f/3 },
+                    { 0.6f, 0.2f, 0.2f }, { 0.2f, 0.6f, 0.2f }, { 0.2f, 0.2f, 0.6f }
+                };
+                bool visible = false;
+                for (int s = 0; s < 4 && !visible; ++s)
+                {
+                    float o[3];
+                    for (int a = 0; a < 3; ++a)
+                        o[a] = kBary[s][0]*v[a] + kBary[s][1]*v[3+a] + kBary[s][2]*v[6+a]
+                             + n[a] * offset;
+                    for (int d = 0; d < numDirs && !visible; ++d) {
+                        const float* dir = dirs + d*3;
+                        if (dir[0]*n[0] + dir[1]*n[1] + dir[2]*n[2] <= 0.05f)
+                            continue;
+                        visible = !bvh->occluded(o, dir);
+                    }
+                }
+                if (visible)
+                    hidden[t] = false;
+            }
+        }
+    };
+}
+
+// ---------------------------------------------------------------------------
+// Construction
+// ---------------------------------------------------------------------------
+
+GltfOcclusionCuller::GltfOcclusionCuller(const GltfOcclusionOptions& options)
+    : m_options(options)
+{
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+void GltfOcclusionCuller::addOccluder(const GltfPrimData& prim)
+{
+    m_occluders.append(prim);
+}
+
+void GltfOcclusionCuller::addPose(const QVector<float>& jointMatrices)
+{
+    m_poses.append(jointMatrices);
+}
+
+QVector<bool> GltfOcclusionCuller::findHidden(const QVector<GltfPrimData>& prims) const
+{
+    GltfTraceScope trace("findHidden", "scene");
+    int numTris = 0;
+    for (int p = 0; p < prims.size(); ++p)
+        numTris += prims[p].positions.size() / 9;
+
+    QVector<bool> hidden(numTris, !m_occluders.isEmpty());
+    if (m_occluders.isEmpty())
+        return hidden;
+
+    // Directions on a Fibonacci sphere: even spread, no pole clustering.
+    const int numDirs = qMax(m_options.directionCount, 6);
+    QVector<float> dirs(numDirs * 3);
+    const double golden = kPi * (3.0 - std::sqrt(5.0));
+    for (int d = 0; d < numDirs; ++d) {
+        double y = 1.0 - 2.0 * (d + 0.5) / numDirs;
+        double r = std::sqrt(1.0 - y*y);
+        dirs[d*3 + 0] = (float)(std::cos(golden * d) * r);
+        dirs[d*3 + 1] = (float)y;
+        dirs[d*3 + 2] = (float)(std::sin(golden * d) * r);
+    }
+
+    QVector< QVector<float> > poses = m_poses;
+    if (poses.isEmpty())
+        poses.append(QVector<float>());
+
+    QVector<int> chunks((numTris + RayTask::kChunk - 1) / RayTask::kChunk);
+    for (int c = 0; c < chunks.size(); ++c)
+        chunks[c] = c;
+
+    for (int pose = 0; pose < poses.size(); ++pose)
+    {
+        QVector<float> occTris;
+        for (int o = 0; o < m_occluders.size(); ++o)
+            occTris += skinPositions(m_occluders[o], poses[pose]);
+        QVector<float> bodyTris;
+        bodyTris.reserve(numTris * 9);
+        for (int p = 0; p < prims.size(); ++p)
+            bodyTris += skinPositions(prims[p], poses[pose]);
+
+        Bvh bvh(occTris);
+
+        RayTask task;
+        task.bvh     = &bvh;
+        task.tris    = bodyTris.constData();
+        task.dirs    = dirs.constData();
+        task.numDirs = numDirs;
+        task.numTris = numTris;
+        task.offset  = m_options.surfaceOffset;
+        task.hidden  = hidden.data();
+        QtConcurrent::blockingMap(chunks, task);
+    }
+    return hidden;
+}
+
+int GltfOcclusionCuller::removeHidden(QVector<GltfPrimData>& prims, const QVector<bool>& hidden,
+                                      bool keepSeparate)
+{
+    QVector<GltfPrimData> separated;
+    int moved = 0;
+    int base  = 0;
+
+    for (int p = 0; p < prims.size(); ++p)
+    {
+        GltfPrimData& src = prims[p];
+        const int numTris = src.positions.size() / 9;
+        const bool hasUVs  = !src.texcoords.isEmpty();
+        const bool skinned = !src.joints.isEmpty();
+
+        GltfPrimData kept = src, gone = src;
+        kept.positions.clear(); kept.normals.clear(); kept.texcoords.clear();
+        kept.joints.clear();    kept.weights.clear();
+        gone.positions.clear(); gone.normals.clear(); gone.texcoords.clear();
+        gone.joints.clear();    gone.weights.clear();
+        gone.materialName = src.materialName + "_Hidden";
+
+        for (int t = 0; t < numTris; ++t)
+        {
+            GltfPrimData& dst = hidden.value(base + t, false) ? gone : kept;
+            for (int k = t*9; k < t*9 + 9; ++k) {
+                dst.positions.append(src.positions[k]);
+                dst.normals.append(src.normals[k]);
+            }
+            if (hasUVs)
+                for (int k = t*6; k < t*6 + 6; ++k)
+                    dst.texcoords.append(src.texcoords[k]);
+            if (skinned)
+                for (int k = t*12; k < t*12 + 12; ++k) {
+                    dst.joints.append(src.joints[k]);
+                    dst.weights.append(src.weights[k]);
+                }
+        }
+        base  += numTris;
+        moved += gone.positions.size() / 9;
+
+        src = kept;
+        if (keepSeparate && !gone.positions.isEmpty())
+            separated.append(gone);
+    }
+
+    // primitives left empty would be invalid glTF
+    for (int p = prims.size() - 1; p >= 0; --p)
+        if (prims[p].positions.isEmpty())
+            prims.remove(p);
+    prims += separated;
+    return moved;
+}
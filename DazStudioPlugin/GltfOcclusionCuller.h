@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QVector>
+
+#include "GltfTypes.h"
+
+/// Tuning for GltfOcclusionCuller.
+struct GltfOcclusionOptions
+{
+    int   directionCount;   // ray directions spread over the sphere; only
+                            // those facing out of a triangle are cast
+    float surfaceOffset;    // ray start above the surface, in output units
+
+    GltfOcclusionOptions() : directionCount(32), surfaceOffset(0.0005f) {}
+};
+
+/// Finds body triangles that clothing hides in every sampled pose.
+///
+/// Opaque clothing primitives are added as occluders and one or more poses
+/// as skinning matrices.  For each pose the occluders are skinned and put
+/// in a BVH; then, in parallel, rays leave a handful of points on each body
+/// triangle in every outward direction.  A triangle is hidden only if every
+/// ray hits clothing in every pose, so anything glimpsed through a gap or
+/// under a moving hem stays.  The body never occludes itself; that keeps
+/// the test conservative for armpits and between the legs.
+class GltfOcclusionCuller
+{
+public:
+    explicit GltfOcclusionCuller(const GltfOcclusionOptions& options = GltfOcclusionOptions());
+
+    void addOccluder(const GltfPrimData& prim);
+
+    /// One pose: 16 floats per skin joint, column-major, each the joint's
+    /// posed world matrix times its inverse bind matrix.  An empty set is
+    /// the bind pose.
+    void addPose(const QVector<float>& jointMatrices);
+
+    /// One flag per triangle of @p prims, in order across primitives.
+    QVector<bool> findHidden(const QVector<GltfPrimData>& prims) const;
+
+    /// Take the triangles flagged in @p hidden out of @p prims.  With
+    /// @p keepSeparate they are appended as extra primitives named
+    /// "<material>_Hidden", so the importer can switch them back on;
+    /// otherwise they are dropped.  Returns the number of triangles moved.
+    static int removeHidden(QVector<GltfPrimData>& prims, const QVector<bool>& hidden,
+                            bool keepSeparate);
+
+private:
+    GltfOcclusionOptions       m_options;
+    QVector<GltfPrimData>      m_occluders;
+    QVector< QVector<float> >  m_poses;
+};
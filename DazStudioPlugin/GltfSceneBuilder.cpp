@@ -0,0 +1,518 @@
+// GltfSceneBuilder.cpp
+// Snapshot expansion and LOD chains for the glTF core.  SDK-free.
+
+#include "GltfSceneBuilder.h"
+#include "GltfMeshSource.h"
+#include "GltfSubdivider.h"
+#include "GltfTopology.h"
+#include "GltfMeshSimplifier.h"
+#include "GltfTrace.h"
+
+#include <QtCore/qtconcurrentmap.h>
+
+#include <cmath>
+
+// LOD chain, matching DazLODGenerator.cs: triangle fraction per level below
+// LOD0, and the screen coverage at which each level (LOD0 first) drops out.
+static const int   kLodLevels = 3;
+static const float kLodRatios[kLodLevels]       = { 0.50f, 0.25f, 0.10f };
+static const float kLodCoverage[kLodLevels + 1] = { 0.60f, 0.30f, 0.10f, 0.02f };
+
+// ---------------------------------------------------------------------------
+// Expansion
+// ---------------------------------------------------------------------------
+
+struct GltfSceneBuilder::ExpandTask
+{
+    typedef void result_type;
+
+    const GltfMeshSnapshot*  snaps;
+    QVector<GltfPrimData>*   out;
+
+    void operator()(int& i) const
+    {
+        GltfTraceScope trace("expandSnapshot", "scene");
+        refineAndExpand(snaps[i], out[i]);
+    }
+};
+
+void GltfSceneBuilder::refineAndExpand(const GltfMeshSnapshot& snap,
+                                       QVector<GltfPrimData>& outPrims)
+{
+    // only subdivision reads the topology; without it expansion's own
+    // range checks are cheaper than building one
+    if (GltfSubdivider::maxLevel(snap) <= 0) {
+        expandSnapshot(snap, outPrims);
+        return;
+    }
+    GltfMeshTopology topology;
+    GltfTopology::build(snap, topology);
+    refineAndExpand(snap, topology, outPrims);
+}
+
+void GltfSceneBuilder::refineAndExpand(const GltfMeshSnapshot& snap,
+                                       const GltfMeshTopology& topology,
+                                       QVector<GltfPrimData>& outPrims)
+{
+    // an empty topology is a mesh with bad vertex indices, which
+    // OpenSubdiv would reject anyway
+    if (GltfSubdivider::maxLevel(snap) > 0 && !topology.isEmpty()) {
+        GltfMeshSnapshot refined;
+        GltfTraceScope refineTrace("subdivide", "scene");
+        bool refinedOk = GltfSubdivider::refine(snap, topology, refined);
+        refineTrace.end();
+        if (refinedOk) {
+            expandSnapshot(refined, outPrims);
+            return;
+        }
+        // topology OpenSubdiv cannot take: fall back to the base mesh
+    }
+    expandSnapshot(snap, outPrims, &topology);
+}
+
+void GltfSceneBuilder::expandAll(const QVector<GltfMeshSnapshot>& snaps,
+                                 QVector< QVector<GltfPrimData> >& outPrims)
+{
+    GltfTraceScope trace("expandAll", "scene");
+    outPrims.resize(snaps.size());
+    QVector<int> indices(snaps.size());
+    for (int i = 0; i < indices.size(); ++i)
+        indices[i] = i;
+
+    ExpandTask task;
+    task.snaps = snaps.constData();
+    task.out   = outPrims.data();
+    QtConcurrent::blockingMap(indices, task);
+}
+
+bool GltfSceneBuilder::buildScene(GltfMeshSource& source, GltfSceneData& outScene)
+{
+    QVector<GltfMeshSnapshot> snaps(source.meshCount());
+    for (int i = 0; i < snaps.size(); ++i)
+        if (!source.snapshot(i, snaps[i]))
+            return false;
+
+    QVector< QVector<GltfPrimData> > expanded;
+    expandAll(snaps, expanded);
+
+    for (int i = 0; i < expanded.size(); ++i)
+    {
+        if (expanded[i].isEmpty())
+            continue;
+
+        GltfMeshData md;
+        md.name      = snaps[i].name;
+        md.firstPrim = outScene.prims.size();
+        md.primCount = expanded[i].size();
+        outScene.prims += expanded[i];
+
+        GltfNodeData nd;
+        nd.name = snaps[i].name;
+        nd.mesh = outScene.meshes.size();
+        outScene.nodes.append(nd);
+        outScene.meshes.append(md);
+    }
+    return true;
+}
+
+namespace
+{
+    enum FaceShape { MixedFaces, AllTriangles, AllQuads };
+
+    // One pass over a group ahead of expansion: its triangle count, whether
+    // it is all triangles, all quads or mixed, and whether every facet,
+    // vertex, UV and skin index it touches is in range.  Only then may the
+    // group skip the per-corner checks.  A mesh topology has already
+    // checked the vertices, and the UVs if it found them all in range.
+    bool scanGroup(const GltfMeshSnapshot& snap, const GltfMeshTopology* topology,
+                   const QVector<int>& faces, FaceShape& shape, int& triTotal)
+    {
+        const int numVerts  = snap.vertexCount();
+        const int numUVs    = snap.uvs.size() / 2;
+        const int numFacets = snap.facetVerts.size() / 4;
+        const bool hasUVs   = numUVs > 0;
+        const bool checked  = topology && !topology->isEmpty() &&
+                              (!hasUVs || topology->allUVsValid);
+
+        if (snap.facetUVs.size() < numFacets * 4)
+            return false;
+        if (!snap.joints.isEmpty() &&
+            (snap.joints.size() < numVerts * 4 || snap.weights.size() < numVerts * 4))
+            return false;
+
+        int quads = 0;
+        for (int f = 0; f < faces.size(); ++f)
+        {
+            int fi = faces[f];
+            if (fi < 0 || fi >= numFacets)
+                return false;
+            const qint32* fv = snap.facetVerts.constData() + fi * 4;
+            const qint32* fu = snap.facetUVs.constData()   + fi * 4;
+            int corners = (fv[3] >= 0) ? 4 : 3;
+            for (int k = 0; k < corners && !checked; ++k) {
+                if (fv[k] < 0 || fv[k] >= numVerts)
+                    return false;
+                if (hasUVs && (fu[k] < 0 || fu[k] >= numUVs))
+                    return false;
+            }
+            quads += (corners == 4);
+        }
+
+        shape    = (quads == faces.size()) ? AllQuads : (quads == 0) ? AllTriangles : MixedFaces;
+        triTotal = faces.size() + quads;
+        return true;
+    }
+
+    // Corner writer for a scanned group, specialised on what the scan found
+    // so the loop carries no bounds checks and, for uniform groups, no
+    // quad/triangle test.  Each face's positions are read once and serve
+    // both the flat normal and the output.
+    template<int Shape, bool HasUVs, bool Skinned>
+    struct FaceEmitter
+    {
+        const float*   srcPos;
+        const float*   srcUVs;
+        const quint16* srcJoints;
+        const float*   srcWeights;
+
+        float*   pos;
+        float*   nrm;
+        float*   uv;
+        quint16* joints;
+        float*   weights;
+
+        void corner(const float* p, const float* n, int vIdx, int uvIdx)
+        {
+            pos[0] = p[0]; pos[1] = p[1]; pos[2] = p[2];
+            nrm[0] = n[0]; nrm[1] = n[1]; nrm[2] = n[2];
+            pos += 3;
+            nrm += 3;
+
+            // glTF origin is top-left, Daz is bottom-left -> flip V
+            if (HasUVs) {
+                uv[0] = srcUVs[uvIdx*2 + 0];
+                uv[1] = 1.0f - srcUVs[uvIdx*2 + 1];
+            } else {
+                uv[0] = 0.0f;
+                uv[1] = 0.0f;
+            }
+            uv += 2;
+
+            if (Skinned) {
+                for (int k = 0; k < 4; ++k) {
+                    joints[k]  = srcJoints[vIdx*4 + k];
+                    weights[k] = srcWeights[vIdx*4 + k];
+                }
+                joints  += 4;
+                weights += 4;
+            }
+        }
+
+        void triangle(const float (*p)[3], const qint32* fv, const qint32* fu,
+                      int a, int b, int c)
+        {
+            float n[3];
+            GltfSceneBuilder::computeFlatNormal(p[a], p[b], p[c], n);
+            corner(p[a], n, fv[a], fu[a]);
+            corner(p[b], n, fv[b], fu[b]);
+            corner(p[c], n, fv[c], fu[c]);
+        }
+
+        void run(const GltfMeshSnapshot& snap, const QVector<int>& faces)
+        {
+            const qint32* facetVerts = snap.facetVerts.constData();
+            const qint32* facetUVs   = snap.facetUVs.constData();
+
+            for (int f = 0; f < faces.size(); ++f)
+            {
+                const qint32* fv = facetVerts + faces[f] * 4;
+                const qint32* fu = facetUVs   + faces[f] * 4;
+                const bool isQuad = (Shape == AllQuads) ||
+                                    (Shape == MixedFaces && fv[3] >= 0);
+
+                float p[4][3];
+                for (int k = 0; k < 3; ++k) {
+                    const float* src = srcPos + fv[k] * 3;
+                    p[k][0] = src[0]; p[k][1] = src[1]; p[k][2] = src[2];
+                }
+                if (isQuad) {
+                    const float* src = srcPos + fv[3] * 3;
+                    p[3][0] = src[0]; p[3][1] = src[1]; p[3][2] = src[2];
+                }
+
+                // Two triangle fans from the quad: (0,1,2) and (0,2,3)
+                triangle(p, fv, fu, 0, 1, 2);
+                if (isQuad)
+                    triangle(p, fv, fu, 0, 2, 3);
+            }
+        }
+    };
+
+    template<int Shape, bool HasUVs, bool Skinned>
+    void emitGroup(const GltfMeshSnapshot& snap, const QVector<int>& faces,
+                   int triTotal, GltfPrimData& prim)
+    {
+        prim.positions.resize(triTotal * 9);
+        prim.normals.resize(triTotal * 9);
+        prim.texcoords.resize(triTotal * 6);
+        if (Skinned) {
+            prim.joints.resize(triTotal * 12);
+            prim.weights.resize(triTotal * 12);
+        }
+
+        FaceEmitter<Shape, HasUVs, Skinned> emitter;
+        emitter.srcPos     = snap.positions.constData();
+        emitter.srcUVs     = snap.uvs.constData();
+        emitter.srcJoints  = snap.joints.constData();
+        emitter.srcWeights = snap.weights.constData();
+        emitter.pos        = prim.positions.data();
+        emitter.nrm        = prim.normals.data();
+        emitter.uv         = prim.texcoords.data();
+        emitter.joints     = Skinned ? prim.joints.data() : 0;
+        emitter.weights    = Skinned ? prim.weights.data() : 0;
+        emitter.run(snap, faces);
+    }
+
+    typedef void (*EmitGroupFn)(const GltfMeshSnapshot&, const QVector<int>&, int, GltfPrimData&);
+
+    // [shape][has UVs][skinned]
+    const EmitGroupFn kEmitGroup[3][2][2] = {
+        { { emitGroup<MixedFaces,   false, false>, emitGroup<MixedFaces,   false, true> },
+          { emitGroup<MixedFaces,   true,  false>, emitGroup<MixedFaces,   true,  true> } },
+        { { emitGroup<AllTriangles, false, false>, emitGroup<AllTriangles, false, true> },
+          { emitGroup<AllTriangles, true,  false>, emitGroup<AllTriangles, true,  true> } },
+        { { emitGroup<AllQuads,     false, false>, emitGroup<AllQuads,     false, true> },
+          { emitGroup<AllQuads,     true,  false>, emitGroup<AllQuads,     true,  true> } },
+    };
+}
+
+void GltfSceneBuilder::expandSnapshot(const GltfMeshSnapshot& snap,
+                                      QVector<GltfPrimData>& outPrims,
+                                      const GltfMeshTopology* topology)
+{
+    const bool hasUVs  = snap.uvs.size() / 2 > 0;
+    const bool skinned = !snap.joints.isEmpty();
+
+    // Build one GltfPrimData per material group
+    for (int g = 0; g < snap.groups.size(); ++g)
+    {
+        const GltfMeshSnapshot::Group& group = snap.groups[g];
+        GltfPrimData prim = group.material;
+
+        FaceShape shape;
+        int triTotal;
+        if (scanGroup(snap, topology, group.faces, shape, triTotal))
+            kEmitGroup[shape][hasUVs][skinned](snap, group.faces, triTotal, prim);
+        else
+            expandGroupChecked(snap, group, prim);
+
+        if (!prim.positions.isEmpty())
+            outPrims.append(prim);
+    }
+}
+
+void GltfSceneBuilder::expandSnapshotChecked(const GltfMeshSnapshot& snap,
+                                             QVector<GltfPrimData>& outPrims)
+{
+    for (int g = 0; g < snap.groups.size(); ++g)
+    {
+        GltfPrimData prim = snap.groups[g].material;
+        expandGroupChecked(snap, snap.groups[g], prim);
+        if (!prim.positions.isEmpty())
+            outPrims.append(prim);
+    }
+}
+
+void GltfSceneBuilder::expandGroupChecked(const GltfMeshSnapshot& snap,
+                                          const GltfMeshSnapshot::Group& group,
+                                          GltfPrimData& prim)
+{
+    const int    numVerts  = snap.vertexCount();
+    const int    numUVs    = snap.uvs.size() / 2;
+    const int    numFacets = snap.facetVerts.size() / 4;
+    const float* srcPos    = snap.positions.constData();
+    const float* srcUVs    = snap.uvs.constData();
+    const bool   skinned   = !snap.joints.isEmpty();
+
+    // size the arrays once rather than growing them corner by corner
+    int triTotal = 0;
+    for (int f = 0; f < group.faces.size(); ++f) {
+        int fi = group.faces[f];
+        if (fi >= 0 && fi < numFacets)
+            triTotal += (snap.facetVerts[fi * 4 + 3] >= 0) ? 2 : 1;
+    }
+    prim.positions.reserve(triTotal * 9);
+    prim.normals.reserve(triTotal * 9);
+    prim.texcoords.reserve(triTotal * 6);
+    if (skinned) {
+        prim.joints.reserve(triTotal * 12);
+        prim.weights.reserve(triTotal * 12);
+    }
+
+    // Triangulate faces in this group
+    for (int f = 0; f < group.faces.size(); ++f)
+    {
+        int fi = group.faces[f];
+        if (fi < 0 || fi >= numFacets)
+            continue;
+
+        const qint32* faceVerts = snap.facetVerts.constData() + fi * 4;
+        const qint32* faceUVs   = snap.facetUVs.constData()   + fi * 4;
+
+        // [3] == -1 means triangle; >= 0 means quad
+        bool isQuad  = (faceVerts[3] >= 0);
+        int triCount = isQuad ? 2 : 1;
+
+        // Two triangle fans from the quad: (0,1,2) and (0,2,3)
+        static const int triMap[2][3] = { {0,1,2}, {0,2,3} };
+
+        for (int t = 0; t < triCount; ++t)
+        {
+            // Collect the 3 vertex positions (for flat normal computation)
+            const float* pts[3];
+            for (int v = 0; v < 3; ++v) {
+                int idx = faceVerts[triMap[t][v]];
+                if (idx < 0 || idx >= numVerts) idx = 0;
+                pts[v] = srcPos + idx * 3;
+            }
+
+            float n[3];
+            computeFlatNormal(pts[0], pts[1], pts[2], n);
+
+            for (int v = 0; v < 3; ++v)
+            {
+                int vi    = triMap[t][v];
+                int vIdx  = faceVerts[vi];
+                int uvIdx = faceUVs[vi];
+
+                if (vIdx < 0 || vIdx >= numVerts) vIdx = 0;
+
+                prim.positions.append(srcPos[vIdx*3 + 0]);
+                prim.positions.append(srcPos[vIdx*3 + 1]);
+                prim.positions.append(srcPos[vIdx*3 + 2]);
+
+                // Flat normal
+                prim.normals.append(n[0]);
+                prim.normals.append(n[1]);
+                prim.normals.append(n[2]);
+
+                // UV: glTF origin is top-left, Daz is bottom-left -> flip V
+                if (uvIdx >= 0 && uvIdx < numUVs) {
+                    prim.texcoords.append(srcUVs[uvIdx*2 + 0]);
+                    prim.texcoords.append(1.0f - srcUVs[uvIdx*2 + 1]);
+                } else {
+                    prim.texcoords.append(0.0f);
+                    prim.texcoords.append(0.0f);
+                }
+
+                if (skinned) {
+                    for (int k = 0; k < 4; ++k) {
+                        prim.joints.append(snap.joints[vIdx*4 + k]);
+                        prim.weights.append(snap.weights[vIdx*4 + k]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void GltfSceneBuilder::computeFlatNormal(const float* a, const float* b,
+                                          const float* c, float* outN)
+{
+    float u[3] = { b[0]-a[0], b[1]-a[1], b[2]-a[2] };
+    float v[3] = { c[0]-a[0], c[1]-a[1], c[2]-a[2] };
+    outN[0] = u[1]*v[2] - u[2]*v[1];
+    outN[1] = u[2]*v[0] - u[0]*v[2];
+    outN[2] = u[0]*v[1] - u[1]*v[0];
+    float len = std::sqrt(outN[0]*outN[0] + outN[1]*outN[1] + outN[2]*outN[2]);
+    if (len > 1e-8f) { outN[0]/=len; outN[1]/=len; outN[2]/=len; }
+    else              { outN[0]=0.0f; outN[1]=1.0f; outN[2]=0.0f; }
+}
+
+// ---------------------------------------------------------------------------
+// Level of detail
+// ---------------------------------------------------------------------------
+
+struct GltfSceneBuilder::LodTask
+{
+    typedef void result_type;
+
+    const GltfPrimData*       prims;
+    QVector<GltfPrimData>*    out;
+    QVector<float>            ratios;
+
+    void operator()(int& p) const
+    {
+        GltfTraceScope trace("simplifyChain", "scene");
+        out[p] = GltfMeshSimplifier::simplifyChain(prims[p], ratios);
+    }
+};
+
+int GltfSceneBuilder::lodLevelCount()
+{
+    return kLodLevels;
+}
+
+void GltfSceneBuilder::appendLods(GltfSceneData& scene)
+{
+    GltfTraceScope trace("appendLods", "scene");
+    const int numPrims  = scene.prims.size();
+    const int numMeshes = scene.meshes.size();
+    const int numNodes  = scene.nodes.size();
+
+    // ---- simplify every primitive on the thread pool ---------------------
+    QVector< QVector<GltfPrimData> > chains(numPrims);
+    QVector<int> indices(numPrims);
+    for (int i = 0; i < indices.size(); ++i)
+        indices[i] = i;
+
+    LodTask task;
+    task.prims = scene.prims.constData();
+    task.out   = chains.data();
+    for (int l = 0; l < kLodLevels; ++l)
+        task.ratios.append(kLodRatios[l]);
+    QtConcurrent::blockingMap(indices, task);
+
+    // ---- one mesh per source mesh and level, reusing its materials -------
+    QVector<int> lodMesh(numMeshes * kLodLevels);
+    for (int m = 0; m < numMeshes; ++m)
+    {
+        const GltfMeshData src = scene.meshes[m];
+        for (int l = 0; l < kLodLevels; ++l)
+        {
+            GltfMeshData md;
+            md.name         = QString("%1_LOD%2").arg(src.name).arg(l + 1);
+            md.firstPrim    = scene.prims.size();
+            md.primCount    = src.primCount;
+            md.materialBase = src.firstPrim;
+            for (int p = src.firstPrim; p < src.firstPrim + src.primCount; ++p)
+                scene.prims.append(chains[p][l]);
+
+            lodMesh[m * kLodLevels + l] = scene.meshes.size();
+            scene.meshes.append(md);
+        }
+    }
+
+    // ---- LOD nodes: copies of the mesh node with the coarser mesh --------
+    // MSFT_lod swaps a level in where the node sits, so each copy keeps the
+    // node's local transform, skin and instance buffers but no parent.
+    for (int n = 0; n < numNodes; ++n)
+    {
+        if (scene.nodes[n].mesh < 0)
+            continue;
+
+        const GltfNodeData base = scene.nodes[n];
+        for (int l = 0; l < kLodLevels; ++l)
+        {
+            GltfNodeData lod = base;
+            lod.name   = QString("%1_LOD%2").arg(base.name).arg(l + 1);
+            lod.parent = -1;
+            lod.mesh   = lodMesh[base.mesh * kLodLevels + l];
+
+            scene.nodes[n].lods.append(scene.nodes.size());
+            scene.nodes.append(lod);
+        }
+        for (int l = 0; l <= kLodLevels; ++l)
+            scene.nodes[n].lodCoverage.append(kLodCoverage[l]);
+    }
+}
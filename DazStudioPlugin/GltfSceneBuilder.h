@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QVector>
+
+#include "GltfTypes.h"
+
+class GltfMeshSource;
+struct GltfMeshTopology;
+
+/// Turns mesh snapshots into glTF primitives: triangulation, flat normals,
+/// V-flipped UVs and per-corner skin data, with Catmull-Clark refinement
+/// first where a group asks for it (GltfSubdivider).  Also builds the LOD
+/// chain of a finished scene (GltfMeshSimplifier, MSFT_lod).
+///
+/// SDK-free; the Daz Studio exporter and the tests share it.
+class GltfSceneBuilder
+{
+public:
+    /// One primitive per non-empty material group of @p snap, appended.
+    /// @p topology, if given, must be @p snap's; it saves re-checking the
+    /// indices.
+    static void expandSnapshot(const GltfMeshSnapshot& snap,
+                               QVector<GltfPrimData>& outPrims,
+                               const GltfMeshTopology* topology = 0);
+
+    /// expandSnapshot() through the generic loop only, with its range checks
+    /// on every corner.  Same output; expandSnapshot() falls back to it for
+    /// groups with out-of-range indices.  Kept callable for the benchmark.
+    static void expandSnapshotChecked(const GltfMeshSnapshot& snap,
+                                      QVector<GltfPrimData>& outPrims);
+
+    /// expandSnapshot() after subdividing the groups that ask for it.  The
+    /// topology is built only for a snapshot that subdivides.
+    static void refineAndExpand(const GltfMeshSnapshot& snap,
+                                QVector<GltfPrimData>& outPrims);
+
+    /// refineAndExpand() with @p snap's topology already built.
+    static void refineAndExpand(const GltfMeshSnapshot& snap,
+                                const GltfMeshTopology& topology,
+                                QVector<GltfPrimData>& outPrims);
+
+    /// refineAndExpand() every snapshot on the thread pool; @p outPrims[i]
+    /// holds snapshot i's primitives.
+    static void expandAll(const QVector<GltfMeshSnapshot>& snaps,
+                          QVector< QVector<GltfPrimData> >& outPrims);
+
+    /// Every mesh of @p source as its own root node and glTF mesh.  False
+    /// if a mesh cannot be read; the source has the reason.
+    static bool buildScene(GltfMeshSource& source, GltfSceneData& outScene);
+
+    /// Append LOD1-3 meshes and nodes for every mesh in @p scene, with
+    /// MSFT_screencoverage hints matching DazLODGenerator's thresholds.
+    static void appendLods(GltfSceneData& scene);
+
+    /// Number of LOD levels appendLods() adds below LOD0.
+    static int lodLevelCount();
+
+    /// Unit normal of triangle abc; +Y if it is degenerate.
+    static void computeFlatNormal(const float* a, const float* b,
+                                  const float* c, float* outN);
+
+private:
+    static void expandGroupChecked(const GltfMeshSnapshot& snap,
+                                   const GltfMeshSnapshot::Group& group,
+                                   GltfPrimData& prim);
+
+    struct ExpandTask;
+    struct LodTask;
+};
@@ -0,0 +1,293 @@
+// GltfSubdivider.cpp
+// OpenSubdiv refinement for the glTF path.  The FBX path gets its
+// subdivision from DzBridge; this covers the GLB output.
+
+#include "GltfSubdivider.h"
+#include "GltfTopology.h"
+
+#include <opensubdiv/far/topologyDescriptor.h>
+#include <opensubdiv/far/stencilTableFactory.h>
+#include <opensubdiv/osd/cpuVertexBuffer.h>
+
+#if defined(GLTF_OSD_TBB)
+#include <opensubdiv/osd/tbbEvaluator.h>
+typedef OpenSubdiv::Osd::TbbEvaluator GltfOsdEvaluator;
+#elif defined(GLTF_OSD_OMP)
+#include <opensubdiv/osd/ompEvaluator.h>
+typedef OpenSubdiv::Osd::OmpEvaluator GltfOsdEvaluator;
+#else
+#include <opensubdiv/osd/cpuEvaluator.h>
+typedef OpenSubdiv::Osd::CpuEvaluator GltfOsdEvaluator;
+#endif
+
+#include <QtCore/qtconcurrentmap.h>
+
+#include <cstring>
+
+using namespace OpenSubdiv;
+
+typedef Far::TopologyDescriptor GltfOsdDescriptor;
+
+namespace
+{
+    /// Run @p stencils over @p numSrc elements of @p width floats each.
+    QVector<float> evalStencils(const float* src, int numSrc, int width,
+                                const Far::StencilTable* stencils)
+    {
+        int numDst = stencils->GetNumStencils();
+        Osd::CpuVertexBuffer* srcBuf = Osd::CpuVertexBuffer::Create(width, numSrc);
+        Osd::CpuVertexBuffer* dstBuf = Osd::CpuVertexBuffer::Create(width, numDst);
+        srcBuf->UpdateData(src, 0, numSrc);
+
+        Osd::BufferDescriptor desc(0, width, width);
+        GltfOsdEvaluator::EvalStencils(srcBuf, desc, dstBuf, desc, stencils);
+
+        QVector<float> out(numDst * width);
+        memcpy(out.data(), dstBuf->BindCpuBuffer(), out.size() * sizeof(float));
+        delete srcBuf;
+        delete dstBuf;
+        return out;
+    }
+
+    /// Skin weights through the vertex stencils: blend every source
+    /// influence, then keep the strongest four.  Runs in chunks on the pool.
+    struct SkinTask
+    {
+        typedef void result_type;
+        static const int kChunk = 4096;
+        static const int kMaxInfluences = 16;
+
+        const Far::StencilTable* stencils;
+        const quint16* srcJoints;
+        const float*   srcWeights;
+        quint16*       dstJoints;
+        float*         dstWeights;
+
+        void operator()(int& chunk) const
+        {
+            const int*        sizes   = &stencils->GetSizes()[0];
+            const Far::Index* offsets = &stencils->GetOffsets()[0];
+            const Far::Index* indices = &stencils->GetControlIndices()[0];
+            const float*      weights = &stencils->GetWeights()[0];
+
+            int begin = chunk * kChunk;
+            int end   = qMin(begin + kChunk, stencils->GetNumStencils());
+            for (int s = begin; s < end; ++s)
+            {
+                quint16 j[kMaxInfluences];
+                float   w[kMaxInfluences];
+                int     n = 0;
+
+                for (int k = 0; k < sizes[s]; ++k) {
+                    int   src = indices[offsets[s] + k];
+                    float sw  = weights[offsets[s] + k];
+                    for (int c = 0; c < 4; ++c) {
+                        float cw = srcWeights[src*4 + c] * sw;
+                        if (cw <= 0.0f)
+                            continue;
+                        quint16 joint = srcJoints[src*4 + c];
+                        int slot = -1;
+                        for (int i = 0; i < n && slot < 0; ++i)
+                            if (j[i] == joint) slot = i;
+                        if (slot >= 0)              { w[slot] += cw; }
+                        else if (n < kMaxInfluences) { j[n] = joint; w[n] = cw; ++n; }
+                    }
+                }
+
+                quint16* oj = dstJoints  + s * 4;
+                float*   ow = dstWeights + s * 4;
+                float sum = 0.0f;
+                for (int c = 0; c < 4; ++c) {
+                    int best = -1;
+                    for (int i = 0; i < n; ++i)
+                        if (w[i] > 0.0f && (best < 0 || w[i] > w[best])) best = i;
+                    oj[c] = best >= 0 ? j[best] : 0;
+                    ow[c] = best >= 0 ? w[best] : 0.0f;
+                    if (best >= 0) w[best] = 0.0f;
+                    sum += ow[c];
+                }
+                if (sum <= 0.0f) { ow[0] = 1.0f; continue; }
+                for (int c = 0; c < 4; ++c)
+                    ow[c] /= sum;
+            }
+        }
+    };
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+int GltfSubdivider::maxLevel(const GltfMeshSnapshot& snap)
+{
+    int level = 0;
+    for (int g = 0; g < snap.groups.size(); ++g)
+        level = qMax(level, snap.groups[g].subdivLevel);
+    return level;
+}
+
+bool GltfSubdivider::refine(const GltfMeshSnapshot& in, GltfMeshSnapshot& out,
+                            QString* error)
+{
+    if (maxLevel(in) <= 0) {
+        out = in;
+        return true;
+    }
+
+    GltfMeshTopology topology;
+    if (!GltfTopology::build(in, topology)) {
+        if (error)
+            *error = QString("GltfSubdivider: '%1' has an invalid vertex index").arg(in.name);
+        return false;
+    }
+    return refine(in, topology, out, error);
+}
+
+bool GltfSubdivider::refine(const GltfMeshSnapshot& in, const GltfMeshTopology& topology,
+                            GltfMeshSnapshot& out, QString* error)
+{
+    const int maxL = maxLevel(in);
+    if (maxL <= 0) {
+        out = in;
+        return true;
+    }
+
+    const int numVerts = in.vertexCount();
+    const int numFaces = topology.faceCount();
+    const int numUVs   = in.uvs.size() / 2;
+    const bool hasUVs  = topology.allUVsValid;
+
+    // ---- topology --------------------------------------------------------
+    // the shared topology's corner arrays are OpenSubdiv's per-face indices
+    QVector<int> vertsPerFace(numFaces);
+    for (int f = 0; f < numFaces; ++f)
+        vertsPerFace[f] = topology.faceSize(f);
+
+    GltfOsdDescriptor desc;
+    desc.numVertices        = numVerts;
+    desc.numFaces           = numFaces;
+    desc.numVertsPerFace    = vertsPerFace.constData();
+    desc.vertIndicesPerFace = topology.cornerVerts.constData();
+
+    GltfOsdDescriptor::FVarChannel uvChannel;
+    if (hasUVs) {
+        uvChannel.numValues    = numUVs;
+        uvChannel.valueIndices = topology.cornerUVs.constData();
+        desc.numFVarChannels   = 1;
+        desc.fvarChannels      = &uvChannel;
+    }
+
+    // Mesh borders stay on the boundary curve; UV borders are smoothed but
+    // pinned at their corners so islands do not drift apart.
+    Sdc::Options sdcOptions;
+    sdcOptions.SetVtxBoundaryInterpolation(Sdc::Options::VTX_BOUNDARY_EDGE_ONLY);
+    sdcOptions.SetFVarLinearInterpolation(Sdc::Options::FVAR_LINEAR_CORNERS_ONLY);
+
+    Far::TopologyRefiner* refiner = Far::TopologyRefinerFactory<GltfOsdDescriptor>::Create(
+        desc, Far::TopologyRefinerFactory<GltfOsdDescriptor>::Options(Sdc::SCHEME_CATMARK, sdcOptions));
+    if (!refiner) {
+        if (error)
+            *error = QString("GltfSubdivider: OpenSubdiv rejected the topology of '%1'").arg(in.name);
+        return false;
+    }
+    // all levels are kept, so each group can pick its own
+    refiner->RefineUniform(Far::TopologyRefiner::UniformOptions(maxL));
+
+    // ---- primvars --------------------------------------------------------
+    // Stencils cover every level, control vertices included, so a stencil
+    // index is a global vertex index: level offset + level-local index.
+    Far::StencilTableFactory::Options so;
+    so.generateOffsets            = true;
+    so.generateControlVerts       = true;
+    so.generateIntermediateLevels = true;
+
+    GltfMeshSnapshot result;
+    result.name = in.name;
+
+    const Far::StencilTable* vStencils = Far::StencilTableFactory::Create(*refiner, so);
+    result.positions = evalStencils(in.positions.constData(), numVerts, 3, vStencils);
+
+    if (!in.joints.isEmpty()) {
+        int numStencils = vStencils->GetNumStencils();
+        result.joints.resize(numStencils * 4);
+        result.weights.resize(numStencils * 4);
+
+        SkinTask task;
+        task.stencils   = vStencils;
+        task.srcJoints  = in.joints.constData();
+        task.srcWeights = in.weights.constData();
+        task.dstJoints  = result.joints.data();
+        task.dstWeights = result.weights.data();
+
+        QVector<int> chunks((numStencils + SkinTask::kChunk - 1) / SkinTask::kChunk);
+        for (int c = 0; c < chunks.size(); ++c)
+            chunks[c] = c;
+        QtConcurrent::blockingMap(chunks, task);
+    }
+    delete vStencils;
+
+    if (hasUVs) {
+        so.interpolationMode = Far::StencilTableFactory::INTERPOLATE_FACE_VARYING;
+        so.fvarChannel       = 0;
+        const Far::StencilTable* uvStencils = Far::StencilTableFactory::Create(*refiner, so);
+        result.uvs = evalStencils(in.uvs.constData(), numUVs, 2, uvStencils);
+        delete uvStencils;
+    }
+
+    QVector<int> vertOffset(maxL + 1), uvOffset(maxL + 1);
+    for (int l = 1; l <= maxL; ++l) {
+        vertOffset[l] = vertOffset[l-1] + refiner->GetLevel(l-1).GetNumVertices();
+        uvOffset[l]   = uvOffset[l-1]   + (hasUVs ? refiner->GetLevel(l-1).GetNumFVarValues(0) : 0);
+    }
+
+    // ---- faces, per group at the group's level ---------------------------
+    for (int g = 0; g < in.groups.size(); ++g)
+    {
+        const GltfMeshSnapshot::Group& src = in.groups[g];
+        const int level = qBound(0, src.subdivLevel, maxL);
+
+        GltfMeshSnapshot::Group dst;
+        dst.material = src.material;
+
+        QVector<int> faces;
+        for (int f = 0; f < src.faces.size(); ++f)
+            if (src.faces[f] >= 0 && src.faces[f] < numFaces)
+                faces.append(src.faces[f]);
+
+        for (int l = 0; l < level; ++l) {
+            const Far::TopologyLevel& lvl = refiner->GetLevel(l);
+            QVector<int> children;
+            children.reserve(faces.size() * 4);
+            for (int f = 0; f < faces.size(); ++f) {
+                Far::ConstIndexArray child = lvl.GetFaceChildFaces(faces[f]);
+                for (int c = 0; c < child.size(); ++c)
+                    children.append(child[c]);
+            }
+            faces = children;
+        }
+
+        const Far::TopologyLevel& lvl = refiner->GetLevel(level);
+        dst.faces.reserve(faces.size());
+        for (int f = 0; f < faces.size(); ++f)
+        {
+            Far::ConstIndexArray fv = lvl.GetFaceVertices(faces[f]);
+            dst.faces.append(result.facetVerts.size() / 4);
+            for (int k = 0; k < 4; ++k)
+                result.facetVerts.append(k < fv.size() ? fv[k] + vertOffset[level] : -1);
+
+            if (hasUVs) {
+                Far::ConstIndexArray fuv = lvl.GetFaceFVarValues(faces[f], 0);
+                for (int k = 0; k < 4; ++k)
+                    result.facetUVs.append(k < fuv.size() ? fuv[k] + uvOffset[level] : -1);
+            } else {
+                for (int k = 0; k < 4; ++k)
+                    result.facetUVs.append(-1);
+            }
+        }
+        result.groups.append(dst);
+    }
+
+    delete refiner;
+    out = result;
+    return true;
+}
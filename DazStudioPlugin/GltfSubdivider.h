@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QString>
+
+#include "GltfTypes.h"
+
+struct GltfMeshTopology;
+
+/// Catmull-Clark refinement of a GltfMeshSnapshot through OpenSubdiv.
+///
+/// The whole mesh is refined uniformly to the highest level any material
+/// group asks for.  Each group then takes its faces from its own level, so
+/// only the groups that need density pay for it in the output.  Positions
+/// are evaluated from Far stencils by the Osd CPU evaluator chosen at build
+/// time (GLTF_OSD_OMP, GLTF_OSD_TBB, or serial); UVs are refined as a
+/// face-varying channel so seams stay intact; skin weights follow the same
+/// vertex stencils.
+class GltfSubdivider
+{
+public:
+    /// Highest GltfMeshSnapshot::Group::subdivLevel in @p snap.
+    static int maxLevel(const GltfMeshSnapshot& snap);
+
+    /// Refine @p in into @p out.  Output groups carry level 0.  Returns
+    /// false (and leaves @p out untouched) on invalid topology.
+    static bool refine(const GltfMeshSnapshot& in, GltfMeshSnapshot& out,
+                       QString* error = 0);
+
+    /// refine() with @p in's topology already built (GltfTopology).
+    static bool refine(const GltfMeshSnapshot& in, const GltfMeshTopology& topology,
+                       GltfMeshSnapshot& out, QString* error = 0);
+};
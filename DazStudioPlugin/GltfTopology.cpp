@@ -0,0 +1,184 @@
+// GltfTopology.cpp
+// CSR and half-edge adjacency of a mesh snapshot or a triangle list, for
+// the geometry passes to share.  SDK-free.
+
+#include "GltfTopology.h"
+#include "GltfTrace.h"
+
+#include <QtCore/qtconcurrentmap.h>
+
+// ---------------------------------------------------------------------------
+// Tasks
+// ---------------------------------------------------------------------------
+
+/// Pairs half-edges in chunks on the pool.  Half-edge h runs a -> b; its
+/// twin is the one half-edge leaving b whose next vertex is a, found among
+/// b's corners.  Each chunk writes only its own twin[] entries.
+struct GltfTopology::TwinTask
+{
+    typedef void result_type;
+    static const int kChunk = 8192;
+
+    const GltfMeshTopology* topo;
+    int*                    twin;
+
+    void operator()(int& chunk) const
+    {
+        const int* vertexOffsets = topo->vertexOffsets.constData();
+        const int* vertexCorners = topo->vertexCorners.constData();
+
+        int begin = chunk * kChunk;
+        int end   = qMin(begin + kChunk, topo->cornerCount());
+        for (int h = begin; h < end; ++h)
+        {
+            int a = topo->from(h);
+            int b = topo->to(h);
+            int found = -1;
+            int matches = 0;
+            if (a != b) {
+                for (int k = vertexOffsets[b]; k < vertexOffsets[b + 1]; ++k) {
+                    int c = vertexCorners[k];
+                    if (topo->to(c) == a) {
+                        found = c;
+                        ++matches;
+                    }
+                }
+            }
+            // more than two faces on the edge: no twin
+            twin[h] = (matches == 1) ? found : -1;
+        }
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+bool GltfTopology::build(const GltfMeshSnapshot& snap, GltfMeshTopology& out)
+{
+    GltfTraceScope trace("buildTopology", "scene");
+    out = GltfMeshTopology();
+
+    const int numVerts  = snap.vertexCount();
+    const int numUVs    = snap.uvs.size() / 2;
+    const int numFacets = snap.facetVerts.size() / 4;
+    const bool hasUVs   = snap.facetUVs.size() >= numFacets * 4;
+
+    // ---- faces -----------------------------------------------------------
+    GltfMeshTopology topo;
+    topo.faceOffsets.resize(numFacets + 1);
+    int corners = 0;
+    for (int f = 0; f < numFacets; ++f) {
+        topo.faceOffsets[f] = corners;
+        bool isQuad = snap.facetVerts[f*4 + 3] >= 0;
+        corners += isQuad ? 4 : 3;
+        topo.quadCount += isQuad;
+    }
+    topo.faceOffsets[numFacets] = corners;
+
+    topo.cornerVerts.resize(corners);
+    topo.cornerUVs.resize(corners);
+    topo.cornerFaces.resize(corners);
+    topo.allUVsValid = numUVs > 0 && hasUVs;
+
+    const qint32* facetVerts = snap.facetVerts.constData();
+    const qint32* facetUVs   = snap.facetUVs.constData();
+    for (int f = 0; f < numFacets; ++f)
+    {
+        int c = topo.faceOffsets[f];
+        int n = topo.faceOffsets[f + 1] - c;
+        for (int k = 0; k < n; ++k)
+        {
+            int v = facetVerts[f*4 + k];
+            if (v < 0 || v >= numVerts)
+                return false;
+            int uv = hasUVs ? facetUVs[f*4 + k] : -1;
+            if (uv < 0 || uv >= numUVs) {
+                uv = -1;
+                topo.allUVsValid = false;
+            }
+            topo.cornerVerts[c + k] = v;
+            topo.cornerUVs[c + k]   = uv;
+            topo.cornerFaces[c + k] = f;
+        }
+    }
+
+    link(topo, numVerts);
+    out = topo;
+    return true;
+}
+
+bool GltfTopology::buildTriangles(const int* triVerts, int triCount, int vertexCount,
+                                  GltfMeshTopology& out)
+{
+    GltfTraceScope trace("buildTriangleTopology", "scene");
+    out = GltfMeshTopology();
+
+    GltfMeshTopology topo;
+    const int corners = triCount * 3;
+    topo.faceOffsets.resize(triCount + 1);
+    for (int f = 0; f <= triCount; ++f)
+        topo.faceOffsets[f] = f * 3;
+
+    topo.cornerVerts.resize(corners);
+    topo.cornerUVs.fill(-1, corners);
+    topo.cornerFaces.resize(corners);
+    for (int c = 0; c < corners; ++c)
+    {
+        int v = triVerts[c];
+        if (v < 0 || v >= vertexCount)
+            return false;
+        topo.cornerVerts[c] = v;
+        topo.cornerFaces[c] = c / 3;
+    }
+
+    link(topo, vertexCount);
+    out = topo;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Internals
+// ---------------------------------------------------------------------------
+
+/// Fills in the vertex -> corner CSR, twins and border count of @p topo,
+/// whose face and corner arrays are set and in range.
+void GltfTopology::link(GltfMeshTopology& topo, int numVerts)
+{
+    const int corners = topo.cornerCount();
+
+    // ---- vertex -> corners -----------------------------------------------
+    topo.vertexOffsets.fill(0, numVerts + 1);
+    for (int c = 0; c < corners; ++c)
+        ++topo.vertexOffsets[topo.cornerVerts[c] + 1];
+    for (int v = 0; v < numVerts; ++v)
+        topo.vertexOffsets[v + 1] += topo.vertexOffsets[v];
+
+    topo.vertexCorners.resize(corners);
+    {
+        QVector<int> fill(topo.vertexOffsets);
+        for (int c = 0; c < corners; ++c)
+            topo.vertexCorners[fill[topo.cornerVerts[c]]++] = c;
+    }
+
+    // ---- half-edge twins -------------------------------------------------
+    topo.twin.resize(corners);
+    TwinTask task;
+    task.topo = &topo;
+    task.twin = topo.twin.data();
+
+    QVector<int> chunks((corners + TwinTask::kChunk - 1) / TwinTask::kChunk);
+    for (int c = 0; c < chunks.size(); ++c)
+        chunks[c] = c;
+    QtConcurrent::blockingMap(chunks, task);
+
+    // a half-edge repeated in the same direction (flipped face) can still
+    // have found a partner that did not find it back; keep pairs mutual
+    for (int h = 0; h < corners; ++h) {
+        int t = topo.twin[h];
+        if (t >= 0 && topo.twin[t] != h)
+            topo.twin[h] = -1;
+        if (topo.twin[h] < 0)
+            ++topo.borderEdges;
+    }
+}
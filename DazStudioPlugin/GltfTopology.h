@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QVector>
+
+#include "GltfTypes.h"
+
+/// Adjacency of one mesh, built when a pass needs more than the facet
+/// list and then only read: subdivision and expansion share a snapshot's,
+/// the LOD simplifier builds one over its welded triangles.
+///
+/// Everything is flat int arrays in CSR form.  Faces are a run of corners;
+/// corner c of face f is faceOffsets[f] + k.  Each corner is also the
+/// half-edge leaving it, towards the next corner of its face, so corner
+/// indices double as half-edge indices and twin[] pairs them up.  A
+/// vertex's corners (and so the faces and outgoing half-edges around it)
+/// are vertexCorners[vertexOffsets[v] .. vertexOffsets[v+1]).
+struct GltfMeshTopology
+{
+    QVector<int> faceOffsets;      // faceCount() + 1; quads have 4 corners, triangles 3
+    QVector<int> cornerVerts;      // vertex of each corner
+    QVector<int> cornerUVs;        // UV index of each corner, -1 if out of range
+    QVector<int> cornerFaces;      // face of each corner
+    QVector<int> twin;             // opposite half-edge; -1 on a border or non-manifold edge
+    QVector<int> vertexOffsets;    // vertexCount + 1
+    QVector<int> vertexCorners;    // corners of each vertex, by face order
+
+    int  quadCount;
+    int  borderEdges;              // half-edges without a twin
+    bool allUVsValid;              // every corner has a UV in range (false if the mesh has none)
+
+    GltfMeshTopology() : quadCount(0), borderEdges(0), allUVsValid(false) {}
+
+    int  faceCount() const   { return faceOffsets.isEmpty() ? 0 : faceOffsets.size() - 1; }
+    int  cornerCount() const { return cornerVerts.size(); }
+    bool isEmpty() const     { return faceOffsets.isEmpty(); }
+
+    int faceSize(int f) const { return faceOffsets[f + 1] - faceOffsets[f]; }
+
+    /// The half-edge after @p h around its face.
+    int next(int h) const
+    {
+        int f = cornerFaces[h];
+        return (h + 1 < faceOffsets[f + 1]) ? h + 1 : faceOffsets[f];
+    }
+    /// The half-edge before @p h around its face.
+    int prev(int h) const
+    {
+        int f = cornerFaces[h];
+        return (h > faceOffsets[f]) ? h - 1 : faceOffsets[f + 1] - 1;
+    }
+
+    /// Vertices at the two ends of half-edge @p h.
+    int from(int h) const { return cornerVerts[h]; }
+    int to(int h) const   { return cornerVerts[next(h)]; }
+
+    /// An interior edge whose two faces disagree on the UVs of either end.
+    bool isUVSeam(int h) const
+    {
+        int t = twin[h];
+        return t >= 0 && (cornerUVs[h] != cornerUVs[next(t)] || cornerUVs[next(h)] != cornerUVs[t]);
+    }
+};
+
+/// Builds GltfMeshTopology from snapshots.  SDK-free.
+class GltfTopology
+{
+public:
+    /// Topology of every facet of @p snap, whatever group it is in.  False,
+    /// with @p out left empty, if a facet names a vertex out of range.
+    static bool build(const GltfMeshSnapshot& snap, GltfMeshTopology& out);
+
+    /// Topology of @p triCount triangles, three vertex indices each in
+    /// @p triVerts, over @p vertexCount vertices and without UVs.  False,
+    /// with @p out left empty, if an index is out of range.
+    static bool buildTriangles(const int* triVerts, int triCount, int vertexCount,
+                               GltfMeshTopology& out);
+
+private:
+    static void link(GltfMeshTopology& topo, int numVerts);
+
+    struct TwinTask;
+};
@@ -0,0 +1,134 @@
+// GltfTrace.cpp
+// Chrome trace-event recording for the export pipeline.
+//
+// Output is the JSON object form of the trace-event format:
+//   { "traceEvents": [ { "name", "cat", "ph": "X", "ts", "dur", "pid", "tid" }, ... ],
+//     "displayTimeUnit": "ms" }
+// plus one "thread_name" metadata event per track.  Times are microseconds.
+
+#include "GltfTrace.h"
+
+#include <QtCore/qatomic.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qtextstream.h>
+#include <QtCore/qthread.h>
+#include <QtCore/qvector.h>
+
+namespace
+{
+    struct TraceEvent
+    {
+        const char* name;
+        const char* category;
+        qint64      beginUs;
+        qint64      durationUs;
+        int         track;
+    };
+
+    // Written by start() before s_enabled is raised, read-only afterwards.
+    QElapsedTimer s_clock;
+    QAtomicInt    s_enabled;
+
+    QMutex                  s_mutex;
+    QVector<TraceEvent>     s_events;
+    QHash<Qt::HANDLE, int>  s_tracks;   // thread -> track, 0 is the thread that called start()
+
+    // Call with s_mutex held.
+    int trackFor(Qt::HANDLE thread)
+    {
+        QHash<Qt::HANDLE, int>::const_iterator it = s_tracks.constFind(thread);
+        if (it != s_tracks.constEnd())
+            return it.value();
+        int track = s_tracks.size();
+        s_tracks.insert(thread, track);
+        return track;
+    }
+}
+
+void GltfTrace::start()
+{
+    s_enabled.fetchAndStoreOrdered(0);
+    QMutexLocker lock(&s_mutex);
+    s_events.clear();
+    s_events.reserve(1024);
+    s_tracks.clear();
+    trackFor(QThread::currentThreadId());
+    s_clock.start();
+    s_enabled.fetchAndStoreOrdered(1);
+}
+
+void GltfTrace::stop()
+{
+    s_enabled.fetchAndStoreOrdered(0);
+}
+
+bool GltfTrace::isEnabled()
+{
+    return s_enabled != 0;
+}
+
+qint64 GltfTrace::nowUs()
+{
+    return s_clock.nsecsElapsed() / 1000;
+}
+
+void GltfTrace::record(const char* name, const char* category, qint64 beginUs, qint64 endUs)
+{
+    // A scope that straddles stop() still lands; one that straddles a
+    // restart would carry the old clock, so drop it.
+    if (beginUs > endUs)
+        return;
+
+    QMutexLocker lock(&s_mutex);
+    TraceEvent e;
+    e.name       = name;
+    e.category   = category;
+    e.beginUs    = beginUs;
+    e.durationUs = endUs - beginUs;
+    e.track      = trackFor(QThread::currentThreadId());
+    s_events.append(e);
+}
+
+bool GltfTrace::write(const QString& path, QString* outError)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        if (outError)
+            *outError = "Cannot open " + path + " for writing: " + file.errorString();
+        return false;
+    }
+
+    QMutexLocker lock(&s_mutex);
+    QTextStream out(&file);
+    out << "{\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"DazToUnity\"}}";
+
+    for (int track = 0; track < s_tracks.size(); ++track)
+    {
+        QString threadName = track == 0 ? QString("Main") : QString("Worker %1").arg(track);
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track
+            << ",\"args\":{\"name\":\"" << threadName << "\"}}";
+        out << ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track
+            << ",\"args\":{\"sort_index\":" << track << "}}";
+    }
+
+    for (int i = 0; i < s_events.size(); ++i)
+    {
+        const TraceEvent& e = s_events[i];
+        out << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category
+            << "\",\"ph\":\"X\",\"ts\":" << e.beginUs << ",\"dur\":" << e.durationUs
+            << ",\"pid\":1,\"tid\":" << e.track << "}";
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    out.flush();
+
+    if (file.error() != QFile::NoError) {
+        if (outError)
+            *outError = "Failed writing " + path + ": " + file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QString>
+
+/// Process-wide recorder of timed phases, written out as a Chrome
+/// trace-event file (chrome://tracing, ui.perfetto.dev).
+///
+/// Off by default.  While it is off a GltfTraceScope costs one atomic
+/// read and nothing is allocated.  While on, every finished scope becomes a
+/// complete ("X") event on the track of the thread it ran on; pool threads
+/// get tracks of their own, named in order of first appearance.
+class GltfTrace
+{
+public:
+    /// Drop anything recorded so far and start recording.  Call from the
+    /// main thread, whose track is named "Main".
+    static void start();
+
+    /// Stop recording; what was recorded stays until the next start().
+    static void stop();
+
+    static bool isEnabled();
+
+    /// Write what was recorded as trace-event JSON.  False, with
+    /// @p outError set if given, if the file cannot be written.
+    static bool write(const QString& path, QString* outError = 0);
+
+    /// Microseconds since start().
+    static qint64 nowUs();
+
+    /// Record one event.  @p name and @p category must outlive the trace
+    /// (string literals).
+    static void record(const char* name, const char* category, qint64 beginUs, qint64 endUs);
+};
+
+/// Times its own lifetime as one trace event.
+///
+///     GltfTraceScope trace("exportHD", "action");
+class GltfTraceScope
+{
+public:
+    explicit GltfTraceScope(const char* name, const char* category = "gltf")
+        : m_name(GltfTrace::isEnabled() ? name : 0), m_category(category), m_beginUs(0)
+    {
+        if (m_name)
+            m_beginUs = GltfTrace::nowUs();
+    }
+
+    ~GltfTraceScope()
+    {
+        end();
+    }
+
+    /// Close the event now rather than at the end of the block.
+    void end()
+    {
+        if (m_name)
+            GltfTrace::record(m_name, m_category, m_beginUs, GltfTrace::nowUs());
+        m_name = 0;
+    }
+
+private:
+    Q_DISABLE_COPY(GltfTraceScope)
+
+    const char* m_name;         // null while tracing is off
+    const char* m_category;
+    qint64      m_beginUs;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+// Scene data shared by the glTF core and the Daz Studio exporter.  Plain
+// Qt containers only: nothing here may depend on the Daz Studio SDK.
+
+/// Per-primitive (per-material-group) geometry and material data.
+struct GltfPrimData
+{
+    // Geometry — expanded (no shared vertices), one entry per triangle corner.
+    // positions.size() == normals.size() == texcoords.size()/2 * 3
+    QVector<float> positions;   // xyz, flat
+    QVector<float> normals;     // xyz, flat (flat per-face normals)
+    QVector<float> texcoords;   // uv,  flat (V flipped for glTF convention)
+    QVector<quint16> joints;    // 4 per corner, skin joint indices; empty if unskinned
+    QVector<float>   weights;   // 4 per corner, summing to 1
+
+    // Material
+    QString materialName;
+    float   baseColor[4];              // RGBA, default 1,1,1,1
+    float   metallicFactor;            // default 0
+    float   roughnessFactor;           // default 0.5
+    QString baseColorTexturePath;      // absolute path, empty if none
+    QString normalTexturePath;         // absolute path, empty if none
+    float   opacity;                   // "Cutout Opacity", default 1
+    QString opacityTexturePath;        // cutout map, empty if none
+
+    GltfPrimData() : metallicFactor(0.0f), roughnessFactor(0.5f), opacity(1.0f)
+    {
+        baseColor[0] = baseColor[1] = baseColor[2] = baseColor[3] = 1.0f;
+    }
+};
+
+/// Raw geometry of one source mesh, copied out of the scene on the main
+/// thread.  Holds no SDK types, so expanding it into primitives can run on
+/// workers.
+struct GltfMeshSnapshot
+{
+    struct Group
+    {
+        GltfPrimData material;          // material fields only; geometry empty
+        QVector<int> faces;             // indices into the facet arrays
+        int          subdivLevel;       // Catmull-Clark levels still to apply
+
+        Group() : subdivLevel(0) {}
+    };
+
+    QString          name;
+    QVector<float>   positions;         // xyz per vertex, scaled, pivot-relative
+    QVector<float>   uvs;               // uv per UV index, Daz orientation
+    QVector<qint32>  facetVerts;        // 4 per facet, [3] == -1 for triangles
+    QVector<qint32>  facetUVs;          // 4 per facet
+    QVector<Group>   groups;            // one per material group
+    QVector<quint16> joints;            // 4 per vertex; empty if unskinned
+    QVector<float>   weights;           // 4 per vertex
+
+    int vertexCount() const { return positions.size() / 3; }
+};
+
+/// One glTF skin: joint node indices plus their inverse bind matrices.
+struct GltfSkinData
+{
+    QVector<int>   joints;              // node indices
+    QVector<float> inverseBindMatrices; // 16 per joint, column-major
+};
+
+/// One glTF mesh: a contiguous run of primitives in the exporter's list.
+struct GltfMeshData
+{
+    QString name;
+    int     firstPrim;
+    int     primCount;
+    quint64 contentHash;       // GltfHasher digest of the source geometry, 0 if unhashed
+    int     materialBase;      // LOD meshes: first primitive whose materials these
+                               // reuse, one for one; -1 for a mesh with its own
+
+    GltfMeshData() : firstPrim(0), primCount(0), contentHash(0), materialBase(-1) {}
+};
+
+/// One glTF node: a mesh carrier, a transform-only parent or a skeleton joint.
+struct GltfNodeData
+{
+    QString name;
+    int     parent;            // index into the node list, -1 for a scene root
+    int     mesh;              // -1 if the node carries no mesh
+    int     skin;              // -1 if the mesh is not skinned
+    float   translation[3];    // local to parent
+    float   rotation[4];       // xyzw, local to parent
+    float   scale[3];
+
+    // EXT_mesh_gpu_instancing: one TRS per instance, local to this node.
+    // Empty for ordinary nodes.
+    QVector<float> instanceTranslations;   // xyz
+    QVector<float> instanceRotations;      // xyzw
+    QVector<float> instanceScales;         // xyz
+
+    // MSFT_lod: nodes drawn in place of this one, finest first, and the
+    // screen coverage below which each level (this node included) drops out.
+    // LOD nodes are listed here only, never as scene roots or children.
+    QVector<int>   lods;
+    QVector<float> lodCoverage;            // lods.size() + 1 entries
+
+    GltfNodeData() : parent(-1), mesh(-1), skin(-1)
+    {
+        translation[0] = translation[1] = translation[2] = 0.0f;
+        rotation[0] = rotation[1] = rotation[2] = 0.0f; rotation[3] = 1.0f;
+        scale[0] = scale[1] = scale[2] = 1.0f;
+    }
+};
+
+/// Everything written to one GLB apart from animation.
+struct GltfSceneData
+{
+    QVector<GltfPrimData> prims;        // materials are one per primitive
+    QVector<GltfMeshData> meshes;
+    QVector<GltfNodeData> nodes;
+    QVector<GltfSkinData> skins;
+};
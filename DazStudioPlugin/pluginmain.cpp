@@ -32,8 +32,10 @@ NEW_PLUGIN_CUSTOM_CLASS_GUID(DzUnityDialog, 06cf5776-8e81-4a81-bad8-619ed1205b58
 
 #include "UnitTest_DzUnityAction.h"
 #include "UnitTest_DzUnityDialog.h"
+#include "UnitTest_DzGLTFExporter.h"
 
 DZ_PLUGIN_CLASS_GUID(UnitTest_DzUnityAction, 17637434-188f-46eb-81e2-8829f2440742);
 DZ_PLUGIN_CLASS_GUID(UnitTest_DzUnityDialog, ca9c9f54-236d-4ab6-bca3-1cf6c3f93f6a);
+DZ_PLUGIN_CLASS_GUID(UnitTest_DzGLTFExporter, 5b0e3f6c-8d21-4a7e-9c4b-2f1d6a93e847);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,383 @@
+// GltfBenchmark.cpp
+// Times each stage of the glTF core on synthetic Genesis-scale meshes.
+//
+//   gltfbenchmark [--cases genesis_base,genesis_hd2,genesis_hd3] [--repeat 3]
+//                 [--dir <scratch folder>] [--out <results.json>] [--label <text>]
+//                 [--verify]
+//
+// Every stage is run --repeat times per case and its median reported, so one
+// stray page fault or pool warm-up does not decide the number.  Results go
+// to stdout as a table and, with --out, to a JSON file in the same layout as
+// Test/Results, for comparing builds side by side.  --verify also checks
+// that the file write() produced means the same as writeToBuffer()'s GLB,
+// that the specialised expansion matches the generic, checked loop, and
+// that every half-edge twin in the mesh topology points back.
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QVector>
+
+#include <algorithm>
+#include <cstdio>
+
+#include "GltfSyntheticMesh.h"
+#include "GltfSceneBuilder.h"
+#include "GltfTopology.h"
+#include "GltfGlbWriter.h"
+#include "GltfGlbReader.h"
+#include "GltfEquivalence.h"
+
+// ----------------------------------------------------------------------------
+// Cases
+// ----------------------------------------------------------------------------
+
+// Vertex counts of Genesis 8 at its base resolution and at the two HD
+// subdivision levels Daz Studio ships; 20 surfaces and 170 joints as on the
+// stock figure.
+struct BenchCase
+{
+    const char* name;
+    int         vertices;
+};
+
+static const BenchCase kCases[] = {
+    { "genesis_base",   25000 },
+    { "genesis_hd2",   400000 },
+    { "genesis_hd3",  1600000 },
+};
+static const int kSurfaces = 20;
+static const int kJoints   = 170;
+
+enum Stage { TopologyStage, ExpandCheckedStage, ExpandStage, BuildStage, NormalsStage, LayoutStage, JsonStage,
+             PackStage, WriteStage, StageCount };
+
+static const char* const kStageNames[StageCount] = {
+    "Topology", "Expand Checked", "Expand", "Build Scene", "Normals", "Layout", "JSON", "Pack", "Write"
+};
+
+struct CaseResult
+{
+    QString name;
+    int     vertices;
+    int     triangles;
+    qint64  glbBytes;
+    double  medianMs[StageCount];
+};
+
+// ----------------------------------------------------------------------------
+// Helpers
+// ----------------------------------------------------------------------------
+
+static double elapsedMs(const QElapsedTimer& timer)
+{
+    return timer.nsecsElapsed() / 1000000.0;
+}
+
+static double median(QVector<double> samples)
+{
+    if (samples.isEmpty())
+        return 0.0;
+    std::sort(samples.begin(), samples.end());
+    int mid = samples.size() / 2;
+    return (samples.size() % 2) ? samples[mid] : 0.5 * (samples[mid - 1] + samples[mid]);
+}
+
+// The flat-normal pass on its own: one computeFlatNormal() per triangle of
+// every primitive, as expandSnapshot() does.  Returns a checksum so the
+// loop cannot be optimised away.
+static float normalsPass(const GltfSceneData& scene)
+{
+    float sum = 0.0f;
+    for (int p = 0; p < scene.prims.size(); ++p)
+    {
+        const float* pos = scene.prims[p].positions.constData();
+        int corners = scene.prims[p].positions.size() / 3;
+        for (int c = 0; c + 2 < corners; c += 3) {
+            float n[3];
+            GltfSceneBuilder::computeFlatNormal(pos + c * 3, pos + (c + 1) * 3, pos + (c + 2) * 3, n);
+            sum += n[1];
+        }
+    }
+    return sum;
+}
+
+static int triangleCount(const GltfSceneData& scene)
+{
+    int corners = 0;
+    for (int p = 0; p < scene.prims.size(); ++p)
+        corners += scene.prims[p].positions.size() / 3;
+    return corners / 3;
+}
+
+// expandSnapshot() must write exactly what the generic loop writes.
+static bool samePrims(const QVector<GltfPrimData>& a, const QVector<GltfPrimData>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (int p = 0; p < a.size(); ++p)
+    {
+        if (a[p].positions != b[p].positions || a[p].normals != b[p].normals ||
+            a[p].texcoords != b[p].texcoords || a[p].joints != b[p].joints ||
+            a[p].weights != b[p].weights)
+            return false;
+    }
+    return true;
+}
+
+static bool twinsPair(const GltfMeshTopology& topo)
+{
+    for (int h = 0; h < topo.cornerCount(); ++h)
+    {
+        int t = topo.twin[h];
+        if (t >= 0 && (topo.twin[t] != h || topo.from(t) != topo.to(h) || topo.to(t) != topo.from(h)))
+            return false;
+    }
+    return true;
+}
+
+static bool verifyOutput(const QString& glbPath, const QByteArray& glb, QString& error)
+{
+    GltfGlbReader reader;
+    GltfDocument  fromFile, fromBuffer;
+    if (!reader.read(glbPath, fromFile) || !reader.parse(glb, fromBuffer)) {
+        error = reader.getLastError();
+        return false;
+    }
+    QStringList differences;
+    if (!GltfEquivalence::compare(fromFile, fromBuffer, GltfEquivalenceOptions(), differences)) {
+        error = "write() and writeToBuffer() disagree: " + differences.join("; ");
+        return false;
+    }
+    return true;
+}
+
+static bool runCase(const BenchCase& bc, int repeat, bool verify, const QString& scratchDir,
+                    CaseResult& result, QString& error)
+{
+    GltfSyntheticOptions options;
+    options.name           = bc.name;
+    options.targetVertices = bc.vertices;
+    options.surfaces       = kSurfaces;
+    options.joints         = kJoints;
+    GltfSyntheticSource source(options);
+
+    // expansion on its own, both loops over the same snapshot
+    GltfMeshSnapshot snap;
+    if (!source.snapshot(0, snap)) {
+        error = source.getLastError();
+        return false;
+    }
+    QVector<GltfPrimData> checkedPrims, prims;
+    GltfMeshTopology topology;
+
+    const QString glbPath = QDir(scratchDir).filePath(QString("%1.glb").arg(bc.name));
+    const QVector<GltfAnimChannel> noChannels;
+    QVector<double> samples[StageCount];
+    GltfGlbWriter writer;
+    volatile float sink = 0.0f;
+    QByteArray glb;
+
+    for (int r = 0; r < repeat; ++r)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        if (!GltfTopology::build(snap, topology)) {
+            error = "invalid vertex index in the synthetic mesh";
+            return false;
+        }
+        samples[TopologyStage].append(elapsedMs(timer));
+
+        timer.restart();
+        checkedPrims.clear();
+        GltfSceneBuilder::expandSnapshotChecked(snap, checkedPrims);
+        samples[ExpandCheckedStage].append(elapsedMs(timer));
+
+        timer.restart();
+        prims.clear();
+        GltfSceneBuilder::expandSnapshot(snap, prims);
+        samples[ExpandStage].append(elapsedMs(timer));
+
+        timer.restart();
+        GltfSceneData scene;
+        if (!GltfSceneBuilder::buildScene(source, scene)) {
+            error = source.getLastError();
+            return false;
+        }
+        source.addSkeleton(scene);
+        samples[BuildStage].append(elapsedMs(timer));
+
+        timer.restart();
+        sink = sink + normalsPass(scene);
+        samples[NormalsStage].append(elapsedMs(timer));
+
+        if (!writer.writeToBuffer(scene, noChannels, glb)) {
+            error = writer.getLastError();
+            return false;
+        }
+        samples[LayoutStage].append(writer.getLastTimings().layoutMs);
+        samples[JsonStage].append(writer.getLastTimings().jsonMs);
+        samples[PackStage].append(writer.getLastTimings().buffersMs);
+
+        timer.restart();
+        if (!writer.write(scene, noChannels, glbPath)) {
+            error = writer.getLastError();
+            return false;
+        }
+        samples[WriteStage].append(elapsedMs(timer));
+
+        result.vertices  = source.vertexCount();
+        result.triangles = triangleCount(scene);
+        result.glbBytes  = glb.size();
+    }
+    bool verified = !verify || verifyOutput(glbPath, glb, error);
+    if (verified && verify && !samePrims(prims, checkedPrims)) {
+        error = "expandSnapshot() and expandSnapshotChecked() disagree";
+        verified = false;
+    }
+    if (verified && verify && !twinsPair(topology)) {
+        error = "GltfTopology built half-edge twins that do not pair up";
+        verified = false;
+    }
+    QFile::remove(glbPath);
+    if (!verified)
+        return false;
+
+    result.name = bc.name;
+    for (int s = 0; s < StageCount; ++s)
+        result.medianMs[s] = median(samples[s]);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Output
+// ----------------------------------------------------------------------------
+
+static void printTable(const QVector<CaseResult>& results)
+{
+    std::printf("%-14s %10s %10s %12s", "Case", "Vertices", "Triangles", "GLB bytes");
+    for (int s = 0; s < StageCount; ++s)
+        std::printf(" %14s", kStageNames[s]);
+    std::printf("\n");
+
+    for (int i = 0; i < results.size(); ++i)
+    {
+        const CaseResult& r = results[i];
+        std::printf("%-14s %10d %10d %12lld", r.name.toLatin1().constData(),
+                    r.vertices, r.triangles, (long long)r.glbBytes);
+        for (int s = 0; s < StageCount; ++s)
+            std::printf(" %14.2f", r.medianMs[s]);
+        std::printf("\n");
+    }
+    std::printf("(median ms per stage)\n");
+}
+
+static bool writeResultsJson(const QString& path, const QString& label, int repeat,
+                             const QVector<CaseResult>& results)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+
+    QTextStream out(&file);
+    out << "{\n";
+    out << "\t\"Benchmark Results Version\" : 1,\n";
+    out << "\t\"Label\" : \"" << label << "\",\n";
+    out << "\t\"Date\" : \"" << QDateTime::currentDateTime().toString(Qt::ISODate) << "\",\n";
+    out << "\t\"Threads\" : " << QThreadPool::globalInstance()->maxThreadCount() << ",\n";
+    out << "\t\"Repeat\" : " << repeat << ",\n";
+    out << "\t\"Cases\" : [\n";
+    for (int i = 0; i < results.size(); ++i)
+    {
+        const CaseResult& r = results[i];
+        out << "\t\t{\n";
+        out << "\t\t\t\"Case\" : \"" << r.name << "\",\n";
+        out << "\t\t\t\"Vertices\" : " << r.vertices << ",\n";
+        out << "\t\t\t\"Triangles\" : " << r.triangles << ",\n";
+        out << "\t\t\t\"GLB Bytes\" : " << r.glbBytes << ",\n";
+        out << "\t\t\t\"Timings (ms)\" : {\n";
+        for (int s = 0; s < StageCount; ++s)
+            out << "\t\t\t\t\"" << kStageNames[s] << "\" : "
+                << QString::number(r.medianMs[s], 'f', 3)
+                << (s + 1 < StageCount ? ",\n" : "\n");
+        out << "\t\t\t}\n";
+        out << "\t\t}" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "\t]\n";
+    out << "}\n";
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// main
+// ----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+
+    QStringList caseNames;
+    for (size_t i = 0; i < sizeof(kCases) / sizeof(kCases[0]); ++i)
+        caseNames << kCases[i].name;
+    int     repeat = 3;
+    QString outPath;
+    QString scratchDir = QDir::tempPath();
+    QString label = "unlabelled";
+    bool    verify = false;
+
+    for (int i = 1; i < args.size(); ++i)
+    {
+        const QString& a = args[i];
+        bool hasValue = i + 1 < args.size();
+        if (a == "--cases" && hasValue)
+            caseNames = args[++i].split(',', QString::SkipEmptyParts);
+        else if (a == "--repeat" && hasValue)
+            repeat = qMax(1, args[++i].toInt());
+        else if (a == "--out" && hasValue)
+            outPath = args[++i];
+        else if (a == "--dir" && hasValue)
+            scratchDir = args[++i];
+        else if (a == "--label" && hasValue)
+            label = args[++i];
+        else if (a == "--verify")
+            verify = true;
+        else {
+            std::fprintf(stderr, "gltfbenchmark: unknown argument %s\n", a.toLocal8Bit().constData());
+            return 2;
+        }
+    }
+
+    QVector<CaseResult> results;
+    for (int c = 0; c < caseNames.size(); ++c)
+    {
+        const BenchCase* bc = 0;
+        for (size_t i = 0; i < sizeof(kCases) / sizeof(kCases[0]); ++i)
+            if (caseNames[c] == kCases[i].name)
+                bc = &kCases[i];
+        if (!bc) {
+            std::fprintf(stderr, "gltfbenchmark: unknown case %s\n", caseNames[c].toLocal8Bit().constData());
+            return 2;
+        }
+
+        CaseResult result;
+        QString error;
+        if (!runCase(*bc, repeat, verify, scratchDir, result, error)) {
+            std::fprintf(stderr, "gltfbenchmark: %s failed: %s\n", bc->name, error.toLocal8Bit().constData());
+            return 1;
+        }
+        results.append(result);
+    }
+
+    printTable(results);
+    if (!outPath.isEmpty() && !writeResultsJson(outPath, label, repeat, results)) {
+        std::fprintf(stderr, "gltfbenchmark: cannot write %s\n", outPath.toLocal8Bit().constData());
+        return 1;
+    }
+    return 0;
+}
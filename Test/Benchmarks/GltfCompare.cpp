@@ -0,0 +1,67 @@
+// GltfCompare.cpp
+// Checks that two glTF exports describe the same scene (GltfEquivalence).
+//
+//   gltfcompare <expected.glb|.gltf> <actual.glb|.gltf>
+//               [--position-tolerance <units>] [--normal-tolerance <n>]
+//               [--texcoord-tolerance <n>] [--weight-tolerance <n>]
+//               [--max-differences <n>]
+//
+// Exit code 0 if equivalent, 1 if not (differences on stdout), 2 on bad
+// arguments.
+
+#include <QCoreApplication>
+#include <QStringList>
+
+#include <cstdio>
+
+#include "GltfEquivalence.h"
+
+static void usage()
+{
+    std::fprintf(stderr, "usage: gltfcompare <expected> <actual> [--position-tolerance x] "
+                         "[--normal-tolerance x] [--texcoord-tolerance x] [--weight-tolerance x] "
+                         "[--max-differences n]\n");
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+
+    GltfEquivalenceOptions options;
+    QStringList paths;
+    for (int i = 1; i < args.size(); ++i)
+    {
+        const QString& a = args[i];
+        bool hasValue = i + 1 < args.size();
+        if (!a.startsWith("--"))
+            paths << a;
+        else if (a == "--position-tolerance" && hasValue)
+            options.positionTolerance = args[++i].toFloat();
+        else if (a == "--normal-tolerance" && hasValue)
+            options.normalTolerance = args[++i].toFloat();
+        else if (a == "--texcoord-tolerance" && hasValue)
+            options.texcoordTolerance = args[++i].toFloat();
+        else if (a == "--weight-tolerance" && hasValue)
+            options.weightTolerance = args[++i].toFloat();
+        else if (a == "--max-differences" && hasValue)
+            options.maxDifferences = args[++i].toInt();
+        else {
+            usage();
+            return 2;
+        }
+    }
+    if (paths.size() != 2) {
+        usage();
+        return 2;
+    }
+
+    QStringList differences;
+    if (GltfEquivalence::compareFiles(paths[0], paths[1], options, differences)) {
+        std::printf("equivalent\n");
+        return 0;
+    }
+    for (int i = 0; i < differences.size(); ++i)
+        std::printf("%s\n", differences[i].toLocal8Bit().constData());
+    return 1;
+}
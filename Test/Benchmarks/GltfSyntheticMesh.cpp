@@ -0,0 +1,181 @@
+// GltfSyntheticMesh.cpp
+// Deterministic figure-sized meshes for the glTF core benchmarks and tests.
+
+#include "GltfSyntheticMesh.h"
+
+#include <cmath>
+
+// Height of the tube, in output units (metres), roughly a standing figure.
+static const float kHeight = 1.8f;
+
+// Small LCG: identical streams on every compiler and platform, unlike rand().
+static float nextJitter(quint32& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return ((state >> 8) / 16777216.0f - 0.5f) * 0.002f;
+}
+
+GltfSyntheticSource::GltfSyntheticSource(const GltfSyntheticOptions& options)
+    : m_options(options)
+{
+    generate();
+}
+
+bool GltfSyntheticSource::readGeometry(int mesh, GltfMeshSnapshot& outSnap)
+{
+    if (mesh != 0 || m_snap.positions.isEmpty()) {
+        m_sLastError = "synthetic mesh: nothing generated";
+        return false;
+    }
+    outSnap = m_snap;       // implicitly shared; nothing is copied here
+    return true;
+}
+
+void GltfSyntheticSource::readMaterial(int mesh, int group, GltfPrimData& prim)
+{
+    Q_UNUSED(mesh);
+    prim.baseColor[0]    = ((group * 37) % 100) / 100.0f;
+    prim.baseColor[1]    = ((group * 61) % 100) / 100.0f;
+    prim.baseColor[2]    = ((group * 83) % 100) / 100.0f;
+    prim.roughnessFactor = 0.3f + 0.02f * group;
+    prim.baseColorTexturePath = QString("/synthetic/%1_%2_diffuse.png").arg(m_options.name).arg(prim.materialName);
+    if (group % 2 == 0)
+        prim.normalTexturePath = QString("/synthetic/%1_%2_normal.png").arg(m_options.name).arg(prim.materialName);
+}
+
+void GltfSyntheticSource::generate()
+{
+    const int cols = qMax(8, (int)std::sqrt(m_options.targetVertices / 2.0));
+    const int rows = qMax(2, m_options.targetVertices / cols);
+    const int surfaces = qMax(1, m_options.surfaces);
+
+    m_snap = GltfMeshSnapshot();
+    m_snap.name = m_options.name;
+
+    // ---- vertices: a closed tube whose radius swells and narrows ---------
+    quint32 rng = m_options.seed;
+    m_snap.positions.resize(rows * cols * 3);
+    float* pos = m_snap.positions.data();
+    for (int r = 0; r < rows; ++r)
+    {
+        float y      = kHeight * r / (rows - 1);
+        float radius = 0.15f + 0.05f * std::sin(y * 7.0f);
+        for (int c = 0; c < cols; ++c) {
+            float a = 6.2831853f * c / cols;
+            float* p = pos + (r * cols + c) * 3;
+            p[0] = radius * std::cos(a) + nextJitter(rng);
+            p[1] = y + nextJitter(rng);
+            p[2] = radius * std::sin(a) + nextJitter(rng);
+        }
+    }
+
+    // ---- UVs: one more column than vertices, split at the seam -----------
+    m_snap.uvs.resize(rows * (cols + 1) * 2);
+    float* uv = m_snap.uvs.data();
+    for (int r = 0; r < rows; ++r)
+        for (int c = 0; c <= cols; ++c) {
+            uv[(r * (cols + 1) + c) * 2 + 0] = (float)c / cols;
+            uv[(r * (cols + 1) + c) * 2 + 1] = (float)r / (rows - 1);
+        }
+
+    // ---- facets, banded into surfaces --------------------------------------
+    m_snap.groups.resize(surfaces);
+    for (int g = 0; g < surfaces; ++g)
+        m_snap.groups[g].material.materialName = QString("Surface_%1").arg(g);
+
+    int quads = (rows - 1) * cols;
+    int tris  = m_options.triangleEvery > 0 ? quads / m_options.triangleEvery : 0;
+    m_snap.facetVerts.reserve((quads + tris) * 4);
+    m_snap.facetUVs.reserve((quads + tris) * 4);
+
+    int faceCounter = 0;
+    for (int r = 0; r < rows - 1; ++r)
+    {
+        QVector<int>& faces = m_snap.groups[r * surfaces / (rows - 1)].faces;
+        for (int c = 0; c < cols; ++c, ++faceCounter)
+        {
+            const qint32 v[4]  = { r * cols + c, r * cols + (c + 1) % cols,
+                                   (r + 1) * cols + (c + 1) % cols, (r + 1) * cols + c };
+            const qint32 t[4]  = { r * (cols + 1) + c, r * (cols + 1) + c + 1,
+                                   (r + 1) * (cols + 1) + c + 1, (r + 1) * (cols + 1) + c };
+
+            bool split = m_options.triangleEvery > 0
+                      && faceCounter % m_options.triangleEvery == m_options.triangleEvery - 1;
+            if (!split) {
+                faces.append(m_snap.facetVerts.size() / 4);
+                for (int k = 0; k < 4; ++k) {
+                    m_snap.facetVerts.append(v[k]);
+                    m_snap.facetUVs.append(t[k]);
+                }
+                continue;
+            }
+
+            static const int triCorners[2][3] = { {0,1,2}, {0,2,3} };
+            for (int h = 0; h < 2; ++h) {
+                faces.append(m_snap.facetVerts.size() / 4);
+                for (int k = 0; k < 3; ++k) {
+                    m_snap.facetVerts.append(v[triCorners[h][k]]);
+                    m_snap.facetUVs.append(t[triCorners[h][k]]);
+                }
+                m_snap.facetVerts.append(-1);
+                m_snap.facetUVs.append(-1);
+            }
+        }
+    }
+
+    // ---- skin: four neighbouring joints along the length -----------------
+    const int joints = m_options.joints;
+    if (joints <= 0)
+        return;
+
+    m_snap.joints.fill(0, rows * cols * 4);
+    m_snap.weights.fill(0.0f, rows * cols * 4);
+    for (int r = 0; r < rows; ++r)
+    {
+        float t  = (float)r / (rows - 1) * (joints - 1);
+        int   j0 = (int)t;
+        quint16 j4[4];
+        float   w4[4];
+        float   sum = 0.0f;
+        for (int k = 0; k < 4; ++k) {
+            int j = j0 - 1 + k;
+            bool valid = j >= 0 && j < joints;
+            j4[k] = valid ? (quint16)j : 0;
+            w4[k] = valid ? qMax(0.0f, 1.0f - std::fabs(t - j) * 0.5f) : 0.0f;
+            sum  += w4[k];
+        }
+        for (int k = 0; k < 4; ++k)
+            w4[k] /= sum;
+
+        for (int c = 0; c < cols; ++c)
+            for (int k = 0; k < 4; ++k) {
+                m_snap.joints[(r * cols + c) * 4 + k]  = j4[k];
+                m_snap.weights[(r * cols + c) * 4 + k] = w4[k];
+            }
+    }
+}
+
+void GltfSyntheticSource::addSkeleton(GltfSceneData& scene) const
+{
+    if (m_options.joints <= 0 || scene.nodes.isEmpty())
+        return;
+
+    GltfSkinData skin;
+    int parent = 0;
+    for (int j = 0; j < m_options.joints; ++j)
+    {
+        GltfNodeData bone;
+        bone.name           = QString("bone_%1").arg(j);
+        bone.parent         = parent;
+        bone.translation[1] = (j == 0) ? 0.0f : kHeight / m_options.joints;
+        parent = scene.nodes.size();
+        scene.nodes.append(bone);
+
+        skin.joints.append(parent);
+        for (int k = 0; k < 16; ++k)
+            skin.inverseBindMatrices.append((k % 5 == 0) ? 1.0f : 0.0f);
+    }
+
+    scene.nodes[0].skin = scene.skins.size();
+    scene.skins.append(skin);
+}
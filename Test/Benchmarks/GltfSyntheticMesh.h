@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QString>
+
+#include "GltfMeshSource.h"
+
+/// Shape of a synthetic test mesh.
+struct GltfSyntheticOptions
+{
+    QString name;
+    int     targetVertices;   // rounded to a whole grid
+    int     surfaces;         // material groups, as bands of rows
+    int     joints;           // skin joints, 4 influences per vertex; 0 = unskinned
+    int     triangleEvery;    // every Nth quad is emitted as two triangles; 0 = quads only
+    quint32 seed;             // position jitter
+
+    GltfSyntheticOptions()
+        : targetVertices(25000), surfaces(20), joints(0), triangleEvery(16), seed(1) {}
+};
+
+/// Deterministic stand-in for a figure mesh: a jittered quad grid wrapped
+/// into a closed tube, with Daz-style UVs (seam column duplicated), row
+/// bands as surfaces and smooth falloff skin weights along its length.
+/// Same options, same bytes, on every platform.
+class GltfSyntheticSource : public GltfMeshSource
+{
+public:
+    explicit GltfSyntheticSource(const GltfSyntheticOptions& options);
+
+    int  meshCount() const { return 1; }
+    bool readGeometry(int mesh, GltfMeshSnapshot& outSnap);
+    void readMaterial(int mesh, int group, GltfPrimData& prim);
+
+    int vertexCount() const { return m_snap.vertexCount(); }
+    int facetCount() const { return m_snap.facetVerts.size() / 4; }
+
+    /// Give @p scene a chain of options.joints bones under its first node,
+    /// bound through one skin with identity inverse bind matrices.
+    void addSkeleton(GltfSceneData& scene) const;
+
+private:
+    GltfSyntheticOptions m_options;
+    GltfMeshSnapshot     m_snap;
+
+    void generate();
+};
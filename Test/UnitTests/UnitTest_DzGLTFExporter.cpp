@@ -0,0 +1,722 @@
+#ifdef UNITTEST_DZBRIDGE
+
+#include <QDir>
+#include <QFile>
+#include <QSet>
+
+#include <dzapp.h>
+#include <dznode.h>
+#include <dzobject.h>
+#include <dzmorph.h>
+#include <dzfloatproperty.h>
+
+#include "UnitTest_DzGLTFExporter.h"
+#include "DzGLTFExporter.h"
+#include "GltfGlbWriter.h"
+#include "GltfGlbReader.h"
+#include "GltfEquivalence.h"
+#include "GltfSceneBuilder.h"
+#include "GltfKeyframeReducer.h"
+#include "GltfAnimationStream.h"
+#include "GltfSubdivider.h"
+#include "GltfMeshSimplifier.h"
+#include "GltfOcclusionCuller.h"
+#include "GltfBufferPool.h"
+#include "GltfSyntheticMesh.h"
+
+#include <cmath>
+
+// Quads of a cube round the origin, wound outwards.  Vertex index bits:
+// 1 = +X, 2 = +Y, 4 = +Z; the +Y face is face 3.
+static const int kCubeFaces[6][4] = {
+	{ 0, 4, 6, 2 }, { 1, 3, 7, 5 }, { 0, 1, 5, 4 },
+	{ 2, 6, 7, 3 }, { 0, 2, 3, 1 }, { 4, 5, 7, 6 }
+};
+
+UnitTest_DzGLTFExporter::UnitTest_DzGLTFExporter()
+{
+}
+
+bool UnitTest_DzGLTFExporter::runUnitTests()
+{
+	RUNTEST(_DzGLTFExporter);
+	RUNTEST(writeToBufferMatchesWrite);
+	RUNTEST(splitBuffersMatchGlb);
+	RUNTEST(incrementalUpdateMatchesFullWrite);
+	RUNTEST(reorderedTrianglesAreEquivalent);
+	RUNTEST(movedVertexIsDetected);
+	RUNTEST(morphValueChangesContentHash);
+	RUNTEST(keyReductionStaysWithinTolerance);
+	RUNTEST(smallestThreeRoundTrips);
+	RUNTEST(streamedAnimationMatchesInMemory);
+	RUNTEST(subdividedCubeRefinesPerGroup);
+	RUNTEST(subdividedOpenBoxKeepsBorders);
+	RUNTEST(simplifiedGridKeepsUVSeam);
+	RUNTEST(enclosedBoxIsCulled);
+	RUNTEST(bufferPoolReusesBlocks);
+
+	return true;
+}
+
+// A small skinned figure stand-in: a few thousand vertices, 6 surfaces, 12 joints.
+void UnitTest_DzGLTFExporter::buildSyntheticScene(GltfSceneData& scene)
+{
+	GltfSyntheticOptions options;
+	options.name = "UnitTestFigure";
+	options.targetVertices = 4000;
+	options.surfaces = 6;
+	options.joints = 12;
+	GltfSyntheticSource source(options);
+
+	scene = GltfSceneData();
+	GltfSceneBuilder::buildScene(source, scene);
+	source.addSkeleton(scene);
+}
+
+// The largest error, over every key of @p original, of @p reduced
+// interpolated at that key's time.
+float UnitTest_DzGLTFExporter::maxReductionError(const GltfAnimChannel& original, const GltfAnimChannel& reduced)
+{
+	int comps = original.componentCount();
+	float maxError = 0.0f;
+	int span = 0;
+	for (int k = 0; k < original.keyCount(); k++)
+	{
+		float time = original.times[k];
+		while (span + 2 < reduced.keyCount() && reduced.times[span + 1] <= time)
+			span++;
+		float value[4];
+		if (reduced.keyCount() == 1)
+		{
+			for (int c = 0; c < comps; c++)
+				value[c] = reduced.values[c];
+		}
+		else
+		{
+			float t0 = reduced.times[span];
+			float dt = reduced.times[span + 1] - t0;
+			GltfKeyframeReducer::interpolate(reduced, reduced.values.constData() + span * comps,
+				reduced.values.constData() + (span + 1) * comps, dt > 0.0f ? (time - t0) / dt : 0.0f, value);
+		}
+		maxError = qMax(maxError, GltfKeyframeReducer::keyError(original, value, original.values.constData() + k * comps));
+	}
+	return maxError;
+}
+
+// A 2 x 2 x 2 cube, each face its own UV island.  With bOpenTop the +Y
+// face is left out.
+void UnitTest_DzGLTFExporter::buildCubeSnapshot(GltfMeshSnapshot& snap, bool bOpenTop)
+{
+	static const float corners[4][2] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+
+	snap = GltfMeshSnapshot();
+	snap.name = "UnitTestCube";
+	for (int v = 0; v < 8; v++)
+	{
+		snap.positions.append((v & 1) ? 1.0f : -1.0f);
+		snap.positions.append((v & 2) ? 1.0f : -1.0f);
+		snap.positions.append((v & 4) ? 1.0f : -1.0f);
+	}
+	for (int f = 0; f < 6; f++)
+	{
+		if (bOpenTop && f == 3)
+			continue;
+		for (int k = 0; k < 4; k++)
+		{
+			snap.facetVerts.append(kCubeFaces[f][k]);
+			snap.facetUVs.append(snap.uvs.size() / 2);
+			snap.uvs.append(corners[k][0]);
+			snap.uvs.append(corners[k][1]);
+		}
+	}
+}
+
+// The same cube as two triangles a face, scaled to fHalfSize, its 12
+// triangles in face order with flat normals.
+void UnitTest_DzGLTFExporter::buildBoxPrim(GltfPrimData& prim, float fHalfSize, const QString& sMaterial)
+{
+	static const int triangles[6] = { 0, 1, 2, 0, 2, 3 };
+
+	prim = GltfPrimData();
+	prim.materialName = sMaterial;
+	for (int f = 0; f < 6; f++)
+	{
+		for (int k = 0; k < 6; k++)
+		{
+			int v = kCubeFaces[f][triangles[k]];
+			prim.positions << ((v & 1) ? fHalfSize : -fHalfSize)
+				<< ((v & 2) ? fHalfSize : -fHalfSize)
+				<< ((v & 4) ? fHalfSize : -fHalfSize);
+			prim.normals << (f == 0 ? -1.0f : f == 1 ? 1.0f : 0.0f)
+				<< (f == 2 ? -1.0f : f == 3 ? 1.0f : 0.0f)
+				<< (f == 4 ? -1.0f : f == 5 ? 1.0f : 0.0f);
+			prim.texcoords << 0.0f << 0.0f;
+		}
+	}
+}
+
+QString UnitTest_DzGLTFExporter::tempPath(const QString& fileName)
+{
+	return QDir::temp().filePath("UnitTest_DzGLTFExporter_" + fileName);
+}
+
+bool UnitTest_DzGLTFExporter::writeReference(const GltfSceneData& scene, const QString& path)
+{
+	GltfGlbWriter writer;
+	return writer.write(scene, QVector<GltfAnimChannel>(), path);
+}
+
+bool UnitTest_DzGLTFExporter::matchesReference(const QString& referencePath, const QString& path)
+{
+	QStringList differences;
+	if (GltfEquivalence::compareFiles(referencePath, path, GltfEquivalenceOptions(), differences))
+		return true;
+	for (int i = 0; i < differences.size(); i++)
+		dzApp->log("UnitTest_DzGLTFExporter: " + differences[i]);
+	return false;
+}
+
+bool UnitTest_DzGLTFExporter::_DzGLTFExporter(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	TRY_METHODCALL(delete new DzGLTFExporter());
+	return bResult;
+}
+
+bool UnitTest_DzGLTFExporter::writeToBufferMatchesWrite(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	GltfSceneData scene;
+	buildSyntheticScene(scene);
+	QString referencePath = tempPath("reference.glb");
+	QString bufferPath = tempPath("buffer.glb");
+
+	QByteArray glb;
+	GltfGlbWriter writer;
+	bResult = writeReference(scene, referencePath)
+		&& writer.writeToBuffer(scene, QVector<GltfAnimChannel>(), glb);
+
+	QFile file(bufferPath);
+	bResult = bResult && file.open(QIODevice::WriteOnly) && file.write(glb) == glb.size();
+	file.close();
+	bResult = bResult && matchesReference(referencePath, bufferPath);
+
+	QFile::remove(referencePath);
+	QFile::remove(bufferPath);
+	return bResult;
+}
+
+bool UnitTest_DzGLTFExporter::splitBuffersMatchGlb(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	GltfSceneData scene;
+	buildSyntheticScene(scene);
+	QString referencePath = tempPath("reference.glb");
+	QString splitPath = tempPath("split.gltf");
+
+	// Small cap, so geometry spreads over several .bin files.
+	GltfGlbWriter writer;
+	writer.setSplitBuffers(true);
+	writer.setMaxBufferBytes(64 * 1024);
+	bResult = writeReference(scene, referencePath)
+		&& writer.write(scene, QVector<GltfAnimChannel>(), splitPath)
+		&& matchesReference(referencePath, splitPath);
+
+	QFile::remove(referencePath);
+	QFile::remove(splitPath);
+	QStringList bins = QDir::temp().entryList(QStringList("UnitTest_DzGLTFExporter_split_*.bin"));
+	for (int i = 0; i < bins.size(); i++)
+		QFile::remove(QDir::temp().filePath(bins[i]));
+	return bResult;
+}
+
+bool UnitTest_DzGLTFExporter::incrementalUpdateMatchesFullWrite(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	GltfSceneData scene;
+	buildSyntheticScene(scene);
+	QString referencePath = tempPath("reference.glb");
+	QString patchedPath = tempPath("patched.glb");
+
+	GltfGlbWriter writer;
+	writer.setIncrementalUpdate(true);
+	bResult = writer.write(scene, QVector<GltfAnimChannel>(), patchedPath);
+
+	// Same layout and JSON, one primitive's UVs shifted (UV accessors carry
+	// no min/max): the second write patches in place.
+	float* texcoords = scene.prims[0].texcoords.data();
+	for (int i = 0; i < scene.prims[0].texcoords.size(); i += 2)
+		texcoords[i] += 0.01f;
+	bResult = bResult
+		&& writer.write(scene, QVector<GltfAnimChannel>(), patchedPath)
+		&& writer.getLastWriteIncremental()
+		&& writeReference(scene, referencePath)
+		&& matchesReference(referencePath, patchedPath);
+
+	QFile::remove(referencePath);
+	QFile::remove(patchedPath);
+	QFile::remove(QDir::temp().filePath(".UnitTest_DzGLTFExporter_patched.glb.idx"));
+	return bResult;
+}
+
+bool UnitTest_DzGLTFExporter::reorderedTrianglesAreEquivalent(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	GltfSceneData scene;
+	buildSyntheticScene(scene);
+	QString referencePath = tempPath("reference.glb");
+	QString reorderedPath = tempPath("reordered.glb");
+	bResult = writeReference(scene, referencePath);
+
+	// Reverse the triangle order of every primitive and start each triangle
+	// at its second corner: different bytes, same meaning.
+	for (int p = 0; p < scene.prims.size(); p++)
+	{
+		GltfPrimData& prim = scene.prims[p];
+		GltfPrimData source = prim;
+		int corners = prim.positions.size() / 3;
+		for (int c = 0; c < corners; c++)
+		{
+			int tri = c / 3;
+			int from = (corners / 3 - 1 - tri) * 3 + (c % 3 + 1) % 3;
+			for (int k = 0; k < 3; k++)
+			{
+				prim.positions[c * 3 + k] = source.positions[from * 3 + k];
+				prim.normals[c * 3 + k] = source.normals[from * 3 + k];
+			}
+			for (int k = 0; k < 2; k++)
+				prim.texcoords[c * 2 + k] = source.texcoords[from * 2 + k];
+			for (int k = 0; k < 4 && !prim.joints.isEmpty(); k++)
+			{
+				prim.joints[c * 4 + k] = source.joints[from * 4 + k];
+				prim.weights[c * 4 + k] = source.weights[from * 4 + k];
+			}
+		}
+	}
+	bResult = bResult
+		&& writeReference(scene, reorderedPath)
+		&& matchesReference(referencePath, reorderedPath);
+
+	QFile::remove(referencePath);
+	QFile::remove(reorderedPath);
+	return bResult;
+}
+
+bool UnitTest_DzGLTFExporter::movedVertexIsDetected(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	GltfSceneData scene;
+	buildSyntheticScene(scene);
+	QString referencePath = tempPath("reference.glb");
+	QString movedPath = tempPath("moved.glb");
+	bResult = writeReference(scene, referencePath);
+
+	// One corner, well past the position tolerance.
+	scene.prims[0].positions[0] += 0.01f;
+	bResult = bResult && writeReference(scene, movedPath);
+
+	QStringList differences;
+	bResult = bResult
+		&& !GltfEquivalence::compareFiles(referencePath, movedPath, GltfEquivalenceOptions(), differences)
+		&& !differences.isEmpty();
+
+	QFile::remove(referencePath);
+	QFile::remove(movedPath);
+	return bResult;
+}
+
+// A morph dial lives on a modifier of the object, not on the node or its
+// base mesh; turning it must still change the content hash, or a resend
+// is skipped as unchanged.
+bool UnitTest_DzGLTFExporter::morphValueChangesContentHash(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	DzNode* pNode = new DzNode();
+	DzObject* pObject = new DzObject();
+	DzMorph* pMorph = new DzMorph();
+	pMorph->setName("UnitTestMorph");
+	pObject->addModifier(pMorph);
+	pNode->setObject(pObject);
+
+	QVector<DzNode*> aRoots;
+	aRoots.append(pNode);
+	DzGLTFExporter exporter;
+	quint64 nBefore = 0, nSame = 0, nAfter = 0;
+	exporter.hashSceneContent(aRoots, nBefore);
+	exporter.hashSceneContent(aRoots, nSame);
+	pMorph->getValueControl()->setValue(0.5f);
+	exporter.hashSceneContent(aRoots, nAfter);
+	bResult = (nBefore == nSame) && (nBefore != nAfter);
+
+	delete pNode;
+	return bResult;
+}
+
+
+// Ten seconds of a walk with a slight bob, and a turn that speeds up:
+// every key the reducer drops must come back from the keys either side of
+// it within the tolerance.
+bool UnitTest_DzGLTFExporter::keyReductionStaysWithinTolerance(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	GltfAnimChannel translation;
+	translation.node = 0;
+	translation.path = GltfAnimChannel::Translation;
+	GltfAnimChannel rotation;
+	rotation.node = 0;
+	rotation.path = GltfAnimChannel::Rotation;
+	for (int k = 0; k < 300; k++)
+	{
+		float time = k / 30.0f;
+		translation.times.append(time);
+		translation.values.append(0.5f * time);
+		translation.values.append(0.01f * std::sin(time));
+		translation.values.append(0.0f);
+		float angle = 0.05f * time * time;
+		rotation.times.append(time);
+		rotation.values.append(0.0f);
+		rotation.values.append(std::sin(0.5f * angle));
+		rotation.values.append(0.0f);
+		rotation.values.append(std::cos(0.5f * angle));
+	}
+
+	GltfKeyframeReducer reducer;
+	GltfAnimChannel reducedTranslation = translation;
+	GltfAnimChannel reducedRotation = rotation;
+	bResult = reducer.reduceChannel(reducedTranslation)
+		&& reducer.reduceChannel(reducedRotation)
+		&& reducedTranslation.keyCount() < translation.keyCount()
+		&& reducedRotation.keyCount() < rotation.keyCount()
+		&& maxReductionError(translation, reducedTranslation) <= reducer.toleranceFor(translation)
+		&& maxReductionError(rotation, reducedRotation) <= reducer.toleranceFor(rotation);
+	return bResult;
+}
+
+// 16 bits over [-1/sqrt2, 1/sqrt2] per component: a packed rotation comes
+// back within about 2e-5 per component, up to the sign of the whole
+// quaternion, whichever component is the largest.
+bool UnitTest_DzGLTFExporter::smallestThreeRoundTrips(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	for (int i = 0; i < 64 && bResult; i++)
+	{
+		float q[4] = { std::sin(i * 0.7f), std::cos(i * 1.3f), std::sin(i * 2.1f + 0.5f), std::cos(i * 0.3f) - 0.5f };
+		float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		for (int c = 0; c < 4; c++)
+			q[c] /= length;
+
+		float unpacked[4];
+		GltfKeyframeReducer::unpackSmallestThree(GltfKeyframeReducer::packSmallestThree(q), unpacked);
+		float dot = q[0] * unpacked[0] + q[1] * unpacked[1] + q[2] * unpacked[2] + q[3] * unpacked[3];
+		float sign = dot < 0.0f ? -1.0f : 1.0f;
+		for (int c = 0; c < 4; c++)
+			bResult = bResult && std::fabs(q[c] - sign * unpacked[c]) < 1.0e-4f;
+	}
+	return bResult;
+}
+
+
+// A take three windows long, whose root walks in a straight line long
+// enough to hit the span cap: writeStreamed() must give the bytes of the
+// in-memory GLB with the same channels reduced in one go.
+bool UnitTest_DzGLTFExporter::streamedAnimationMatchesInMemory(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	GltfSceneData scene;
+	buildSyntheticScene(scene);
+
+	const int nFrames = 700;
+	const int nWindowFrames = 256;
+	QVector<GltfAnimChannel> channels;
+	for (int n = 0; n < 4; n++)
+	{
+		GltfAnimChannel channel;
+		channel.node = n;
+		channel.path = (n == 0) ? GltfAnimChannel::Translation : GltfAnimChannel::Rotation;
+		for (int f = 0; f < nFrames; f++)
+		{
+			float time = f / 30.0f;
+			channel.times.append(time);
+			if (n == 0)
+			{
+				channel.values.append(0.5f * time);
+				channel.values.append(0.0f);
+				channel.values.append(0.0f);
+			}
+			else
+			{
+				float angle = 0.3f * n * std::sin(time / n);
+				channel.values.append(std::sin(0.5f * angle));
+				channel.values.append(0.0f);
+				channel.values.append(0.0f);
+				channel.values.append(std::cos(0.5f * angle));
+			}
+		}
+		channels.append(channel);
+	}
+
+	QString streamedPath = tempPath("streamed.glb");
+	GltfAnimationStream stream;
+	bResult = stream.begin(channels, tempPath("streamed.scratch"));
+	for (int nFirst = 0; nFirst < nFrames && bResult; nFirst += nWindowFrames)
+	{
+		int nCount = qMin(nWindowFrames, nFrames - nFirst);
+		QVector< QVector<float> > values(channels.size());
+		for (int c = 0; c < channels.size(); c++)
+		{
+			int comps = channels[c].componentCount();
+			values[c] = channels[c].values.mid(nFirst * comps, nCount * comps);
+		}
+		bResult = stream.appendWindow(channels[0].times.mid(nFirst, nCount), values);
+	}
+	GltfGlbWriter writer;
+	bResult = bResult && stream.finish() && writer.writeStreamed(scene, stream, streamedPath);
+
+	QVector<GltfAnimChannel> reduced = channels;
+	GltfKeyframeReducer reducer;
+	reducer.reduce(reduced);
+	QByteArray glb;
+	bResult = bResult && writer.writeToBuffer(scene, reduced, glb);
+
+	QFile file(streamedPath);
+	bResult = bResult && file.open(QIODevice::ReadOnly) && file.readAll() == glb;
+	file.close();
+
+	QFile::remove(streamedPath);
+	return bResult;
+}
+
+
+// Each group takes its faces from its own level: the top at level 2 gives
+// 16 quads, the five sides at level 1 give 20.  The corners are rounded
+// off, so no refined vertex is anywhere near one.
+bool UnitTest_DzGLTFExporter::subdividedCubeRefinesPerGroup(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	GltfMeshSnapshot cube;
+	buildCubeSnapshot(cube, false);
+	GltfMeshSnapshot::Group top;
+	top.faces.append(3);
+	top.subdivLevel = 2;
+	GltfMeshSnapshot::Group sides;
+	sides.faces << 0 << 1 << 2 << 4 << 5;
+	sides.subdivLevel = 1;
+	cube.groups << top << sides;
+
+	GltfMeshSnapshot refined;
+	bResult = GltfSubdivider::refine(cube, refined)
+		&& refined.groups.size() == 2
+		&& refined.groups[0].faces.size() == 16
+		&& refined.groups[1].faces.size() == 20
+		&& refined.groups[0].subdivLevel == 0
+		&& refined.groups[1].subdivLevel == 0
+		&& refined.facetVerts.size() == 36 * 4;
+	for (int i = 0; i < refined.facetVerts.size() && bResult; i++)
+	{
+		int v = refined.facetVerts[i];
+		bResult = v >= 0 && v < refined.vertexCount()
+			&& std::fabs(refined.positions[v * 3]) + std::fabs(refined.positions[v * 3 + 1])
+				+ std::fabs(refined.positions[v * 3 + 2]) < 2.0f;
+	}
+	return bResult;
+}
+
+// An open box: the rim is a mesh border and stays on its plane, its four
+// corners and four edges giving the 8 rim vertices of level 1, while every
+// face's UV island, a seam all round, keeps its corners and refines to the
+// halves of its square.
+bool UnitTest_DzGLTFExporter::subdividedOpenBoxKeepsBorders(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	GltfMeshSnapshot box;
+	buildCubeSnapshot(box, true);
+	GltfMeshSnapshot::Group all;
+	all.faces << 0 << 1 << 2 << 3 << 4;
+	all.subdivLevel = 1;
+	box.groups << all;
+
+	GltfMeshSnapshot refined;
+	bResult = GltfSubdivider::refine(box, refined)
+		&& refined.groups.size() == 1
+		&& refined.groups[0].faces.size() == 20;
+
+	QSet<int> rim;
+	for (int i = 0; i < refined.facetVerts.size() && bResult; i++)
+	{
+		float y = refined.positions[refined.facetVerts[i] * 3 + 1];
+		bResult = y <= 1.0f + 1.0e-6f;
+		if (y >= 1.0f - 1.0e-6f)
+			rim.insert(refined.facetVerts[i]);
+	}
+	bResult = bResult && rim.size() == 8;
+
+	for (int i = 0; i < refined.facetUVs.size() && bResult; i++)
+	{
+		for (int k = 0; k < 2 && bResult; k++)
+		{
+			float uv = refined.uvs[refined.facetUVs[i] * 2 + k];
+			bResult = std::fabs(uv) < 1.0e-6f || std::fabs(uv - 0.5f) < 1.0e-6f
+				|| std::fabs(uv - 1.0f) < 1.0e-6f;
+		}
+	}
+	return bResult;
+}
+
+
+// A rippled 24 x 24 grid split into two UV islands down its middle.  Each
+// LOD hits its triangle target, no triangle bridges the islands, and all
+// 25 seam vertices survive on both sides of the seam.
+bool UnitTest_DzGLTFExporter::simplifiedGridKeepsUVSeam(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	const int nCells = 24;
+	static const int corners[6][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 0 }, { 1, 1 }, { 0, 1 } };
+	GltfPrimData grid;
+	for (int y = 0; y < nCells; y++)
+	{
+		for (int x = 0; x < nCells; x++)
+		{
+			float fIsland = (x < nCells / 2) ? 0.0f : 0.5f;
+			for (int k = 0; k < 6; k++)
+			{
+				int gx = x + corners[k][0];
+				int gy = y + corners[k][1];
+				grid.positions << float(gx) << 0.25f * std::sin(gx * 0.5f) * std::cos(gy * 0.3f) << float(gy);
+				grid.normals << 0.0f << 1.0f << 0.0f;
+				grid.texcoords << gx * 0.5f / nCells + fIsland << float(gy) / nCells;
+			}
+		}
+	}
+	int nSourceTriangles = grid.positions.size() / 9;
+
+	QVector<float> ratios;
+	ratios << 0.5f << 0.25f;
+	QVector<GltfPrimData> lods = GltfMeshSimplifier::simplifyChain(grid, ratios);
+	bResult = lods.size() == ratios.size();
+	for (int i = 0; i < lods.size() && bResult; i++)
+	{
+		const GltfPrimData& lod = lods[i];
+		int nTriangles = lod.positions.size() / 9;
+		bResult = nTriangles > 0 && nTriangles <= int(nSourceTriangles * ratios[i]);
+
+		QSet<int> leftSeam, rightSeam;
+		for (int t = 0; t < nTriangles && bResult; t++)
+		{
+			bool bLeft = false, bRight = false;
+			for (int k = 0; k < 3; k++)
+			{
+				int corner = t * 3 + k;
+				float u = lod.texcoords[corner * 2];
+				bLeft = bLeft || u < 0.5f - 1.0e-6f;
+				bRight = bRight || u > 0.5f + 1.0e-6f;
+				if (lod.positions[corner * 3] != float(nCells / 2))
+					continue;
+				int gy = int(lod.positions[corner * 3 + 2]);
+				if (std::fabs(u - 0.25f) < 1.0e-6f)
+					leftSeam.insert(gy);
+				else if (std::fabs(u - 0.75f) < 1.0e-6f)
+					rightSeam.insert(gy);
+			}
+			bResult = !(bLeft && bRight);
+		}
+		bResult = bResult && leftSeam.size() == nCells + 1 && rightSeam.size() == nCells + 1;
+	}
+	return bResult;
+}
+
+
+// A body box inside a shirt box is hidden, a hair box round the shirt is
+// not; culling moves the body into its own _Hidden primitive.  With the
+// shirt's top cut away the body's top shows through, its bottom does not.
+bool UnitTest_DzGLTFExporter::enclosedBoxIsCulled(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	GltfPrimData shirt, body, hair;
+	buildBoxPrim(shirt, 1.2f, "Shirt");
+	buildBoxPrim(body, 1.0f, "Skin");
+	buildBoxPrim(hair, 1.5f, "Hair");
+
+	GltfOcclusionCuller culler;
+	culler.addOccluder(shirt);
+	QVector<GltfPrimData> prims;
+	prims << body << hair;
+	QVector<bool> hidden = culler.findHidden(prims);
+	bResult = hidden.size() == 24;
+	for (int t = 0; t < hidden.size() && bResult; t++)
+		bResult = hidden[t] == (t < 12);
+
+	bResult = bResult && GltfOcclusionCuller::removeHidden(prims, hidden, true) == 12
+		&& prims.size() == 2
+		&& prims[0].materialName == "Hair" && prims[0].positions.size() == 12 * 9
+		&& prims[1].materialName == "Skin_Hidden" && prims[1].positions.size() == 12 * 9;
+
+	// face 3, the top, is triangles 6 and 7; face 2, the bottom, 4 and 5
+	GltfPrimData openShirt;
+	for (int i = 0; i < shirt.positions.size(); i++)
+	{
+		if (i / 18 != 3)
+		{
+			openShirt.positions.append(shirt.positions[i]);
+			openShirt.normals.append(shirt.normals[i]);
+		}
+	}
+	GltfOcclusionCuller openCuller;
+	openCuller.addOccluder(openShirt);
+	QVector<GltfPrimData> bodyOnly;
+	bodyOnly << body;
+	hidden = openCuller.findHidden(bodyOnly);
+	bResult = bResult && hidden.size() == 12
+		&& !hidden[6] && !hidden[7] && hidden[4] && hidden[5];
+	return bResult;
+}
+
+
+// A released block comes back for the next request of its size class
+// instead of a fresh allocation; trim() frees the largest held blocks
+// first, down to what it is told to keep.
+bool UnitTest_DzGLTFExporter::bufferPoolReusesBlocks(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	const int nSmall = GltfBufferPool::kMinBlockBytes;
+	const int nLarge = GltfBufferPool::kMinBlockBytes * 2;
+	GltfBufferPool pool;
+
+	QByteArray small = pool.acquire(1000);
+	QByteArray large = pool.acquire(nSmall + 1);
+	GltfBufferPoolStats stats = pool.stats();
+	bResult = small.size() == nSmall && large.size() == nLarge
+		&& stats.allocations == 2 && stats.bytesInUse == nSmall + nLarge && stats.bytesHeld == 0;
+
+	pool.release(small);
+	stats = pool.stats();
+	bResult = bResult && small.isEmpty()
+		&& stats.bytesInUse == nLarge && stats.bytesHeld == nSmall;
+
+	QByteArray reused = pool.acquire(5000);
+	stats = pool.stats();
+	bResult = bResult && reused.size() == nSmall
+		&& stats.acquires == 3 && stats.allocations == 2 && stats.bytesHeld == 0;
+
+	pool.release(reused);
+	pool.release(large);
+	stats = pool.stats();
+	bResult = bResult && stats.bytesInUse == 0 && stats.bytesHeld == nSmall + nLarge
+		&& stats.peakBytes == nSmall + nLarge && stats.bytesAllocated == nSmall + nLarge;
+
+	// the large block goes first, so the next large request allocates again
+	pool.trim(nSmall);
+	bResult = bResult && pool.stats().bytesHeld == nSmall;
+	large = pool.acquire(nLarge);
+	bResult = bResult && pool.stats().allocations == 3;
+
+	pool.release(large);
+	pool.trim();
+	stats = pool.stats();
+	bResult = bResult && stats.bytesHeld == 0 && stats.bytesInUse == 0;
+	return bResult;
+}
+
+
+#include "moc_UnitTest_DzGLTFExporter.cpp"
+
+#endif
\ No newline at end of file
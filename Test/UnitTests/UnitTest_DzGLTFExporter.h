@@ -0,0 +1,49 @@
+#pragma once
+#ifdef UNITTEST_DZBRIDGE
+
+#include <QObject>
+#include "UnitTest.h"
+
+struct GltfSceneData;
+struct GltfAnimChannel;
+struct GltfMeshSnapshot;
+struct GltfPrimData;
+
+// Checks the glTF writer's faster paths against its reference output
+// (GltfGlbWriter::write() to a single GLB) with GltfEquivalence, and that
+// the checker itself tells meaning from bytes.
+class UnitTest_DzGLTFExporter : public UnitTest {
+	Q_OBJECT
+public:
+	UnitTest_DzGLTFExporter();
+	bool runUnitTests();
+
+private:
+	bool _DzGLTFExporter(UnitTest::TestResult* testResult);
+	bool writeToBufferMatchesWrite(UnitTest::TestResult* testResult);
+	bool splitBuffersMatchGlb(UnitTest::TestResult* testResult);
+	bool incrementalUpdateMatchesFullWrite(UnitTest::TestResult* testResult);
+	bool reorderedTrianglesAreEquivalent(UnitTest::TestResult* testResult);
+	bool movedVertexIsDetected(UnitTest::TestResult* testResult);
+	bool morphValueChangesContentHash(UnitTest::TestResult* testResult);
+	bool keyReductionStaysWithinTolerance(UnitTest::TestResult* testResult);
+	bool smallestThreeRoundTrips(UnitTest::TestResult* testResult);
+	bool streamedAnimationMatchesInMemory(UnitTest::TestResult* testResult);
+	bool subdividedCubeRefinesPerGroup(UnitTest::TestResult* testResult);
+	bool subdividedOpenBoxKeepsBorders(UnitTest::TestResult* testResult);
+	bool simplifiedGridKeepsUVSeam(UnitTest::TestResult* testResult);
+	bool enclosedBoxIsCulled(UnitTest::TestResult* testResult);
+	bool bufferPoolReusesBlocks(UnitTest::TestResult* testResult);
+
+	static void buildSyntheticScene(GltfSceneData& scene);
+	static QString tempPath(const QString& fileName);
+	static bool writeReference(const GltfSceneData& scene, const QString& path);
+	static bool matchesReference(const QString& referencePath, const QString& path);
+	static void buildCubeSnapshot(GltfMeshSnapshot& snap, bool bOpenTop);
+	static void buildBoxPrim(GltfPrimData& prim, float fHalfSize, const QString& sMaterial);
+	static float maxReductionError(const GltfAnimChannel& original, const GltfAnimChannel& reduced);
+
+};
+
+
+#endif
\ No newline at end of file
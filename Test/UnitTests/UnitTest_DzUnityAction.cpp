@@ -20,6 +20,9 @@ bool UnitTest_DzUnityAction::runUnitTests()
 	RUNTEST(setExportOptions);
 	RUNTEST(createUnityFiles);
 	RUNTEST(readGuiRootFolder);
+	RUNTEST(getLastExportSeconds);
+	RUNTEST(getLastExportStats);
+	RUNTEST(exportBatch);
 
 	return true;
 }
@@ -88,6 +91,27 @@ bool UnitTest_DzUnityAction::readGuiRootFolder(UnitTest::TestResult* testResult)
 	return bResult;
 }
 
+bool UnitTest_DzUnityAction::getLastExportSeconds(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	TRY_METHODCALL(qobject_cast<DzUnityAction*>(m_testObject)->getLastExportSeconds());
+	return bResult;
+}
+
+bool UnitTest_DzUnityAction::getLastExportStats(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	TRY_METHODCALL(qobject_cast<DzUnityAction*>(m_testObject)->getLastExportStats());
+	return bResult;
+}
+
+bool UnitTest_DzUnityAction::exportBatch(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	TRY_METHODCALL(qobject_cast<DzUnityAction*>(m_testObject)->exportBatch(""));
+	return bResult;
+}
+
 
 #include "moc_UnitTest_DzUnityAction.cpp"
 
@@ -20,6 +20,9 @@ private:
 	bool setExportOptions(UnitTest::TestResult* testResult);
 	bool createUnityFiles(UnitTest::TestResult* testResult);
 	bool readGuiRootFolder(UnitTest::TestResult* testResult);
+	bool getLastExportSeconds(UnitTest::TestResult* testResult);
+	bool getLastExportStats(UnitTest::TestResult* testResult);
+	bool exportBatch(UnitTest::TestResult* testResult);
 
 };
 
@@ -17,6 +17,7 @@ bool UnitTest_DzUnityDialog::runUnitTests()
 	RUNTEST(loadSavedSettings);
 	RUNTEST(HandleSelectAssetsFolderButton);
 	RUNTEST(HandleInstallUnityFilesCheckBoxChange);
+	RUNTEST(HandleQueueSendsCheckBoxChange);
 	RUNTEST(HandleAssetTypeComboChange);
 	RUNTEST(HandleAssetFolderChanged);
 
@@ -65,6 +66,13 @@ bool UnitTest_DzUnityDialog::HandleInstallUnityFilesCheckBoxChange(UnitTest::Tes
 	return bResult;
 }
 
+bool UnitTest_DzUnityDialog::HandleQueueSendsCheckBoxChange(UnitTest::TestResult* testResult)
+{
+	bool bResult = true;
+	TRY_METHODCALL(qobject_cast<DzUnityDialog*>(m_testObject)->HandleQueueSendsCheckBoxChange(0));
+	return bResult;
+}
+
 bool UnitTest_DzUnityDialog::HandleAssetTypeComboChange(UnitTest::TestResult* testResult)
 {
 	bool bResult = true;
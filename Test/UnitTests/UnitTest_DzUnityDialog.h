@@ -17,6 +17,7 @@ private:
 	bool loadSavedSettings(UnitTest::TestResult* testResult);
 	bool HandleSelectAssetsFolderButton(UnitTest::TestResult* testResult);
 	bool HandleInstallUnityFilesCheckBoxChange(UnitTest::TestResult* testResult);
+	bool HandleQueueSendsCheckBoxChange(UnitTest::TestResult* testResult);
 	bool HandleAssetTypeComboChange(UnitTest::TestResult* testResult);
 	bool HandleAssetFolderChanged(UnitTest::TestResult* testResult);
 